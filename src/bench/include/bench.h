@@ -0,0 +1,74 @@
+#ifndef BTCLITE_BENCH_H
+#define BTCLITE_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+
+namespace btclite {
+namespace bench {
+
+// Heap allocations made by the whole process, counted by the replaced global
+// operator new in bench.cpp.
+struct AllocStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+AllocStats GetAllocStats();
+
+
+class State {
+public:
+    explicit State(uint64_t num_iters);
+
+    //-------------------------------------------------------------------------
+    // Usage: while (state.KeepRunning()) { ... }
+    bool KeepRunning();
+
+    // Report a user defined value next to the timing results.
+    void SetCounter(const std::string& name, double value);
+
+    //-------------------------------------------------------------------------
+    uint64_t num_iters() const;
+    std::chrono::nanoseconds elapsed() const;
+    const AllocStats& allocs() const;
+    const std::map<std::string, double>& counters() const;
+
+private:
+    uint64_t num_iters_;
+    uint64_t count_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::nanoseconds elapsed_;
+    AllocStats start_allocs_;
+    AllocStats allocs_;
+    std::map<std::string, double> counters_;
+};
+
+using BenchFunction = std::function<void(State&)>;
+
+class BenchRunner {
+public:
+    BenchRunner(const std::string& name, BenchFunction func, uint64_t num_iters);
+
+    // Run every registered benchmark whose name contains filter.
+    static void RunAll(const std::string& filter);
+
+private:
+    using BenchMap = std::map<std::string, std::pair<BenchFunction, uint64_t> >;
+
+    static BenchMap& benchmarks();
+};
+
+} // namespace bench
+} // namespace btclite
+
+// BENCHMARK(function, iterations) registers a benchmark.
+#define BENCHMARK(func, num_iters) \
+    static btclite::bench::BenchRunner bench_##func(#func, func, num_iters);
+
+#endif // BTCLITE_BENCH_H
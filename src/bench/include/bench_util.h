@@ -0,0 +1,27 @@
+#ifndef BTCLITE_BENCH_UTIL_H
+#define BTCLITE_BENCH_UTIL_H
+
+#include "block.h"
+
+
+namespace btclite {
+namespace bench {
+
+// Build a block of num_txs synthetic transactions with P2PKH-sized scripts.
+// Inputs reference distinct outpoints so every transaction hash differs.
+// With witness set the inputs spend P2WPKH instead: an empty script_sig and
+// a signature and public key on the witness stack.
+consensus::Block CreateBenchBlock(size_t num_txs, size_t inputs_per_tx = 2,
+                                  size_t outputs_per_tx = 2, bool witness = false);
+
+// Resident set size of this process in bytes, 0 where /proc is unavailable.
+size_t ResidentMemory();
+
+// Peak resident set size of this process in bytes, 0 where /proc is
+// unavailable.
+size_t PeakResidentMemory();
+
+} // namespace bench
+} // namespace btclite
+
+#endif // BTCLITE_BENCH_UTIL_H
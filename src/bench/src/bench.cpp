@@ -0,0 +1,184 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+
+namespace {
+
+std::atomic<uint64_t> g_alloc_count(0);
+std::atomic<uint64_t> g_alloc_bytes(0);
+
+} // namespace
+
+void *operator new(size_t size)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+// std::pmr's default resource allocates through the aligned forms.
+void *operator new(size_t size, std::align_val_t align)
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void *p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+
+namespace btclite {
+namespace bench {
+
+AllocStats GetAllocStats()
+{
+    AllocStats stats;
+    stats.count = g_alloc_count.load(std::memory_order_relaxed);
+    stats.bytes = g_alloc_bytes.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+State::State(uint64_t num_iters)
+    : num_iters_(num_iters ? num_iters : 1), count_(0), start_(),
+      elapsed_(0), start_allocs_(), allocs_(), counters_()
+{
+}
+
+bool State::KeepRunning()
+{
+    if (count_ == 0) {
+        start_allocs_ = GetAllocStats();
+        start_ = std::chrono::steady_clock::now();
+    }
+    else if (count_ == num_iters_) {
+        elapsed_ = std::chrono::steady_clock::now() - start_;
+        AllocStats end_allocs = GetAllocStats();
+        allocs_.count = end_allocs.count - start_allocs_.count;
+        allocs_.bytes = end_allocs.bytes - start_allocs_.bytes;
+        return false;
+    }
+
+    ++count_;
+    return true;
+}
+
+void State::SetCounter(const std::string& name, double value)
+{
+    counters_[name] = value;
+}
+
+uint64_t State::num_iters() const
+{
+    return num_iters_;
+}
+
+std::chrono::nanoseconds State::elapsed() const
+{
+    return elapsed_;
+}
+
+const AllocStats& State::allocs() const
+{
+    return allocs_;
+}
+
+const std::map<std::string, double>& State::counters() const
+{
+    return counters_;
+}
+
+BenchRunner::BenchRunner(const std::string& name, BenchFunction func, uint64_t num_iters)
+{
+    benchmarks().emplace(name, std::make_pair(func, num_iters));
+}
+
+void BenchRunner::RunAll(const std::string& filter)
+{
+    std::cout << "# Benchmark, iterations, ns/op, allocs/op, alloc_bytes/op, counters\n";
+    for (const auto& it : benchmarks()) {
+        if (it.first.find(filter) == std::string::npos)
+            continue;
+
+        State state(it.second.second);
+        it.second.first(state);
+
+        double iters = static_cast<double>(state.num_iters());
+        std::cout << it.first << ", " << state.num_iters() << ", "
+                  << std::fixed << std::setprecision(1)
+                  << state.elapsed().count() / iters << ", "
+                  << state.allocs().count / iters << ", "
+                  << state.allocs().bytes / iters;
+        for (const auto& counter : state.counters()) {
+            std::cout << ", " << counter.first << "=" << counter.second;
+        }
+        std::cout << std::endl;
+    }
+}
+
+BenchRunner::BenchMap& BenchRunner::benchmarks()
+{
+    static BenchMap benchmarks_map;
+    return benchmarks_map;
+}
+
+} // namespace bench
+} // namespace btclite
@@ -0,0 +1,30 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <glog/logging.h>
+
+#include "bench.h"
+
+
+int main(int argc, char **argv)
+{
+    std::string filter;
+
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = 1;
+    FLAGS_v = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "-filter=", 8) == 0) {
+            filter = argv[i] + 8;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [-filter=<name substring>]\n";
+            return 1;
+        }
+    }
+
+    btclite::bench::BenchRunner::RunAll(filter);
+
+    return 0;
+}
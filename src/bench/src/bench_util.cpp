@@ -0,0 +1,80 @@
+#include "bench_util.h"
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+
+namespace btclite {
+namespace bench {
+
+consensus::Block CreateBenchBlock(size_t num_txs, size_t inputs_per_tx,
+                                  size_t outputs_per_tx, bool witness)
+{
+    using namespace consensus;
+    
+    std::vector<TransactionRef> transactions;
+    transactions.reserve(num_txs);
+    
+    for (size_t i = 0; i < num_txs; i++) {
+        std::pmr::vector<TxIn> inputs;
+        std::pmr::vector<TxOut> outputs;
+        
+        for (size_t j = 0; j < inputs_per_tx; j++) {
+            util::Hash256 prev_hash;
+            prev_hash.fill(0);
+            std::memcpy(prev_hash.data(), &i, sizeof(i));
+            if (witness) {
+                ScriptWitness script_witness(std::vector<std::vector<uint8_t> >{
+                    std::vector<uint8_t>(72, static_cast<uint8_t>(j)),
+                    std::vector<uint8_t>(33, static_cast<uint8_t>(j)) });
+                inputs.emplace_back(OutPoint(prev_hash, static_cast<uint32_t>(j)), Script(),
+                                    TxIn::default_sequence_no, script_witness);
+                continue;
+            }
+            // 72 bytes signature + 33 bytes compressed public key
+            Script script_sig(std::vector<uint8_t>(107, static_cast<uint8_t>(j)));
+            inputs.emplace_back(OutPoint(prev_hash, static_cast<uint32_t>(j)), script_sig);
+        }
+        for (size_t j = 0; j < outputs_per_tx; j++) {
+            // OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG
+            Script script_pub_key(std::vector<uint8_t>(25, static_cast<uint8_t>(j)));
+            outputs.emplace_back(50000 + j, script_pub_key);
+        }
+        transactions.push_back(MakeTransactionRef(
+                                   Transaction(2, std::move(inputs), std::move(outputs), 0)));
+    }
+    
+    Block block(std::move(transactions));
+    BlockHeader header(1, util::Hash256(), block.ComputeMerkleRoot(), 1231006505,
+                       0x1d00ffff, 0);
+    block.set_header(header);
+    
+    return block;
+}
+
+size_t ResidentMemory()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident))
+        return 0;
+    
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+size_t PeakResidentMemory()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        // VmHWM:     12345 kB
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stoul(line.substr(6)) * 1024;
+    }
+    
+    return 0;
+}
+
+} // namespace bench
+} // namespace btclite
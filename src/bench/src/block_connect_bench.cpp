@@ -0,0 +1,201 @@
+#include "bench.h"
+
+#include <cstring>
+#include <random>
+
+#include "block_connector.h"
+#include "chain/include/params.h"
+#include "coins_db.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+const fs::path kBenchPath = fs::path("/tmp") / "block_connect_bench";
+
+// Blocks 1 to kSetupBlocks only seed and mature the coins; the next
+// kBlocks are the ones timed.
+constexpr uint32_t kSetupBlocks = 101;
+constexpr uint32_t kBlocks = 100;
+constexpr size_t kBlockTxs = 2000;
+constexpr size_t kSeedOutputs = 2 * kBlockTxs;
+constexpr size_t kTxInputs = 2;
+constexpr size_t kTxOutputs = 3;
+constexpr size_t kRecentOutputs = 20000;
+// small enough to be flushed every few blocks, so that inputs come from
+// the database as much as from the cache
+constexpr size_t kCacheSize = 16 << 20;
+
+struct Unspent {
+    consensus::OutPoint outpoint;
+    uint64_t value;
+};
+
+// OP_TRUE, the scripts cost next to nothing here
+consensus::Script BenchScript()
+{
+    consensus::Script script;
+    script.Push(consensus::Opcode::OP_TRUE);
+    return script;
+}
+
+consensus::Block MakeBlock(const consensus::Params& params, const util::Hash256& prev,
+                           uint32_t height, size_t coinbase_outputs, uint64_t fees,
+                           std::vector<consensus::TransactionRef>&& transactions)
+{
+    std::vector<uint8_t> script_sig(sizeof(height));
+    std::memcpy(script_sig.data(), &height, sizeof(height));
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(consensus::OutPoint(), consensus::Script(script_sig));
+    std::pmr::vector<consensus::TxOut> outputs;
+    const uint64_t value = params.BlockSubsidy(height) + fees;
+    for (size_t i = 0; i < coinbase_outputs; i++)
+        outputs.emplace_back(value / coinbase_outputs, BenchScript());
+    transactions.insert(transactions.begin(), consensus::MakeTransactionRef(
+                            consensus::Transaction(1, std::move(inputs), std::move(outputs), 0)));
+    
+    consensus::Block block(std::move(transactions));
+    block.set_header(consensus::BlockHeader(1, prev, block.ComputeMerkleRoot(),
+                                            1600000000 + height, 0x207fffff, 0));
+    return block;
+}
+
+// A valid chain on top of the mainnet genesis block. Block 1 pays its
+// coinbase to kSeedOutputs outputs, which block kSetupBlocks splits into
+// kTxOutputs each once they are mature. From then on every block has
+// kBlockTxs transactions of kTxInputs inputs, spending outputs of earlier
+// blocks, and kTxOutputs outputs.
+std::vector<consensus::Block> CreateBenchChain(const consensus::Params& params)
+{
+    std::mt19937_64 rng(1);
+    std::vector<consensus::Block> blocks;
+    std::vector<Unspent> unspent;
+    util::Hash256 prev = params.GenesisBlock().GetHash();
+    
+    for (uint32_t height = 1; height <= kSetupBlocks + kBlocks; height++) {
+        std::vector<consensus::TransactionRef> transactions;
+        std::vector<Unspent> created;
+        uint64_t fees = 0;
+    
+        const size_t txs = height < kSetupBlocks ? 0 :
+                           height == kSetupBlocks ? kSeedOutputs : kBlockTxs;
+        const size_t tx_inputs = height == kSetupBlocks ? 1 : kTxInputs;
+        for (size_t i = 0; i < txs; i++) {
+            std::pmr::vector<consensus::TxIn> inputs;
+            std::pmr::vector<consensus::TxOut> outputs;
+            uint64_t in_amount = 0;
+            for (size_t j = 0; j < tx_inputs; j++) {
+                size_t k;
+                if (height == kSetupBlocks) {
+                    k = unspent.size() - 1;
+                }
+                else {
+                    size_t window = (rng() & 1) ? std::min(unspent.size(), kRecentOutputs)
+                                                : unspent.size();
+                    k = unspent.size() - 1 - rng() % window;
+                }
+                inputs.emplace_back(unspent[k].outpoint, consensus::Script());
+                in_amount += unspent[k].value;
+                unspent[k] = unspent.back();
+                unspent.pop_back();
+            }
+            for (size_t j = 0; j < kTxOutputs; j++)
+                outputs.emplace_back(in_amount / kTxOutputs, BenchScript());
+            fees += in_amount % kTxOutputs;
+    
+            transactions.push_back(consensus::MakeTransactionRef(
+                consensus::Transaction(2, std::move(inputs), std::move(outputs), 0)));
+            const util::Hash256 txid = transactions.back()->GetHash();
+            for (uint32_t j = 0; j < kTxOutputs; j++)
+                created.push_back({ consensus::OutPoint(txid, j), in_amount / kTxOutputs });
+        }
+    
+        blocks.push_back(MakeBlock(params, prev, height, height == 1 ? kSeedOutputs : 1,
+                                   fees, std::move(transactions)));
+        prev = blocks.back().GetHash();
+        if (height == 1) {
+            const consensus::TransactionRef& coinbase = blocks.back().transactions()[0];
+            for (uint32_t j = 0; j < kSeedOutputs; j++)
+                unspent.push_back({ consensus::OutPoint(coinbase->GetHash(), j),
+                                    coinbase->outputs()[j].value() });
+        }
+        unspent.insert(unspent.end(), created.begin(), created.end());
+    }
+    
+    return blocks;
+}
+
+const std::vector<consensus::Block>& BenchChain(const consensus::Params& params)
+{
+    static const std::vector<consensus::Block> blocks = CreateBenchChain(params);
+    return blocks;
+}
+
+// Connect the timed blocks on top of the flushed setup blocks, reading the
+// next block's coins ahead when prefetch is set.
+void ConnectChain(State& state, util::ThreadPool *pool, bool prefetch)
+{
+    const chain::Params chain_params(BtcNet::kMainNet);
+    const consensus::Params& params = chain_params.consensus_params();
+    const std::vector<consensus::Block>& blocks = BenchChain(params);
+    std::chrono::nanoseconds connecting(0);
+    size_t connected = 0, flushes = 0;
+    
+    while (state.KeepRunning()) {
+        fs::remove_all(kBenchPath);
+        chain::CoinsViewDb db(kBenchPath);
+        db.Open();
+        chain::CoinsViewCache cache(&db, kCacheSize);
+        chain::BlockConnector connector(params, &cache, &db, pool);
+        chain::BlockUndo undo;
+    
+        connector.ConnectBlock(params.GenesisBlock(), 0, nullptr);
+        for (uint32_t height = 1; height <= kSetupBlocks; height++)
+            connector.ConnectBlock(blocks[height - 1], height, &undo);
+        cache.Flush();
+    
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t height = kSetupBlocks + 1; height <= blocks.size(); height++) {
+            if (prefetch && height < blocks.size())
+                connector.Prefetch(blocks[height]);
+            if (connector.ConnectBlock(blocks[height - 1], height, &undo) ==
+                    chain::ConnectResult::kConnected)
+                connected++;
+            if (cache.NeedFlush()) {
+                cache.Flush();
+                flushes++;
+            }
+        }
+        connecting += std::chrono::steady_clock::now() - start;
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(connecting).count();
+    state.SetCounter("blocks/s", connected / seconds);
+    state.SetCounter("txs/s", connected * (kBlockTxs + 1) / seconds);
+    state.SetCounter("failed", static_cast<double>(kBlocks * state.num_iters() - connected));
+    state.SetCounter("flushes", static_cast<double>(flushes) / state.num_iters());
+}
+
+} // namespace
+
+// Every stage on the calling thread, coins read when they are spent.
+static void BlockConnectSerial(State& state)
+{
+    ConnectChain(state, nullptr, false);
+}
+
+// Checks spread over the pool and the next block's coins read during the
+// current one.
+static void BlockConnectPipelined(State& state)
+{
+    ConnectChain(state, &util::SingletonThreadPool::GetInstance(), true);
+}
+
+BENCHMARK(BlockConnectSerial, 3);
+BENCHMARK(BlockConnectPipelined, 3);
+
+} // namespace bench
+} // namespace btclite
@@ -0,0 +1,115 @@
+#include "bench.h"
+
+#include "bench_util.h"
+#include "block_index.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+// A mainnet-sized header tree.
+constexpr size_t kBlockIndexEntries = 800000;
+
+// The layout BlockIndex had before the arena: a full header copy, pointer
+// links and a size_t height, one heap allocation per entry.
+struct HeapBlockIndex {
+    consensus::BlockHeader header;
+    util::Hash256 block_hash;
+    HeapBlockIndex *pprev = nullptr;
+    HeapBlockIndex *pskip = nullptr;
+    size_t height = 0;
+    util::uint256_t chain_work = 0;
+    uint32_t tx_num = 0;
+    uint32_t chain_tx_num = 0;
+    uint32_t status = 0;
+    int32_t sequence_id = 0;
+};
+
+consensus::BlockHeader BenchHeader(size_t i)
+{
+    util::Hash256 merkle_root;
+    merkle_root.fill(static_cast<uint8_t>(i));
+    
+    return consensus::BlockHeader(0x20000000, util::Hash256{}, merkle_root,
+                                  1231006505 + 600 * i, 0x1d00ffff, i);
+}
+
+double MiB(size_t bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+static void BlockIndexHeap(State& state)
+{
+    while (state.KeepRunning()) {
+        size_t rss_before = ResidentMemory();
+        std::vector<HeapBlockIndex*> active_chain;
+        
+        for (size_t i = 0; i < kBlockIndexEntries; i++) {
+            HeapBlockIndex *pindex = new HeapBlockIndex;
+            pindex->header = BenchHeader(i);
+            pindex->pprev = i ? active_chain.back() : nullptr;
+            pindex->height = i;
+            pindex->chain_work = (pindex->pprev ? pindex->pprev->chain_work : 0) + 1;
+            active_chain.push_back(pindex);
+        }
+        
+        size_t rss = ResidentMemory() - rss_before;
+        auto start = std::chrono::steady_clock::now();
+        size_t steps = 0;
+        for (const HeapBlockIndex *pindex = active_chain.back(); pindex; pindex = pindex->pprev)
+            steps++;
+        double walk = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        state.SetCounter("rss_MiB", MiB(rss));
+        state.SetCounter("bytes/entry", static_cast<double>(rss) / kBlockIndexEntries);
+        state.SetCounter("walk_ns/entry", walk * 1e9 / steps);
+        
+        for (HeapBlockIndex *pindex : active_chain)
+            delete pindex;
+    }
+}
+
+// The arena keeps its entries for the life of the process, run this one on
+// its own when comparing memory.
+static void BlockIndexArena(State& state)
+{
+    chain::BlockIndexArena& arena = chain::SingletonBlockIndexArena::GetInstance();
+    
+    while (state.KeepRunning()) {
+        size_t rss_before = ResidentMemory();
+        std::vector<chain::BlockIndexHandle> active_chain;
+        chain::BlockIndex *pprev = nullptr;
+        
+        for (size_t i = 0; i < kBlockIndexEntries; i++) {
+            chain::BlockIndex *pindex = arena.New(BenchHeader(i));
+            pindex->set_pprev(pprev);
+            pindex->set_height(i);
+            pindex->BuildSkip();
+            pindex->set_chain_work((pprev ? pprev->chain_work() : 0) + 1);
+            active_chain.push_back(pindex->handle());
+            pprev = pindex;
+        }
+        
+        size_t rss = ResidentMemory() - rss_before;
+        auto start = std::chrono::steady_clock::now();
+        size_t steps = 0;
+        for (const chain::BlockIndex *pindex = pprev; pindex; pindex = pindex->pprev())
+            steps++;
+        double walk = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        
+        state.SetCounter("rss_MiB", MiB(rss));
+        state.SetCounter("bytes/entry", static_cast<double>(rss) / kBlockIndexEntries);
+        state.SetCounter("walk_ns/entry", walk * 1e9 / steps);
+    }
+}
+
+BENCHMARK(BlockIndexHeap, 1);
+BENCHMARK(BlockIndexArena, 1);
+
+} // namespace bench
+} // namespace btclite
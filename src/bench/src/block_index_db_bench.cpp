@@ -0,0 +1,88 @@
+#include "bench.h"
+
+#include <cstring>
+
+#include "block_index_db.h"
+#include "pow.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kBlockIndexEntries = 1000000;
+
+const fs::path kBenchPath = fs::path("/tmp") / "block_index_db_bench";
+
+// Write a kBlockIndexEntries long chain to a fresh snapshot at kBenchPath.
+void WriteBenchSnapshot()
+{
+    fs::remove_all(kBenchPath);
+    fs::create_directories(kBenchPath);
+    
+    chain::ChainState::BlockMap map;
+    map.reserve(kBlockIndexEntries);
+    chain::BlockIndex *pprev = nullptr;
+    for (size_t i = 0; i < kBlockIndexEntries; i++) {
+        util::Hash256 merkle_root, hash;
+        merkle_root.fill(static_cast<uint8_t>(i));
+        std::memcpy(hash.data(), &i, sizeof(i));
+        consensus::BlockHeader header(0x20000000, pprev ? pprev->block_hash() : util::Hash256{},
+                                      merkle_root, 1231006505 + 600 * i, 0x1d00ffff, i);
+    
+        chain::BlockIndex *pindex = chain::SingletonBlockIndexArena::GetInstance().New(header);
+        pindex->set_block_hash(hash);
+        pindex->set_pprev(pprev);
+        pindex->set_height(i);
+        pindex->set_chain_work((pprev ? pprev->chain_work() : 0) + header.GetBlockProof());
+        pindex->set_tx_num(1);
+        pindex->set_chain_tx_num(i + 1);
+        pindex->set_status(chain::kBlockValidTree | chain::kBlockHaveData);
+        map[hash] = pindex;
+        pprev = pindex;
+    }
+    
+    chain::BlockIndexDb db(kBenchPath);
+    db.Compact(map, pprev);
+}
+
+// Arena entries are never freed, so every iteration grows the process by
+// the whole index; run few of them.
+void LoadBlockIndex(State& state, util::ThreadPool *pool)
+{
+    WriteBenchSnapshot();
+    
+    size_t entries = 0;
+    while (state.KeepRunning()) {
+        chain::BlockIndexDb db(kBenchPath);
+        chain::ChainState::BlockMap map;
+        util::Hash256 tip_hash;
+        if (db.Load(&map, &tip_hash, pool))
+            entries = map.size();
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ms/load", seconds * 1e3 / state.num_iters());
+    state.SetCounter("ns/entry", seconds * 1e9 / (kBlockIndexEntries * state.num_iters()));
+    state.SetCounter("entries", entries);
+}
+
+} // namespace
+
+static void BlockIndexLoadSerial(State& state)
+{
+    LoadBlockIndex(state, nullptr);
+}
+
+static void BlockIndexLoadParallel(State& state)
+{
+    LoadBlockIndex(state, &util::SingletonThreadPool::GetInstance());
+}
+
+BENCHMARK(BlockIndexLoadSerial, 2);
+BENCHMARK(BlockIndexLoadParallel, 2);
+
+} // namespace bench
+} // namespace btclite
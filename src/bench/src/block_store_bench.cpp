@@ -0,0 +1,171 @@
+#include "bench.h"
+
+#include <fcntl.h>
+#include <random>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "block_store.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+const fs::path kBenchPath = fs::path("/tmp") / "block_store_bench";
+
+// About 1 MB serialized.
+constexpr size_t kWriteBlockTxs = 2700;
+constexpr size_t kWriteBlocks = 256;
+
+// About 250 kB serialized, all of them in the first blk file.
+constexpr size_t kReadBlockTxs = 670;
+constexpr size_t kReadBlocks = 500;
+constexpr size_t kReads = 20000;
+
+// keeps the touched bytes from being optimized away
+volatile uint64_t touched_sum;
+
+fs::path CleanBenchPath()
+{
+    fs::remove_all(kBenchPath);
+    fs::create_directories(kBenchPath);
+    return kBenchPath;
+}
+
+// sync_each syncs after every block, as a store without batching would.
+void WriteBlocks(State& state, bool sync_each)
+{
+    const consensus::Block block = CreateBenchBlock(kWriteBlockTxs);
+    const size_t block_size = block.SerializedSize();
+    
+    while (state.KeepRunning()) {
+        chain::BlockStore store(CleanBenchPath());
+        store.Open();
+        chain::FlatFilePos pos;
+        for (size_t i = 0; i < kWriteBlocks; i++) {
+            store.WriteBlock(block, &pos);
+            if (sync_each)
+                store.Flush();
+        }
+        store.Flush();
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("MB/s", block_size * kWriteBlocks * state.num_iters() / seconds / 1e6);
+    state.SetCounter("us/block", seconds * 1e6 / (kWriteBlocks * state.num_iters()));
+}
+
+std::vector<chain::FlatFilePos> WriteReadBlocks(chain::BlockStore *store)
+{
+    const consensus::Block block = CreateBenchBlock(kReadBlockTxs);
+    std::vector<chain::FlatFilePos> positions(kReadBlocks);
+    store->Open();
+    for (chain::FlatFilePos& pos : positions)
+        store->WriteBlock(block, &pos);
+    store->Flush();
+    
+    return positions;
+}
+
+// Stands in for sending the block: every cache line is read once.
+uint64_t Touch(const uint8_t *data, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i += 64)
+        sum += data[i];
+    return sum + data[size - 1];
+}
+
+} // namespace
+
+static void BlockStoreWriteBatched(State& state)
+{
+    WriteBlocks(state, false);
+}
+
+static void BlockStoreWriteSyncEach(State& state)
+{
+    WriteBlocks(state, true);
+}
+
+// Raw blocks at random positions, viewed in the mapping.
+static void BlockStoreReadRawMapped(State& state)
+{
+    chain::BlockStore store(CleanBenchPath());
+    const std::vector<chain::FlatFilePos> positions = WriteReadBlocks(&store);
+    std::mt19937 rng(1);
+    uint64_t sum = 0;
+    
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kReads; i++) {
+            util::ByteSpan raw = store.ReadRawBlock(positions[rng() % positions.size()]);
+            sum += Touch(raw.data(), raw.size());
+        }
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/read", seconds * 1e9 / (kReads * state.num_iters()));
+    touched_sum = sum;
+}
+
+// The same reads copied out with pread(), for comparison.
+static void BlockStoreReadRawCopied(State& state)
+{
+    chain::BlockStore store(CleanBenchPath());
+    const std::vector<chain::FlatFilePos> positions = WriteReadBlocks(&store);
+    const size_t block_size = store.ReadRawBlock(positions[0]).size();
+    std::vector<uint8_t> buf(block_size);
+    int fd = ::open(store.BlockFilePath(0).c_str(), O_RDONLY);
+    std::mt19937 rng(1);
+    uint64_t sum = 0;
+    
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kReads; i++) {
+            const chain::FlatFilePos& pos = positions[rng() % positions.size()];
+            if (::pread(fd, buf.data(), block_size, pos.pos) == static_cast<ssize_t>(block_size))
+                sum += Touch(buf.data(), buf.size());
+        }
+    }
+    ::close(fd);
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/read", seconds * 1e9 / (kReads * state.num_iters()));
+    touched_sum = sum;
+}
+
+// Random blocks parsed into a consensus::Block.
+static void BlockStoreReadBlock(State& state)
+{
+    chain::BlockStore store(CleanBenchPath());
+    const std::vector<chain::FlatFilePos> positions = WriteReadBlocks(&store);
+    std::mt19937 rng(1);
+    const size_t reads = kReads / 20;
+    size_t txs = 0;
+    
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < reads; i++) {
+            consensus::Block block;
+            if (store.ReadBlock(positions[rng() % positions.size()], &block))
+                txs += block.transactions().size();
+        }
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("us/read", seconds * 1e6 / (reads * state.num_iters()));
+    state.SetCounter("txs/read", static_cast<double>(txs) / (reads * state.num_iters()));
+}
+
+BENCHMARK(BlockStoreWriteBatched, 3);
+BENCHMARK(BlockStoreWriteSyncEach, 3);
+BENCHMARK(BlockStoreReadRawMapped, 5);
+BENCHMARK(BlockStoreReadRawCopied, 5);
+BENCHMARK(BlockStoreReadBlock, 5);
+
+} // namespace bench
+} // namespace btclite
@@ -0,0 +1,187 @@
+#include "bench.h"
+
+#include "block_index.h"
+#include "compact.h"
+#include "pow.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kHeaders = 2016;
+constexpr size_t kSyncHeaders = 200 * kHeaders;
+
+// One retarget period of headers, the targets spread over mainnet's range.
+std::vector<consensus::BlockHeader> BenchHeaders()
+{
+    std::vector<consensus::BlockHeader> headers(kHeaders);
+    uint32_t bits = 0x1d00ffff;
+    
+    for (size_t i = 0; i < kHeaders; i++) {
+        headers[i].set_bits(bits);
+        headers[i].set_time(1231006505 + 600 * i);
+        headers[i].set_nonce(i);
+        // walk the exponent down and vary the mantissa
+        bits = (((bits >> 24) - (i % 7 == 6)) << 24) | (0x008000 + (i * 2654435761u) % 0x7fffff);
+        if ((bits >> 24) < 0x17)
+            bits = 0x1d00ffff;
+    }
+    
+    return headers;
+}
+
+// Headers as seen in initial sync: nBits only changes at a retarget, every
+// kHeaders blocks.
+std::vector<consensus::BlockHeader> SyncHeaders()
+{
+    const std::vector<consensus::BlockHeader> periods = BenchHeaders();
+    std::vector<consensus::BlockHeader> headers(kSyncHeaders);
+    util::Hash256 prev{};
+    
+    for (size_t i = 0; i < kSyncHeaders; i++) {
+        headers[i] = periods[i / kHeaders];
+        headers[i].set_hashPrevBlock(prev);
+        headers[i].set_time(1231006505 + 600 * i);
+        headers[i].set_nonce(i);
+        prev = headers[i].GetHash();
+    }
+    
+    return headers;
+}
+
+} // namespace
+
+static void BlockProof(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = BenchHeaders();
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers) {
+            util::uint256_t proof = header.GetBlockProof();
+            (void)proof;
+        }
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/header", seconds * 1e9 / (state.num_iters() * kHeaders));
+}
+
+// Chain work accumulation as done by ChainState::AddToBlockIndex.
+static void ChainWork(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = BenchHeaders();
+    util::uint256_t work = 0;
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers)
+            work = work + header.GetBlockProof();
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/header", seconds * 1e9 / (state.num_iters() * kHeaders));
+    state.SetCounter("sizeof_uint256", sizeof(util::uint256_t));
+    state.SetCounter("sizeof_BlockIndex", sizeof(chain::BlockIndex));
+}
+
+static void CompactRoundTrip(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = BenchHeaders();
+    uint32_t sum = 0;
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers)
+            sum += consensus::Compact(consensus::Compact(header.bits()).normal()).compact();
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/header", seconds * 1e9 / (state.num_iters() * kHeaders));
+    state.SetCounter("checksum", sum & 0xffff);
+}
+
+// Header sync before the target cache: hash through the serializer, decode
+// nBits, compare as numbers.
+static void HeaderPowDecode(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = SyncHeaders();
+    size_t passed = 0;
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers) {
+            consensus::Compact compact(header.bits());
+            util::uint256_t target = compact.normal();
+            if (!compact.negative() && !compact.overflowed() && target != 0 &&
+                    util::uint256_t::FromHash256(header.GetHash()) <= target)
+                passed++;
+        }
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("headers/s", state.num_iters() * kSyncHeaders / seconds);
+    state.SetCounter("passed", passed);
+}
+
+// The fused check over the 80-byte wire form, as received in a headers message.
+static void HeaderPowFused(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = SyncHeaders();
+    util::MemoryStream ms;
+    for (const auto& header : headers)
+        ms << header;
+    const uint8_t *raw = ms.Data();
+    size_t passed = 0;
+    
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < kSyncHeaders; i++)
+            passed += consensus::CheckHeaderProofOfWork(raw + 80 * i);
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("headers/s", state.num_iters() * kSyncHeaders / seconds);
+    state.SetCounter("passed", passed);
+}
+
+static void TargetDecode(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = SyncHeaders();
+    uint64_t sum = 0;
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers)
+            sum += consensus::TargetCache::Decode(header.bits()).bits();
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/header", seconds * 1e9 / (state.num_iters() * kSyncHeaders));
+    state.SetCounter("checksum", sum & 0xffff);
+}
+
+static void TargetCacheGet(State& state)
+{
+    const std::vector<consensus::BlockHeader> headers = SyncHeaders();
+    consensus::TargetCache cache;
+    uint64_t sum = 0;
+    
+    while (state.KeepRunning()) {
+        for (const auto& header : headers)
+            sum += cache.Get(header.bits()).bits();
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/header", seconds * 1e9 / (state.num_iters() * kSyncHeaders));
+    state.SetCounter("hit_rate", static_cast<double>(cache.hits()) / (cache.hits() + cache.misses()));
+    state.SetCounter("checksum", sum & 0xffff);
+}
+
+BENCHMARK(BlockProof, 50);
+BENCHMARK(ChainWork, 50);
+BENCHMARK(CompactRoundTrip, 50);
+BENCHMARK(HeaderPowDecode, 2);
+BENCHMARK(HeaderPowFused, 2);
+BENCHMARK(TargetDecode, 5);
+BENCHMARK(TargetCacheGet, 5);
+
+} // namespace bench
+} // namespace btclite
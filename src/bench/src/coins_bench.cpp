@@ -0,0 +1,151 @@
+#include "bench.h"
+
+#include <cstring>
+#include <random>
+
+#include "bench_util.h"
+#include "coins_db.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+const fs::path kBenchPath = fs::path("/tmp") / "coins_bench";
+
+constexpr size_t kBlocks = 250;
+constexpr size_t kBlockTxs = 2000;
+constexpr size_t kTxInputs = 2;
+// one more than the inputs, so the set grows by a coin per transaction
+constexpr size_t kTxOutputs = 3;
+// Half the inputs spend one of this many newest outputs, the way much
+// of the chain spends coins a few blocks old; the rest spend any output.
+constexpr size_t kRecentOutputs = 20000;
+
+using BenchBlock = std::vector<consensus::TransactionRef>;
+
+// kBlocks synthetic blocks of kTxInputs-in kTxOutputs-out transactions, each
+// input spending an output of an earlier block. The first block only creates
+// outputs, from inputs that are never looked up.
+std::vector<BenchBlock> CreateBenchChain()
+{
+    using namespace consensus;
+    
+    std::mt19937_64 rng(1);
+    std::vector<OutPoint> unspent;
+    std::vector<BenchBlock> blocks(kBlocks);
+    uint64_t nonce = 0;
+    
+    for (size_t height = 0; height < kBlocks; height++) {
+        std::vector<OutPoint> created;
+        for (size_t i = 0; i < kBlockTxs; i++) {
+            std::pmr::vector<TxIn> inputs;
+            std::pmr::vector<TxOut> outputs;
+            for (size_t j = 0; j < kTxInputs; j++) {
+                OutPoint prevout;
+                if (height == 0) {
+                    util::Hash256 hash{};
+                    std::memcpy(hash.data(), &nonce, sizeof(nonce));
+                    prevout = OutPoint(hash, nonce++);
+                }
+                else {
+                    size_t window = (rng() & 1) ? std::min(unspent.size(), kRecentOutputs)
+                                                : unspent.size();
+                    size_t k = unspent.size() - 1 - rng() % window;
+                    prevout = unspent[k];
+                    unspent[k] = unspent.back();
+                    unspent.pop_back();
+                }
+                // the signatures play no part here
+                inputs.emplace_back(prevout, Script());
+            }
+            for (size_t j = 0; j < kTxOutputs; j++) {
+                // OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG
+                outputs.emplace_back(rng() % 100000000,
+                                     Script(std::vector<uint8_t>(25, static_cast<uint8_t>(j))));
+            }
+    
+            blocks[height].push_back(MakeTransactionRef(
+                                         Transaction(2, std::move(inputs), std::move(outputs), 0)));
+            const util::Hash256 txid = blocks[height].back()->GetHash();
+            for (uint32_t j = 0; j < kTxOutputs; j++)
+                created.emplace_back(txid, j);
+        }
+        unspent.insert(unspent.end(), created.begin(), created.end());
+    }
+    
+    return blocks;
+}
+
+const std::vector<BenchBlock>& BenchChain()
+{
+    static const std::vector<BenchBlock> blocks = CreateBenchChain();
+    return blocks;
+}
+
+// Connect the chain into a fresh database through a cache of max_memory
+// bytes, flushing whenever it is full and once at the end.
+void ReplayChain(State& state, size_t max_memory)
+{
+    const std::vector<BenchBlock>& blocks = BenchChain();
+    size_t ops = 0, flushes = 0, peak_cache = 0;
+    
+    while (state.KeepRunning()) {
+        fs::remove_all(kBenchPath);
+        chain::CoinsViewDb db(kBenchPath);
+        db.Open();
+        chain::CoinsViewCache cache(&db, max_memory);
+    
+        for (size_t height = 0; height < blocks.size(); height++) {
+            for (const consensus::TransactionRef& tx : blocks[height]) {
+                if (height > 0) {
+                    for (const consensus::TxIn& input : tx->inputs())
+                        if (cache.SpendCoin(input.prevout()))
+                            ops++;
+                }
+                cache.AddCoins(*tx, height);
+                ops += tx->outputs().size();
+            }
+    
+            util::Hash256 best_block{};
+            std::memcpy(best_block.data(), &height, sizeof(height));
+            cache.SetBestBlock(best_block);
+            peak_cache = std::max(peak_cache, cache.DynamicMemoryUsage());
+            if (cache.NeedFlush()) {
+                cache.Flush();
+                flushes++;
+            }
+        }
+        cache.Flush();
+        flushes++;
+    }
+    fs::remove_all(kBenchPath);
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ops/s", ops / seconds);
+    state.SetCounter("flushes", static_cast<double>(flushes) / state.num_iters());
+    state.SetCounter("peak_cache_MB", peak_cache / 1e6);
+    // of the whole run, the synthetic chain included
+    state.SetCounter("peak_rss_MB", PeakResidentMemory() / 1e6);
+}
+
+} // namespace
+
+// The whole set fits, one flush at the end.
+static void CoinsReplayCached(State& state)
+{
+    ReplayChain(state, chain::CoinsViewCache::kDefaultMaxMemory);
+}
+
+// A cache far smaller than the set, flushed every few blocks.
+static void CoinsReplayFlushing(State& state)
+{
+    ReplayChain(state, 8 << 20);
+}
+
+BENCHMARK(CoinsReplayCached, 3);
+BENCHMARK(CoinsReplayFlushing, 3);
+
+} // namespace bench
+} // namespace btclite
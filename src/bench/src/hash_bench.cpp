@@ -0,0 +1,140 @@
+#include "bench.h"
+
+#include "bench_util.h"
+#include "hash.h"
+#include "sha256.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kBlockTxs = 2000;
+constexpr size_t kD64Blocks = 1024;
+
+// Batched 64-byte double hashes with a fixed backend, reported as hashes/s.
+void DoubleSha256D64(State& state, crypto::sha256::Backend backend)
+{
+    std::vector<uint8_t> in(64 * kD64Blocks, 0x5a);
+    std::vector<uint8_t> out(32 * kD64Blocks);
+    
+    if (!crypto::sha256::UseBackend(backend)) {
+        while (state.KeepRunning()) {
+        }
+        state.SetCounter("unsupported", 1);
+        return;
+    }
+    
+    while (state.KeepRunning()) {
+        crypto::sha256::DoubleSha256D64(out.data(), in.data(), kD64Blocks);
+    }
+    crypto::sha256::AutoDetect();
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("hashes/s", kD64Blocks * state.num_iters() / seconds);
+}
+
+} // namespace
+
+// Buffer the whole serialization, then hash it.
+static void DoubleHashBlockBuffered(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        crypto::HashOStream hs;
+        hs << block;
+        hs.DoubleSha256();
+    }
+    state.SetCounter("block_bytes", block.SerializedSize());
+}
+
+// Hash bytes as they are serialized.
+static void DoubleHashBlockStreaming(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        crypto::GetDoubleHash(block);
+    }
+    state.SetCounter("block_bytes", block.SerializedSize());
+}
+
+static void DoubleHashTxBuffered(State& state)
+{
+    consensus::Block block = CreateBenchBlock(1);
+    const consensus::Transaction& tx = *block.transactions().front();
+    
+    while (state.KeepRunning()) {
+        crypto::HashOStream hs;
+        hs << tx;
+        hs.DoubleSha256();
+    }
+}
+
+static void DoubleHashTxStreaming(State& state)
+{
+    consensus::Block block = CreateBenchBlock(1);
+    const consensus::Transaction& tx = *block.transactions().front();
+    
+    while (state.KeepRunning()) {
+        crypto::GetDoubleHash(tx);
+    }
+}
+
+static void DoubleSha256D64Standard(State& state)
+{
+    DoubleSha256D64(state, crypto::sha256::Backend::kStandard);
+}
+
+static void DoubleSha256D64Sse4(State& state)
+{
+    DoubleSha256D64(state, crypto::sha256::Backend::kSse4);
+}
+
+static void DoubleSha256D64Avx2(State& state)
+{
+    DoubleSha256D64(state, crypto::sha256::Backend::kAvx2);
+}
+
+static void DoubleSha256D64ShaNi(State& state)
+{
+    DoubleSha256D64(state, crypto::sha256::Backend::kShaNi);
+}
+
+// Fill a container from a block, the way a pool or relay queue would.
+static void CopyBlockTransactions(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        std::vector<consensus::Transaction> txs;
+        txs.reserve(block.transactions().size());
+        for (const auto& tx : block.transactions())
+            txs.push_back(*tx);
+    }
+}
+
+static void ShareBlockTransactions(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        std::vector<consensus::TransactionRef> txs(block.transactions());
+    }
+}
+
+BENCHMARK(DoubleHashBlockBuffered, 50);
+BENCHMARK(DoubleHashBlockStreaming, 50);
+BENCHMARK(DoubleHashTxBuffered, 20000);
+BENCHMARK(DoubleHashTxStreaming, 20000);
+BENCHMARK(CopyBlockTransactions, 50);
+BENCHMARK(ShareBlockTransactions, 50);
+BENCHMARK(DoubleSha256D64Standard, 100);
+BENCHMARK(DoubleSha256D64Sse4, 100);
+BENCHMARK(DoubleSha256D64Avx2, 100);
+BENCHMARK(DoubleSha256D64ShaNi, 100);
+
+} // namespace bench
+} // namespace btclite
@@ -0,0 +1,110 @@
+#include "bench.h"
+
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "hash.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kMapEntries = 1000000;
+
+// The block map before it went flat: one node per entry, keyed by the first
+// 8 bytes of the hash.
+using NodeMap = std::unordered_map<util::Hash256, uint32_t, crypto::Hasher<util::Hash256> >;
+using FlatMap = crypto::Hash256Map<uint32_t>;
+
+std::vector<util::Hash256> BenchKeys(size_t num, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<util::Hash256> keys(num);
+    for (util::Hash256& key : keys) {
+        for (size_t i = 0; i < key.size(); i += 8) {
+            uint64_t word = rng();
+            std::memcpy(key.data() + i, &word, 8);
+        }
+    }
+    
+    return keys;
+}
+
+template <typename Map>
+void MapInsert(State& state)
+{
+    std::vector<util::Hash256> keys = BenchKeys(kMapEntries, 1);
+    
+    while (state.KeepRunning()) {
+        Map map;
+        for (size_t i = 0; i < keys.size(); i++)
+            map.try_emplace(keys[i], i);
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("ns/insert", seconds * 1e9 / (kMapEntries * state.num_iters()));
+    state.SetCounter("allocs/insert", static_cast<double>(state.allocs().count) /
+                     (kMapEntries * state.num_iters()));
+}
+
+// Look up every key once, then as many absent ones.
+template <typename Map>
+void MapLookup(State& state)
+{
+    std::vector<util::Hash256> keys = BenchKeys(kMapEntries, 1);
+    std::vector<util::Hash256> missing = BenchKeys(kMapEntries, 2);
+    Map map;
+    for (size_t i = 0; i < keys.size(); i++)
+        map.try_emplace(keys[i], i);
+    
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        for (const util::Hash256& key : keys)
+            found += map.count(key);
+    }
+    double hit = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    start = std::chrono::steady_clock::now();
+    for (const util::Hash256& key : missing)
+        found += map.count(key);
+    double miss = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    state.SetCounter("ns/hit", hit * 1e9 / (kMapEntries * state.num_iters()));
+    state.SetCounter("ns/miss", miss * 1e9 / kMapEntries);
+    state.SetCounter("found", found);
+}
+
+} // namespace
+
+static void BlockMapInsertNode(State& state)
+{
+    MapInsert<NodeMap>(state);
+}
+
+static void BlockMapInsertFlat(State& state)
+{
+    MapInsert<FlatMap>(state);
+}
+
+static void BlockMapLookupNode(State& state)
+{
+    MapLookup<NodeMap>(state);
+}
+
+static void BlockMapLookupFlat(State& state)
+{
+    MapLookup<FlatMap>(state);
+}
+
+BENCHMARK(BlockMapInsertNode, 5);
+BENCHMARK(BlockMapInsertFlat, 5);
+BENCHMARK(BlockMapLookupNode, 5);
+BENCHMARK(BlockMapLookupFlat, 5);
+
+} // namespace bench
+} // namespace btclite
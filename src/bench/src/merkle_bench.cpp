@@ -0,0 +1,125 @@
+#include "bench.h"
+
+#include <thread>
+
+#include "bench_util.h"
+#include "merkle.h"
+#include "sha256.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+std::vector<util::Hash256> TxHashes(size_t num_txs)
+{
+    consensus::Block block = CreateBenchBlock(num_txs);
+    std::vector<util::Hash256> leaves;
+    
+    for (const auto& tx : block.transactions())
+        leaves.push_back(tx->GetHash());
+    
+    return leaves;
+}
+
+// Root of a block with num_txs cached txids, one whole level per batch call.
+void MerkleRoot(State& state, size_t num_txs, crypto::sha256::Backend backend)
+{
+    const std::vector<util::Hash256> leaves = TxHashes(num_txs);
+    bool mutated = false;
+    
+    if (!crypto::sha256::UseBackend(backend)) {
+        while (state.KeepRunning()) {
+        }
+        state.SetCounter("unsupported", 1);
+        return;
+    }
+    
+    while (state.KeepRunning()) {
+        std::vector<util::Hash256> hashes(leaves);
+        consensus::ComputeMerkleRoot(std::move(hashes), &mutated);
+    }
+    crypto::sha256::AutoDetect();
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("roots/s", state.num_iters() / seconds);
+}
+
+// Witness root of deep copies of a block so no wtxid is cached yet.
+void WitnessMerkleRoot(State& state, size_t num_txs, util::ThreadPool *pool)
+{
+    const consensus::Block block = CreateBenchBlock(num_txs, 2, 2, true);
+    std::vector<consensus::Block> blocks;
+    size_t i = 0;
+    
+    for (uint64_t n = 0; n < state.num_iters(); n++) {
+        std::vector<consensus::TransactionRef> transactions;
+        for (const auto& tx : block.transactions())
+            transactions.push_back(consensus::MakeTransactionRef(*tx));
+        blocks.emplace_back(block.header(), std::move(transactions));
+    }
+    
+    while (state.KeepRunning()) {
+        consensus::BlockWitnessMerkleRoot(blocks[i++], pool);
+    }
+    
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("roots/s", state.num_iters() / seconds);
+}
+
+} // namespace
+
+static void WitnessMerkleRoot4kSingleThread(State& state)
+{
+    WitnessMerkleRoot(state, 4000, nullptr);
+}
+
+static void WitnessMerkleRoot4kThreadPool(State& state)
+{
+    util::ThreadPool pool(std::thread::hardware_concurrency());
+    WitnessMerkleRoot(state, 4000, &pool);
+    state.SetCounter("threads", std::thread::hardware_concurrency());
+}
+
+static void MerkleRoot2kStandard(State& state)
+{
+    MerkleRoot(state, 2000, crypto::sha256::Backend::kStandard);
+}
+
+static void MerkleRoot2k(State& state)
+{
+    MerkleRoot(state, 2000, crypto::sha256::backend());
+}
+
+static void MerkleRoot4kStandard(State& state)
+{
+    MerkleRoot(state, 4000, crypto::sha256::Backend::kStandard);
+}
+
+static void MerkleRoot4k(State& state)
+{
+    MerkleRoot(state, 4000, crypto::sha256::backend());
+}
+
+static void MerkleRoot10kStandard(State& state)
+{
+    MerkleRoot(state, 10000, crypto::sha256::Backend::kStandard);
+}
+
+static void MerkleRoot10k(State& state)
+{
+    MerkleRoot(state, 10000, crypto::sha256::backend());
+}
+
+BENCHMARK(MerkleRoot2kStandard, 100);
+BENCHMARK(MerkleRoot2k, 100);
+BENCHMARK(MerkleRoot4kStandard, 50);
+BENCHMARK(MerkleRoot4k, 50);
+BENCHMARK(MerkleRoot10kStandard, 20);
+BENCHMARK(MerkleRoot10k, 20);
+BENCHMARK(WitnessMerkleRoot4kSingleThread, 20);
+BENCHMARK(WitnessMerkleRoot4kThreadPool, 20);
+
+} // namespace bench
+} // namespace btclite
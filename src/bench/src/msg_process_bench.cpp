@@ -0,0 +1,297 @@
+#include "bench.h"
+
+#include <chrono>
+
+#include <arpa/inet.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+
+#include "msg_process.h"
+#include "protocol/addr.h"
+#include "protocol/inventory.h"
+#include "protocol/ping.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace bench {
+
+using namespace network::protocol;
+
+namespace {
+
+constexpr size_t kInvEntries = 1000;
+constexpr size_t kAddrEntries = 1000;
+
+std::vector<uint8_t> InvPayload()
+{
+    Inv inv;
+    util::MemoryStream ms;
+
+    for (size_t i = 0; i < kInvEntries; i++) {
+        util::Hash256 hash;
+        hash.fill(static_cast<uint8_t>(i));
+        inv.mutable_inv_vects()->emplace_back(kMsgTx, hash);
+    }
+    ms << inv;
+
+    return std::vector<uint8_t>(ms.Data(), ms.Data() + ms.Size());
+}
+
+std::vector<uint8_t> AddrPayload()
+{
+    Addr addr;
+    util::MemoryStream ms;
+
+    for (size_t i = 0; i < kAddrEntries; i++) {
+        network::NetAddr net_addr;
+        net_addr.SetIpv4(htonl(0x01020300 + static_cast<uint32_t>(i)));
+        net_addr.set_port(8333);
+        addr.mutable_addr_list()->push_back(net_addr);
+    }
+    ms << addr;
+
+    return std::vector<uint8_t>(ms.Data(), ms.Data() + ms.Size());
+}
+
+// Old ParseMsgData path: stage the payload in a vector before deserializing.
+template <typename Message>
+void ParseCopied(State& state, const std::vector<uint8_t>& payload)
+{
+    // stands in for the evbuffer_pullup() pointer
+    const uint8_t *raw = payload.data();
+    uint64_t copied = 0;
+
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> vec;
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        Message msg;
+
+        vec.reserve(payload.size());
+        vec.assign(raw, raw + payload.size());
+        copied += vec.size();
+        msg.Deserialize(byte_source);
+    }
+    state.SetCounter("copied_bytes/msg", static_cast<double>(copied) / state.num_iters());
+}
+
+// Current ParseMsgData path: deserialize in place.
+template <typename Message>
+void ParseInPlace(State& state, const std::vector<uint8_t>& payload)
+{
+    const uint8_t *raw = payload.data();
+
+    while (state.KeepRunning()) {
+        util::ByteSpanSource byte_source(raw, payload.size());
+        Message msg;
+
+        msg.Deserialize(byte_source);
+    }
+}
+
+// A header followed by its payload, as ParseMsg finds them in the evbuffer.
+struct RawMsg {
+    MessageHeader header;
+    std::vector<uint8_t> payload;
+};
+
+template <typename Message>
+RawMsg MakeRawMsg(const Message& msg)
+{
+    util::MemoryStream ms;
+    ms << msg;
+
+    return RawMsg{ MessageHeader(kTestnetMagic, msg.Command(), ms.Size(),
+                                 util::FromLittleEndian<uint32_t>(msg.GetHash().data())),
+                   std::vector<uint8_t>(ms.Data(), ms.Data() + ms.Size()) };
+}
+
+Inv MixedInv()
+{
+    Inv inv;
+    for (size_t i = 0; i < 8; i++)
+        inv.mutable_inv_vects()->emplace_back(kMsgTx, util::RandHash256());
+    return inv;
+}
+
+Inv LargeInv()
+{
+    const std::vector<uint8_t> payload = InvPayload();
+    util::ByteSpanSource byte_source(payload.data(), payload.size());
+    Inv inv;
+    inv.Deserialize(byte_source);
+    return inv;
+}
+
+Addr MixedAddr()
+{
+    Addr addr;
+    for (size_t i = 0; i < 4; i++) {
+        network::NetAddr net_addr;
+        net_addr.SetIpv4(htonl(0x01020300 + static_cast<uint32_t>(i)));
+        net_addr.set_port(8333);
+        addr.mutable_addr_list()->push_back(net_addr);
+    }
+    return addr;
+}
+
+// ping, inv and addr as peers mostly send them, with a few entries each,
+// and headers, which has no handler yet and is dropped after the lookup
+std::vector<RawMsg> MixedStream()
+{
+    std::vector<RawMsg> stream;
+
+    stream.push_back(MakeRawMsg(Ping(util::RandUint64(), kProtocolVersion)));
+    stream.push_back(MakeRawMsg(MixedInv()));
+    stream.push_back(MakeRawMsg(MixedInv()));
+    stream.push_back(MakeRawMsg(MixedAddr()));
+    stream.push_back(RawMsg{ MessageHeader(kTestnetMagic, msg_command::kMsgHeaders, 1, 0),
+                             std::vector<uint8_t>(1, 0) });
+
+    return stream;
+}
+
+// An established peer on one end of a bufferevent pair, whatever is sent to
+// it piles up at the other end.
+struct BenchPeer {
+    struct event_base *base = nullptr;
+    struct bufferevent *pair[2] = {};
+    network::Params params;
+    network::LocalService local_service;
+    network::Peers peers;
+    chain::ChainState chain_state;
+    std::shared_ptr<network::Node> node;
+
+    BenchPeer()
+        : base(event_base_new()),
+          params(BtcNet::kTestNet, util::Args(), fs::path("/tmp/foo"))
+    {
+        bufferevent_pair_new(base, BEV_OPT_CLOSE_ON_FREE, pair);
+
+        network::NetAddr addr;
+        addr.SetIpv4(inet_addr("1.2.3.4"));
+        node = std::make_shared<network::Node>(pair[0], addr, false);
+        node->mutable_protocol()->version = kProtocolVersion;
+        node->mutable_connection()->set_connection_state(
+            network::NodeConnection::kEstablished);
+    }
+
+    ~BenchPeer()
+    {
+        // the timer started by the first send holds the node, which frees
+        // its end of the pair
+        util::SingletonTimerMng::GetInstance().StopTimer(node->timers().no_sending_timer);
+        node->mutable_timers()->no_sending_timer.reset();
+        node.reset();
+        bufferevent_free(pair[1]);
+        event_base_free(base);
+    }
+
+    void DrainSent()
+    {
+        struct evbuffer *buf = bufferevent_get_input(pair[1]);
+        evbuffer_drain(buf, evbuffer_get_length(buf));
+    }
+};
+
+// Whole ParseMsgData path: command lookup, deserializing, checksum, handler.
+void Dispatch(State& state, const std::vector<RawMsg>& stream)
+{
+    BenchPeer peer;
+    uint64_t handled = 0;
+
+    while (state.KeepRunning()) {
+        for (const RawMsg& msg : stream)
+            handled += network::ParseMsgData(msg.payload.data(), peer.node, msg.header,
+                                             peer.params, peer.local_service, &peer.peers,
+                                             &peer.chain_state);
+        // the pongs sent back
+        peer.DrainSent();
+    }
+
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("msgs/s", stream.size() * state.num_iters() / seconds);
+    state.SetCounter("handled/iter", static_cast<double>(handled) / state.num_iters());
+}
+
+} // namespace
+
+static void DispatchMixed(State& state)
+{
+    Dispatch(state, MixedStream());
+}
+
+static void DispatchLargeInv(State& state)
+{
+    Dispatch(state, { MakeRawMsg(LargeInv()) });
+}
+
+// Whole SendMsg path: serializing, checksum, bufferevent write.
+static void SendMixed(State& state)
+{
+    BenchPeer peer;
+    const uint32_t magic = peer.params.msg_magic();
+    const Ping ping(util::RandUint64(), kProtocolVersion);
+    const Inv inv = MixedInv();
+    const Addr addr = MixedAddr();
+    uint64_t sent = 0;
+
+    while (state.KeepRunning()) {
+        sent += network::SendMsg(ping, magic, peer.node);
+        sent += network::SendMsg(inv, magic, peer.node);
+        sent += network::SendMsg(inv, magic, peer.node);
+        sent += network::SendMsg(addr, magic, peer.node);
+        peer.DrainSent();
+    }
+
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("msgs/s", sent / seconds);
+}
+
+static void SendLargeInv(State& state)
+{
+    BenchPeer peer;
+    const Inv inv = LargeInv();
+    uint64_t sent = 0;
+
+    while (state.KeepRunning()) {
+        sent += network::SendMsg(inv, peer.params.msg_magic(), peer.node);
+        peer.DrainSent();
+    }
+
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("msgs/s", sent / seconds);
+}
+
+static void ParseInvCopied(State& state)
+{
+    ParseCopied<Inv>(state, InvPayload());
+}
+
+static void ParseInvInPlace(State& state)
+{
+    ParseInPlace<Inv>(state, InvPayload());
+}
+
+static void ParseAddrCopied(State& state)
+{
+    ParseCopied<Addr>(state, AddrPayload());
+}
+
+static void ParseAddrInPlace(State& state)
+{
+    ParseInPlace<Addr>(state, AddrPayload());
+}
+
+BENCHMARK(ParseInvCopied, 2000);
+BENCHMARK(ParseInvInPlace, 2000);
+BENCHMARK(ParseAddrCopied, 200);
+BENCHMARK(ParseAddrInPlace, 200);
+BENCHMARK(DispatchMixed, 20000);
+BENCHMARK(DispatchLargeInv, 2000);
+BENCHMARK(SendMixed, 20000);
+BENCHMARK(SendLargeInv, 2000);
+
+} // namespace bench
+} // namespace btclite
@@ -0,0 +1,211 @@
+#include "bench.h"
+
+#include <chrono>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <event2/bufferevent.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "msg_process.h"
+#include "protocol/ping.h"
+#include "protocol/pong.h"
+#include "reactor.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace bench {
+
+using namespace network::protocol;
+
+namespace {
+
+constexpr size_t kPeers = 256;
+constexpr size_t kPingsPerRound = 16;
+
+void SetNoDelay(int fd)
+{
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+bool WriteAll(int fd, const uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool ReadAll(int fd, uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = read(fd, data, size);
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// kPeers peers connected over loopback TCP, whose sockets are spread over
+// the reactors as the acceptor spreads inbound ones. Every message a
+// reactor reads is framed and handled on its thread, the pong to a ping
+// written back from there too.
+struct LoopbackPeers {
+    network::Reactors reactors;
+    network::Params params;
+    network::LocalService local_service;
+    network::Peers peers;
+    chain::ChainState chain_state;
+    struct Conn {
+        LoopbackPeers *self;
+        std::shared_ptr<network::Node> node;
+    };
+    std::vector<Conn> conns;
+    std::vector<int> clients;
+
+    explicit LoopbackPeers(size_t num_reactors)
+        : reactors(num_reactors),
+          params(BtcNet::kTestNet, util::Args(), fs::path("/tmp/foo"))
+    {
+        reactors.InitEvent();
+        reactors.StartEventLoops();
+        // read callbacks hold on to their element
+        conns.reserve(kPeers);
+
+        int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in sock_addr = {};
+        socklen_t len = sizeof(sock_addr);
+        sock_addr.sin_family = AF_INET;
+        sock_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd, reinterpret_cast<struct sockaddr*>(&sock_addr), len);
+        listen(listen_fd, kPeers);
+        getsockname(listen_fd, reinterpret_cast<struct sockaddr*>(&sock_addr), &len);
+
+        for (size_t i = 0; i < kPeers; i++) {
+            int client = socket(AF_INET, SOCK_STREAM, 0);
+            connect(client, reinterpret_cast<struct sockaddr*>(&sock_addr), len);
+            SetNoDelay(client);
+            clients.push_back(client);
+
+            int fd = accept(listen_fd, nullptr, nullptr);
+            SetNoDelay(fd);
+            evutil_make_socket_nonblocking(fd);
+            network::Reactor *reactor = reactors.LeastLoaded();
+            struct bufferevent *bev = bufferevent_socket_new(
+                    reactor->base(), fd, BEV_OPT_THREADSAFE | BEV_OPT_CLOSE_ON_FREE);
+
+            network::NetAddr addr;
+            addr.SetIpv4(htonl(0x7f000001));
+            auto node = std::make_shared<network::Node>(bev, addr);
+            node->mutable_connection()->set_reactor(reactor);
+            node->mutable_protocol()->version = kProtocolVersion;
+            node->mutable_connection()->set_connection_state(
+                network::NodeConnection::kEstablished);
+            conns.push_back({ this, node });
+
+            bufferevent_setcb(bev, ReadCb, nullptr, nullptr, &conns.back());
+            bufferevent_enable(bev, EV_READ);
+        }
+        close(listen_fd);
+    }
+
+    ~LoopbackPeers()
+    {
+        // no read callback is left running once the loops are joined
+        reactors.ExitEventLoops();
+        reactors.Join();
+        for (Conn& conn : conns)
+            conn.node->StopAllTimers();
+        conns.clear();
+        for (int client : clients)
+            close(client);
+    }
+
+    static void ReadCb(struct bufferevent *bev, void *arg)
+    {
+        auto *conn = reinterpret_cast<Conn*>(arg);
+        LoopbackPeers *self = conn->self;
+        network::ParseMsg(conn->node, self->params, self->local_service, &self->peers,
+                          &self->chain_state);
+    }
+};
+
+std::vector<uint8_t> PingRound()
+{
+    util::MemoryStream ms;
+    for (size_t i = 0; i < kPingsPerRound; i++) {
+        Ping ping(util::RandUint64(), kProtocolVersion);
+        ms << MessageHeader(kTestnetMagic, ping.Command(), ping.SerializedSize(),
+                            util::FromLittleEndian<uint32_t>(ping.GetHash().data()))
+           << ping;
+    }
+
+    return std::vector<uint8_t>(ms.Data(), ms.Data() + ms.Size());
+}
+
+// Every peer sends a round of pings and waits for the pongs, the peers'
+// ends driven by as many threads as there are reactors.
+void Loopback(State& state, size_t num_reactors)
+{
+    LoopbackPeers loopback(num_reactors);
+    const std::vector<uint8_t> round = PingRound();
+    const size_t pongs_size = kPingsPerRound * (MessageHeader::kSize + Pong(0).SerializedSize());
+    bool ok = true;
+
+    while (state.KeepRunning()) {
+        std::vector<std::thread> threads;
+        std::vector<char> results(num_reactors, 1);
+        for (size_t t = 0; t < num_reactors; t++) {
+            threads.emplace_back([&, t] {
+                std::vector<uint8_t> pongs(pongs_size);
+                for (size_t i = t; i < kPeers; i += num_reactors)
+                    results[t] &= WriteAll(loopback.clients[i], round.data(), round.size());
+                for (size_t i = t; i < kPeers; i += num_reactors)
+                    results[t] &= ReadAll(loopback.clients[i], pongs.data(), pongs.size());
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        for (char result : results)
+            ok &= (result != 0);
+    }
+
+    double seconds = std::chrono::duration<double>(state.elapsed()).count();
+    state.SetCounter("msgs/s", kPeers * kPingsPerRound * state.num_iters() / seconds);
+    state.SetCounter("ok", ok);
+}
+
+} // namespace
+
+static void ReactorsLoopback1(State& state)
+{
+    Loopback(state, 1);
+}
+
+static void ReactorsLoopback2(State& state)
+{
+    Loopback(state, 2);
+}
+
+static void ReactorsLoopback4(State& state)
+{
+    Loopback(state, 4);
+}
+
+BENCHMARK(ReactorsLoopback1, 50);
+BENCHMARK(ReactorsLoopback2, 50);
+BENCHMARK(ReactorsLoopback4, 50);
+
+} // namespace bench
+} // namespace btclite
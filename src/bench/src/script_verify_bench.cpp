@@ -0,0 +1,202 @@
+#include "bench.h"
+
+#include <cstring>
+
+#include "check_queue.h"
+#include "ecdsa.h"
+#include "hash.h"
+#include "interpreter.h"
+#include "script_cache.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kTxs = 500;
+constexpr size_t kTxInputs = 4;
+
+// Spending transactions and the outputs they spend, every other one P2PKH
+// and P2WPKH, all signed by one key.
+struct SignedBatch {
+    std::vector<consensus::Transaction> txs;
+    std::vector<std::vector<consensus::TxOut> > spent;
+    std::vector<consensus::PrecomputedTxData> txdata;
+};
+
+SignedBatch CreateSignedBatch()
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 1, sizeof(seckey));
+    std::vector<uint8_t> pubkey;
+    crypto::EcdsaPublicKey(seckey, true, &pubkey);
+    const util::Hash160 key_hash = crypto::hashfuncs::Hash160(pubkey);
+    const std::vector<uint8_t> program(key_hash.begin(), key_hash.end());
+    
+    consensus::Script p2pkh;
+    p2pkh.Push(consensus::Opcode::OP_DUP);
+    p2pkh.Push(consensus::Opcode::OP_HASH160);
+    p2pkh.Push(program);
+    p2pkh.Push(consensus::Opcode::OP_EQUALVERIFY);
+    p2pkh.Push(consensus::Opcode::OP_CHECKSIG);
+    consensus::Script p2wpkh;
+    p2wpkh.Push(consensus::Opcode::OP_0);
+    p2wpkh.Push(program);
+    
+    SignedBatch batch;
+    for (size_t i = 0; i < kTxs; i++) {
+        const bool witness = i & 1;
+        std::pmr::vector<consensus::TxIn> inputs;
+        std::vector<consensus::TxOut> spent;
+        util::Hash256 prev_hash = {};
+        std::memcpy(prev_hash.data(), &i, sizeof(i));
+        for (uint32_t j = 0; j < kTxInputs; j++) {
+            inputs.emplace_back(consensus::OutPoint(prev_hash, j), consensus::Script());
+            spent.emplace_back(10000 + j, witness ? p2wpkh : p2pkh);
+        }
+        std::pmr::vector<consensus::TxOut> outputs;
+        outputs.emplace_back(kTxInputs * 10000, p2pkh);
+        consensus::Transaction tx(2, std::move(inputs), std::move(outputs), 0);
+    
+        // BIP143 hashes do not cover the witness, so they hold once it is in
+        const consensus::SigVersion sigversion = witness ? consensus::SigVersion::kWitnessV0
+                                                         : consensus::SigVersion::kBase;
+        std::pmr::vector<consensus::TxIn> signed_inputs = tx.inputs();
+        for (uint32_t j = 0; j < kTxInputs; j++) {
+            std::vector<uint8_t> sig;
+            crypto::SignEcdsa(seckey, consensus::SignatureHash(
+                                  p2pkh, tx, j, consensus::kSigHashAll, spent[j].value(),
+                                  sigversion), &sig);
+            sig.push_back(consensus::kSigHashAll);
+            if (witness) {
+                signed_inputs[j].set_scriptWitness(consensus::ScriptWitness(
+                    std::vector<std::vector<uint8_t> >{ sig, pubkey }));
+            }
+            else {
+                consensus::Script script_sig;
+                script_sig.Push(sig);
+                script_sig.Push(pubkey);
+                signed_inputs[j].set_scriptSig(script_sig);
+            }
+        }
+        tx.set_inputs(std::move(signed_inputs));
+    
+        batch.txs.push_back(std::move(tx));
+        batch.spent.push_back(std::move(spent));
+    }
+    
+    // once txs is done growing, the checks keep pointers into it
+    for (const consensus::Transaction& tx : batch.txs)
+        batch.txdata.emplace_back(tx);
+    
+    return batch;
+}
+
+const SignedBatch& BenchBatch()
+{
+    static const SignedBatch batch = CreateSignedBatch();
+    return batch;
+}
+
+// Verify every input of the batch through a queue, skipping transactions
+// the cache has when there is one, as block connecting does.
+bool VerifyOnce(const SignedBatch& batch, util::CheckQueue<consensus::ScriptCheck> *queue,
+                consensus::ScriptCache *cache)
+{
+    const uint32_t flags = consensus::kVerifyP2sh | consensus::kVerifyDerSig |
+                           consensus::kVerifyWitness;
+    std::vector<const consensus::Transaction*> verified;
+    util::CheckQueueControl<consensus::ScriptCheck> control(queue);
+    for (size_t i = 0; i < batch.txs.size(); i++) {
+        if (cache && cache->HaveScripts(batch.txs[i], flags))
+            continue;
+        std::vector<consensus::ScriptCheck> checks;
+        checks.reserve(kTxInputs);
+        for (size_t j = 0; j < kTxInputs; j++)
+            checks.emplace_back(batch.spent[i][j], batch.txs[i], j, flags, &batch.txdata[i],
+                                cache);
+        control.Add(std::move(checks));
+        verified.push_back(&batch.txs[i]);
+    }
+    if (!control.Wait())
+        return false;
+    
+    if (cache)
+        for (const consensus::Transaction *tx : verified)
+            cache->AddScripts(*tx, flags);
+    return true;
+}
+
+// On a queue of workers threads besides the calling one. A cache is filled
+// before the clock starts, so that every transaction is found in it.
+void VerifyBatch(State& state, size_t workers, consensus::ScriptCache *cache = nullptr)
+{
+    const SignedBatch& batch = BenchBatch();
+    util::CheckQueue<consensus::ScriptCheck> queue(workers);
+    std::chrono::nanoseconds verifying(0);
+    size_t failed = 0;
+    
+    if (cache)
+        VerifyOnce(batch, &queue, cache);
+    const util::CuckooCache::Stats warm = cache ? cache->script_stats()
+                                                : util::CuckooCache::Stats();
+    
+    while (state.KeepRunning()) {
+        auto start = std::chrono::steady_clock::now();
+        if (!VerifyOnce(batch, &queue, cache))
+            failed++;
+        verifying += std::chrono::steady_clock::now() - start;
+    }
+    
+    double seconds = std::chrono::duration<double>(verifying).count();
+    state.SetCounter("inputs/s", state.num_iters() * kTxs * kTxInputs / seconds);
+    state.SetCounter("threads", static_cast<double>(workers + 1));
+    state.SetCounter("failed", static_cast<double>(failed));
+    if (cache) {
+        util::CuckooCache::Stats stats = cache->script_stats();
+        stats.hits -= warm.hits;
+        stats.misses -= warm.misses;
+        state.SetCounter("hit_rate", stats.HitRate());
+    }
+}
+
+} // namespace
+
+static void ScriptVerify1Thread(State& state)
+{
+    VerifyBatch(state, 0);
+}
+
+static void ScriptVerify2Threads(State& state)
+{
+    VerifyBatch(state, 1);
+}
+
+static void ScriptVerify4Threads(State& state)
+{
+    VerifyBatch(state, 3);
+}
+
+// a thread per core
+static void ScriptVerifyAllCores(State& state)
+{
+    VerifyBatch(state, util::CheckQueue<consensus::ScriptCheck>::DefaultWorkers());
+}
+
+// Every transaction verified before, as for a block whose transactions the
+// node has seen already.
+static void ScriptVerifyCached(State& state)
+{
+    consensus::ScriptCache cache;
+    VerifyBatch(state, 0, &cache);
+}
+
+BENCHMARK(ScriptVerify1Thread, 5);
+BENCHMARK(ScriptVerify2Threads, 5);
+BENCHMARK(ScriptVerify4Threads, 5);
+BENCHMARK(ScriptVerifyAllCores, 5);
+BENCHMARK(ScriptVerifyCached, 5);
+
+} // namespace bench
+} // namespace btclite
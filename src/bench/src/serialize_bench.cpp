@@ -0,0 +1,122 @@
+#include "bench.h"
+
+#include "bench_util.h"
+#include "hash.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace bench {
+
+namespace {
+
+constexpr size_t kBlockTxs = 2000;
+
+} // namespace
+
+// Growing the output vector on every write, as before SerializedSize()
+// based reservation.
+static void SerializeBlockUnreserved(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> vec;
+        util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+        util::Serializer<util::ByteSink<std::vector<uint8_t> > > serializer(byte_sink);
+        serializer.SerialWrite(block);
+    }
+    state.SetCounter("block_bytes", block.SerializedSize());
+}
+
+static void SerializeBlockReserved(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        util::MemoryStream ms;
+        ms << block;
+    }
+    state.SetCounter("block_bytes", block.SerializedSize());
+}
+
+static void HashOStreamBlockReserved(State& state)
+{
+    consensus::Block block = CreateBenchBlock(kBlockTxs);
+    
+    while (state.KeepRunning()) {
+        crypto::HashOStream hs;
+        hs << block;
+    }
+    state.SetCounter("block_bytes", block.SerializedSize());
+}
+
+// 3000 txs of 2 inputs and 2 P2PKH outputs, allocs/op counts every script
+// that does not fit in Script's inline buffer.
+static void DeserializeBlock(State& state)
+{
+    consensus::Block block = CreateBenchBlock(3000);
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    block.Serialize(byte_sink);
+    
+    while (state.KeepRunning()) {
+        consensus::Block block2;
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        block2.Deserialize(byte_source);
+    }
+    state.SetCounter("block_bytes", vec.size());
+}
+
+// Same as DeserializeBlock, with the transactions drawn from the block's arena.
+static void DeserializeBlockArena(State& state)
+{
+    consensus::Block block = CreateBenchBlock(3000);
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    block.Serialize(byte_sink);
+    
+    while (state.KeepRunning()) {
+        consensus::Block block2;
+        block2.set_useArena(true);
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        block2.Deserialize(byte_source);
+    }
+    state.SetCounter("block_bytes", vec.size());
+}
+
+// Parse 3000 segwit transactions (2 P2WPKH inputs each) in the BIP144
+// format and keep them, alloc_bytes/op is their heap footprint.
+static void DeserializeWitnessTxs(State& state)
+{
+    consensus::Block block = CreateBenchBlock(3000, 2, 2, true);
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    for (const auto& tx : block.transactions())
+        tx->Serialize(byte_sink, true);
+    
+    while (state.KeepRunning()) {
+        std::vector<consensus::Transaction> txs(block.transactions().size());
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        for (auto& tx : txs)
+            tx.Deserialize(byte_source, true);
+    }
+    
+    size_t witness_bytes = 0;
+    for (const auto& tx : block.transactions())
+        for (const auto& input : tx->inputs())
+            witness_bytes += sizeof(consensus::ScriptWitness)
+                             + input.script_witness().allocated_memory();
+    state.SetCounter("witness_items", block.transactions().size() * 2 * 2);
+    state.SetCounter("witness_bytes", witness_bytes);
+}
+
+BENCHMARK(SerializeBlockUnreserved, 50);
+BENCHMARK(SerializeBlockReserved, 50);
+BENCHMARK(HashOStreamBlockReserved, 50);
+BENCHMARK(DeserializeBlock, 20);
+BENCHMARK(DeserializeBlockArena, 20);
+BENCHMARK(DeserializeWitnessTxs, 20);
+
+} // namespace bench
+} // namespace btclite
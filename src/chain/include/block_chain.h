@@ -2,8 +2,12 @@
 #define BTCLITE_CHAIN_BLOCK_CHAIN_H
 
 
+#include "block_connector.h"
 #include "block_index.h"
+#include "block_index_db.h"
+#include "block_store.h"
 #include "chain_state.h"
+#include "coins_db.h"
 #include "chain/include/params.h"
 
 
@@ -20,13 +24,31 @@ public:
     void Interrupt();
     void Stop();
     
+    //-------------------------------------------------------------------------
+    // Store block and connect it if it extends the best chain.
+    bool ProcessNewBlock(const consensus::Block& block);
+    
     //-------------------------------------------------------------------------    
     const ChainState& chain_state() const;    
     ChainState *mutable_chain_state();
+    // Hit and miss counts of the scripts and signatures skipped.
+    const consensus::ScriptCache& script_cache() const;
     
 private:
     const Params params_;
+    // serializes connecting blocks and flushing
+    util::CriticalSection cs_block_chain_;
     ChainState chain_state_;
+    BlockIndexDb block_index_db_;
+    BlockStore block_store_;
+    CoinsViewDb coins_db_;
+    CoinsViewCache coins_cache_;
+    ScriptCheckQueue script_checks_;
+    consensus::ScriptCache script_cache_;
+    BlockConnector connector_;
+    
+    bool ActivateBestChain();
+    bool Flush();
 };
 
 } // namespace chain
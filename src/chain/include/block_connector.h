@@ -0,0 +1,138 @@
+#ifndef BTCLITE_CHAIN_BLOCK_CONNECTOR_H
+#define BTCLITE_CHAIN_BLOCK_CONNECTOR_H
+
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "block.h"
+#include "check_queue.h"
+#include "coins.h"
+#include "consensus/include/params.h"
+#include "interpreter.h"
+#include "script_cache.h"
+#include "thread.h"
+
+
+namespace btclite {
+namespace chain {
+
+// Undo data of a block: the coins it spent, in the order of the inputs that
+// spent them.
+using BlockUndo = std::vector<Coin>;
+
+using ScriptCheckQueue = util::CheckQueue<consensus::ScriptCheck>;
+
+// Median time past of the block at a height below the one being connected,
+// which lock times and BIP68 sequence locks are measured against.
+using MedianTimePast = std::function<int64_t(uint32_t height)>;
+
+// Outcome of connecting a block. kError is no fault of the block: it is not
+// on top of the coins, or its undo data or coins could not be written, and
+// it may connect later.
+enum class ConnectResult {
+    kConnected,
+    kInvalid,
+    kError
+};
+
+/*
+ * Connects blocks to a coins cache in three stages, keeping disk reads and
+ * CPU-bound checks off the thread that applies them:
+ *
+ *   1. The coins the block spends are read from the store in parallel on
+ *      the thread pool and put into the cache.
+ *   2. While the reads go on, the context-free checks of its transactions
+ *      run in ranges on the pool and the caller, hashing the transactions
+ *      on the way. Once they are all done the caller checks the block's
+ *      structure, merkle root, weight, witness commitment and BIP34
+ *      coinbase height.
+ *   3. One thread spends the inputs and adds the outputs in a child cache,
+ *      checking amounts, coinbase maturity, lock times, BIP68 sequence
+ *      locks and, where BIP34 does not imply it, that no unspent coin is
+ *      overwritten (BIP30). It merges the child cache into the cache only
+ *      if the whole block is valid and its undo data written. The scripts
+ *      of every input it spends go to the check queue as it goes and are
+ *      waited for before the merge. Transactions the script cache has seen
+ *      pass under the same flags are not checked again.
+ *
+ * Prefetch() starts stage 1 for the next block before the current one is
+ * connected, so its reads overlap stages 2 and 3 of the block before. Reads
+ * that a cache flush may have made stale are dropped.
+ *
+ * Not thread safe; one thread connects blocks and flushes the cache.
+ */
+class BlockConnector : util::Uncopyable {
+public:
+    // Coinbase outputs can be spent this many blocks after their own.
+    static constexpr uint32_t kCoinbaseMaturity = 100;
+    
+    // store is the base view of coins. It is read from several threads at
+    // once, as CoinsViewDb allows. Without pool every stage runs on the
+    // caller, and without checks every script. script_cache, if given,
+    // holds the transactions and signatures that passed.
+    BlockConnector(const consensus::Params& params, CoinsViewCache *coins,
+                   const CoinsView *store, util::ThreadPool *pool = nullptr,
+                   ScriptCheckQueue *checks = nullptr,
+                   consensus::ScriptCache *script_cache = nullptr);
+    ~BlockConnector();
+    
+    //-------------------------------------------------------------------------
+    // Start reading the coins spent by block that the cache does not have.
+    void Prefetch(const consensus::Block& block);
+    
+    // Connect block at height on top of the cache's best block, which moves
+    // to block. *undo gets the spent coins. write_undo, if given, is handed
+    // them once the block is found valid and before the cache changes; the
+    // block is not connected if it fails. Without median_time_past the
+    // block's own time stands in for that of every block before it. On
+    // failure the cache holds no change beyond prefetched coins.
+    ConnectResult ConnectBlock(const consensus::Block& block, uint32_t height, BlockUndo *undo,
+                               const std::function<bool(const BlockUndo&)>& write_undo = nullptr,
+                               const MedianTimePast& median_time_past = nullptr);
+    
+    // The script rules in force for the block hash at height.
+    uint32_t ScriptFlags(const util::Hash256& hash, uint32_t height) const;
+    
+    //-------------------------------------------------------------------------
+    CoinsViewCache *coins() const
+    {
+        return coins_;
+    }
+
+private:
+    struct PendingFetch {
+        util::Hash256 block_hash;
+        uint64_t flushes = 0;
+        std::vector<consensus::OutPoint> outpoints;
+        // found[i] is nonzero if coins[i] was read
+        std::vector<Coin> coins;
+        std::vector<uint8_t> found;
+        std::vector<std::future<void> > futures;
+    };
+    
+    const consensus::Params& params_;
+    CoinsViewCache *coins_;
+    const CoinsView *store_;
+    util::ThreadPool *pool_;
+    ScriptCheckQueue *checks_;
+    consensus::ScriptCache *script_cache_;
+    std::unique_ptr<PendingFetch> pending_;
+    
+    std::unique_ptr<PendingFetch> StartFetch(const consensus::Block& block);
+    void FinishFetch(std::unique_ptr<PendingFetch> fetch);
+    bool CheckBlock(const consensus::Block& block, uint32_t height);
+    // BIP141 commitment of the coinbase to the witnesses, once segwit is in
+    // force; blocks without one carry no witnesses.
+    bool CheckWitnessCommitment(const consensus::Block& block, uint32_t height);
+    bool ApplyBlock(const consensus::Block& block, uint32_t height,
+                    const MedianTimePast& median_time_past, CoinsViewCache *view,
+                    BlockUndo *spent);
+};
+
+} // namespace chain
+} // namespace btclite
+
+#endif // BTCLITE_CHAIN_BLOCK_CONNECTOR_H
@@ -2,7 +2,12 @@
 #define BTCLITE_CHAIN_BLOCK_INDEX_H
 
 
+#include <atomic>
+#include <cassert>
+#include <mutex>
+
 #include "block.h"
+#include "util.h"
 
 
 namespace btclite {
@@ -48,18 +53,40 @@ enum BlockStatus : uint32_t {
     kBlockOptWitness       =   128, //!< block data in blk*.data was received with a witness-enforcing client
 };
 
+// Where a record is in the numbered blk/rev files of the BlockStore: the
+// file number and the offset of the record's data in it.
+struct FlatFilePos {
+    uint32_t file = 0;
+    uint32_t pos = 0;
+};
+
+// Stable 32-bit name of a BlockIndex in the BlockIndexArena, half the size
+// of a pointer. 0 is the null handle.
+using BlockIndexHandle = uint32_t;
+constexpr BlockIndexHandle kNullBlockIndex = 0;
+
+class BlockIndexArena;
+
 /*
  * The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
  * to it, but at most one of them can be part of the currently active branch.
+ *
+ * Entries live in the BlockIndexArena and link to each other by handle. Only
+ * entries created by the arena can be linked to, see BlockIndexArena::New().
  */
 class BlockIndex {
 public:    
     BlockIndex() = default;
     
     explicit BlockIndex(const consensus::BlockHeader& header)
-        : header_(header) {}
+        : version_(header.version()), time_(header.time()), bits_(header.bits()),
+          nonce_(header.nonce()), merkle_root_hash_(header.hashMerkleRoot()) {}
+    
+    // Entries are named by their address in the arena, copies would not be.
+    BlockIndex(const BlockIndex&) = delete;
+    BlockIndex& operator=(const BlockIndex&) = delete;
     
     //-------------------------------------------------------------------------
     // Check whether this block index entry is valid up to the passed validity level.
@@ -72,20 +99,22 @@ public:
     
     BlockIndex *GetAncestor(size_t height)
     {
-        return const_cast<BlockIndex*>(GetAncestor(height));
+        return const_cast<BlockIndex*>(static_cast<const BlockIndex*>(this)->GetAncestor(height));
     }
     
-    void BuildSkip()
-    {
-        if (pprev_) {
-            pskip_ = pprev_->GetAncestor(GetSkipHeight(height_));
-        }
-    }
+    void BuildSkip();
+    
+    // Median time of this block and the ten before it, BIP113.
+    int64_t GetMedianTimePast() const;
+    
+    // The header is stored without its previous block hash, which is the
+    // hash of pprev.
+    consensus::BlockHeader GetBlockHeader() const;
     
     //-------------------------------------------------------------------------
-    const consensus::BlockHeader& header() const
+    BlockIndexHandle handle() const
     {
-        return header_;
+        return handle_;
     }
     
     util::Hash256 block_hash() const
@@ -98,20 +127,11 @@ public:
         block_hash_ = hash;
     }
     
-    const BlockIndex *pprev() const
-    {
-        return pprev_;
-    }
-    
-    void set_pprev(BlockIndex *pprev)
-    {
-        pprev_ = pprev;
-    }
+    const BlockIndex *pprev() const;
+    BlockIndex *pprev();
+    void set_pprev(const BlockIndex *pprev);
     
-    const BlockIndex* pskip() const
-    {
-        return pskip_;
-    }
+    const BlockIndex* pskip() const;
     
     size_t height() const
     {
@@ -120,7 +140,7 @@ public:
     
     void set_height(size_t height)
     {
-        height_ = height;
+        height_ = static_cast<uint32_t>(height);
     }
     
     const util::uint256_t& chain_work() const
@@ -133,6 +153,16 @@ public:
         chain_work_ = chain_work;
     }
     
+    uint32_t time() const
+    {
+        return time_;
+    }
+    
+    uint32_t bits() const
+    {
+        return bits_;
+    }
+    
     uint32_t tx_num() const
     {
         return tx_num_;
@@ -173,24 +203,65 @@ public:
         sequence_id_ = id;
     }
     
-private:
-    consensus::BlockHeader header_;
+    // Valid with kBlockHaveData.
+    FlatFilePos GetBlockPos() const
+    {
+        return FlatFilePos{ file_, data_pos_ };
+    }
     
-    // the hash of this block
-    util::Hash256 block_hash_;
+    void set_block_pos(const FlatFilePos& pos)
+    {
+        file_ = pos.file;
+        data_pos_ = pos.pos;
+    }
     
-    // pointer to the index of the predecessor of this block
-    BlockIndex *pprev_ = nullptr;
+    // Valid with kBlockHaveUndo. The undo data is in the rev file numbered
+    // like the blk file of the block.
+    FlatFilePos GetUndoPos() const
+    {
+        return FlatFilePos{ file_, undo_pos_ };
+    }
     
-    // pointer to the index of some further predecessor of this block
-    BlockIndex *pskip_ = nullptr;
+    void set_undo_pos(uint32_t pos)
+    {
+        undo_pos_ = pos;
+    }
 
+private:
+    friend class BlockIndexArena;
+    friend class BlockIndexDb;
+    
+    // The fields read while walking the tree and comparing work come first,
+    // so that GetAncestor and BlockIndexWorkComparator touch a single cache
+    // line of an entry.
+    
+    // handle of the index of the predecessor of this block
+    BlockIndexHandle prev_ = kNullBlockIndex;
+    
+    // handle of the index of some further predecessor of this block
+    BlockIndexHandle skip_ = kNullBlockIndex;
+    
     // height of the entry in the chain. The genesis block has height 0
-    size_t height_ = 0;
-
+    uint32_t height_ = 0;
+    
+    // Verification status of this block. See enum BlockStatus
+    std::underlying_type_t<BlockStatus> status_ = kBlockValidUnknown;
+    
     // (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     util::uint256_t chain_work_ = 0;
     
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    int32_t sequence_id_ = 0;
+    
+    // this entry's own handle, kNullBlockIndex outside the arena
+    BlockIndexHandle handle_ = kNullBlockIndex;
+    
+    // block header fields
+    int32_t version_ = 0;
+    uint32_t time_ = 0;
+    uint32_t bits_ = 0;
+    uint32_t nonce_ = 0;
+    
     // Number of transactions in this block.
     // Note: in a potential headers-first mode, this number cannot be relied upon
     uint32_t tx_num_ = 0;
@@ -199,13 +270,20 @@ private:
     // This value will be non-zero only if and only if transactions for this block and all its parents are available.
     // Change to 64-bit type when necessary; won't happen before 2030
     uint32_t chain_tx_num_ = 0;
-
-    // Verification status of this block. See enum BlockStatus
-    std::underlying_type_t<BlockStatus> status_ = kBlockValidUnknown;
     
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    int32_t sequence_id_ = 0;
-
+    // Which blk/rev file pair the block is stored in
+    uint32_t file_ = 0;
+    
+    // Byte offset of the block data within blk?????.dat
+    uint32_t data_pos_ = 0;
+    
+    // Byte offset of the undo data within rev?????.dat
+    uint32_t undo_pos_ = 0;
+    
+    // the hash of this block
+    util::Hash256 block_hash_ = {};
+    
+    util::Hash256 merkle_root_hash_ = {};
     
     // Turn the lowest '1' bit in the binary representation of a number into a '0'.
     inline int InvertLowestOne(int n) const
@@ -227,6 +305,91 @@ private:
     }
 };
 
+static_assert(sizeof(BlockIndex) == 160, "BlockIndex layout changed");
+
+/*
+ * Storage of all BlockIndex entries, in chunks that never move, so that an
+ * entry is named by a 32-bit handle: the chunk number in the high bits and
+ * the slot in the low ones. Entries are never freed, like the block index
+ * itself.
+ *
+ * The chunk table has room for every handle and is filled in place, so Get()
+ * takes no lock. New() serializes callers on a mutex.
+ */
+class BlockIndexArena {
+public:
+    static constexpr unsigned int kChunkBits = 14;
+    static constexpr size_t kChunkSize = size_t{1} << kChunkBits;
+    static constexpr size_t kMaxChunks = size_t{1} << (32 - kChunkBits);
+    
+    // constexpr so that the static instance, chunk table included, is
+    // zero-initialized in place rather than written at startup
+    constexpr BlockIndexArena() = default;
+    BlockIndexArena(const BlockIndexArena&) = delete;
+    BlockIndexArena& operator=(const BlockIndexArena&) = delete;
+    
+    //-------------------------------------------------------------------------
+    BlockIndex *New();
+    BlockIndex *New(const consensus::BlockHeader& header);
+    // Default entries under count consecutive handles, for bulk loading.
+    // Returns the first handle.
+    BlockIndexHandle NewRange(size_t count);
+    
+    BlockIndex *Get(BlockIndexHandle handle) const
+    {
+        if (handle == kNullBlockIndex)
+            return nullptr;
+        BlockIndex *chunk = chunks_[handle >> kChunkBits].load(std::memory_order_acquire);
+        return chunk + (handle & (kChunkSize - 1));
+    }
+    
+    //-------------------------------------------------------------------------
+    // Number of entries handed out.
+    size_t size() const;
+    // Bytes of chunk storage reserved.
+    size_t allocated_memory() const;
+    
+private:
+    mutable std::mutex mutex_;
+    // handle 0 stays unused as the null handle
+    uint32_t next_ = 1;
+    std::atomic<BlockIndex*> chunks_[kMaxChunks] = {};
+};
+
+// Singleton pattern, thread safe after c++11
+class SingletonBlockIndexArena : util::Uncopyable {
+public:
+    static BlockIndexArena& GetInstance()
+    {
+        static BlockIndexArena arena;
+        return arena;
+    }
+    
+private:
+    SingletonBlockIndexArena() {}
+};
+
+inline const BlockIndex *BlockIndex::pprev() const
+{
+    return SingletonBlockIndexArena::GetInstance().Get(prev_);
+}
+
+inline BlockIndex *BlockIndex::pprev()
+{
+    return SingletonBlockIndexArena::GetInstance().Get(prev_);
+}
+
+inline void BlockIndex::set_pprev(const BlockIndex *pprev)
+{
+    assert(pprev == nullptr || pprev->handle_ != kNullBlockIndex);
+    prev_ = pprev ? pprev->handle_ : kNullBlockIndex;
+}
+
+inline const BlockIndex *BlockIndex::pskip() const
+{
+    return SingletonBlockIndexArena::GetInstance().Get(skip_);
+}
+
 struct BlockIndexWorkComparator
 {
     bool operator()(const BlockIndex *pa, const BlockIndex *pb) const 
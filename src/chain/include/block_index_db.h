@@ -0,0 +1,80 @@
+#ifndef BTCLITE_CHAIN_BLOCK_INDEX_DB_H
+#define BTCLITE_CHAIN_BLOCK_INDEX_DB_H
+
+
+#include <vector>
+
+#include "block_index.h"
+#include "chain_state.h"
+#include "fs.h"
+#include "thread.h"
+
+
+namespace btclite {
+namespace chain {
+
+/*
+ * The block index on disk, as two files of fixed-size binary records:
+ * blockindex.dat is a snapshot of every entry and blockindex.log holds the
+ * entries changed since, appended in flush order. A later record for the
+ * same block replaces an earlier one, and the log also records the active
+ * tip. Once the log grows past a fraction of the snapshot, Compact()
+ * writes a new snapshot and starts an empty log.
+ *
+ * Loading maps both files and rebuilds the entries, their links, chain
+ * work and skip pointers in ranges spread over a thread pool. Load() comes
+ * first, it reads the generation that Append() and Compact() continue.
+ */
+class BlockIndexDb : util::Uncopyable {
+public:
+    static constexpr uint32_t kVersion = 2;
+    static constexpr size_t kHeaderSize = 64;
+    static constexpr size_t kRecordSize = 144;
+    // Below this many log records compaction is not worth a full rewrite.
+    static constexpr size_t kMinCompactRecords = 10000;
+    
+    explicit BlockIndexDb(const fs::path& path);
+    
+    //-------------------------------------------------------------------------
+    // Append entries to the log, then a record of tip if it is not null.
+    bool Append(const std::vector<const BlockIndex*>& entries, const BlockIndex *tip);
+    
+    // Replace the snapshot with all entries of map and empty the log.
+    bool Compact(const ChainState::BlockMap& map, const BlockIndex *tip);
+    
+    // Whether the log has grown enough that Compact() should replace Append().
+    bool NeedCompact() const;
+    
+    // Rebuild the stored entries into the block index arena and map, which
+    // must be empty. *tip_hash is set to the stored tip, or null if none was
+    // stored. With pool the work is shared with its threads. Missing files
+    // load as an empty index.
+    bool Load(ChainState::BlockMap *map, util::Hash256 *tip_hash,
+              util::ThreadPool *pool = nullptr);
+    
+    //-------------------------------------------------------------------------
+    const fs::path& path_snapshot() const;
+    const fs::path& path_log() const;
+    size_t snapshot_records() const;
+    size_t log_records() const;
+
+private:
+    const std::string default_snapshot_file = "blockindex.dat";
+    const std::string default_log_file = "blockindex.log";
+    
+    fs::path path_snapshot_;
+    fs::path path_log_;
+    // snapshot generation, a log of any other one is stale
+    uint64_t generation_ = 0;
+    size_t snapshot_records_ = 0;
+    size_t log_records_ = 0;
+    
+    static void EncodeEntry(const BlockIndex& index, uint8_t *out);
+    static void EncodeTip(const BlockIndex& tip, uint8_t *out);
+    static void DecodeEntry(const uint8_t *in, BlockIndex *index);
+};
+
+} // namespace chain
+} // namespace btclite
+
+#endif // BTCLITE_CHAIN_BLOCK_INDEX_DB_H
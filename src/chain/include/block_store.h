@@ -0,0 +1,124 @@
+#ifndef BTCLITE_CHAIN_BLOCK_STORE_H
+#define BTCLITE_CHAIN_BLOCK_STORE_H
+
+
+#include <memory>
+#include <vector>
+
+#include "blob.h"
+#include "block.h"
+#include "block_index.h"
+#include "fs.h"
+#include "mapped_file.h"
+#include "sync.h"
+
+
+namespace btclite {
+namespace chain {
+
+/*
+ * Full blocks and their undo data, appended to numbered flat files under
+ * blocks/: blk00000.dat, blk00001.dat, ... hold blocks in the order they
+ * arrive, and rev?????.dat the undo data of the blocks in the blk file of
+ * the same number. A record is a 4-byte marker, the 4-byte length of its
+ * data and the data; a FlatFilePos points at the data.
+ *
+ * Files grow in preallocated chunks, and a blk file is trimmed and synced
+ * once the next block would take it past its maximum size. Writes are not
+ * synced one by one: Flush() syncs every file written since its last call,
+ * and has to come before the block index that points into them is written.
+ *
+ * Reads come straight out of a shared read-only mapping of each file, with
+ * room for the file to grow to that size so that appending never moves it.
+ * ReadRawBlock() returns the serialized block in place, ready to be sent to
+ * a peer without a copy; the view stays valid for the life of the store.
+ */
+class BlockStore : util::Uncopyable {
+public:
+    static constexpr uint32_t kRecordMagic = 0x43455242; // "BREC"
+    static constexpr size_t kRecordHeaderSize = 8;
+    static constexpr size_t kMaxBlockFileSize = 0x8000000; // 128 MiB
+    static constexpr size_t kBlockFileChunkSize = 0x1000000; // 16 MiB
+    static constexpr size_t kUndoFileChunkSize = 0x100000; // 1 MiB
+    
+    // max_file_size is lowered by tests only.
+    explicit BlockStore(const fs::path& path, size_t max_file_size = kMaxBlockFileSize);
+    ~BlockStore();
+    
+    //-------------------------------------------------------------------------
+    // Create the blocks directory if needed and find where the last blk file
+    // ends. Records torn by a crash at the end of a file are written over.
+    bool Open();
+    
+    // Sync every file written since the last call.
+    bool Flush();
+    
+    //-------------------------------------------------------------------------
+    // Append block to the last blk file, or to a new one if it would not
+    // fit, and set *pos to where it went.
+    bool WriteBlock(const consensus::Block& block, FlatFilePos *pos);
+    
+    // Append the undo data of a block stored in blk file number file to the
+    // rev file of that number.
+    bool WriteUndo(const util::ByteSpan& undo, uint32_t file, FlatFilePos *pos);
+    
+    bool ReadBlock(const FlatFilePos& pos, consensus::Block *block) const;
+    
+    // The stored data at pos, or an empty span if there is no record there.
+    util::ByteSpan ReadRawBlock(const FlatFilePos& pos) const;
+    util::ByteSpan ReadRawUndo(const FlatFilePos& pos) const;
+    
+    //-------------------------------------------------------------------------
+    const fs::path& path_blocks() const;
+    fs::path BlockFilePath(uint32_t file) const;
+    fs::path UndoFilePath(uint32_t file) const;
+    
+    // Number of the blk file that blocks are appended to.
+    uint32_t last_file() const;
+
+private:
+    enum FileType {
+        kBlockFile,
+        kUndoFile,
+        kFileTypes
+    };
+    
+    struct FlatFile {
+        // open for writing, -1 if not
+        int fd = -1;
+        // end of the last record
+        size_t size = 0;
+        // bytes preallocated on disk, records included
+        size_t allocated = 0;
+        bool dirty = false;
+        // the mapping for reads, and the smaller ones it replaced, which
+        // readers may still be looking into
+        std::unique_ptr<util::MappedFile> mapped;
+        std::vector<std::unique_ptr<util::MappedFile> > retired;
+    };
+    
+    const std::string default_blocks_dir = "blocks";
+    
+    fs::path path_blocks_;
+    const size_t max_file_size_;
+    
+    mutable util::CriticalSection cs_block_store_;
+    // per type, indexed by file number; unscanned files are null
+    mutable std::vector<std::unique_ptr<FlatFile> > files_[kFileTypes];
+    uint32_t last_file_ = 0;
+    bool dir_dirty_ = false;
+    // reused for serializing blocks
+    std::vector<uint8_t> write_buf_;
+    
+    fs::path FilePath(FileType type, uint32_t file) const;
+    FlatFile *GetFile(FileType type, uint32_t file) const;
+    bool Append(FileType type, uint32_t file, const uint8_t *record, size_t size,
+                FlatFilePos *pos);
+    bool FinalizeFile(FileType type, uint32_t file);
+    util::ByteSpan ReadRaw(FileType type, const FlatFilePos& pos) const;
+};
+
+} // namespace chain
+} // namespace btclite
+
+#endif // BTCLITE_CHAIN_BLOCK_STORE_H
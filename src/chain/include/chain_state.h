@@ -1,15 +1,21 @@
 #ifndef BTCLITE_CHAIN_CHAIN_STATE_H
 #define BTCLITE_CHAIN_CHAIN_STATE_H
 
+#include <map>
 
+#include "block_connector.h"
 #include "block_index.h"
 #include "chain/include/params.h"
+#include "thread.h"
 #include "util.h"
 
 
 namespace btclite {
 namespace chain {
 
+class BlockIndexDb;
+class BlockStore;
+
 // An in-memory indexed chain of blocks.
 class Chain : util::Uncopyable {
 public:
@@ -17,13 +23,13 @@ public:
     // or nullptr if none.
     BlockIndex *Genesis() const 
     {
-        return active_chain_.size() > 0 ? active_chain_[0] : nullptr;
+        return active_chain_.size() > 0 ? Get(active_chain_[0]) : nullptr;
     }
 
     // Returns the index entry for the tip of this chain, or nullptr if none.
     BlockIndex *Tip() const 
     {
-        return active_chain_.size() > 0 ? active_chain_[active_chain_.size() - 1] : nullptr;
+        return active_chain_.size() > 0 ? Get(active_chain_[active_chain_.size() - 1]) : nullptr;
     }
     
     // Returns the index entry at a particular height in this chain,
@@ -32,7 +38,7 @@ public:
     {
         if (height < 0 || height >= active_chain_.size())
             return nullptr;
-        return active_chain_[height];
+        return Get(active_chain_[height]);
     }
 
     // Compare two chains efficiently.
@@ -50,7 +56,8 @@ public:
     // Efficiently check whether a block is present in this chain.
     bool IsExist(const BlockIndex *pindex) const 
     {
-        return GetBlockIndex(pindex->height()) == pindex;
+        return pindex->height() < active_chain_.size() &&
+               active_chain_[pindex->height()] == pindex->handle();
     }
 
     // Find the successor of a block in this chain, 
@@ -76,23 +83,60 @@ public:
     const BlockIndex *FindFork(const BlockIndex *pindex) const;
     
     //-------------------------------------------------------------------------
-    const std::vector<BlockIndex*>& active_chain() const
+    const std::vector<BlockIndexHandle>& active_chain() const
     {
         return active_chain_;
     }
     
 private:
-    std::vector<BlockIndex*> active_chain_;
+    // handles rather than pointers, half the size at 800k+ blocks
+    std::vector<BlockIndexHandle> active_chain_;
+    
+    static BlockIndex *Get(BlockIndexHandle handle)
+    {
+        return SingletonBlockIndexArena::GetInstance().Get(handle);
+    }
 };
 
 class ChainState {
 public:
-    using BlockMap = std::unordered_map<
-                     util::Hash256, BlockIndex*, crypto::Hasher<util::Hash256> >;
+    using BlockMap = crypto::Hash256Map<BlockIndex*>;
     
-    bool LoadGenesisBlock(const consensus::Block& genesis_block);
+    // Add the genesis block to the index and the active chain, with its
+    // data written to store and connected by connector, unless the loaded
+    // index already has it.
+    bool LoadGenesisBlock(const consensus::Block& genesis_block, BlockStore *store,
+                          BlockConnector *connector);
     void CheckBlockIndex(const BlockIndex *genesis, const BlockIndex *tip);
     
+    // Rebuild the block index and the active chain from db, into an empty
+    // chain state.
+    bool LoadBlockIndex(BlockIndexDb *db, util::ThreadPool *pool = nullptr);
+    // Write the entries changed since the last flush and the tip to db.
+    bool FlushBlockIndex(BlockIndexDb *db);
+    
+    // Add a header whose parent is in the index, so that its block can be
+    // accepted before the blocks in between.
+    bool AcceptBlockHeader(const consensus::BlockHeader& header);
+    
+    // Add a block whose parent is in the index, with its data written to
+    // store. ActivateBestChain() connects it once it is on the best chain,
+    // and the blocks before it have their data too.
+    bool AcceptBlock(const consensus::Block& block, BlockStore *store);
+    
+    // Connect the blocks from the tip up to the best candidate, reading them
+    // from store. Returns early once the coins cache of connector needs a
+    // flush; call again after flushing it. Blocks found invalid are marked
+    // so, false is returned when one could not be read or connected for
+    // any other reason.
+    bool ActivateBestChain(BlockStore *store, BlockConnector *connector);
+    
+    // Move the active chain back to its block best_block, or before the
+    // genesis block if best_block is null. The coins are flushed after the
+    // index, so a crash in between leaves them behind the loaded tip, and
+    // ActivateBestChain() then connects the blocks since again.
+    bool RewindTip(const util::Hash256& best_block);
+    
     uint32_t ActiveChainHeight() const
     {
         LOCK(cs_chain_state_);
@@ -105,11 +149,24 @@ private:
     BlockMap map_block_index_;    
     std::set<BlockIndex*> set_dirty_block_index_;
     std::set<BlockIndex*, BlockIndexWorkComparator> set_block_index_candidates_;    
+    // blocks with data whose parent has none yet, by parent
+    std::multimap<BlockIndex*, BlockIndex*> map_blocks_unlinked_;
+    // Blocks loaded from disk are assigned id 0, so start the counter at 1.
+    int32_t block_sequence_id_ = 1;
     BlockIndex *pindex_best_header_ = nullptr;
+    // tip last written to the block index db
+    const BlockIndex *flushed_tip_ = nullptr;
+    // heaviest fork last warned about not being switched to
+    const BlockIndex *fork_warned_ = nullptr;
     
+    BlockIndex *AcceptHeader(const consensus::BlockHeader& header);
     BlockIndex *AddToBlockIndex(const consensus::BlockHeader& header);
-    bool ReceivedBlockTransactions(const consensus::Block& block, BlockIndex *pindex);
-    bool ConnectTip(BlockIndex *pindex);
+    bool ReceivedBlockTransactions(const consensus::Block& block, BlockIndex *pindex,
+                                   const FlatFilePos& pos);
+    ConnectResult ConnectTip(BlockIndex *pindex, const consensus::Block& block,
+                             BlockStore *store, BlockConnector *connector);
+    void InvalidBlockFound(BlockIndex *pindex);
+    void PruneBlockIndexCandidates();
 };
 
 } // namesapce chain
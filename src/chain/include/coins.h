@@ -0,0 +1,230 @@
+#ifndef BTCLITE_CHAIN_COINS_H
+#define BTCLITE_CHAIN_COINS_H
+
+
+#include "flat_hash_map.h"
+#include "hash.h"
+#include "transaction.h"
+#include "util.h"
+
+
+namespace btclite {
+namespace chain {
+
+// An unspent transaction output together with the height of the block that
+// created it and whether it was a coinbase output. A spent coin is one with
+// a null output.
+class Coin {
+public:
+    Coin();
+    Coin(const consensus::TxOut& out, uint32_t height, bool coinbase);
+    Coin(consensus::TxOut&& out, uint32_t height, bool coinbase) noexcept;
+    
+    //-------------------------------------------------------------------------
+    // Mark spent and release the script.
+    void Clear();
+    bool IsSpent() const;
+    
+    // Heap bytes held by the output script.
+    size_t DynamicMemoryUsage() const;
+    
+    //-------------------------------------------------------------------------
+    template <typename Stream>
+    void Serialize(Stream& os) const
+    {
+        util::Serializer<Stream> serializer(os);
+        serializer.SerialWrite(static_cast<uint32_t>(height_ * 2 + coinbase_));
+        serializer.SerialWrite(out_);
+    }
+    
+    template <typename Stream>
+    void Deserialize(Stream& is)
+    {
+        util::Deserializer<Stream> deserializer(is);
+        uint32_t code = 0;
+        deserializer.SerialRead(&code);
+        height_ = code >> 1;
+        coinbase_ = code & 1;
+        deserializer.SerialRead(&out_);
+    }
+    
+    //-------------------------------------------------------------------------
+    bool operator==(const Coin& b) const;
+    bool operator!=(const Coin& b) const;
+    
+    //-------------------------------------------------------------------------
+    const consensus::TxOut& out() const
+    {
+        return out_;
+    }
+    
+    uint32_t height() const
+    {
+        return height_;
+    }
+    
+    bool coinbase() const
+    {
+        return coinbase_;
+    }
+
+private:
+    consensus::TxOut out_;
+    uint32_t height_ : 31;
+    uint32_t coinbase_ : 1;
+};
+
+// Hasher for OutPoint-keyed hash tables, salted per instance like
+// crypto::SaltedHash256Hasher.
+class SaltedOutPointHasher {
+public:
+    SaltedOutPointHasher();
+    
+    size_t operator()(const consensus::OutPoint& outpoint) const
+    {
+        return crypto::SipHashUint256Extra(k0_, k1_, outpoint.prev_hash(), outpoint.index());
+    }
+
+private:
+    uint64_t k0_;
+    uint64_t k1_;
+};
+
+struct CoinsCacheEntry {
+    enum Flags : uint8_t {
+        // differs from the coin in the parent view
+        kDirty = 1,
+        // the parent view has no unspent coin for it, so once spent the
+        // entry can be dropped instead of written down
+        kFresh = 2
+    };
+    
+    Coin coin;
+    uint8_t flags = 0;
+    
+    CoinsCacheEntry() = default;
+    explicit CoinsCacheEntry(Coin&& c)
+        : coin(std::move(c)) {}
+};
+
+using CoinsMap = util::FlatHashMap<consensus::OutPoint, CoinsCacheEntry, SaltedOutPointHasher>;
+
+/*
+ * A view of the unspent outputs as of some best block. The views stack: a
+ * cache answers from memory and asks its base view for what it does not
+ * have, down to the database at the bottom.
+ */
+class CoinsView {
+public:
+    virtual ~CoinsView() = default;
+    
+    // Set *coin to the unspent coin at outpoint. False if there is none.
+    virtual bool GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const = 0;
+    virtual bool HaveCoin(const consensus::OutPoint& outpoint) const;
+    
+    // Hash of the block the view is up to date with, null if none yet.
+    virtual util::Hash256 GetBestBlock() const = 0;
+    
+    // Apply the dirty entries of coins and move the view to best_block. The
+    // entries may be moved from, the caller drops them afterwards.
+    virtual bool BatchWrite(CoinsMap *coins, const util::Hash256& best_block) = 0;
+    
+    // Rough size of the view in bytes, 0 if unknown.
+    virtual size_t EstimateSize() const;
+};
+
+/*
+ * A write-back cache over another view. Coins read from the base are kept,
+ * coins added and spent while connecting blocks only change the cache, and
+ * Flush() writes all the changes down in one batch and empties the cache.
+ *
+ * Each entry records whether it differs from the base (dirty) and whether
+ * the base has no unspent coin for it (fresh). A fresh coin spent before a
+ * flush, the common case for outputs spent soon after they are created, is
+ * simply dropped and never reaches the base.
+ *
+ * Not thread safe; its owner serializes access.
+ */
+class CoinsViewCache : public CoinsView, util::Uncopyable {
+public:
+    // Flush once the cache uses more than this, by default.
+    static constexpr size_t kDefaultMaxMemory = 450 << 20;
+    
+    explicit CoinsViewCache(CoinsView *base, size_t max_memory = kDefaultMaxMemory);
+    
+    //-------------------------------------------------------------------------
+    bool GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const override;
+    bool HaveCoin(const consensus::OutPoint& outpoint) const override;
+    util::Hash256 GetBestBlock() const override;
+    bool BatchWrite(CoinsMap *coins, const util::Hash256& best_block) override;
+    
+    //-------------------------------------------------------------------------
+    // The unspent coin at outpoint, or nullptr. Valid until the cache is
+    // next changed.
+    const Coin *AccessCoin(const consensus::OutPoint& outpoint) const;
+    
+    // Add an unspent coin. Unless possible_overwrite, adding over an unspent
+    // coin is an error; it is allowed for the duplicate coinbases of BIP30.
+    // Unspendable outputs are not stored.
+    bool AddCoin(const consensus::OutPoint& outpoint, Coin&& coin, bool possible_overwrite);
+    
+    // Add the outputs of tx, created in the block at height.
+    bool AddCoins(const consensus::Transaction& tx, uint32_t height);
+    
+    // Spend the coin at outpoint, moving it to *moveout if not null. False if
+    // there is no unspent coin there.
+    bool SpendCoin(const consensus::OutPoint& outpoint, Coin *moveout = nullptr);
+    
+    // Drop the entry for outpoint if it is unchanged, e.g. after a read
+    // that turned out to be unneeded.
+    void Uncache(const consensus::OutPoint& outpoint);
+    
+    // Whether outpoint has an entry, spent or not, without asking the base.
+    bool HaveCoinInCache(const consensus::OutPoint& outpoint) const;
+    
+    // Keep coin, read from the base by the caller, unless outpoint already
+    // has an entry. The base must not have been flushed to since the read.
+    void CacheCoin(const consensus::OutPoint& outpoint, Coin&& coin);
+    
+    void SetBestBlock(const util::Hash256& best_block);
+    
+    // Write the changes to the base view and empty the cache.
+    bool Flush();
+    
+    //-------------------------------------------------------------------------
+    // Bytes held by the table and the scripts of its coins.
+    size_t DynamicMemoryUsage() const;
+    
+    // Whether the cache has outgrown max_memory and should be flushed.
+    bool NeedFlush() const;
+    
+    size_t CacheSize() const;
+    
+    // Number of flushes so far, to tell whether a read from the base is
+    // older than the last one.
+    uint64_t flushes() const
+    {
+        return flushes_;
+    }
+    
+    size_t max_memory() const
+    {
+        return max_memory_;
+    }
+
+private:
+    CoinsView *base_;
+    const size_t max_memory_;
+    mutable util::Hash256 best_block_;
+    mutable CoinsMap cache_coins_;
+    // script bytes of the cached coins
+    mutable size_t cached_coins_usage_ = 0;
+    uint64_t flushes_ = 0;
+    
+    CoinsMap::iterator FetchCoin(const consensus::OutPoint& outpoint) const;
+};
+
+} // namespace chain
+} // namespace btclite
+
+#endif // BTCLITE_CHAIN_COINS_H
@@ -0,0 +1,56 @@
+#ifndef BTCLITE_CHAIN_COINS_DB_H
+#define BTCLITE_CHAIN_COINS_DB_H
+
+
+#include <memory>
+
+#include <rocksdb/db.h>
+
+#include "coins.h"
+#include "fs.h"
+
+
+namespace btclite {
+namespace chain {
+
+/*
+ * The unspent outputs on disk, in a RocksDB database under chainstate/. A
+ * coin is stored under 'C' followed by its outpoint, and the best block
+ * under 'B'. BatchWrite() applies a whole cache flush and the new best
+ * block as one synced write batch, so after a crash the database is at
+ * some flushed best block and never between two.
+ *
+ * GetCoin() may be called from several threads at once.
+ */
+class CoinsViewDb : public CoinsView, util::Uncopyable {
+public:
+    static constexpr uint8_t kCoinKey = 'C';
+    static constexpr uint8_t kBestBlockKey = 'B';
+    static constexpr size_t kCoinKeySize = 1 + sizeof(util::Hash256) + sizeof(uint32_t);
+    
+    explicit CoinsViewDb(const fs::path& path);
+    
+    //-------------------------------------------------------------------------
+    // Open the database, creating it if missing.
+    bool Open();
+    
+    //-------------------------------------------------------------------------
+    bool GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const override;
+    util::Hash256 GetBestBlock() const override;
+    bool BatchWrite(CoinsMap *coins, const util::Hash256& best_block) override;
+    size_t EstimateSize() const override;
+    
+    //-------------------------------------------------------------------------
+    const fs::path& path_chainstate() const;
+
+private:
+    const std::string default_chainstate_dir = "chainstate";
+    
+    fs::path path_chainstate_;
+    std::unique_ptr<rocksdb::DB> db_;
+};
+
+} // namespace chain
+} // namespace btclite
+
+#endif // BTCLITE_CHAIN_COINS_DB_H
@@ -7,7 +7,12 @@ namespace btclite {
 namespace chain {
 
 BlockChain::BlockChain(const util::Configuration& config)
-    : params_(config.btcnet()) 
+    : params_(config.btcnet()), block_index_db_(config.path_data_dir()),
+      block_store_(config.path_data_dir()), coins_db_(config.path_data_dir()),
+      coins_cache_(&coins_db_),
+      script_checks_(), script_cache_(),
+      connector_(params_.consensus_params(), &coins_cache_, &coins_db_,
+                 &util::SingletonThreadPool::GetInstance(), &script_checks_, &script_cache_)
 {
 }
 
@@ -15,7 +20,26 @@ bool BlockChain::Init()
 {
     BTCLOG(LOG_LEVEL_INFO) << "Initializing block chain...";
     
-    chain_state_.LoadGenesisBlock(params_.consensus_params().GenesisBlock());
+    if (!chain_state_.LoadBlockIndex(&block_index_db_, &util::SingletonThreadPool::GetInstance())) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Loading block index failed, remove "
+                                << block_index_db_.path_snapshot() << " and "
+                                << block_index_db_.path_log() << " to start over.";
+        return false;
+    }
+    
+    if (!block_store_.Open() || !coins_db_.Open())
+        return false;
+    if (!chain_state_.RewindTip(coins_cache_.GetBestBlock())) {
+        BTCLOG(LOG_LEVEL_ERROR) << "The coins do not match the block index, remove "
+                                << coins_db_.path_chainstate() << " and the block index "
+                                << "to start over.";
+        return false;
+    }
+    if (!chain_state_.LoadGenesisBlock(params_.consensus_params().GenesisBlock(), &block_store_,
+                                       &connector_))
+        return false;
+    if (!ActivateBestChain() || !Flush())
+        return false;
     
     BTCLOG(LOG_LEVEL_INFO) << "Finished initializing block chain.";
     
@@ -33,6 +57,14 @@ void BlockChain::Interrupt()
 
 void BlockChain::Stop()
 {
+    LOCK(cs_block_chain_);
+    Flush();
+}
+
+bool BlockChain::ProcessNewBlock(const consensus::Block& block)
+{
+    LOCK(cs_block_chain_);
+    return chain_state_.AcceptBlock(block, &block_store_) && ActivateBestChain();
 }
 
 const ChainState& BlockChain::chain_state() const
@@ -45,5 +77,38 @@ ChainState* BlockChain::mutable_chain_state()
     return &chain_state_;
 }
 
+const consensus::ScriptCache& BlockChain::script_cache() const
+{
+    return script_cache_;
+}
+
+bool BlockChain::ActivateBestChain()
+{
+    while (true) {
+        if (!chain_state_.ActivateBestChain(&block_store_, &connector_))
+            return false;
+        if (!coins_cache_.NeedFlush())
+            return true;
+        if (!Flush())
+            return false;
+    }
+}
+
+// Block and undo data is synced before the index entries that point into
+// it, and the index before the coins, which can then only be behind it.
+bool BlockChain::Flush()
+{
+    const util::CuckooCache::Stats scripts = script_cache_.script_stats();
+    const util::CuckooCache::Stats signatures = script_cache_.signature_stats();
+    BTCLOG(LOG_LEVEL_VERBOSE) << "Script cache hit rate: transactions " << scripts.HitRate()
+                              << " (" << scripts.hits << "/" << scripts.hits + scripts.misses
+                              << "), signatures " << signatures.HitRate()
+                              << " (" << signatures.hits << "/"
+                              << signatures.hits + signatures.misses << ")";
+    
+    return block_store_.Flush() && chain_state_.FlushBlockIndex(&block_index_db_) &&
+           coins_cache_.Flush();
+}
+
 } // namespace chain
 } // namespace btclite
@@ -0,0 +1,403 @@
+#include "block_connector.h"
+
+#include <atomic>
+
+#include "merkle.h"
+#include "tx_check.h"
+
+
+namespace btclite {
+namespace chain {
+
+namespace {
+
+// Per task. Coin reads are costly enough to share out in small ranges.
+constexpr size_t kMinFetchRange = 64;
+constexpr size_t kMinCheckRange = 256;
+
+// BIP141 witness commitment: OP_RETURN, a 36-byte push of 0xaa21a9ed and
+// the commitment hash.
+constexpr uint8_t kWitnessCommitmentHeader[] = { 0x6a, 0x24, 0xaa, 0x21, 0xa9, 0xed };
+constexpr size_t kWitnessCommitmentSize = sizeof(kWitnessCommitmentHeader) + kHashSize;
+
+// Some coinbases before BIP34 start with what reads as a height from here
+// on, so BIP30 holds again.
+constexpr uint32_t kBip34ImpliesBip30Limit = 1983702;
+
+bool Reject(const consensus::Block& block, const char *reason)
+{
+    const util::Hash256 hash = block.GetHash();
+    BTCLOG(LOG_LEVEL_WARNING) << "Block " << util::EncodeHex(hash.rbegin(), hash.rend())
+                              << " can not be connected: " << reason;
+    return false;
+}
+
+// The coinbase output holding the witness commitment, the last one if there
+// are several, or null.
+const consensus::TxOut *WitnessCommitment(const consensus::Block& block)
+{
+    const std::pmr::vector<consensus::TxOut>& outputs = block.transactions()[0]->outputs();
+    for (auto it = outputs.rbegin(); it != outputs.rend(); ++it) {
+        const consensus::Script& script = it->script_pub_key();
+        if (script.size() >= kWitnessCommitmentSize &&
+                std::equal(std::begin(kWitnessCommitmentHeader),
+                           std::end(kWitnessCommitmentHeader), script.begin()))
+            return &(*it);
+    }
+    
+    return nullptr;
+}
+
+} // namespace
+
+BlockConnector::BlockConnector(const consensus::Params& params, CoinsViewCache *coins,
+                               const CoinsView *store, util::ThreadPool *pool,
+                               ScriptCheckQueue *checks, consensus::ScriptCache *script_cache)
+    : params_(params), coins_(coins), store_(store), pool_(pool), checks_(checks),
+      script_cache_(script_cache)
+{
+}
+
+BlockConnector::~BlockConnector()
+{
+    if (pending_)
+        for (auto& future : pending_->futures)
+            future.wait();
+}
+
+void BlockConnector::Prefetch(const consensus::Block& block)
+{
+    if (pending_)
+        FinishFetch(std::move(pending_));
+    pending_ = StartFetch(block);
+}
+
+uint32_t BlockConnector::ScriptFlags(const util::Hash256& hash, uint32_t height) const
+{
+    const consensus::SoftForkHeights& forks = params_.SoftForks();
+    
+    // P2SH and segwit hold from genesis, no block before them breaks them
+    // but this one
+    uint32_t flags = consensus::kVerifyNone;
+    if (hash != forks.bip16_exception)
+        flags |= consensus::kVerifyP2sh | consensus::kVerifyWitness;
+    
+    if (height >= forks.bip66)
+        flags |= consensus::kVerifyDerSig;
+    if (height >= forks.bip65)
+        flags |= consensus::kVerifyCheckLockTime;
+    if (height >= forks.csv)
+        flags |= consensus::kVerifyCheckSequence;
+    if (height >= forks.segwit)
+        flags |= consensus::kVerifyNullDummy;
+    
+    return flags;
+}
+
+ConnectResult BlockConnector::ConnectBlock(
+    const consensus::Block& block, uint32_t height, BlockUndo *undo,
+    const std::function<bool(const BlockUndo&)>& write_undo,
+    const MedianTimePast& median_time_past)
+{
+    const util::Hash256 hash = block.GetHash();
+    std::unique_ptr<PendingFetch> fetch;
+    if (pending_ && pending_->block_hash == hash)
+        fetch = std::move(pending_);
+    else
+        fetch = StartFetch(block);
+    
+    // The genesis coinbase has never been spendable, nothing to apply.
+    if (height == 0) {
+        FinishFetch(std::move(fetch));
+        coins_->SetBestBlock(hash);
+        return ConnectResult::kConnected;
+    }
+    
+    if (block.header().hashPrevBlock() != coins_->GetBestBlock()) {
+        FinishFetch(std::move(fetch));
+        Reject(block, "not on top of the coins");
+        return ConnectResult::kError;
+    }
+    
+    // stage 2, the pool also serves the reads queued before
+    const std::vector<consensus::TransactionRef>& transactions = block.transactions();
+    std::atomic<bool> txs_valid(true);
+    util::ForEachRange(pool_, transactions.size(), kMinCheckRange,
+                       [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end && txs_valid.load(std::memory_order_relaxed); i++) {
+            // hashed here, for the merkle root and the coins, in parallel
+            transactions[i]->GetHash();
+            if (!consensus::CheckTransaction(*transactions[i]))
+                txs_valid.store(false, std::memory_order_relaxed);
+        }
+    });
+    bool valid = txs_valid && CheckBlock(block, height);
+    
+    FinishFetch(std::move(fetch));
+    if (!valid)
+        return ConnectResult::kInvalid;
+    
+    // stage 3, merged once the undo data is safe
+    CoinsViewCache view(coins_);
+    BlockUndo spent;
+    if (!ApplyBlock(block, height, median_time_past, &view, &spent))
+        return ConnectResult::kInvalid;
+    if (write_undo && !write_undo(spent)) {
+        Reject(block, "writing undo data failed");
+        return ConnectResult::kError;
+    }
+    if (!view.Flush()) {
+        Reject(block, "writing coins failed");
+        return ConnectResult::kError;
+    }
+    if (undo)
+        *undo = std::move(spent);
+    
+    return ConnectResult::kConnected;
+}
+
+std::unique_ptr<BlockConnector::PendingFetch> BlockConnector::StartFetch(
+    const consensus::Block& block)
+{
+    auto fetch = std::make_unique<PendingFetch>();
+    fetch->block_hash = block.GetHash();
+    fetch->flushes = coins_->flushes();
+    
+    // Outputs created in the block itself are looked up too and not found,
+    // rather than hashing every transaction here on the caller.
+    for (const consensus::TransactionRef& tx : block.transactions()) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const consensus::TxIn& input : tx->inputs())
+            if (!coins_->HaveCoinInCache(input.prevout()))
+                fetch->outpoints.push_back(input.prevout());
+    }
+    
+    const size_t count = fetch->outpoints.size();
+    fetch->coins.resize(count);
+    fetch->found.resize(count);
+    PendingFetch *pfetch = fetch.get();
+    const CoinsView *store = store_;
+    auto read = [pfetch, store](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            pfetch->found[i] = store->GetCoin(pfetch->outpoints[i], &pfetch->coins[i]);
+    };
+    
+    if (pool_ == nullptr) {
+        read(0, count);
+        return fetch;
+    }
+    
+    // All on the pool, the caller goes on with the block before.
+    const size_t max_tasks = 2 * std::max(1u, std::thread::hardware_concurrency());
+    const size_t tasks = std::max<size_t>(1, std::min(max_tasks, count / kMinFetchRange));
+    const size_t step = (count + tasks - 1) / tasks;
+    for (size_t begin = 0; begin < count; begin += step)
+        fetch->futures.push_back(pool_->AddTask(read, begin, std::min(begin + step, count)));
+    
+    return fetch;
+}
+
+void BlockConnector::FinishFetch(std::unique_ptr<PendingFetch> fetch)
+{
+    for (auto& future : fetch->futures)
+        future.get();
+    
+    // A flush since the reads may have spent or erased what they found.
+    if (fetch->flushes != coins_->flushes())
+        return;
+    
+    for (size_t i = 0; i < fetch->outpoints.size(); i++)
+        if (fetch->found[i])
+            coins_->CacheCoin(fetch->outpoints[i], std::move(fetch->coins[i]));
+}
+
+bool BlockConnector::CheckBlock(const consensus::Block& block, uint32_t height)
+{
+    const std::vector<consensus::TransactionRef>& transactions = block.transactions();
+    if (transactions.empty())
+        return Reject(block, "no transactions");
+    if (!transactions[0]->IsCoinBase())
+        return Reject(block, "first transaction is not a coinbase");
+    for (size_t i = 1; i < transactions.size(); i++)
+        if (transactions[i]->IsCoinBase())
+            return Reject(block, "more than one coinbase");
+    
+    // A mutated tree repeats its last transactions and hashes the same.
+    bool mutated = false;
+    if (block.ComputeMerkleRoot(&mutated) != block.header().hashMerkleRoot())
+        return Reject(block, "merkle root mismatch");
+    if (mutated)
+        return Reject(block, "duplicate transactions");
+    
+    if (block.SerializedSize(false) > kMaxBlockSize)
+        return Reject(block, "oversize");
+    if (block.Weight() > kMaxBlockWeight)
+        return Reject(block, "overweight");
+    
+    if (height >= params_.SoftForks().bip34) {
+        consensus::Script expected;
+        expected.Push(static_cast<uint64_t>(height));
+        const consensus::Script& script_sig = transactions[0]->inputs()[0].script_sig();
+        if (script_sig.size() < expected.size() ||
+                !std::equal(expected.begin(), expected.end(), script_sig.begin()))
+            return Reject(block, "coinbase does not start with the height");
+    }
+    
+    return CheckWitnessCommitment(block, height);
+}
+
+bool BlockConnector::CheckWitnessCommitment(const consensus::Block& block, uint32_t height)
+{
+    const consensus::TxOut *commitment = nullptr;
+    if (height >= params_.SoftForks().segwit)
+        commitment = WitnessCommitment(block);
+    
+    // Without a commitment there is nothing the witnesses are bound to.
+    if (!commitment) {
+        for (const consensus::TransactionRef& tx : block.transactions())
+            if (tx->HasWitness())
+                return Reject(block, "unexpected witness");
+        return true;
+    }
+    
+    // The witness tree can not be mutated without the transaction tree,
+    // which has been checked.
+    const consensus::ScriptWitness& reserved =
+        block.transactions()[0]->inputs()[0].script_witness();
+    if (reserved.size() != 1 || reserved[0].size() != kHashSize)
+        return Reject(block, "bad witness reserved value");
+    
+    uint8_t buf[2 * kHashSize];
+    const util::Hash256 root = consensus::BlockWitnessMerkleRoot(block, pool_);
+    std::copy(root.begin(), root.end(), buf);
+    std::copy(reserved[0].begin(), reserved[0].end(), buf + kHashSize);
+    const util::Hash256 hash = crypto::hashfuncs::DoubleSha256(buf, sizeof(buf));
+    if (!std::equal(hash.begin(), hash.end(),
+                    commitment->script_pub_key().begin() + sizeof(kWitnessCommitmentHeader)))
+        return Reject(block, "witness merkle root mismatch");
+    
+    return true;
+}
+
+bool BlockConnector::ApplyBlock(const consensus::Block& block, uint32_t height,
+                                const MedianTimePast& median_time_past,
+                                CoinsViewCache *view, BlockUndo *spent)
+{
+    const std::vector<consensus::TransactionRef>& transactions = block.transactions();
+    const util::Hash256 hash = block.GetHash();
+    const uint32_t flags = ScriptFlags(hash, height);
+    const consensus::SoftForkHeights& forks = params_.SoftForks();
+    uint64_t fees = 0;
+    
+    // Lock times are measured against the median time past once BIP113 is
+    // in force, which it is along with BIP68.
+    const bool csv = height >= forks.csv;
+    auto time_past = [&](uint32_t h) -> int64_t
+    {
+        return median_time_past ? median_time_past(h) : block.header().time();
+    };
+    const int64_t prev_time_past = time_past(height - 1);
+    const int64_t lock_time_cutoff = csv ? prev_time_past : block.header().time();
+    
+    // With BIP34 a coinbase can not repeat, nor then a transaction spending
+    // the outputs of one.
+    const bool bip30 = (height < forks.bip34 || height >= kBip34ImpliesBip30Limit) &&
+                       std::find(forks.bip30_exceptions.begin(), forks.bip30_exceptions.end(),
+                                 hash) == forks.bip30_exceptions.end();
+    
+    // The queued checks point into txdata, reserved so it never moves. The
+    // control is declared after it, to wait for them before it goes.
+    std::vector<consensus::PrecomputedTxData> txdata;
+    txdata.reserve(transactions.size());
+    util::CheckQueueControl<consensus::ScriptCheck> control(checks_);
+    // cached once the whole block has passed
+    std::vector<const consensus::Transaction*> verified;
+    
+    for (const consensus::TransactionRef& tx : transactions) {
+        if (!consensus::IsFinalTx(*tx, height, lock_time_cutoff))
+            return Reject(block, "non-final transaction");
+    
+        if (!tx->IsCoinBase()) {
+            // scripts that passed before under the same flags are skipped
+            const bool cached = script_cache_ && script_cache_->HaveScripts(*tx, flags);
+            uint64_t in_amount = 0;
+            // the last height and time that do not satisfy the BIP68 locks
+            const bool sequence_locks = csv && tx->version() >= 2;
+            int64_t min_height = -1;
+            int64_t min_time = -1;
+            const std::pmr::vector<consensus::TxIn>& inputs = tx->inputs();
+            std::vector<consensus::ScriptCheck> checks;
+            if (!cached) {
+                txdata.emplace_back(*tx);
+                checks.reserve(inputs.size());
+            }
+            for (size_t i = 0; i < inputs.size(); i++) {
+                Coin coin;
+                if (!view->SpendCoin(inputs[i].prevout(), &coin))
+                    return Reject(block, "input missing or spent");
+                if (coin.coinbase() && height - coin.height() < kCoinbaseMaturity)
+                    return Reject(block, "premature spend of coinbase");
+                in_amount += coin.out().value();
+                if (coin.out().value() > kMaxSatoshiAmount || in_amount > kMaxSatoshiAmount)
+                    return Reject(block, "input values out of range");
+                const uint32_t sequence = inputs[i].sequence_no();
+                if (sequence_locks && !(sequence & consensus::kSequenceLockTimeDisable)) {
+                    const int64_t lock = sequence & consensus::kSequenceLockTimeMask;
+                    if (sequence & consensus::kSequenceLockTimeType) {
+                        const uint32_t coin_height = std::max<uint32_t>(coin.height(), 1) - 1;
+                        min_time = std::max(min_time, time_past(coin_height) +
+                                            (lock << consensus::kSequenceLockTimeGranularity) - 1);
+                    }
+                    else {
+                        min_height = std::max<int64_t>(min_height, coin.height() + lock - 1);
+                    }
+                }
+                if (!cached)
+                    checks.emplace_back(coin.out(), *tx, i, flags, &txdata.back(), script_cache_);
+                spent->push_back(std::move(coin));
+            }
+            if (min_height >= height || min_time >= prev_time_past)
+                return Reject(block, "sequence locks not satisfied");
+    
+            // in range, CheckTransaction() has seen to it
+            const uint64_t out_amount = tx->OutputsAmount();
+            if (in_amount < out_amount)
+                return Reject(block, "outputs exceed inputs");
+            fees += in_amount - out_amount;
+    
+            if (!cached) {
+                control.Add(std::move(checks));
+                if (control.failed())
+                    return Reject(block, "script verification failed");
+                if (script_cache_)
+                    verified.push_back(tx.get());
+            }
+        }
+    
+        if (bip30) {
+            const util::Hash256 txid = tx->GetHash();
+            for (uint32_t i = 0; i < tx->outputs().size(); i++)
+                if (view->HaveCoin(consensus::OutPoint(txid, i)))
+                    return Reject(block, "output overwrites an unspent coin");
+        }
+        if (!view->AddCoins(*tx, height))
+            return Reject(block, "output overwrites an unspent coin");
+    }
+    
+    if (transactions[0]->OutputsAmount() > params_.BlockSubsidy(height) + fees)
+        return Reject(block, "coinbase pays too much");
+    if (!control.Wait())
+        return Reject(block, "script verification failed");
+    for (const consensus::Transaction *tx : verified)
+        script_cache_->AddScripts(*tx, flags);
+    
+    view->SetBestBlock(hash);
+    
+    return true;
+}
+
+} // namespace chain
+} // namespace btclite
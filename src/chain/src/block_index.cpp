@@ -1,5 +1,9 @@
 #include "block_index.h"
 
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
 
 namespace btclite {
 namespace chain {
@@ -15,9 +19,8 @@ bool BlockIndex::IsValid(BlockStatus upto) const
 std::string BlockIndex::ToString() const
 {
     std::stringstream ss;
-    util::Hash256 hash_merkle_root = header_.hashMerkleRoot();
-    ss << "BlockIndex(pprev=" << pprev_ << ", height=" << height_
-       << ", merkle=" << util::EncodeHex(hash_merkle_root.rbegin(), hash_merkle_root.rend())
+    ss << "BlockIndex(pprev=" << pprev() << ", height=" << height_
+       << ", merkle=" << util::EncodeHex(merkle_root_hash_.rbegin(), merkle_root_hash_.rend())
        << ", hashBlock=" << util::EncodeHex(block_hash_.rbegin(), block_hash_.rend()) 
        << ")";
     
@@ -29,22 +32,23 @@ const BlockIndex *BlockIndex::GetAncestor(size_t height) const
     if (height > height_ || height < 0) {
         return nullptr;
     }
-
+    
+    const BlockIndexArena& arena = SingletonBlockIndexArena::GetInstance();
     const BlockIndex* pindex_walk = this;
     size_t height_walk = height_;
     while (height_walk > height) {
         int height_skip = GetSkipHeight(height_walk);
         int height_skip_prev = GetSkipHeight(height_walk - 1);
-        if (pindex_walk->pskip() != nullptr &&
+        if (pindex_walk->skip_ != kNullBlockIndex &&
                 (height_skip == height ||
                  (height_skip > height && !(height_skip_prev < height_skip - 2 &&
                                            height_skip_prev >= height)))) {
             // Only follow pskip if pprev->pskip isn't better than pskip->pprev.
-            pindex_walk = pindex_walk->pskip();
+            pindex_walk = arena.Get(pindex_walk->skip_);
             height_walk = height_skip;
         } else {
-            assert(pindex_walk->pprev());
-            pindex_walk = pindex_walk->pprev();
+            assert(pindex_walk->prev_ != kNullBlockIndex);
+            pindex_walk = arena.Get(pindex_walk->prev_);
             height_walk--;
         }
     }
@@ -52,6 +56,35 @@ const BlockIndex *BlockIndex::GetAncestor(size_t height) const
     return pindex_walk;
 }
 
+void BlockIndex::BuildSkip()
+{
+    if (const BlockIndex *prev = pprev()) {
+        const BlockIndex *skip = prev->GetAncestor(GetSkipHeight(height_));
+        skip_ = skip ? skip->handle_ : kNullBlockIndex;
+    }
+}
+
+int64_t BlockIndex::GetMedianTimePast() const
+{
+    constexpr size_t kMedianTimeSpan = 11;
+    int64_t times[kMedianTimeSpan];
+    size_t count = 0;
+    for (const BlockIndex *pindex = this; pindex && count < kMedianTimeSpan;
+            pindex = pindex->pprev())
+        times[count++] = pindex->time_;
+    
+    std::sort(times, times + count);
+    return times[count / 2];
+}
+
+consensus::BlockHeader BlockIndex::GetBlockHeader() const
+{
+    const BlockIndex *prev = pprev();
+    
+    return consensus::BlockHeader(version_, prev ? prev->block_hash_ : util::Hash256{},
+                                  merkle_root_hash_, time_, bits_, nonce_);
+}
+
 bool BlockIndex::RaiseValidity(BlockStatus up_to)
 {
     // Only validity flags allowed.
@@ -69,5 +102,69 @@ bool BlockIndex::RaiseValidity(BlockStatus up_to)
     return false;
 }
 
+BlockIndex *BlockIndexArena::New()
+{
+    return New(consensus::BlockHeader());
+}
+
+BlockIndex *BlockIndexArena::New(const consensus::BlockHeader& header)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (next_ == kNullBlockIndex)
+        throw std::length_error("block index arena is full");
+    
+    const size_t chunk = next_ >> kChunkBits;
+    BlockIndex *entries = chunks_[chunk].load(std::memory_order_relaxed);
+    if (entries == nullptr) {
+        // Pages stay untouched until entries are constructed in them, so a
+        // fresh chunk costs next to no resident memory.
+        entries = static_cast<BlockIndex*>(::operator new(kChunkSize * sizeof(BlockIndex)));
+        chunks_[chunk].store(entries, std::memory_order_release);
+    }
+    
+    BlockIndex *pindex = new (entries + (next_ & (kChunkSize - 1))) BlockIndex(header);
+    pindex->handle_ = next_++;
+    
+    return pindex;
+}
+
+BlockIndexHandle BlockIndexArena::NewRange(size_t count)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    if (next_ == kNullBlockIndex || count > (size_t{1} << 32) - next_)
+        throw std::length_error("block index arena is full");
+    
+    const BlockIndexHandle first = next_;
+    for (size_t i = 0; i < count; i++) {
+        const size_t chunk = next_ >> kChunkBits;
+        BlockIndex *entries = chunks_[chunk].load(std::memory_order_relaxed);
+        if (entries == nullptr) {
+            entries = static_cast<BlockIndex*>(::operator new(kChunkSize * sizeof(BlockIndex)));
+            chunks_[chunk].store(entries, std::memory_order_release);
+        }
+    
+        BlockIndex *pindex = new (entries + (next_ & (kChunkSize - 1))) BlockIndex;
+        pindex->handle_ = next_++;
+    }
+    
+    return first;
+}
+
+size_t BlockIndexArena::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_ - 1;
+}
+
+size_t BlockIndexArena::allocated_memory() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (next_ == 1)
+        return 0;
+    return (((next_ - 1) >> kChunkBits) + 1) * kChunkSize * sizeof(BlockIndex);
+}
+
 } // namesapce chain
 } // namesapce btclite
@@ -0,0 +1,506 @@
+#include "block_index_db.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "mapped_file.h"
+#include "pow.h"
+#include "util_endian.h"
+
+
+namespace btclite {
+namespace chain {
+
+namespace {
+
+/*
+ * File header, kHeaderSize bytes:
+ *   0  magic             u32
+ *   4  version           u32
+ *   8  generation        u64, bumped by each compaction; a log only
+ *                        applies to the snapshot of its own generation
+ *  16  record count      u64, snapshot only
+ *  24  tip hash          32 bytes, snapshot only
+ *  56  reserved
+ *
+ * Record, kRecordSize bytes, integers little-endian:
+ *   0  type              u32, kEntryRecord or kTipRecord
+ *   4  version           i32
+ *   8  time, bits, nonce u32
+ *  20  height            u32
+ *  24  status            u32
+ *  28  tx_num            u32
+ *  32  block hash        32 bytes, the tip's hash in a tip record
+ *  64  prev block hash   32 bytes
+ *  96  merkle root       32 bytes
+ * 128  file              u32, see BlockIndex::GetBlockPos()
+ * 132  data pos, undo pos u32
+ * 140  reserved
+ */
+constexpr uint32_t kSnapshotMagic = 0x58444942; // "BIDX"
+constexpr uint32_t kLogMagic = 0x474f4c42;      // "BLOG"
+
+constexpr uint32_t kEntryRecord = 1;
+constexpr uint32_t kTipRecord = 2;
+
+constexpr size_t kHashOffset = 32;
+constexpr size_t kPrevOffset = 64;
+constexpr size_t kMerkleOffset = 96;
+constexpr size_t kPosOffset = 128;
+
+// Records written per write() call.
+constexpr size_t kWriteBatch = 4096;
+
+// Fewer entries than this per task are not worth a thread.
+constexpr size_t kMinLoadRange = 16384;
+
+struct FileHeader {
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t generation = 0;
+    uint64_t count = 0;
+    util::Hash256 tip_hash = {};
+};
+
+void EncodeHeader(const FileHeader& header, uint8_t *out)
+{
+    std::fill(out, out + BlockIndexDb::kHeaderSize, 0);
+    util::ToLittleEndian(header.magic, out);
+    util::ToLittleEndian(header.version, out + 4);
+    util::ToLittleEndian(header.generation, out + 8);
+    util::ToLittleEndian(header.count, out + 16);
+    std::copy(header.tip_hash.begin(), header.tip_hash.end(), out + 24);
+}
+
+bool DecodeHeader(const util::MappedFile& file, uint32_t magic, FileHeader *header)
+{
+    if (file.size() < BlockIndexDb::kHeaderSize)
+        return false;
+    
+    const uint8_t *in = file.data();
+    header->magic = util::FromLittleEndian<uint32_t>(in);
+    header->version = util::FromLittleEndian<uint32_t>(in + 4);
+    header->generation = util::FromLittleEndian<uint64_t>(in + 8);
+    header->count = util::FromLittleEndian<uint64_t>(in + 16);
+    std::copy(in + 24, in + 56, header->tip_hash.begin());
+    
+    return header->magic == magic && header->version == BlockIndexDb::kVersion;
+}
+
+util::Hash256 ReadHash(const uint8_t *in)
+{
+    util::Hash256 hash;
+    std::copy(in, in + hash.size(), hash.begin());
+    return hash;
+}
+
+bool WriteAll(int fd, const uint8_t *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    
+    return true;
+}
+
+} // namespace
+
+BlockIndexDb::BlockIndexDb(const fs::path& path)
+    : path_snapshot_(path / default_snapshot_file),
+      path_log_(path / default_log_file)
+{
+}
+
+bool BlockIndexDb::Append(const std::vector<const BlockIndex*>& entries, const BlockIndex *tip)
+{
+    const size_t count = entries.size() + (tip ? 1 : 0);
+    if (count == 0)
+        return true;
+    
+    std::vector<uint8_t> buf(count * kRecordSize);
+    for (size_t i = 0; i < entries.size(); i++)
+        EncodeEntry(*entries[i], &buf[i * kRecordSize]);
+    if (tip)
+        EncodeTip(*tip, &buf[entries.size() * kRecordSize]);
+    
+    int fd = ::open(path_log_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Open " << path_log_ << " failed: " << std::strerror(errno);
+        return false;
+    }
+    
+    bool ret = true;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ret = false;
+    }
+    else if (static_cast<size_t>(st.st_size) < kHeaderSize) {
+        // new log, or one cut off inside its header
+        FileHeader header;
+        header.magic = kLogMagic;
+        header.version = kVersion;
+        header.generation = generation_;
+        uint8_t out[kHeaderSize];
+        EncodeHeader(header, out);
+        ret = ::ftruncate(fd, 0) == 0 && WriteAll(fd, out, kHeaderSize);
+    }
+    else if ((st.st_size - kHeaderSize) % kRecordSize) {
+        // drop a record torn by a crash before appending after it
+        ret = ::ftruncate(fd, st.st_size - (st.st_size - kHeaderSize) % kRecordSize) == 0;
+    }
+    
+    ret = ret && WriteAll(fd, buf.data(), buf.size()) && ::fdatasync(fd) == 0;
+    if (!ret)
+        BTCLOG(LOG_LEVEL_ERROR) << "Appending to " << path_log_ << " failed: " << std::strerror(errno);
+    ::close(fd);
+    
+    if (ret)
+        log_records_ += count;
+    
+    return ret;
+}
+
+bool BlockIndexDb::Compact(const ChainState::BlockMap& map, const BlockIndex *tip)
+{
+    std::vector<const BlockIndex*> entries;
+    entries.reserve(map.size());
+    for (const auto& value : map)
+        entries.push_back(value.second);
+    
+    // Stored by height, entries come back into the arena in that order and
+    // a walk down the chain reads memory front to back.
+    std::sort(entries.begin(), entries.end(), [](const BlockIndex *a, const BlockIndex *b)
+    {
+        return a->height_ < b->height_ || (a->height_ == b->height_ && a->handle_ < b->handle_);
+    });
+    
+    FileHeader header;
+    header.magic = kSnapshotMagic;
+    header.version = kVersion;
+    header.generation = generation_ + 1;
+    header.count = entries.size();
+    if (tip)
+        header.tip_hash = tip->block_hash_;
+    
+    fs::path path_tmp = path_snapshot_;
+    path_tmp += ".new";
+    int fd = ::open(path_tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Open " << path_tmp << " failed: " << std::strerror(errno);
+        return false;
+    }
+    
+    std::vector<uint8_t> buf(std::max(kHeaderSize, kWriteBatch * kRecordSize));
+    EncodeHeader(header, buf.data());
+    bool ret = WriteAll(fd, buf.data(), kHeaderSize);
+    for (size_t begin = 0; ret && begin < entries.size(); begin += kWriteBatch) {
+        size_t end = std::min(begin + kWriteBatch, entries.size());
+        for (size_t i = begin; i < end; i++)
+            EncodeEntry(*entries[i], &buf[(i - begin) * kRecordSize]);
+        ret = WriteAll(fd, buf.data(), (end - begin) * kRecordSize);
+    }
+    ret = ret && ::fsync(fd) == 0;
+    ::close(fd);
+    
+    // The new snapshot is complete on disk before it replaces the old one. A
+    // crash before the log is reset leaves a log of the old generation,
+    // which Load() ignores.
+    std::error_code ec;
+    if (ret)
+        fs::rename(path_tmp, path_snapshot_, ec);
+    if (!ret || ec) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Writing " << path_snapshot_ << " failed: "
+                                << (ec ? ec.message() : std::strerror(errno));
+        fs::remove(path_tmp, ec);
+        return false;
+    }
+    
+    // The rename is on disk before the log goes, or a crash could bring
+    // back the old snapshot without the log it needs. Until then the db
+    // stays as it was, and the next flush compacts again.
+    const fs::path path_dir = path_snapshot_.parent_path();
+    int dir_fd = ::open(path_dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0 || ::fsync(dir_fd) != 0) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Sync " << path_dir << " failed: " << std::strerror(errno);
+        if (dir_fd >= 0)
+            ::close(dir_fd);
+        return false;
+    }
+    ::close(dir_fd);
+    
+    generation_ = header.generation;
+    snapshot_records_ = entries.size();
+    log_records_ = 0;
+    fs::remove(path_log_, ec);
+    
+    BTCLOG(LOG_LEVEL_INFO) << "Flushed " << entries.size() << " block index entries to "
+                           << default_snapshot_file;
+    
+    return true;
+}
+
+bool BlockIndexDb::NeedCompact() const
+{
+    return log_records_ >= kMinCompactRecords && log_records_ >= snapshot_records_ / 4;
+}
+
+bool BlockIndexDb::Load(ChainState::BlockMap *map, util::Hash256 *tip_hash,
+                        util::ThreadPool *pool)
+{
+    if (!map || !tip_hash || !map->empty())
+        return false;
+    
+    tip_hash->fill(0);
+    generation_ = 0;
+    snapshot_records_ = 0;
+    log_records_ = 0;
+    
+    // entry records, the snapshot's first
+    std::vector<const uint8_t*> records;
+    
+    util::MappedFile snapshot;
+    FileHeader header;
+    if (snapshot.Open(path_snapshot_)) {
+        if (!DecodeHeader(snapshot, kSnapshotMagic, &header) ||
+                (snapshot.size() - kHeaderSize) / kRecordSize < header.count) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Block index snapshot " << path_snapshot_ << " is corrupted.";
+            return false;
+        }
+        generation_ = header.generation;
+        snapshot_records_ = header.count;
+        *tip_hash = header.tip_hash;
+        records.reserve(header.count);
+        for (size_t i = 0; i < header.count; i++)
+            records.push_back(snapshot.data() + kHeaderSize + i * kRecordSize);
+    }
+    
+    util::MappedFile log;
+    std::vector<const uint8_t*> log_entries;
+    if (log.Open(path_log_)) {
+        if (!DecodeHeader(log, kLogMagic, &header) || header.generation != generation_) {
+            // left behind by a compaction that did not finish
+            BTCLOG(LOG_LEVEL_WARNING) << "Discarding stale block index log " << path_log_;
+            log.Close();
+            std::error_code ec;
+            fs::remove(path_log_, ec);
+        }
+        else {
+            // a torn last record is dropped, Append() cuts it off
+            log_records_ = (log.size() - kHeaderSize) / kRecordSize;
+            for (size_t i = 0; i < log_records_; i++) {
+                const uint8_t *record = log.data() + kHeaderSize + i * kRecordSize;
+                uint32_t type = util::FromLittleEndian<uint32_t>(record);
+                if (type == kEntryRecord) {
+                    log_entries.push_back(record);
+                }
+                else if (type == kTipRecord) {
+                    *tip_hash = ReadHash(record + kHashOffset);
+                }
+                else {
+                    BTCLOG(LOG_LEVEL_ERROR) << "Block index log " << path_log_ << " is corrupted.";
+                    return false;
+                }
+            }
+        }
+    }
+    
+    // The latest record of a block wins.
+    if (!log_entries.empty()) {
+        crypto::Hash256Map<size_t> latest;
+        latest.reserve(log_entries.size());
+        for (size_t i = 0; i < log_entries.size(); i++)
+            latest[ReadHash(log_entries[i] + kHashOffset)] = i;
+    
+        records.erase(std::remove_if(records.begin(), records.end(), [&latest](const uint8_t *record)
+        {
+            return latest.contains(ReadHash(record + kHashOffset));
+        }), records.end());
+        for (size_t i = 0; i < log_entries.size(); i++) {
+            if (latest.at(ReadHash(log_entries[i] + kHashOffset)) == i)
+                records.push_back(log_entries[i]);
+        }
+    }
+    
+    const size_t count = records.size();
+    if (count == 0)
+        return true;
+    
+    BlockIndexArena& arena = SingletonBlockIndexArena::GetInstance();
+    const BlockIndexHandle first = arena.NewRange(count);
+    
+    util::ForEachRange(pool, count, kMinLoadRange, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            DecodeEntry(records[i], arena.Get(first + i));
+    });
+    
+    map->reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        BlockIndex *pindex = arena.Get(first + i);
+        if (!map->try_emplace(pindex->block_hash_, pindex).second) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Duplicate block index entry " << pindex->ToString();
+            map->clear();
+            return false;
+        }
+    }
+    
+    // Link each entry to its parent and start its chain work at its own
+    // block proof. The map is only read here.
+    const ChainState::BlockMap& index = *map;
+    std::atomic<bool> linked(true);
+    util::ForEachRange(pool, count, kMinLoadRange, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++) {
+            BlockIndex *pindex = arena.Get(first + i);
+            pindex->chain_work_ = consensus::GetBlockProof(pindex->bits_);
+            if (pindex->height_ == 0)
+                continue;
+            auto it = index.find(ReadHash(records[i] + kPrevOffset));
+            if (it == index.end() || it->second->height_ + 1 != pindex->height_) {
+                linked.store(false, std::memory_order_relaxed);
+                return;
+            }
+            pindex->prev_ = it->second->handle_;
+        }
+    });
+    if (!linked) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Block index entries with missing parents in " << path_snapshot_;
+        map->clear();
+        return false;
+    }
+    
+    // Order by height, so that every parent comes before its children.
+    uint32_t max_height = 0;
+    for (size_t i = 0; i < count; i++)
+        max_height = std::max(max_height, arena.Get(first + i)->height_);
+    std::vector<uint32_t> offsets(max_height + 2, 0);
+    for (size_t i = 0; i < count; i++)
+        offsets[arena.Get(first + i)->height_ + 1]++;
+    for (size_t h = 1; h < offsets.size(); h++)
+        offsets[h] += offsets[h - 1];
+    std::vector<BlockIndex*> by_height(count);
+    for (size_t i = 0; i < count; i++) {
+        BlockIndex *pindex = arena.Get(first + i);
+        by_height[offsets[pindex->height_]++] = pindex;
+    }
+    
+    // Chain work and transaction counts add up along the chain.
+    BlockIndex *best = nullptr;
+    for (BlockIndex *pindex : by_height) {
+        const BlockIndex *prev = pindex->pprev();
+        if (prev)
+            pindex->chain_work_ += prev->chain_work_;
+        if (pindex->tx_num_ && (!prev || prev->chain_tx_num_))
+            pindex->chain_tx_num_ = (prev ? prev->chain_tx_num_ : 0) + pindex->tx_num_;
+        if (!best || best->chain_work_ < pindex->chain_work_)
+            best = pindex;
+    }
+    
+    // Nearly every entry is on the most-work chain, where the skip target
+    // is found by height without walking, so those are set in parallel.
+    // Entries off that chain walk their own ancestors, after them in height
+    // order.
+    std::vector<BlockIndexHandle> best_chain(best->height_ + 1);
+    for (const BlockIndex *pindex = best; pindex; pindex = pindex->pprev())
+        best_chain[pindex->height_] = pindex->handle_;
+    util::ForEachRange(pool, best_chain.size(), kMinLoadRange, [&](size_t begin, size_t end)
+    {
+        for (size_t h = std::max<size_t>(begin, 1); h < end; h++) {
+            BlockIndex *pindex = arena.Get(best_chain[h]);
+            pindex->skip_ = best_chain[pindex->GetSkipHeight(h)];
+        }
+    });
+    for (BlockIndex *pindex : by_height) {
+        if (pindex->height_ >= best_chain.size() || best_chain[pindex->height_] != pindex->handle_)
+            pindex->BuildSkip();
+    }
+    
+    BTCLOG(LOG_LEVEL_INFO) << "Loaded " << count << " block index entries from "
+                           << default_snapshot_file << " and " << default_log_file;
+    
+    return true;
+}
+
+void BlockIndexDb::EncodeEntry(const BlockIndex& index, uint8_t *out)
+{
+    const BlockIndex *prev = index.pprev();
+    
+    util::ToLittleEndian(kEntryRecord, out);
+    util::ToLittleEndian(static_cast<uint32_t>(index.version_), out + 4);
+    util::ToLittleEndian(index.time_, out + 8);
+    util::ToLittleEndian(index.bits_, out + 12);
+    util::ToLittleEndian(index.nonce_, out + 16);
+    util::ToLittleEndian(index.height_, out + 20);
+    util::ToLittleEndian(index.status_, out + 24);
+    util::ToLittleEndian(index.tx_num_, out + 28);
+    std::copy(index.block_hash_.begin(), index.block_hash_.end(), out + kHashOffset);
+    if (prev)
+        std::copy(prev->block_hash_.begin(), prev->block_hash_.end(), out + kPrevOffset);
+    else
+        std::fill(out + kPrevOffset, out + kMerkleOffset, 0);
+    std::copy(index.merkle_root_hash_.begin(), index.merkle_root_hash_.end(), out + kMerkleOffset);
+    util::ToLittleEndian(index.file_, out + kPosOffset);
+    util::ToLittleEndian(index.data_pos_, out + kPosOffset + 4);
+    util::ToLittleEndian(index.undo_pos_, out + kPosOffset + 8);
+    std::fill(out + kPosOffset + 12, out + kRecordSize, 0);
+}
+
+void BlockIndexDb::EncodeTip(const BlockIndex& tip, uint8_t *out)
+{
+    std::fill(out, out + kRecordSize, 0);
+    util::ToLittleEndian(kTipRecord, out);
+    std::copy(tip.block_hash_.begin(), tip.block_hash_.end(), out + kHashOffset);
+}
+
+void BlockIndexDb::DecodeEntry(const uint8_t *in, BlockIndex *index)
+{
+    index->version_ = static_cast<int32_t>(util::FromLittleEndian<uint32_t>(in + 4));
+    index->time_ = util::FromLittleEndian<uint32_t>(in + 8);
+    index->bits_ = util::FromLittleEndian<uint32_t>(in + 12);
+    index->nonce_ = util::FromLittleEndian<uint32_t>(in + 16);
+    index->height_ = util::FromLittleEndian<uint32_t>(in + 20);
+    index->status_ = util::FromLittleEndian<uint32_t>(in + 24);
+    index->tx_num_ = util::FromLittleEndian<uint32_t>(in + 28);
+    index->block_hash_ = ReadHash(in + kHashOffset);
+    index->merkle_root_hash_ = ReadHash(in + kMerkleOffset);
+    index->file_ = util::FromLittleEndian<uint32_t>(in + kPosOffset);
+    index->data_pos_ = util::FromLittleEndian<uint32_t>(in + kPosOffset + 4);
+    index->undo_pos_ = util::FromLittleEndian<uint32_t>(in + kPosOffset + 8);
+}
+
+const fs::path& BlockIndexDb::path_snapshot() const
+{
+    return path_snapshot_;
+}
+
+const fs::path& BlockIndexDb::path_log() const
+{
+    return path_log_;
+}
+
+size_t BlockIndexDb::snapshot_records() const
+{
+    return snapshot_records_;
+}
+
+size_t BlockIndexDb::log_records() const
+{
+    return log_records_;
+}
+
+} // namespace chain
+} // namespace btclite
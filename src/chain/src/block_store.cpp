@@ -0,0 +1,407 @@
+#include "block_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "serialize.h"
+#include "util_endian.h"
+
+
+namespace btclite {
+namespace chain {
+
+namespace {
+
+bool WriteAllAt(int fd, const uint8_t *data, size_t size, size_t offset)
+{
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+    
+    return true;
+}
+
+bool ReadAllAt(int fd, uint8_t *data, size_t size, size_t offset)
+{
+    while (size > 0) {
+        ssize_t read = ::pread(fd, data, size, offset);
+        if (read < 0 && errno == EINTR)
+            continue;
+        if (read <= 0)
+            return false;
+        data += read;
+        size -= read;
+        offset += read;
+    }
+    
+    return true;
+}
+
+} // namespace
+
+BlockStore::BlockStore(const fs::path& path, size_t max_file_size)
+    : path_blocks_(path / default_blocks_dir), max_file_size_(max_file_size)
+{
+}
+
+BlockStore::~BlockStore()
+{
+    Flush();
+    for (auto& files : files_) {
+        for (auto& flat_file : files) {
+            if (flat_file && flat_file->fd >= 0)
+                ::close(flat_file->fd);
+        }
+    }
+}
+
+bool BlockStore::Open()
+{
+    LOCK(cs_block_store_);
+    
+    std::error_code ec;
+    fs::create_directories(path_blocks_, ec);
+    if (ec) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Create " << path_blocks_ << " failed: " << ec.message();
+        return false;
+    }
+    
+    last_file_ = 0;
+    while (fs::exists(FilePath(kBlockFile, last_file_ + 1)))
+        last_file_++;
+    
+    FlatFile *last = GetFile(kBlockFile, last_file_);
+    if (!last)
+        return false;
+    
+    BTCLOG(LOG_LEVEL_INFO) << "Appending blocks to " << FilePath(kBlockFile, last_file_)
+                           << " at " << last->size;
+    
+    return true;
+}
+
+bool BlockStore::Flush()
+{
+    LOCK(cs_block_store_);
+    
+    bool ret = true;
+    for (int type = 0; type < kFileTypes; type++) {
+        for (uint32_t file = 0; file < files_[type].size(); file++) {
+            FlatFile *flat_file = files_[type][file].get();
+            if (!flat_file || flat_file->fd < 0)
+                continue;
+            if (flat_file->dirty) {
+                if (::fdatasync(flat_file->fd) != 0) {
+                    BTCLOG(LOG_LEVEL_ERROR) << "Sync " << FilePath(static_cast<FileType>(type), file)
+                                            << " failed: " << std::strerror(errno);
+                    ret = false;
+                    continue;
+                }
+                flat_file->dirty = false;
+            }
+            // only the pair being appended to stays open
+            if (file != last_file_) {
+                ::close(flat_file->fd);
+                flat_file->fd = -1;
+            }
+        }
+    }
+    
+    // make new files part of the directory for good
+    if (dir_dirty_) {
+        int fd = ::open(path_blocks_.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0 || ::fsync(fd) != 0) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Sync " << path_blocks_ << " failed: " << std::strerror(errno);
+            ret = false;
+        }
+        else {
+            dir_dirty_ = false;
+        }
+        if (fd >= 0)
+            ::close(fd);
+    }
+    
+    return ret;
+}
+
+bool BlockStore::WriteBlock(const consensus::Block& block, FlatFilePos *pos)
+{
+    using ByteSinkType = util::ByteSink<std::vector<uint8_t> >;
+    
+    if (!pos)
+        return false;
+    
+    LOCK(cs_block_store_);
+    
+    write_buf_.clear();
+    write_buf_.reserve(kRecordHeaderSize + block.SerializedSize());
+    write_buf_.resize(kRecordHeaderSize);
+    ByteSinkType byte_sink(write_buf_);
+    util::Serializer<ByteSinkType> serializer(byte_sink);
+    // with the witnesses, which ReadBlock() gets back
+    serializer.SerialWrite(block);
+    
+    if (write_buf_.size() > max_file_size_) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Block of " << write_buf_.size() << " bytes is too large to store.";
+        return false;
+    }
+    util::ToLittleEndian(kRecordMagic, &write_buf_[0]);
+    util::ToLittleEndian(static_cast<uint32_t>(write_buf_.size() - kRecordHeaderSize), &write_buf_[4]);
+    
+    FlatFile *last = GetFile(kBlockFile, last_file_);
+    if (!last)
+        return false;
+    if (last->size > 0 && last->size + write_buf_.size() > max_file_size_) {
+        if (!FinalizeFile(kBlockFile, last_file_) || !FinalizeFile(kUndoFile, last_file_))
+            return false;
+        last_file_++;
+    }
+    
+    return Append(kBlockFile, last_file_, write_buf_.data(), write_buf_.size(), pos);
+}
+
+bool BlockStore::WriteUndo(const util::ByteSpan& undo, uint32_t file, FlatFilePos *pos)
+{
+    if (!pos || undo.empty() || undo.size() > max_file_size_)
+        return false;
+    
+    LOCK(cs_block_store_);
+    
+    if (file > last_file_)
+        return false;
+    
+    write_buf_.resize(kRecordHeaderSize + undo.size());
+    util::ToLittleEndian(kRecordMagic, &write_buf_[0]);
+    util::ToLittleEndian(static_cast<uint32_t>(undo.size()), &write_buf_[4]);
+    std::copy(undo.begin(), undo.end(), write_buf_.begin() + kRecordHeaderSize);
+    
+    return Append(kUndoFile, file, write_buf_.data(), write_buf_.size(), pos);
+}
+
+bool BlockStore::ReadBlock(const FlatFilePos& pos, consensus::Block *block) const
+{
+    if (!block)
+        return false;
+    
+    util::ByteSpan raw = ReadRawBlock(pos);
+    if (raw.empty()) {
+        BTCLOG(LOG_LEVEL_ERROR) << "No block at " << BlockFilePath(pos.file) << ":" << pos.pos;
+        return false;
+    }
+    
+    try {
+        util::ByteSpanSource byte_source(raw.data(), raw.size());
+        block->Clear();
+        block->Deserialize(byte_source);
+        if (byte_source.remaining() != 0)
+            throw std::ios_base::failure("trailing data");
+    }
+    catch (const std::exception& e) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Reading block at " << BlockFilePath(pos.file) << ":"
+                                << pos.pos << " failed: " << e.what();
+        return false;
+    }
+    
+    return true;
+}
+
+util::ByteSpan BlockStore::ReadRawBlock(const FlatFilePos& pos) const
+{
+    return ReadRaw(kBlockFile, pos);
+}
+
+util::ByteSpan BlockStore::ReadRawUndo(const FlatFilePos& pos) const
+{
+    return ReadRaw(kUndoFile, pos);
+}
+
+const fs::path& BlockStore::path_blocks() const
+{
+    return path_blocks_;
+}
+
+fs::path BlockStore::BlockFilePath(uint32_t file) const
+{
+    return FilePath(kBlockFile, file);
+}
+
+fs::path BlockStore::UndoFilePath(uint32_t file) const
+{
+    return FilePath(kUndoFile, file);
+}
+
+uint32_t BlockStore::last_file() const
+{
+    LOCK(cs_block_store_);
+    return last_file_;
+}
+
+fs::path BlockStore::FilePath(FileType type, uint32_t file) const
+{
+    std::stringstream ss;
+    ss << (type == kBlockFile ? "blk" : "rev") << std::setw(5) << std::setfill('0') << file << ".dat";
+    return path_blocks_ / ss.str();
+}
+
+// The state of a file, found by walking its record headers the first time
+// it is asked for. The walk stops at the preallocated zeros after the last
+// record, or at a record cut short by a crash.
+BlockStore::FlatFile *BlockStore::GetFile(FileType type, uint32_t file) const
+{
+    auto& files = files_[type];
+    if (file >= files.size())
+        files.resize(file + 1);
+    if (files[file])
+        return files[file].get();
+    
+    auto flat_file = std::make_unique<FlatFile>();
+    const fs::path path = FilePath(type, file);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Stat " << path << " failed: " << std::strerror(errno);
+            ::close(fd);
+            return nullptr;
+        }
+        const size_t file_size = st.st_size;
+    
+        size_t pos = 0;
+        uint8_t header[kRecordHeaderSize];
+        while (pos + kRecordHeaderSize <= file_size &&
+                ReadAllAt(fd, header, kRecordHeaderSize, pos)) {
+            uint32_t length = util::FromLittleEndian<uint32_t>(header + 4);
+            if (util::FromLittleEndian<uint32_t>(header) != kRecordMagic || length == 0 ||
+                    length > file_size - pos - kRecordHeaderSize)
+                break;
+            pos += kRecordHeaderSize + length;
+        }
+        ::close(fd);
+    
+        flat_file->size = pos;
+        flat_file->allocated = file_size;
+    }
+    else if (errno != ENOENT) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Open " << path << " failed: " << std::strerror(errno);
+        return nullptr;
+    }
+    
+    files[file] = std::move(flat_file);
+    
+    return files[file].get();
+}
+
+bool BlockStore::Append(FileType type, uint32_t file, const uint8_t *record, size_t size,
+                        FlatFilePos *pos)
+{
+    FlatFile *flat_file = GetFile(type, file);
+    if (!flat_file)
+        return false;
+    
+    const fs::path path = FilePath(type, file);
+    if (flat_file->fd < 0) {
+        if (!fs::exists(path))
+            dir_dirty_ = true;
+        flat_file->fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (flat_file->fd < 0) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Open " << path << " failed: " << std::strerror(errno);
+            return false;
+        }
+    }
+    
+    // Reserve disk space a chunk at a time so that the file stays in few
+    // extents. Where that is not supported the write extends the file.
+    const size_t end = flat_file->size + size;
+    if (end > flat_file->allocated) {
+        const size_t chunk = type == kBlockFile ? kBlockFileChunkSize : kUndoFileChunkSize;
+        const size_t allocated = (end + chunk - 1) / chunk * chunk;
+        if (::posix_fallocate(flat_file->fd, flat_file->allocated,
+                              allocated - flat_file->allocated) == 0)
+            flat_file->allocated = allocated;
+    }
+    
+    if (!WriteAllAt(flat_file->fd, record, size, flat_file->size)) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Writing to " << path << " failed: " << std::strerror(errno);
+        return false;
+    }
+    
+    pos->file = file;
+    pos->pos = static_cast<uint32_t>(flat_file->size + kRecordHeaderSize);
+    flat_file->size = end;
+    flat_file->allocated = std::max(flat_file->allocated, end);
+    flat_file->dirty = true;
+    
+    return true;
+}
+
+// Give back the preallocated space after the last record and sync the file.
+bool BlockStore::FinalizeFile(FileType type, uint32_t file)
+{
+    FlatFile *flat_file = GetFile(type, file);
+    if (!flat_file)
+        return false;
+    if (flat_file->fd < 0)
+        return true;
+    
+    if (::ftruncate(flat_file->fd, flat_file->size) != 0 || ::fdatasync(flat_file->fd) != 0) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Finalizing " << FilePath(type, file) << " failed: "
+                                << std::strerror(errno);
+        return false;
+    }
+    ::close(flat_file->fd);
+    flat_file->fd = -1;
+    flat_file->allocated = flat_file->size;
+    flat_file->dirty = false;
+    
+    return true;
+}
+
+util::ByteSpan BlockStore::ReadRaw(FileType type, const FlatFilePos& pos) const
+{
+    LOCK(cs_block_store_);
+    
+    if (pos.file > last_file_)
+        return util::ByteSpan();
+    FlatFile *flat_file = GetFile(type, pos.file);
+    if (!flat_file || pos.pos < kRecordHeaderSize || pos.pos > flat_file->size)
+        return util::ByteSpan();
+    
+    // Map once with room to grow. A file that outgrows its mapping gets a
+    // bigger one, the old one stays for the views handed out of it.
+    if (!flat_file->mapped || flat_file->mapped->size() < flat_file->size) {
+        auto mapped = std::make_unique<util::MappedFile>();
+        if (!mapped->Open(FilePath(type, pos.file), std::max(max_file_size_, 2 * flat_file->size))) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Mapping " << FilePath(type, pos.file) << " failed: "
+                                    << std::strerror(errno);
+            return util::ByteSpan();
+        }
+        if (flat_file->mapped)
+            flat_file->retired.push_back(std::move(flat_file->mapped));
+        flat_file->mapped = std::move(mapped);
+    }
+    
+    const uint8_t *header = flat_file->mapped->data() + pos.pos - kRecordHeaderSize;
+    uint32_t length = util::FromLittleEndian<uint32_t>(header + 4);
+    if (util::FromLittleEndian<uint32_t>(header) != kRecordMagic ||
+            length > flat_file->size - pos.pos)
+        return util::ByteSpan();
+    
+    return util::ByteSpan(header + kRecordHeaderSize, length);
+}
+
+} // namespace chain
+} // namespace btclite
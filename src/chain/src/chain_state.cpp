@@ -1,5 +1,13 @@
 #include "chain_state.h"
 
+#include <algorithm>
+
+#include "block_connector.h"
+#include "block_index_db.h"
+#include "block_store.h"
+#include "stream.h"
+#include "string_encoding.h"
+
 
 namespace btclite {
 namespace chain {
@@ -11,9 +19,10 @@ void Chain::SetTip(const BlockIndex *pindex)
         return;
     }
     
+    assert(pindex->handle() != kNullBlockIndex);
     active_chain_.resize(pindex->height() + 1);
-    while (pindex && active_chain_[pindex->height()] != pindex) {
-        active_chain_[pindex->height()] = const_cast<BlockIndex*>(pindex);
+    while (pindex && active_chain_[pindex->height()] != pindex->handle()) {
+        active_chain_[pindex->height()] = pindex->handle();
         pindex = pindex->pprev();
     }
 }
@@ -67,7 +76,8 @@ const BlockIndex *Chain::FindFork(const BlockIndex *pindex) const
     return pindex;
 }
 
-bool ChainState::LoadGenesisBlock(const consensus::Block& genesis_block)
+bool ChainState::LoadGenesisBlock(const consensus::Block& genesis_block, BlockStore *store,
+                                  BlockConnector *connector)
 {
     LOCK(cs_chain_state_);
     
@@ -75,13 +85,19 @@ bool ChainState::LoadGenesisBlock(const consensus::Block& genesis_block)
         return true;
     }
     
+    FlatFilePos pos;
+    if (!store || !connector || !store->WriteBlock(genesis_block, &pos)) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Writing genesis block to disk failed.";
+        return false;
+    }
+    
     BlockIndex *pindex = AddToBlockIndex(genesis_block.header());
-    if (!ReceivedBlockTransactions(genesis_block, pindex)) {
+    if (!ReceivedBlockTransactions(genesis_block, pindex, pos)) {
         BTCLOG(LOG_LEVEL_ERROR) << "Genesis block can not be accepted!";
         return false;
     }
     
-    if (!ConnectTip(pindex)) {
+    if (ConnectTip(pindex, genesis_block, store, connector) != ConnectResult::kConnected) {
         BTCLOG(LOG_LEVEL_ERROR) << "Add genesis block to active chain failed.";
         return false;
     }
@@ -89,6 +105,225 @@ bool ChainState::LoadGenesisBlock(const consensus::Block& genesis_block)
     return true;
 }
 
+bool ChainState::LoadBlockIndex(BlockIndexDb *db, util::ThreadPool *pool)
+{
+    LOCK(cs_chain_state_);
+    
+    if (!db || !map_block_index_.empty())
+        return false;
+    
+    util::Hash256 tip_hash;
+    if (!db->Load(&map_block_index_, &tip_hash, pool))
+        return false;
+    
+    for (const auto& value : map_block_index_) {
+        BlockIndex *pindex = value.second;
+        if (pindex_best_header_ == nullptr || 
+                pindex_best_header_->chain_work() < pindex->chain_work()) {
+            pindex_best_header_ = pindex;
+        }
+    }
+    
+    BlockMap::iterator it = map_block_index_.find(tip_hash);
+    if (it != map_block_index_.end()) {
+        active_chain_.SetTip(it->second);
+        flushed_tip_ = it->second;
+    }
+    
+    // Only blocks with at least as much work as the tip can replace it.
+    // Blocks waiting for the data of a parent are linked when it comes.
+    for (const auto& value : map_block_index_) {
+        BlockIndex *pindex = value.second;
+        if (pindex->tx_num() && !pindex->chain_tx_num() && pindex->pprev()) {
+            map_blocks_unlinked_.insert(std::make_pair(pindex->pprev(), pindex));
+            continue;
+        }
+        if (pindex->chain_tx_num() && !(pindex->status() & kBlockFailedMask) &&
+                (active_chain_.Tip() == nullptr || 
+                 !set_block_index_candidates_.value_comp()(pindex, active_chain_.Tip()))) {
+            set_block_index_candidates_.insert(pindex);
+        }
+    }
+    
+    return true;
+}
+
+bool ChainState::AcceptBlock(const consensus::Block& block, BlockStore *store)
+{
+    LOCK(cs_chain_state_);
+    
+    if (!store)
+        return false;
+    
+    BlockIndex *pindex = AcceptHeader(block.header());
+    if (!pindex)
+        return false;
+    if (pindex->status() & kBlockHaveData)
+        return true;
+    
+    FlatFilePos pos;
+    if (!store->WriteBlock(block, &pos))
+        return false;
+    
+    return ReceivedBlockTransactions(block, pindex, pos);
+}
+
+bool ChainState::AcceptBlockHeader(const consensus::BlockHeader& header)
+{
+    LOCK(cs_chain_state_);
+    
+    return AcceptHeader(header) != nullptr;
+}
+
+bool ChainState::ActivateBestChain(BlockStore *store, BlockConnector *connector)
+{
+    LOCK(cs_chain_state_);
+    
+    if (!store || !connector)
+        return false;
+    
+    while (true) {
+        // Switching to a fork needs the undo data applied, not done yet.
+        // The forks are kept as candidates for when it is, the best one
+        // extending the tip is connected meanwhile.
+        BlockIndex *tip = active_chain_.Tip();
+        BlockIndex *best = nullptr;
+        for (auto it = set_block_index_candidates_.rbegin();
+                it != set_block_index_candidates_.rend(); ++it) {
+            if (!tip || (*it)->GetAncestor(tip->height()) == tip) {
+                best = *it;
+                break;
+            }
+            // once for each heaviest fork, not on every pass
+            if (it == set_block_index_candidates_.rbegin() && *it != fork_warned_) {
+                BTCLOG(LOG_LEVEL_WARNING) << "Not reorganizing to " << (*it)->ToString();
+                fork_warned_ = *it;
+            }
+        }
+        if (!best || best == tip)
+            break;
+    
+        std::vector<BlockIndex*> path;
+        for (BlockIndex *pindex = best; pindex != tip; pindex = pindex->pprev())
+            path.push_back(pindex);
+        std::reverse(path.begin(), path.end());
+    
+        // The next block is read and its coins prefetched before this one
+        // is connected, so the reads overlap the checks and the apply.
+        consensus::Block block, next;
+        if (!store->ReadBlock(path[0]->GetBlockPos(), &next))
+            return false;
+        for (size_t i = 0; i < path.size(); i++) {
+            block = std::move(next);
+            if (i + 1 < path.size()) {
+                if (!store->ReadBlock(path[i + 1]->GetBlockPos(), &next))
+                    return false;
+                connector->Prefetch(next);
+            }
+    
+            // Only a block found invalid is marked so, one that failed for
+            // want of disk or coins is tried again on the next call.
+            ConnectResult result = ConnectTip(path[i], block, store, connector);
+            if (result == ConnectResult::kError)
+                return false;
+            if (result == ConnectResult::kInvalid) {
+                InvalidBlockFound(path[i]);
+                break;
+            }
+    
+            if (connector->coins()->NeedFlush()) {
+                PruneBlockIndexCandidates();
+                return true;
+            }
+        }
+    }
+    
+    PruneBlockIndexCandidates();
+    
+    return true;
+}
+
+bool ChainState::RewindTip(const util::Hash256& best_block)
+{
+    LOCK(cs_chain_state_);
+    
+    BlockIndex *tip = active_chain_.Tip();
+    if (best_block == crypto::null_hash) {
+        active_chain_.SetTip(nullptr);
+        return true;
+    }
+    
+    BlockMap::iterator it = map_block_index_.find(best_block);
+    if (it == map_block_index_.end() || tip == nullptr ||
+            tip->GetAncestor(it->second->height()) != it->second) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Coins best block " 
+                                << util::EncodeHex(best_block.rbegin(), best_block.rend())
+                                << " is not on the active chain.";
+        return false;
+    }
+    
+    if (it->second != tip) {
+        BTCLOG(LOG_LEVEL_INFO) << "Coins are at height " << it->second->height()
+                               << ", connecting blocks up to " << tip->height() << " again.";
+        active_chain_.SetTip(it->second);
+    }
+    
+    return true;
+}
+
+bool ChainState::FlushBlockIndex(BlockIndexDb *db)
+{
+    LOCK(cs_chain_state_);
+    
+    if (!db)
+        return false;
+    
+    const BlockIndex *tip = active_chain_.Tip();
+    if (set_dirty_block_index_.empty() && tip == flushed_tip_)
+        return true;
+    
+    bool ret;
+    if (db->NeedCompact()) {
+        ret = db->Compact(map_block_index_, tip);
+    }
+    else {
+        std::vector<const BlockIndex*> entries(set_dirty_block_index_.begin(),
+                                               set_dirty_block_index_.end());
+        ret = db->Append(entries, tip != flushed_tip_ ? tip : nullptr);
+    }
+    
+    if (ret) {
+        set_dirty_block_index_.clear();
+        flushed_tip_ = tip;
+    }
+    
+    return ret;
+}
+
+BlockIndex *ChainState::AcceptHeader(const consensus::BlockHeader& header)
+{
+    util::Hash256 hash;
+    if (!header.CheckProofOfWork(&hash)) {
+        BTCLOG(LOG_LEVEL_WARNING) << "Block " << util::EncodeHex(hash.rbegin(), hash.rend())
+                                  << " has not enough proof of work.";
+        return nullptr;
+    }
+    
+    BlockMap::iterator it = map_block_index_.find(hash);
+    if (it != map_block_index_.end())
+        return it->second;
+    
+    BlockMap::iterator it_prev = map_block_index_.find(header.hashPrevBlock());
+    if (it_prev == map_block_index_.end() || 
+            (it_prev->second->status() & kBlockFailedMask)) {
+        BTCLOG(LOG_LEVEL_WARNING) << "Block " << util::EncodeHex(hash.rbegin(), hash.rend())
+                                  << " has an unknown or invalid parent.";
+        return nullptr;
+    }
+    
+    return AddToBlockIndex(header);
+}
+
 BlockIndex* ChainState::AddToBlockIndex(const consensus::BlockHeader& header)
 {
     // Check for duplicate
@@ -98,7 +333,7 @@ BlockIndex* ChainState::AddToBlockIndex(const consensus::BlockHeader& header)
         return it->second;
     }
     
-    BlockIndex* pindex_new = new BlockIndex(header);
+    BlockIndex* pindex_new = SingletonBlockIndexArena::GetInstance().New(header);
     
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
@@ -127,18 +362,11 @@ BlockIndex* ChainState::AddToBlockIndex(const consensus::BlockHeader& header)
 }
 
 bool ChainState::ReceivedBlockTransactions(const consensus::Block& block, 
-                                           BlockIndex *pindex)
+                                           BlockIndex *pindex, const FlatFilePos& pos)
 {
-    // Blocks loaded from disk are assigned id 0, so start the counter at 1.
-    static int32_t block_sequence_id = 1;
-    /*
-     * Every received block is assigned a unique and increasing identifier, so we
-     * know which one to give priority in case of a fork.
-     */
-    util::CriticalSection cs_block_sequence_id;
-    
     pindex->set_tx_num(block.transactions().size());
     pindex->set_chain_tx_num(0);
+    pindex->set_block_pos(pos);
     pindex->set_status(pindex->status() | kBlockHaveData);
     pindex->RaiseValidity(kBlockValidTransactions);
     set_dirty_block_index_.insert(pindex);
@@ -155,33 +383,102 @@ bool ChainState::ReceivedBlockTransactions(const consensus::Block& block,
             pindex_front->set_chain_tx_num((pindex_front->pprev() ? 
                                             pindex_front->pprev()->chain_tx_num() : 0) + 
                                             pindex_front->tx_num());
-            {
-                LOCK(cs_block_sequence_id);
-                pindex->set_sequence_id(block_sequence_id);
-                block_sequence_id++;
-            }
+            /*
+             * Every received block is assigned a unique and increasing identifier, so we
+             * know which one to give priority in case of a fork.
+             */
+            pindex_front->set_sequence_id(block_sequence_id_++);
+            set_dirty_block_index_.insert(pindex_front);
             if (active_chain_.Tip() == nullptr || 
                     !set_block_index_candidates_.value_comp()(pindex_front, active_chain_.Tip())) {
                 set_block_index_candidates_.insert(pindex_front);
             }
+            
+            auto range = map_blocks_unlinked_.equal_range(pindex_front);
+            for (auto it = range.first; it != range.second; ++it)
+                queue.push_back(it->second);
+            map_blocks_unlinked_.erase(range.first, range.second);
         }
     }
     else {
+        // linked once the parent has its data
+        map_blocks_unlinked_.insert(std::make_pair(pindex->pprev(), pindex));
     }
     
     return true;
 }
 
-bool ChainState::ConnectTip(BlockIndex *pindex)
+ConnectResult ChainState::ConnectTip(BlockIndex *pindex, const consensus::Block& block, 
+                                     BlockStore *store, BlockConnector *connector)
 {
     assert(pindex->pprev() == active_chain_.Tip());
     
+    // Written before the coins move to the block, which is not connected
+    // if it can not be. The genesis block spends nothing and has no undo
+    // data.
+    FlatFilePos pos;
+    std::function<bool(const BlockUndo&)> write_undo;
+    if (pindex->pprev()) {
+        write_undo = [&](const BlockUndo& undo)
+        {
+            util::MemoryStream ms;
+            ms << undo;
+            return store->WriteUndo(util::ByteSpan(ms.Data(), ms.Size()),
+                                    pindex->GetBlockPos().file, &pos);
+        };
+    }
+    
+    ConnectResult result = connector->ConnectBlock(
+        block, pindex->height(), nullptr, write_undo,
+        [pindex](uint32_t height) { return pindex->GetAncestor(height)->GetMedianTimePast(); });
+    if (result != ConnectResult::kConnected)
+        return result;
+    
+    if (pindex->pprev()) {
+        pindex->set_undo_pos(pos.pos);
+        pindex->set_status(pindex->status() | kBlockHaveUndo);
+    }
+    pindex->RaiseValidity(kBlockValidScripts);
+    set_dirty_block_index_.insert(pindex);
+    
     active_chain_.SetTip(pindex);
     BTCLOG(LOG_LEVEL_VERBOSE) << "active chain new " << pindex->ToString(); 
     
-    return true;
+    return ConnectResult::kConnected;
+}
+
+void ChainState::InvalidBlockFound(BlockIndex *pindex)
+{
+    pindex->set_status(pindex->status() | kBlockFailedValid);
+    set_dirty_block_index_.insert(pindex);
+    
+    for (auto it = set_block_index_candidates_.begin(); it != set_block_index_candidates_.end();) {
+        BlockIndex *candidate = *it;
+        if (candidate->GetAncestor(pindex->height()) == pindex) {
+            if (candidate != pindex) {
+                candidate->set_status(candidate->status() | kBlockFailedChild);
+                set_dirty_block_index_.insert(candidate);
+            }
+            it = set_block_index_candidates_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
 }
 
+// Drop the candidates that have less work than the tip.
+void ChainState::PruneBlockIndexCandidates()
+{
+    const BlockIndex *tip = active_chain_.Tip();
+    if (tip == nullptr)
+        return;
+    
+    auto it = set_block_index_candidates_.begin();
+    while (it != set_block_index_candidates_.end() && 
+           set_block_index_candidates_.value_comp()(*it, tip))
+        it = set_block_index_candidates_.erase(it);
+}
 
 } // namesapce chain
 } // namesapce btclite
@@ -0,0 +1,281 @@
+#include "coins.h"
+
+#include "random.h"
+
+
+namespace btclite {
+namespace chain {
+
+Coin::Coin()
+    : out_(), height_(0), coinbase_(false)
+{
+}
+
+Coin::Coin(const consensus::TxOut& out, uint32_t height, bool coinbase)
+    : out_(out), height_(height), coinbase_(coinbase)
+{
+}
+
+Coin::Coin(consensus::TxOut&& out, uint32_t height, bool coinbase) noexcept
+    : out_(std::move(out)), height_(height), coinbase_(coinbase)
+{
+}
+
+void Coin::Clear()
+{
+    out_ = consensus::TxOut();
+    height_ = 0;
+    coinbase_ = false;
+}
+
+bool Coin::IsSpent() const
+{
+    return out_.IsNull();
+}
+
+size_t Coin::DynamicMemoryUsage() const
+{
+    return out_.script_pub_key().allocated_memory();
+}
+
+bool Coin::operator==(const Coin& b) const
+{
+    return out_ == b.out_ && height_ == b.height_ && coinbase_ == b.coinbase_;
+}
+
+bool Coin::operator!=(const Coin& b) const
+{
+    return !(*this == b);
+}
+
+SaltedOutPointHasher::SaltedOutPointHasher()
+    : k0_(util::RandUint64()), k1_(util::RandUint64())
+{
+}
+
+bool CoinsView::HaveCoin(const consensus::OutPoint& outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, &coin);
+}
+
+size_t CoinsView::EstimateSize() const
+{
+    return 0;
+}
+
+CoinsViewCache::CoinsViewCache(CoinsView *base, size_t max_memory)
+    : base_(base), max_memory_(max_memory), best_block_(), cache_coins_()
+{
+}
+
+CoinsMap::iterator CoinsViewCache::FetchCoin(const consensus::OutPoint& outpoint) const
+{
+    CoinsMap::iterator it = cache_coins_.find(outpoint);
+    if (it != cache_coins_.end())
+        return it;
+    
+    Coin coin;
+    if (!base_->GetCoin(outpoint, &coin))
+        return cache_coins_.end();
+    
+    it = cache_coins_.try_emplace(outpoint, std::move(coin)).first;
+    cached_coins_usage_ += it->second.coin.DynamicMemoryUsage();
+    
+    return it;
+}
+
+bool CoinsViewCache::GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const
+{
+    const Coin *cached = AccessCoin(outpoint);
+    if (!cached)
+        return false;
+    
+    *coin = *cached;
+    return true;
+}
+
+bool CoinsViewCache::HaveCoin(const consensus::OutPoint& outpoint) const
+{
+    return AccessCoin(outpoint) != nullptr;
+}
+
+util::Hash256 CoinsViewCache::GetBestBlock() const
+{
+    if (best_block_ == crypto::null_hash)
+        best_block_ = base_->GetBestBlock();
+    return best_block_;
+}
+
+bool CoinsViewCache::BatchWrite(CoinsMap *coins, const util::Hash256& best_block)
+{
+    for (auto& [outpoint, child] : *coins) {
+        if (!(child.flags & CoinsCacheEntry::kDirty))
+            continue;
+    
+        CoinsMap::iterator it = cache_coins_.find(outpoint);
+        if (it == cache_coins_.end()) {
+            // a fresh coin spent in the child never existed here either
+            if ((child.flags & CoinsCacheEntry::kFresh) && child.coin.IsSpent())
+                continue;
+            it = cache_coins_.try_emplace(outpoint, std::move(child.coin)).first;
+            it->second.flags = CoinsCacheEntry::kDirty | (child.flags & CoinsCacheEntry::kFresh);
+            cached_coins_usage_ += it->second.coin.DynamicMemoryUsage();
+            continue;
+        }
+    
+        CoinsCacheEntry& parent = it->second;
+        if ((child.flags & CoinsCacheEntry::kFresh) && !parent.coin.IsSpent()) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Fresh coin " << outpoint.ToString()
+                                    << " is unspent in the parent cache.";
+            return false;
+        }
+    
+        cached_coins_usage_ -= parent.coin.DynamicMemoryUsage();
+        if ((parent.flags & CoinsCacheEntry::kFresh) && child.coin.IsSpent()) {
+            // the base below never saw it
+            cache_coins_.erase(it);
+        }
+        else {
+            parent.coin = std::move(child.coin);
+            parent.flags |= CoinsCacheEntry::kDirty;
+            cached_coins_usage_ += parent.coin.DynamicMemoryUsage();
+        }
+    }
+    
+    SetBestBlock(best_block);
+    return true;
+}
+
+const Coin *CoinsViewCache::AccessCoin(const consensus::OutPoint& outpoint) const
+{
+    CoinsMap::iterator it = FetchCoin(outpoint);
+    if (it == cache_coins_.end() || it->second.coin.IsSpent())
+        return nullptr;
+    
+    return &it->second.coin;
+}
+
+bool CoinsViewCache::AddCoin(const consensus::OutPoint& outpoint, Coin&& coin,
+                             bool possible_overwrite)
+{
+    assert(!coin.IsSpent());
+    if (coin.out().script_pub_key().IsUnspendable())
+        return true;
+    
+    auto [it, inserted] = cache_coins_.try_emplace(outpoint);
+    CoinsCacheEntry& entry = it->second;
+    bool fresh = false;
+    if (!possible_overwrite) {
+        if (!entry.coin.IsSpent()) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Adding coin " << outpoint.ToString()
+                                    << " over an unspent one.";
+            return false;
+        }
+        // A spent coin that is still dirty has to reach the base as spent,
+        // so only a coin the base may not have at all can be fresh.
+        fresh = !(entry.flags & CoinsCacheEntry::kDirty);
+    }
+    
+    cached_coins_usage_ -= entry.coin.DynamicMemoryUsage();
+    entry.coin = std::move(coin);
+    entry.flags |= CoinsCacheEntry::kDirty | (fresh ? CoinsCacheEntry::kFresh : 0);
+    cached_coins_usage_ += entry.coin.DynamicMemoryUsage();
+    
+    return true;
+}
+
+bool CoinsViewCache::AddCoins(const consensus::Transaction& tx, uint32_t height)
+{
+    const util::Hash256 txid = tx.GetHash();
+    const bool coinbase = tx.IsCoinBase();
+    const std::pmr::vector<consensus::TxOut>& outputs = tx.outputs();
+    for (uint32_t i = 0; i < outputs.size(); i++) {
+        // Coinbases can repeat an earlier txid (BIP30), and checking for
+        // that costs a read, so they may overwrite.
+        if (!AddCoin(consensus::OutPoint(txid, i), Coin(outputs[i], height, coinbase), coinbase))
+            return false;
+    }
+    
+    return true;
+}
+
+bool CoinsViewCache::SpendCoin(const consensus::OutPoint& outpoint, Coin *moveout)
+{
+    CoinsMap::iterator it = FetchCoin(outpoint);
+    if (it == cache_coins_.end() || it->second.coin.IsSpent())
+        return false;
+    
+    CoinsCacheEntry& entry = it->second;
+    cached_coins_usage_ -= entry.coin.DynamicMemoryUsage();
+    if (moveout)
+        *moveout = std::move(entry.coin);
+    
+    if (entry.flags & CoinsCacheEntry::kFresh) {
+        cache_coins_.erase(it);
+    }
+    else {
+        entry.flags |= CoinsCacheEntry::kDirty;
+        entry.coin.Clear();
+    }
+    
+    return true;
+}
+
+void CoinsViewCache::Uncache(const consensus::OutPoint& outpoint)
+{
+    CoinsMap::iterator it = cache_coins_.find(outpoint);
+    if (it != cache_coins_.end() && it->second.flags == 0) {
+        cached_coins_usage_ -= it->second.coin.DynamicMemoryUsage();
+        cache_coins_.erase(it);
+    }
+}
+
+bool CoinsViewCache::HaveCoinInCache(const consensus::OutPoint& outpoint) const
+{
+    return cache_coins_.contains(outpoint);
+}
+
+void CoinsViewCache::CacheCoin(const consensus::OutPoint& outpoint, Coin&& coin)
+{
+    auto [it, inserted] = cache_coins_.try_emplace(outpoint, std::move(coin));
+    if (inserted)
+        cached_coins_usage_ += it->second.coin.DynamicMemoryUsage();
+}
+
+void CoinsViewCache::SetBestBlock(const util::Hash256& best_block)
+{
+    best_block_ = best_block;
+}
+
+bool CoinsViewCache::Flush()
+{
+    // counted first, reads racing the write are as stale as earlier ones
+    flushes_++;
+    if (!base_->BatchWrite(&cache_coins_, best_block_))
+        return false;
+    
+    // a new table rather than clear(), to give the memory back
+    cache_coins_ = CoinsMap();
+    cached_coins_usage_ = 0;
+    
+    return true;
+}
+
+size_t CoinsViewCache::DynamicMemoryUsage() const
+{
+    return cache_coins_.allocated_memory() + cached_coins_usage_;
+}
+
+bool CoinsViewCache::NeedFlush() const
+{
+    return DynamicMemoryUsage() > max_memory_;
+}
+
+size_t CoinsViewCache::CacheSize() const
+{
+    return cache_coins_.size();
+}
+
+} // namespace chain
+} // namespace btclite
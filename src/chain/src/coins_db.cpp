@@ -0,0 +1,173 @@
+#include "coins_db.h"
+
+#include <rocksdb/write_batch.h>
+
+#include "blob.h"
+#include "serialize.h"
+#include "util_endian.h"
+
+
+namespace btclite {
+namespace chain {
+
+namespace {
+
+// MiB of block cache, with a hash index and bloom filters for the lookups
+// by outpoint that make up nearly all reads.
+constexpr uint64_t kBlockCacheMb = 64;
+constexpr size_t kWriteBufferSize = 64 << 20;
+
+using CoinKey = std::array<uint8_t, CoinsViewDb::kCoinKeySize>;
+
+// The index goes in big endian, so the outputs of a transaction sort together.
+CoinKey MakeCoinKey(const consensus::OutPoint& outpoint)
+{
+    CoinKey key;
+    key[0] = CoinsViewDb::kCoinKey;
+    std::copy(outpoint.prev_hash().begin(), outpoint.prev_hash().end(), key.begin() + 1);
+    util::ToBigEndian(outpoint.index(), key.data() + 1 + outpoint.prev_hash().size());
+    
+    return key;
+}
+
+rocksdb::Slice ToSlice(const CoinKey& key)
+{
+    return rocksdb::Slice(reinterpret_cast<const char*>(key.data()), key.size());
+}
+
+} // namespace
+
+CoinsViewDb::CoinsViewDb(const fs::path& path)
+    : path_chainstate_(path / default_chainstate_dir)
+{
+}
+
+bool CoinsViewDb::Open()
+{
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    options.OptimizeForPointLookup(kBlockCacheMb);
+    options.write_buffer_size = kWriteBufferSize;
+    
+    std::error_code ec;
+    fs::create_directories(path_chainstate_.parent_path(), ec);
+    
+    rocksdb::DB *db = nullptr;
+    rocksdb::Status status = rocksdb::DB::Open(options, path_chainstate_.string(), &db);
+    if (!status.ok()) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Open " << path_chainstate_ << " failed: " << status.ToString();
+        return false;
+    }
+    db_.reset(db);
+    
+    return true;
+}
+
+bool CoinsViewDb::GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const
+{
+    if (!db_)
+        return false;
+    
+    std::string value;
+    rocksdb::Status status = db_->Get(rocksdb::ReadOptions(), ToSlice(MakeCoinKey(outpoint)), &value);
+    if (!status.ok()) {
+        if (!status.IsNotFound())
+            BTCLOG(LOG_LEVEL_ERROR) << "Reading coin " << outpoint.ToString() << " failed: "
+                                    << status.ToString();
+        return false;
+    }
+    
+    try {
+        util::ByteSpanSource byte_source(reinterpret_cast<const uint8_t*>(value.data()),
+                                         value.size());
+        coin->Deserialize(byte_source);
+    }
+    catch (const std::exception& e) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Decoding coin " << outpoint.ToString() << " failed: "
+                                << e.what();
+        return false;
+    }
+    
+    return true;
+}
+
+util::Hash256 CoinsViewDb::GetBestBlock() const
+{
+    util::Hash256 best_block{};
+    if (!db_)
+        return best_block;
+    
+    const char key = kBestBlockKey;
+    std::string value;
+    if (db_->Get(rocksdb::ReadOptions(), rocksdb::Slice(&key, 1), &value).ok() &&
+            value.size() == best_block.size())
+        std::copy(value.begin(), value.end(), best_block.begin());
+    
+    return best_block;
+}
+
+bool CoinsViewDb::BatchWrite(CoinsMap *coins, const util::Hash256& best_block)
+{
+    if (!db_)
+        return false;
+    
+    using ByteSinkType = util::ByteSink<std::vector<uint8_t> >;
+    rocksdb::WriteBatch batch;
+    std::vector<uint8_t> value;
+    size_t written = 0, erased = 0;
+    for (const auto& [outpoint, entry] : *coins) {
+        if (!(entry.flags & CoinsCacheEntry::kDirty))
+            continue;
+    
+        CoinKey key = MakeCoinKey(outpoint);
+        if (entry.coin.IsSpent()) {
+            batch.Delete(ToSlice(key));
+            erased++;
+            continue;
+        }
+    
+        value.clear();
+        ByteSinkType byte_sink(value);
+        entry.coin.Serialize(byte_sink);
+        batch.Put(ToSlice(key), rocksdb::Slice(reinterpret_cast<const char*>(value.data()),
+                                               value.size()));
+        written++;
+    }
+    
+    if (best_block != crypto::null_hash) {
+        const char key = kBestBlockKey;
+        batch.Put(rocksdb::Slice(&key, 1),
+                  rocksdb::Slice(reinterpret_cast<const char*>(best_block.data()),
+                                 best_block.size()));
+    }
+    
+    rocksdb::WriteOptions write_options;
+    write_options.sync = true;
+    rocksdb::Status status = db_->Write(write_options, &batch);
+    if (!status.ok()) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Writing coins to " << path_chainstate_ << " failed: "
+                                << status.ToString();
+        return false;
+    }
+    BTCLOG(LOG_LEVEL_VERBOSE) << "Flushed coins: " << written << " written, " << erased
+                              << " erased.";
+    
+    return true;
+}
+
+size_t CoinsViewDb::EstimateSize() const
+{
+    uint64_t size = 0;
+    if (!db_ || !db_->GetIntProperty("rocksdb.estimate-live-data-size", &size))
+        return 0;
+    
+    return size;
+}
+
+const fs::path& CoinsViewDb::path_chainstate() const
+{
+    return path_chainstate_;
+}
+
+} // namespace chain
+} // namespace btclite
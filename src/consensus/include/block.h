@@ -2,6 +2,7 @@
 #define BTCLITE_CONSENSUS_BLOCK_H
 
 
+#include "arena.h"
 #include "transaction.h"
 
 
@@ -29,6 +30,7 @@ public:
     void Clear();    
     bool IsNull() const;    
     util::uint256_t GetBlockProof() const;
+    size_t SerializedSize() const;
     
     //-------------------------------------------------------------------------
     template <typename Stream> void Serialize(Stream& os) const;
@@ -36,6 +38,9 @@ public:
     
     //-------------------------------------------------------------------------
     util::Hash256 GetHash() const;
+    // Whether the header hash meets its own nBits target, the hash is
+    // written to *hash if it is not null.
+    bool CheckProofOfWork(util::Hash256 *hash = nullptr) const;
     
     //-------------------------------------------------------------------------
     BlockHeader& operator=(const BlockHeader& b);
@@ -97,11 +102,13 @@ class Block {
 public:
     Block();
     
-    Block(const std::vector<Transaction>& transactions);
-    Block(std::vector<Transaction>&& transactions) noexcept;
+    Block(const std::vector<TransactionRef>& transactions);
+    Block(std::vector<TransactionRef>&& transactions) noexcept;
     
-    Block(const BlockHeader& header, const std::vector<Transaction>& transactions);
-    Block(BlockHeader&& header, std::vector<Transaction>&& transactions) noexcept;
+    Block(const BlockHeader& header, const std::vector<TransactionRef>& transactions);
+    Block(BlockHeader&& header, std::vector<TransactionRef>&& transactions) noexcept;
+    
+    // Copies share the transactions, which are immutable.
     
     Block(const Block& b);
     Block(Block&& b) noexcept;
@@ -110,22 +117,40 @@ public:
     void Clear();    
     util::Hash256 GetHash() const;    
     std::string ToString() const;
-    util::Hash256 ComputeMerkleRoot() const;
+    util::Hash256 ComputeMerkleRoot(bool *mutated = nullptr) const;
+    // Root committed to by the BIP141 witness commitment in the coinbase.
+    util::Hash256 ComputeWitnessMerkleRoot(bool *mutated = nullptr) const;
+    // Without witness, the BIP141 stripped size.
+    size_t SerializedSize(bool witness = true) const;
+    // BIP141 block weight.
+    size_t Weight() const;
     
     //-------------------------------------------------------------------------
+    // Transactions are in the BIP144 extended format, blocks carry their
+    // witnesses on the wire and on disk.
     template <typename Stream>
     void Serialize(Stream& os) const
     {
         util::Serializer<Stream> serializer(os);
         serializer.SerialWrite(header_);
-        serializer.SerialWrite(transactions_);
+        serializer.SerWriteVarInt(transactions_.size());
+        for (const TransactionRef& tx : transactions_)
+            tx->Serialize(os, true);
     }
     template <typename Stream>
     void Deserialize(Stream& is)
     {
         util::Deserializer<Stream> deserializer(is);
         deserializer.SerialRead(&header_);
-        deserializer.SerialRead(&transactions_);
+        if (use_arena_) {
+            util::ArenaAllocator<Transaction> alloc(
+                std::make_shared<util::Arena>(kArenaChunkSize));
+            deserializer.SerialRead(&transactions_, alloc, true);
+        }
+        else {
+            deserializer.SerialRead(&transactions_,
+                                    std::pmr::polymorphic_allocator<Transaction>(), true);
+        }
     }
     
     //-------------------------------------------------------------------------
@@ -138,13 +163,24 @@ public:
     void set_header(const BlockHeader& header);
     void set_header(BlockHeader&& header);
     
-    const std::vector<Transaction>& transactions() const;
-    void set_transactions(const std::vector<Transaction>& transactions);
-    void set_transactions(std::vector<Transaction>&& transactions);
+    const std::vector<TransactionRef>& transactions() const;
+    void set_transactions(const std::vector<TransactionRef>& transactions);
+    void set_transactions(std::vector<TransactionRef>&& transactions);
+    
+    // Opt-in: Deserialize allocates the transactions and their input and
+    // output lists from one arena instead of one by one. The arena is freed
+    // in one go once the block and every TransactionRef taken from it are
+    // gone.
+    bool use_arena() const;
+    void set_useArena(bool use);
     
 private:
     BlockHeader header_;
-    std::vector<Transaction> transactions_;
+    std::vector<TransactionRef> transactions_;
+    bool use_arena_ = false;
+    
+    // First arena chunk, later ones grow geometrically.
+    static constexpr size_t kArenaChunkSize = 256 * 1024;
 };
 
 
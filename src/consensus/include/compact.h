@@ -50,7 +50,7 @@ private:
     
     void SetCompact(uint32_t compact);
     void GetCompact();
-    size_t LogicalSize(util::uint256_t value);
+    size_t LogicalSize(const util::uint256_t& value);
 };
 
 } // namespace consensus
@@ -0,0 +1,216 @@
+#ifndef BTCLITE_CONSENSUS_INTERPRETER_H
+#define BTCLITE_CONSENSUS_INTERPRETER_H
+
+
+#include <vector>
+
+#include "transaction.h"
+
+
+namespace btclite {
+namespace consensus {
+
+class ScriptCache;
+
+// The rules EvalScript() and VerifyScript() enforce on top of the original
+// ones. All of them are soft forks, a script valid with a flag is valid
+// without it.
+enum ScriptFlags : uint32_t {
+    kVerifyNone = 0,
+    // evaluate P2SH redeem scripts, BIP16
+    kVerifyP2sh = 1U << 0,
+    // signatures in strict DER, BIP66
+    kVerifyDerSig = 1U << 1,
+    // the dummy OP_CHECKMULTISIG pops has to be empty, BIP147
+    kVerifyNullDummy = 1U << 2,
+    // OP_CHECKLOCKTIMEVERIFY, BIP65
+    kVerifyCheckLockTime = 1U << 3,
+    // OP_CHECKSEQUENCEVERIFY, BIP112
+    kVerifyCheckSequence = 1U << 4,
+    // witness programs, BIP141 and BIP143; needs kVerifyP2sh
+    kVerifyWitness = 1U << 5
+};
+
+enum class ScriptError {
+    kOk = 0,
+    kUnknown,
+    kEvalFalse,
+    kOpReturn,
+    
+    // limits
+    kScriptSize,
+    kPushSize,
+    kOpCount,
+    kStackSize,
+    kSigCount,
+    kPubkeyCount,
+    
+    // failed *VERIFY opcodes
+    kVerify,
+    kEqualVerify,
+    kCheckMultisigVerify,
+    kCheckSigVerify,
+    kNumEqualVerify,
+    
+    // logical and stack errors
+    kBadOpcode,
+    kDisabledOpcode,
+    kInvalidStackOperation,
+    kInvalidAltstackOperation,
+    kUnbalancedConditional,
+    
+    // lock times
+    kNegativeLocktime,
+    kUnsatisfiedLocktime,
+    
+    // signatures
+    kSigDer,
+    kSigNullDummy,
+    kSigPushOnly,
+    
+    // segwit
+    kWitnessProgramWrongLength,
+    kWitnessProgramWitnessEmpty,
+    kWitnessProgramMismatch,
+    kWitnessMalleated,
+    kWitnessMalleatedP2sh,
+    kWitnessUnexpected,
+    kCleanStack
+};
+
+const char *ScriptErrorString(ScriptError error);
+
+// Which transaction digest a signature commits to: the original one or the
+// BIP143 one of witness v0 scripts.
+enum class SigVersion {
+    kBase,
+    kWitnessV0
+};
+
+enum SigHashType : uint32_t {
+    kSigHashAll = 1,
+    kSigHashNone = 2,
+    kSigHashSingle = 3,
+    kSigHashAnyoneCanPay = 0x80
+};
+
+// The BIP143 hashes shared by every input of a transaction, so signing or
+// checking n inputs hashes the transaction once rather than n times.
+struct PrecomputedTxData {
+    util::Hash256 hash_prevouts = {};
+    util::Hash256 hash_sequence = {};
+    util::Hash256 hash_outputs = {};
+    bool ready = false;
+    
+    PrecomputedTxData() = default;
+    // computed only if tx has witness data, nothing else can use them
+    explicit PrecomputedTxData(const Transaction& tx);
+};
+
+// The hash input n_in of tx signs for hash_type. script_code is the script
+// being run, from its last executed OP_CODESEPARATOR on. amount, the value
+// of the spent output, is only signed in witness v0. txdata may be null.
+util::Hash256 SignatureHash(const Script& script_code, const Transaction& tx, size_t n_in,
+                            uint32_t hash_type, uint64_t amount, SigVersion sigversion,
+                            const PrecomputedTxData *txdata = nullptr);
+
+// What the script opcodes ask of the transaction they are run for. The
+// base class has no transaction, every check fails.
+class SignatureChecker {
+public:
+    virtual ~SignatureChecker() = default;
+    
+    // sig carries its sighash type as the last byte.
+    virtual bool CheckSig(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                          const Script& script_code, SigVersion sigversion) const
+    {
+        return false;
+    }
+    
+    virtual bool CheckLockTime(const ScriptInt& lock_time) const
+    {
+        return false;
+    }
+    
+    virtual bool CheckSequence(const ScriptInt& sequence) const
+    {
+        return false;
+    }
+};
+
+class TransactionSignatureChecker : public SignatureChecker {
+public:
+    // tx and txdata have to outlive the checker. amount is the value of the
+    // output input n_in spends.
+    TransactionSignatureChecker(const Transaction *tx, size_t n_in, uint64_t amount,
+                                const PrecomputedTxData *txdata = nullptr);
+    
+    //-------------------------------------------------------------------------
+    bool CheckSig(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                  const Script& script_code, SigVersion sigversion) const override;
+    bool CheckLockTime(const ScriptInt& lock_time) const override;
+    bool CheckSequence(const ScriptInt& sequence) const override;
+
+protected:
+    // The signature check itself, sig without its sighash type byte.
+    virtual bool VerifySignature(const std::vector<uint8_t>& sig,
+                                 const std::vector<uint8_t>& pubkey,
+                                 const util::Hash256& sighash) const;
+
+private:
+    const Transaction *tx_;
+    size_t n_in_;
+    uint64_t amount_;
+    const PrecomputedTxData *txdata_;
+};
+
+using ScriptStack = std::vector<std::vector<uint8_t> >;
+
+// Run script on stack. *error, if given, tells why it failed.
+bool EvalScript(ScriptStack *stack, const Script& script, uint32_t flags,
+                const SignatureChecker& checker, SigVersion sigversion,
+                ScriptError *error = nullptr);
+
+// Whether script_sig and witness satisfy script_pub_key under flags: the
+// two scripts run one after the other on the same stack, then the redeem
+// script of P2SH and the witness program of segwit outputs. Witness
+// versions above 0 are left to future soft forks and always pass.
+bool VerifyScript(const Script& script_sig, const Script& script_pub_key,
+                  const ScriptWitness& witness, uint32_t flags,
+                  const SignatureChecker& checker, ScriptError *error = nullptr);
+
+/*
+ * The scripts of one input against the output it spends, packaged to run on
+ * another thread: it keeps a copy of the output and pointers to the
+ * transaction and its precomputed hashes, which have to stay alive until the
+ * check has run. With a cache, signatures it has are taken as valid and the
+ * ones that verify are added to it.
+ */
+class ScriptCheck {
+public:
+    ScriptCheck() = default;
+    ScriptCheck(const TxOut& spent, const Transaction& tx, size_t n_in, uint32_t flags,
+                const PrecomputedTxData *txdata, ScriptCache *cache = nullptr);
+    
+    bool operator()();
+    
+    //-------------------------------------------------------------------------
+    ScriptError error() const
+    {
+        return error_;
+    }
+
+private:
+    TxOut spent_;
+    const Transaction *tx_ = nullptr;
+    size_t n_in_ = 0;
+    uint32_t flags_ = kVerifyNone;
+    const PrecomputedTxData *txdata_ = nullptr;
+    ScriptCache *cache_ = nullptr;
+    ScriptError error_ = ScriptError::kUnknown;
+};
+
+} // namespace consensus
+} // namespace btclite
+
+#endif // BTCLITE_CONSENSUS_INTERPRETER_H
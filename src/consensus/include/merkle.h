@@ -0,0 +1,45 @@
+#ifndef BTCLITE_CONSENSUS_MERKLE_H
+#define BTCLITE_CONSENSUS_MERKLE_H
+
+
+#include <vector>
+
+#include "arithmetic.h"
+#include "block.h"
+#include "thread.h"
+
+
+namespace btclite {
+namespace consensus {
+
+/*
+ * The merkle root is computed one tree level at a time. Each level is kept
+ * as one contiguous buffer of 32-byte hashes, so every sibling pair is
+ * already a 64-byte input and the whole level is handed to the multi-buffer
+ * double-SHA256 at once, writing the parents over the front of the buffer.
+ *
+ * WARNING! If a level has an odd number of nodes its last node is paired
+ * with itself. This allows a block to be mutated without changing the root:
+ * the transactions [1,2,3,4,5,6] and [1,2,3,4,5,6,5,6] give the same root
+ * (CVE-2012-2459). Such a mutation always produces two identical adjacent
+ * nodes on some level, so if mutated is not null it is set when any such
+ * pair is seen.
+ */
+util::Hash256 ComputeMerkleRoot(std::vector<util::Hash256>&& leaves, bool *mutated = nullptr);
+
+// Blocks with at least this many transactions hash their wtxids in parallel.
+constexpr size_t kParallelWitnessHashTxs = 1000;
+
+/*
+ * Root of the BIP141 witness tree of block, whose leaves are the wtxids with
+ * the coinbase's replaced by zero. The wtxids are split into contiguous
+ * ranges hashed as tasks on pool, one of them on the calling thread; if pool
+ * is null everything is hashed on the calling thread.
+ */
+util::Hash256 BlockWitnessMerkleRoot(const Block& block, util::ThreadPool *pool,
+                                     bool *mutated = nullptr);
+
+} // namespace consensus
+} // namespace btclite
+
+#endif // BTCLITE_CONSENSUS_MERKLE_H
@@ -1,6 +1,8 @@
 #ifndef BTCLITE_CONSENSUS_PARAMS_H
 #define BTCLITE_CONSENSUS_PARAMS_H
 
+#include <vector>
+
 #include "btcnet.h"
 #include "block.h"
 
@@ -48,6 +50,20 @@ struct Bip9Params {
                                      int64_t start_time, int64_t timeout);
 };
 
+// Heights from which the script soft forks are enforced, zero for a chain
+// that had them from the start.
+struct SoftForkHeights {
+    // the one block after BIP16 that spends a P2SH output without it
+    util::Hash256 bip16_exception;
+    // the two blocks that repeat an earlier unspent coinbase, BIP30
+    std::vector<util::Hash256> bip30_exceptions;
+    uint32_t bip34; // the height at the start of coinbase scripts
+    uint32_t bip65; // OP_CHECKLOCKTIMEVERIFY
+    uint32_t bip66; // strict DER signatures
+    uint32_t csv; // OP_CHECKSEQUENCEVERIFY, BIP112
+    uint32_t segwit; // empty OP_CHECKMULTISIG dummy, BIP147
+};
+
 /*
 struct PowParams {
 uint256 powLimit;
@@ -74,12 +90,16 @@ public:
     
     const Block& GenesisBlock() const;    
     int SubsideHalvingInterval() const;    
+    // New coins a block at height may pay to its coinbase, on top of fees.
+    uint64_t BlockSubsidy(uint32_t height) const;
     const Bip9Params& Bip9params() const;
+    const SoftForkHeights& SoftForks() const;
 
 private:
     Block genesis_;
     int subsidy_halving_interval_; // blocks
     Bip9Params bip9_params_;
+    SoftForkHeights soft_forks_ = {};
     //PowParams pow_params_;
     
     void CreateGenesisBlock(const std::string& coinbase, const Script& output_script, 
@@ -0,0 +1,98 @@
+#ifndef BTCLITE_CONSENSUS_POW_H
+#define BTCLITE_CONSENSUS_POW_H
+
+
+#include <atomic>
+
+#include "arithmetic.h"
+#include "util.h"
+
+
+namespace btclite {
+namespace consensus {
+
+/*
+ * Targets decoded from compact nBits, shared by all threads without a lock.
+ * Header sync goes through hundreds of thousands of headers that carry only
+ * a few hundred distinct nBits, so nearly every lookup skips Compact.
+ *
+ * The table is direct-mapped, a colliding nBits replaces the slot. Each slot
+ * is a small seqlock: a reader that finds it being written or torn counts a
+ * miss and decodes the target itself instead of waiting.
+ */
+class TargetCache : util::Uncopyable {
+public:
+    static constexpr size_t kSlots = 512;
+    
+    TargetCache() = default;
+    
+    //-------------------------------------------------------------------------
+    // Target encoded by bits, 0 if bits is negative, overflowed or zero.
+    util::uint256_t Get(uint32_t bits);
+    static util::uint256_t Decode(uint32_t bits);
+    
+    // Not safe against concurrent lookups, for tests and benchmarks.
+    void Clear();
+    
+    //-------------------------------------------------------------------------
+    uint64_t hits() const;
+    uint64_t misses() const;
+    
+private:
+    struct Slot {
+        // odd while a writer fills the slot
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint32_t> bits{0};
+        std::atomic<uint64_t> limbs[util::uint256_t::kLimbs]{};
+    };
+    
+    // An empty slot reads as bits 0 with target 0, which is the right
+    // answer for bits 0, so slots need no valid flag.
+    Slot slots_[kSlots];
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    
+    static size_t SlotIndex(uint32_t bits)
+    {
+        return (bits * 0x9e3779b1u) >> 23;
+    }
+};
+
+static_assert(TargetCache::kSlots == (size_t{1} << (32 - 23)), "SlotIndex covers kSlots");
+
+// Singleton pattern, thread safe after c++11
+class SingletonTargetCache : util::Uncopyable {
+public:
+    static TargetCache& GetInstance()
+    {
+        static TargetCache target_cache;
+        return target_cache;
+    }
+    
+private:
+    SingletonTargetCache() {}
+};
+
+
+//-----------------------------------------------------------------------------
+// Whether hash, read as a little-endian 256-bit number, is at most target.
+// Compares from the most significant limb, so a failing hash usually
+// returns after the first one.
+bool HashMeetsTarget(const util::Hash256& hash, const util::uint256_t& target);
+
+// Expected number of hashes to find a block at the target encoded by bits,
+// 0 if bits is invalid.
+util::uint256_t GetBlockProof(uint32_t bits);
+
+// Whether hash satisfies the proof of work claimed by bits.
+bool CheckProofOfWork(const util::Hash256& hash, uint32_t bits);
+
+// Hash the 80-byte serialized header at header and check it against the
+// nBits it carries, in one pass. The header hash is written to *hash if it
+// is not null, so callers that index the header need not hash it again.
+bool CheckHeaderProofOfWork(const uint8_t *header, util::Hash256 *hash = nullptr);
+
+} // namespace consensus
+} // namespace btclite
+
+#endif // BTCLITE_CONSENSUS_POW_H
@@ -6,6 +6,7 @@
 #include <utility>
 
 #include "arithmetic.h"
+#include "prevector.h"
 #include "serialize.h"
 
 
@@ -162,20 +163,31 @@ public:
     static constexpr size_t max_size = 4;
     
     explicit ScriptInt(const int64_t& n);   
-    explicit ScriptInt(const std::vector<uint8_t>&, bool);
+    // Throws std::runtime_error for more than max_bytes bytes, or for a
+    // non-minimal encoding if minimal is set. Lock times take 5 bytes.
+    explicit ScriptInt(const std::vector<uint8_t>&, bool, size_t max_bytes = max_size);
     
     //-------------------------------------------------------------------------
     int IntValue() const;
     std::vector<uint8_t> BytesValue() const;
-    static std::vector<uint8_t> BytesEncoding(const uint64_t&);
+    static std::vector<uint8_t> BytesEncoding(const int64_t&);
 };
 
+// Script bytes are kept inline up to 28 bytes, enough for P2PKH, P2SH,
+// P2WPKH and P2WSH output scripts, so most scripts need no heap allocation.
+using ScriptBase = util::Prevector<28, uint8_t>;
+
 class Script {
 public:
+    static constexpr size_t max_size = 10000;
+    
+    using const_iterator = ScriptBase::const_iterator;
+    using const_reverse_iterator = ScriptBase::const_reverse_iterator;
+    
     Script() = default;
     
-    Script(std::vector<uint8_t>&& v) noexcept;
     Script(const std::vector<uint8_t>& v);
+    Script(const_iterator first, const_iterator last);
     
     Script(Script&& s) noexcept;
     Script(const Script& s);
@@ -203,15 +215,19 @@ public:
     void clear();
     
     //-------------------------------------------------------------------------
-    bool Pop(std::vector<uint8_t>::const_iterator&, Opcode*) const;
-    bool Pop(std::vector<uint8_t>::const_iterator&, const Opcode&, std::vector<uint8_t>*) const;
+    bool Pop(const_iterator&, Opcode*) const;
+    bool Pop(const_iterator&, const Opcode&, std::vector<uint8_t>*) const;
+    
+    // Read the opcode at pc and the data it pushes, empty if none, moving pc
+    // past both. False at the end or on a push cut short.
+    bool GetOp(const_iterator& pc, Opcode *opcode, std::vector<uint8_t> *data) const;
     
     //-------------------------------------------------------------------------
-    std::vector<uint8_t>::const_iterator begin() const;
-    std::vector<uint8_t>::const_iterator end() const;
+    const_iterator begin() const;
+    const_iterator end() const;
     
-    std::vector<uint8_t>::const_reverse_iterator rbegin() const;
-    std::vector<uint8_t>::const_reverse_iterator rend() const;
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator rend() const;
     
     //-------------------------------------------------------------------------
     bool operator==(const Script& b) const;
@@ -223,8 +239,26 @@ public:
     //-------------------------------------------------------------------------
     size_t SerializedSize() const;
     
+    size_t size() const;
+    bool empty() const;
+    
+    // Heap bytes held beyond the object itself.
+    size_t allocated_memory() const;
+    
+    // Starts with OP_RETURN or is too large to ever execute, so an output
+    // paying to it can never be spent.
+    bool IsUnspendable() const;
+    
+    // OP_HASH160 <20 bytes> OP_EQUAL, BIP16
+    bool IsPayToScriptHash() const;
+    // Only opcodes up to OP_16, all of them pushes.
+    bool IsPushOnly() const;
+    // A version opcode, OP_0 to OP_16, and a single push of 2 to 40 bytes,
+    // BIP141.
+    bool IsWitnessProgram(int *version, std::vector<uint8_t> *program) const;
+
 private:
-    std::vector<uint8_t> data_;
+    ScriptBase data_;
 };
 
 } // namespace consensus
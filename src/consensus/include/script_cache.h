@@ -0,0 +1,86 @@
+#ifndef BTCLITE_CONSENSUS_SCRIPT_CACHE_H
+#define BTCLITE_CONSENSUS_SCRIPT_CACHE_H
+
+
+#include <vector>
+
+#include "cuckoo_cache.h"
+#include "interpreter.h"
+
+
+namespace btclite {
+namespace consensus {
+
+/*
+ * Remembers what passed script verification, so that it is not verified a
+ * second time: whole transactions under a set of script flags, and single
+ * signatures. A transaction seen before, in a block that failed for another
+ * reason or on a branch that lost a reorganization, then costs one lookup
+ * rather than a signature check per input.
+ *
+ * Keys are SHA-256 of a random salt and the entry, so nobody outside can
+ * aim entries at the same slots. Only successes are stored.
+ *
+ * Thread safe.
+ */
+class ScriptCache : util::Uncopyable {
+public:
+    static constexpr size_t kDefaultSize = 32 << 20;
+    
+    // max_bytes is split evenly between transactions and signatures.
+    explicit ScriptCache(size_t max_bytes = kDefaultSize);
+    
+    //-------------------------------------------------------------------------
+    // Every input of tx passed under flags, keyed by its wtxid, which
+    // commits to the scripts and witnesses. The spent outputs are not part
+    // of the key, as they are fixed by the txids the inputs name.
+    bool HaveScripts(const Transaction& tx, uint32_t flags) const;
+    void AddScripts(const Transaction& tx, uint32_t flags);
+    
+    bool HaveSignature(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                       const util::Hash256& sighash) const;
+    void AddSignature(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                      const util::Hash256& sighash);
+    
+    //-------------------------------------------------------------------------
+    util::CuckooCache::Stats script_stats() const
+    {
+        return scripts_.stats();
+    }
+    
+    util::CuckooCache::Stats signature_stats() const
+    {
+        return signatures_.stats();
+    }
+
+private:
+    util::Hash256 script_salt_;
+    util::Hash256 signature_salt_;
+    util::CuckooCache scripts_;
+    util::CuckooCache signatures_;
+    
+    util::Hash256 ScriptKey(const Transaction& tx, uint32_t flags) const;
+    util::Hash256 SignatureKey(const std::vector<uint8_t>& sig,
+                               const std::vector<uint8_t>& pubkey,
+                               const util::Hash256& sighash) const;
+};
+
+// Looks signatures up in a ScriptCache before verifying them, and adds the
+// ones that verify.
+class CachingSignatureChecker : public TransactionSignatureChecker {
+public:
+    CachingSignatureChecker(const Transaction *tx, size_t n_in, uint64_t amount,
+                            const PrecomputedTxData *txdata, ScriptCache *cache);
+
+protected:
+    bool VerifySignature(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                         const util::Hash256& sighash) const override;
+
+private:
+    ScriptCache *cache_;
+};
+
+} // namespace consensus
+} // namespace btclite
+
+#endif // BTCLITE_CONSENSUS_SCRIPT_CACHE_H
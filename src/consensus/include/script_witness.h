@@ -1,43 +1,112 @@
 #ifndef BTCLITE_CONSENSUS_SCRIPT_WITNESS_H
 #define BTCLITE_CONSENSUS_SCRIPT_WITNESS_H
 
+#include <algorithm>
+#include <ios>
 #include <string>
 #include <vector>
 #include <utility>
 
+#include "blob.h"
+#include "constants.h"
+#include "prevector.h"
+#include "serialize.h"
+
 
 namespace btclite {
 namespace consensus {
 
+/*
+ * The witness stack of one input, stored flat: the items back to back in
+ * one byte buffer plus the end offset of each item. Offsets for up to four
+ * items are kept inline, so a P2WPKH or P2WSH multisig stack costs a single
+ * allocation however many items it has.
+ */
 class ScriptWitness {
 public:
+    using Item = util::ByteSpan;
+    
     ScriptWitness() = default;
     
     ScriptWitness(const ScriptWitness& witness);
     ScriptWitness(ScriptWitness&& witness) noexcept;
     
     explicit ScriptWitness(const std::vector<std::vector<uint8_t> >& stack);
-    explicit ScriptWitness(std::vector<std::vector<uint8_t> >&& stack) noexcept;
     
     //-------------------------------------------------------------------------
     bool IsNull() const;
     void Clear();
     std::string ToString() const;
     
+    //-------------------------------------------------------------------------
+    // Number of stack items.
+    size_t size() const;
+    // View of item pos, valid until the witness is modified.
+    Item operator[](size_t pos) const;
+    void Push(const uint8_t *data, size_t size);
+    void Push(const std::vector<uint8_t>& item);
+    
+    std::vector<std::vector<uint8_t> > ToStack() const;
+    // Heap bytes owned by the witness.
+    size_t allocated_memory() const;
+    size_t SerializedSize() const;
+    
+    //-------------------------------------------------------------------------
+    // BIP144: item count, then each item as a length-prefixed byte string.
+    template <typename Stream>
+    void Serialize(Stream& os) const
+    {
+        util::Serializer<Stream> serializer(os);
+        serializer.SerWriteVarInt(offsets_.size());
+        for (size_t i = 0; i < offsets_.size(); i++) {
+            Item item = (*this)[i];
+            serializer.SerWriteVarInt(item.size());
+            if (!item.empty())
+                os.write(reinterpret_cast<const char*>(item.data()), item.size());
+        }
+    }
+    
+    template <typename Stream>
+    void Deserialize(Stream& is)
+    {
+        util::Deserializer<Stream> deserializer(is);
+        uint64_t count = deserializer.SerReadVarInt();
+        
+        data_.clear();
+        offsets_.clear();
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t size = deserializer.SerReadVarInt();
+            if (data_.size() + size > kMaxBlockSize)
+                throw std::ios_base::failure("witness stack larger than max block size");
+            size_t pos = data_.size();
+            // Reserve room for the items still to come as if they were
+            // public keys, which makes a P2WPKH stack a single exact
+            // allocation, and at least double so long stacks stay linear.
+            if (pos + size > data_.capacity()) {
+                uint64_t guess = pos + size + (count - i - 1) * kPubKeyItemSize;
+                data_.reserve(std::min<uint64_t>(std::max<uint64_t>(guess, 2 * data_.capacity()),
+                                                 kMaxBlockSize));
+            }
+            data_.resize(pos + size);
+            if (size > 0)
+                is.read(reinterpret_cast<char*>(data_.data() + pos), size);
+            offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        }
+    }
+    
     //-------------------------------------------------------------------------
     bool operator==(const ScriptWitness& b) const;
     bool operator!=(const ScriptWitness& b) const;
     
     ScriptWitness& operator=(const ScriptWitness& b);
-    ScriptWitness& operator=(ScriptWitness&& b);
-    
-    //-------------------------------------------------------------------------
-    const std::vector<std::vector<uint8_t> >& stack() const;
-    void set_stack(const std::vector<std::vector<uint8_t> >& stack);
-    void set_stack(std::vector<std::vector<uint8_t> >&& stack);
+    ScriptWitness& operator=(ScriptWitness&& b) noexcept;
     
 private:
-    std::vector<std::vector<uint8_t> > stack_;
+    // compressed public key, the usual item after a signature
+    static constexpr size_t kPubKeyItemSize = 33;
+    
+    std::vector<uint8_t> data_;
+    util::Prevector<4, uint32_t> offsets_;
 };
 
 } // namespace consensus
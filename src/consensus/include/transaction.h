@@ -1,6 +1,10 @@
 #ifndef BTCLITE_CONSENSUS_TRANSACTION_H
 #define BTCLITE_CONSENSUS_TRANSACTION_H
 
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+
 #include "hash.h"
 #include "script.h"
 #include "script_witness.h"
@@ -10,6 +14,14 @@
 namespace btclite {
 namespace consensus {
 
+// lock times below are heights, from here on they are times
+constexpr int64_t kLockTimeThreshold = 500000000;
+// BIP68 sequence number fields, times count in units of 512 seconds
+constexpr uint32_t kSequenceLockTimeDisable = 1U << 31;
+constexpr uint32_t kSequenceLockTimeType = 1U << 22;
+constexpr uint32_t kSequenceLockTimeMask = 0x0000ffff;
+constexpr int kSequenceLockTimeGranularity = 9;
+
 /** An outpoint - a combination of a transaction hash and an index n into its vout */
 class OutPoint {
 public:
@@ -173,7 +185,7 @@ public:
     
     //-------------------------------------------------------------------------
     void Clear();    
-    bool IsNull();    
+    bool IsNull() const;    
     std::string ToString() const;    
     size_t SerializedSize() const;
     
@@ -216,19 +228,69 @@ private:
     static constexpr uint64_t null_value = std::numeric_limits<uint64_t>::max();
 };
 
+/** A hash computed lazily on first use and then published once, so const
+ * objects can be read from several threads. Every thread that finds the
+ * cache empty computes the hash itself; the first one to finish stores it
+ * and the others just return their own, identical, result.
+ */
+class HashCache {
+public:
+    HashCache();
+    HashCache(const HashCache& b);
+    
+    //-------------------------------------------------------------------------
+    template <typename Func>
+    util::Hash256 Get(Func&& compute) const
+    {
+        if (state_.load(std::memory_order_acquire) == kReady)
+            return hash_;
+        
+        util::Hash256 hash = compute();
+        uint8_t expected = kEmpty;
+        if (state_.compare_exchange_strong(expected, kWriting, std::memory_order_acquire)) {
+            hash_ = hash;
+            state_.store(kReady, std::memory_order_release);
+        }
+        
+        return hash;
+    }
+    
+    // Not thread safe, only for owners that are about to modify the object.
+    void Clear();
+    
+    //-------------------------------------------------------------------------
+    HashCache& operator=(const HashCache& b);
+    
+private:
+    enum : uint8_t {
+        kEmpty = 0,
+        kWriting,
+        kReady
+    };
+    
+    mutable std::atomic<uint8_t> state_;
+    mutable util::Hash256 hash_;
+};
+
 class Transaction {
 public:
     Transaction();
-    
-    Transaction(uint32_t version, const std::vector<TxIn>& inputs,
-                const std::vector<TxOut>& outputs, uint32_t lock_time);
-    Transaction(uint32_t version, std::vector<TxIn>&& inputs,
-                std::vector<TxOut>&& outputs, uint32_t lock_time) noexcept;
+    // Inputs and outputs are allocated from resource, which has to outlive
+    // the transaction. Copies go back to the default resource.
+    explicit Transaction(std::pmr::memory_resource *resource);
+    
+    Transaction(uint32_t version, const std::pmr::vector<TxIn>& inputs,
+                const std::pmr::vector<TxOut>& outputs, uint32_t lock_time);
+    Transaction(uint32_t version, std::pmr::vector<TxIn>&& inputs,
+                std::pmr::vector<TxOut>&& outputs, uint32_t lock_time) noexcept;
         
     Transaction(const Transaction& t);    
     Transaction(Transaction&& t) noexcept;
     
     //-------------------------------------------------------------------------
+    // With witness set, transactions that carry witness data use the BIP144
+    // extended format: a 0x00 marker and 0x01 flag after the version, and
+    // the witness stack of every input before the lock time.
     template <typename Stream> void Serialize(Stream& os, bool witness = false) const;
     template <typename Stream> void Deserialize(Stream& is, bool witness = false);
     
@@ -241,13 +303,16 @@ public:
     
     //-------------------------------------------------------------------------
     util::Hash256 GetHash() const;
+    // BIP141 wtxid, equal to the txid for transactions without witness data.
     util::Hash256 GetWitnessHash() const;
     
     //-------------------------------------------------------------------------
     bool IsNull() const;    
     bool IsCoinBase() const;
+    bool HasWitness() const;
     
-    size_t SerializedSize() const;
+    // Size of what Serialize() writes with the same witness argument.
+    size_t SerializedSize(bool witness = false) const;
     uint64_t OutputsAmount() const;
     std::string ToString() const;
     
@@ -255,30 +320,102 @@ public:
     uint32_t version() const;
     void set_version(uint32_t v);
     
-    const std::vector<TxIn>& inputs() const;
-    void set_inputs(const std::vector<TxIn>& inputs);
-    void set_inputs(std::vector<TxIn>&& inputs);
+    const std::pmr::vector<TxIn>& inputs() const;
+    void set_inputs(const std::pmr::vector<TxIn>& inputs);
+    void set_inputs(std::pmr::vector<TxIn>&& inputs);
     
-    const std::vector<TxOut>& outputs() const;
-    void set_outputs(const std::vector<TxOut>& outputs);
-    void set_outputs(std::vector<TxOut>&& outputs);
+    const std::pmr::vector<TxOut>& outputs() const;
+    void set_outputs(const std::pmr::vector<TxOut>& outputs);
+    void set_outputs(std::pmr::vector<TxOut>&& outputs);
     
     uint32_t lock_time() const;
     void set_lockTime(uint32_t t);
     
 private:    
     uint32_t version_;
-    std::vector<TxIn> inputs_;
-    std::vector<TxOut> outputs_;
+    std::pmr::vector<TxIn> inputs_;
+    std::pmr::vector<TxOut> outputs_;
     uint32_t lock_time_;
     
-    mutable util::Hash256 hash_cache_;
-    mutable util::Hash256 witness_hash_cache_;
+    HashCache hash_cache_;
+    HashCache witness_hash_cache_;
     
     // Default transaction version.
     static constexpr uint32_t default_version = 2;
 };
 
+template <typename Stream>
+void Transaction::Serialize(Stream& os, bool witness) const
+{
+    util::Serializer<Stream> serializer(os);
+    const bool extended = witness && HasWitness();
+    
+    serializer.SerialWrite(version_);
+    if (extended) {
+        serializer.SerialWrite(uint8_t{0}); // marker, reads as an empty input vector
+        serializer.SerialWrite(uint8_t{1}); // flag
+    }
+    serializer.SerialWrite(inputs_);
+    serializer.SerialWrite(outputs_);
+    if (extended) {
+        for (const auto& input : inputs_)
+            serializer.SerialWrite(input.script_witness());
+    }
+    serializer.SerialWrite(lock_time_);
+}
+
+template <typename Stream>
+void Transaction::Deserialize(Stream& is, bool witness)
+{
+    util::Deserializer<Stream> deserializer(is);
+    uint8_t flags = 0;
+    
+    deserializer.SerialRead(&version_);
+    deserializer.SerialRead(&inputs_);
+    if (inputs_.empty() && witness) {
+        // an empty input vector is the BIP144 marker, the flag byte follows
+        deserializer.SerialRead(&flags);
+        if (flags != 0) {
+            deserializer.SerialRead(&inputs_);
+            deserializer.SerialRead(&outputs_);
+        }
+        else {
+            outputs_.clear();
+        }
+    }
+    else {
+        deserializer.SerialRead(&outputs_);
+    }
+    
+    if (flags & 1) {
+        flags ^= 1;
+        for (auto& input : inputs_) {
+            ScriptWitness script_witness;
+            deserializer.SerialRead(&script_witness);
+            input.set_scriptWitness(std::move(script_witness));
+        }
+        if (!HasWitness())
+            throw std::ios_base::failure("Superfluous witness record");
+    }
+    if (flags)
+        throw std::ios_base::failure("Unknown transaction optional data");
+    
+    deserializer.SerialRead(&lock_time_);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
+}
+
+/** Transactions are immutable once shared: blocks, messages and pools hold
+ * them through refs instead of copying, and the hashes are computed once.
+ */
+using TransactionRef = std::shared_ptr<const Transaction>;
+
+template <typename Tx>
+TransactionRef MakeTransactionRef(Tx&& tx)
+{
+    return std::make_shared<const Transaction>(std::forward<Tx>(tx));
+}
+
 } // namespace consensus
 } // namespace btclite
 
@@ -0,0 +1,25 @@
+#ifndef BTCLITE_CONSENSUS_TX_CHECK_H
+#define BTCLITE_CONSENSUS_TX_CHECK_H
+
+
+#include "transaction.h"
+
+
+namespace btclite {
+namespace consensus {
+
+// The checks that need nothing but the transaction itself: inputs and
+// outputs present, the size without witness within a block, output values
+// in range, no input spent twice, and a coinbase script of 2 to 100 bytes or
+// no null prevout otherwise. Safe to run on many transactions at once.
+bool CheckTransaction(const Transaction& tx);
+
+// Whether tx can be in a block at height, its lock time a height below it,
+// a time before lock_time_cutoff, or disabled by final sequence numbers in
+// every input.
+bool IsFinalTx(const Transaction& tx, uint32_t height, int64_t lock_time_cutoff);
+
+} // namespace consensus
+} // namespace btclite
+
+#endif // BTCLITE_CONSENSUS_TX_CHECK_H
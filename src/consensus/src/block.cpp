@@ -1,9 +1,12 @@
 #include "block.h"
 
 #include <memory>
+#include <numeric>
 #include <sstream>
 
-#include "compact.h"
+#include "merkle.h"
+#include "pow.h"
+#include "util_endian.h"
 
 
 namespace btclite {
@@ -47,20 +50,13 @@ bool BlockHeader::IsNull() const
 
 util::uint256_t BlockHeader::GetBlockProof() const
 {
-    Compact compact(nBits_);
-    util::uint256_t target = compact.normal();
-    
-    if (compact.negative() || 
-            compact.overflowed() || 
-            target == 0) {
-        return 0;
-    }
-    
-    // We need to compute 2**256 / (target+1), but we can't represent 2**256
-    // as it's too large for an util::uint256_t. However, as 2**256 is at least
-    // as large as target+1, it is equal to ((2**256 - target - 1) / (target+1)) + 1,
-    // or ~target / (target+1) + 1.
-    return (~target / (target + 1)) + 1;
+    return consensus::GetBlockProof(nBits_);
+}
+
+size_t BlockHeader::SerializedSize() const
+{
+    return sizeof(version_) + prev_block_hash_.size() + merkle_root_hash_.size()
+           + sizeof(time_) + sizeof(nBits_) + sizeof(nonce_);
 }
 
 util::Hash256 BlockHeader::GetHash() const
@@ -68,6 +64,19 @@ util::Hash256 BlockHeader::GetHash() const
     return crypto::GetDoubleHash(*this);
 }
 
+bool BlockHeader::CheckProofOfWork(util::Hash256 *hash) const
+{
+    uint8_t header[80];
+    util::ToLittleEndian(static_cast<uint32_t>(version_), header);
+    std::copy(prev_block_hash_.begin(), prev_block_hash_.end(), header + 4);
+    std::copy(merkle_root_hash_.begin(), merkle_root_hash_.end(), header + 36);
+    util::ToLittleEndian(time_, header + 68);
+    util::ToLittleEndian(nBits_, header + 72);
+    util::ToLittleEndian(nonce_, header + 76);
+    
+    return CheckHeaderProofOfWork(header, hash);
+}
+
 BlockHeader& BlockHeader::operator=(const BlockHeader& b)
 {
     version_ = b.version_;
@@ -159,33 +168,34 @@ Block::Block()
     Clear();
 }
     
-Block::Block(const std::vector<Transaction>& transactions)
+Block::Block(const std::vector<TransactionRef>& transactions)
     : header_(BlockHeader()), transactions_(transactions) 
 {
 }
 
-Block::Block(std::vector<Transaction>&& transactions) noexcept
+Block::Block(std::vector<TransactionRef>&& transactions) noexcept
     : header_(BlockHeader()), transactions_(std::move(transactions))
 {
 }
     
-Block::Block(const BlockHeader& header, const std::vector<Transaction>& transactions)
+Block::Block(const BlockHeader& header, const std::vector<TransactionRef>& transactions)
     : header_(header), transactions_(transactions)
 {
 }
 
-Block::Block(BlockHeader&& header, std::vector<Transaction>&& transactions) noexcept
+Block::Block(BlockHeader&& header, std::vector<TransactionRef>&& transactions) noexcept
     : header_(std::move(header)), transactions_(std::move(transactions))
 {
 }
     
 Block::Block(const Block& b)
-    : header_(b.header_), transactions_(b.transactions_) 
+    : header_(b.header_), transactions_(b.transactions_), use_arena_(b.use_arena_)
 {
 }
 
 Block::Block(Block&& b) noexcept
-    : header_(std::move(b.header_)), transactions_(std::move(b.transactions_))
+    : header_(std::move(b.header_)), transactions_(std::move(b.transactions_)),
+      use_arena_(b.use_arena_)
 {
 }
 
@@ -203,7 +213,9 @@ util::Hash256 Block::GetHash() const
 Block& Block::operator=(Block&& b) noexcept
 {
     if (this != &b) {
-    
+        header_ = std::move(b.header_);
+        transactions_ = std::move(b.transactions_);
+        use_arena_ = b.use_arena_;
     }
     
     return *this;
@@ -225,35 +237,47 @@ std::string Block::ToString() const
        << "tx.size=" << transactions_.size() << ")\n";
 
     for (const auto& tx : transactions_) {
-        ss << "  " << tx.ToString() << "\n";
+        ss << "  " << tx->ToString() << "\n";
     }
     
     return ss.str();
 }
 
-util::Hash256 Block::ComputeMerkleRoot() const
+util::Hash256 Block::ComputeMerkleRoot(bool *mutated) const
 {
     std::vector<util::Hash256> leaves;
-    std::vector<util::Hash256> swap;
-    for_each(transactions_.begin(), transactions_.end(), [&leaves](const Transaction& tx)
-                                                         { leaves.push_back(tx.GetHash()); });
     
-    swap.reserve((leaves.size() + 1) / 2);
-    while (leaves.size() > 1) {
-        // If number of hashes is odd, duplicate last hash in the list.
-        if (leaves.size() % 2 != 0)
-            leaves.push_back(leaves.back());
-        for (auto it = leaves.begin(); it != leaves.end(); it += 2) {
-            swap.push_back(crypto::hashfuncs::DoubleSha256(
-                               util::EncodeHex(it[0].rbegin(), it[0].rend()) + 
-                               util::EncodeHex(it[1].rbegin(), it[1].rend())));
-        }
-        std::swap(leaves, swap);
-        swap.clear();
-    }
+    leaves.reserve(transactions_.size());
+    for (const auto& tx : transactions_)
+        leaves.push_back(tx->GetHash());
     
-    // There is now only one item in the list.
-    return leaves.front();
+    return consensus::ComputeMerkleRoot(std::move(leaves), mutated);
+}
+
+util::Hash256 Block::ComputeWitnessMerkleRoot(bool *mutated) const
+{
+    util::ThreadPool *pool = nullptr;
+    if (transactions_.size() >= kParallelWitnessHashTxs)
+        pool = &util::SingletonThreadPool::GetInstance();
+    
+    return BlockWitnessMerkleRoot(*this, pool, mutated);
+}
+
+size_t Block::SerializedSize(bool witness) const
+{
+    const auto txs = [witness](size_t size, const TransactionRef& tx)
+    {
+        return size + tx->SerializedSize(witness);
+    };
+    
+    return header_.SerializedSize()
+           + util::VarIntSize(transactions_.size())
+           + std::accumulate(transactions_.begin(), transactions_.end(), size_t{0}, txs);
+}
+
+size_t Block::Weight() const
+{
+    return SerializedSize(false) * (kWitnessScaleFactor - 1) + SerializedSize(true);
 }
 
 const BlockHeader& Block::header() const
@@ -271,21 +295,31 @@ void Block::set_header(BlockHeader&& header)
     header_ = std::move(header);
 }
 
-const std::vector<Transaction>& Block::transactions() const
+const std::vector<TransactionRef>& Block::transactions() const
 {
     return transactions_;
 }
 
-void Block::set_transactions(const std::vector<Transaction>& transactions)
+void Block::set_transactions(const std::vector<TransactionRef>& transactions)
 {
     transactions_ = transactions;
 }
 
-void Block::set_transactions(std::vector<Transaction>&& transactions)
+void Block::set_transactions(std::vector<TransactionRef>&& transactions)
 {
     transactions_ = std::move(transactions);
 }
 
+bool Block::use_arena() const
+{
+    return use_arena_;
+}
+
+void Block::set_useArena(bool use)
+{
+    use_arena_ = use;
+}
+
 Block CreateGenesisBlock(const std::string& coinbase, const Script& output_script,
                          uint32_t time, uint32_t nonce, uint32_t bits, int32_t version,
                          uint64_t reward)
@@ -295,16 +329,15 @@ Block CreateGenesisBlock(const std::string& coinbase, const Script& output_scrip
     script.Push(ScriptInt(4));
     script.Push(std::vector<uint8_t>(coinbase.begin(), coinbase.end()));
 
-    std::vector<TxIn> inputs;
+    std::pmr::vector<TxIn> inputs;
     TxIn input(std::move(OutPoint()), script);
     inputs.push_back(input);
 
-    std::vector<TxOut> outputs;
+    std::pmr::vector<TxOut> outputs;
     outputs.push_back(TxOut(reward, output_script));
 
-    std::vector<Transaction> transactions;
-    Transaction tx_new(1, inputs, outputs, 0);
-    transactions.push_back(tx_new);
+    std::vector<TransactionRef> transactions;
+    transactions.push_back(MakeTransactionRef(Transaction(1, inputs, outputs, 0)));
 
     Block genesis(transactions);
     BlockHeader header(version, util::Hash256(), genesis.ComputeMerkleRoot(), time, bits, nonce);    
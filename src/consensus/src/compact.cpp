@@ -35,14 +35,9 @@ bool Compact::overflowed() const
     return overflowed_;
 }
 
-size_t Compact::LogicalSize(util::uint256_t value)
+size_t Compact::LogicalSize(const util::uint256_t& value)
 {
-    size_t byte = 0;
-
-    for (; value != 0; ++byte)
-        value >>= 8;
-
-    return byte;
+    return (value.bits() + 7) / 8;
 }
 
 void Compact::SetCompact(uint32_t compact)
@@ -69,9 +64,9 @@ void Compact::GetCompact()
     size_t size = LogicalSize(normal_);
     
     if (size <= 3) {
-        compact_ = static_cast<uint64_t>(normal_) << 8 * (3 - size);
+        compact_ = normal_.GetLow64() << 8 * (3 - size);
     } else {
-        compact_ = static_cast<uint64_t>(normal_ >> 8 * (size - 3));
+        compact_ = (normal_ >> 8 * (size - 3)).GetLow64();
     }
     
     // The 0x00800000 bit denotes the sign.
@@ -0,0 +1,1179 @@
+#include "interpreter.h"
+
+#include <algorithm>
+
+#include "ecdsa.h"
+#include "script_cache.h"
+
+
+namespace btclite {
+namespace consensus {
+
+namespace {
+
+constexpr size_t kMaxElementSize = 520;
+constexpr int kMaxOpsPerScript = 201;
+constexpr int kMaxPubkeysPerMultisig = 20;
+constexpr size_t kMaxStackSize = 1000;
+
+const std::vector<uint8_t> kFalse;
+const std::vector<uint8_t> kTrue(1, 1);
+
+bool SetError(ScriptError *error, ScriptError value)
+{
+    if (error)
+        *error = value;
+    return value == ScriptError::kOk;
+}
+
+bool CastToBool(const std::vector<uint8_t>& v)
+{
+    for (size_t i = 0; i < v.size(); i++) {
+        if (v[i] != 0) {
+            // negative zero is false too
+            if (i == v.size() - 1 && v[i] == 0x80)
+                return false;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool IsDisabled(Opcode opcode)
+{
+    switch (opcode) {
+        case Opcode::OP_CAT:
+        case Opcode::OP_SUBSTR:
+        case Opcode::OP_LEFT:
+        case Opcode::OP_RIGHT:
+        case Opcode::OP_INVERT:
+        case Opcode::OP_AND:
+        case Opcode::OP_OR:
+        case Opcode::OP_XOR:
+        case Opcode::OP_2MUL:
+        case Opcode::OP_2DIV:
+        case Opcode::OP_MUL:
+        case Opcode::OP_DIV:
+        case Opcode::OP_MOD:
+        case Opcode::OP_LSHIFT:
+        case Opcode::OP_RSHIFT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// BIP66: 0x30 <length> 0x02 <R length> <R> 0x02 <S length> <S> <sighash>,
+// the integers minimal and positive.
+bool IsValidSignatureEncoding(const std::vector<uint8_t>& sig)
+{
+    if (sig.size() < 9 || sig.size() > 73)
+        return false;
+    if (sig[0] != 0x30)
+        return false;
+    if (sig[1] != sig.size() - 3)
+        return false;
+    
+    const size_t rlen = sig[3];
+    if (5 + rlen >= sig.size())
+        return false;
+    const size_t slen = sig[5 + rlen];
+    if (rlen + slen + 7 != sig.size())
+        return false;
+    
+    if (sig[2] != 0x02 || rlen == 0)
+        return false;
+    if (sig[4] & 0x80)
+        return false;
+    if (rlen > 1 && sig[4] == 0x00 && !(sig[5] & 0x80))
+        return false;
+    
+    if (sig[rlen + 4] != 0x02 || slen == 0)
+        return false;
+    if (sig[rlen + 6] & 0x80)
+        return false;
+    if (slen > 1 && sig[rlen + 6] == 0x00 && !(sig[rlen + 7] & 0x80))
+        return false;
+    
+    return true;
+}
+
+bool CheckSignatureEncoding(const std::vector<uint8_t>& sig, uint32_t flags,
+                            ScriptError *error)
+{
+    // an empty signature is a quick way to fail a check on purpose
+    if (sig.empty())
+        return true;
+    if ((flags & kVerifyDerSig) && !IsValidSignatureEncoding(sig))
+        return SetError(error, ScriptError::kSigDer);
+    
+    return true;
+}
+
+// Remove every push of exactly sig's bytes that starts on an opcode, as the
+// original signature hash did before signing.
+void FindAndDelete(Script *script, const std::vector<uint8_t>& sig)
+{
+    Script pattern;
+    pattern.Push(sig);
+    
+    std::vector<uint8_t> result;
+    bool found = false;
+    Script::const_iterator pc = script->begin(), kept = script->begin();
+    Opcode opcode;
+    std::vector<uint8_t> data;
+    do {
+        result.insert(result.end(), kept, pc);
+        while (static_cast<size_t>(script->end() - pc) >= pattern.size() &&
+               std::equal(pattern.begin(), pattern.end(), pc)) {
+            pc += pattern.size();
+            found = true;
+        }
+        kept = pc;
+    } while (script->GetOp(pc, &opcode, &data));
+    
+    if (found) {
+        result.insert(result.end(), kept, script->end());
+        *script = Script(result);
+    }
+}
+
+// The script the original signature hash signs, without its
+// OP_CODESEPARATORs.
+Script WithoutCodeSeparators(const Script& script_code)
+{
+    std::vector<uint8_t> result;
+    Script::const_iterator pc = script_code.begin(), kept = script_code.begin();
+    Opcode opcode;
+    std::vector<uint8_t> data;
+    while (script_code.GetOp(pc, &opcode, &data)) {
+        if (opcode == Opcode::OP_CODESEPARATOR) {
+            result.insert(result.end(), kept, pc - 1);
+            kept = pc;
+        }
+    }
+    if (kept == script_code.begin())
+        return script_code;
+    result.insert(result.end(), kept, script_code.end());
+    
+    return Script(result);
+}
+
+util::Hash256 LegacySignatureHash(const Script& script_code, const Transaction& tx,
+                                  size_t n_in, uint32_t hash_type)
+{
+    const uint32_t base_type = hash_type & 0x1f;
+    const bool anyone_can_pay = hash_type & kSigHashAnyoneCanPay;
+    
+    // SIGHASH_SINGLE without a matching output signs the number one, a bug
+    // the chain has to keep
+    if (base_type == kSigHashSingle && n_in >= tx.outputs().size()) {
+        util::Hash256 one = {};
+        one[0] = 1;
+        return one;
+    }
+    
+    crypto::HashWriter hw;
+    util::Serializer<crypto::HashWriter> serializer(hw);
+    const Script code = WithoutCodeSeparators(script_code);
+    const Script empty = Script();
+    
+    serializer.SerialWrite(tx.version());
+    
+    const std::pmr::vector<TxIn>& inputs = tx.inputs();
+    serializer.SerWriteVarInt(anyone_can_pay ? 1 : inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (anyone_can_pay && i != n_in)
+            continue;
+        serializer.SerialWrite(inputs[i].prevout());
+        serializer.SerialWrite(i == n_in ? code : empty);
+        // the others' sequence numbers are left free with NONE and SINGLE
+        if (i != n_in && (base_type == kSigHashNone || base_type == kSigHashSingle))
+            serializer.SerialWrite(uint32_t(0));
+        else
+            serializer.SerialWrite(inputs[i].sequence_no());
+    }
+    
+    const std::pmr::vector<TxOut>& outputs = tx.outputs();
+    if (base_type == kSigHashNone) {
+        serializer.SerWriteVarInt(0);
+    }
+    else if (base_type == kSigHashSingle) {
+        // the outputs before n_in blanked, value -1 and no script
+        serializer.SerWriteVarInt(n_in + 1);
+        for (size_t i = 0; i < n_in; i++)
+            serializer.SerialWrite(TxOut());
+        serializer.SerialWrite(outputs[n_in]);
+    }
+    else {
+        serializer.SerWriteVarInt(outputs.size());
+        for (const TxOut& output : outputs)
+            serializer.SerialWrite(output);
+    }
+    
+    serializer.SerialWrite(tx.lock_time());
+    serializer.SerialWrite(hash_type);
+    
+    return hw.DoubleSha256();
+}
+
+util::Hash256 HashPrevouts(const Transaction& tx)
+{
+    crypto::HashWriter hw;
+    for (const TxIn& input : tx.inputs())
+        hw << input.prevout();
+    return hw.DoubleSha256();
+}
+
+util::Hash256 HashSequence(const Transaction& tx)
+{
+    crypto::HashWriter hw;
+    for (const TxIn& input : tx.inputs())
+        hw << input.sequence_no();
+    return hw.DoubleSha256();
+}
+
+util::Hash256 HashOutputs(const Transaction& tx)
+{
+    crypto::HashWriter hw;
+    for (const TxOut& output : tx.outputs())
+        hw << output;
+    return hw.DoubleSha256();
+}
+
+util::Hash256 WitnessV0SignatureHash(const Script& script_code, const Transaction& tx,
+                                     size_t n_in, uint32_t hash_type, uint64_t amount,
+                                     const PrecomputedTxData *txdata)
+{
+    const uint32_t base_type = hash_type & 0x1f;
+    const bool anyone_can_pay = hash_type & kSigHashAnyoneCanPay;
+    const bool cached = txdata && txdata->ready;
+    util::Hash256 hash_prevouts = {};
+    util::Hash256 hash_sequence = {};
+    util::Hash256 hash_outputs = {};
+    
+    if (!anyone_can_pay)
+        hash_prevouts = cached ? txdata->hash_prevouts : HashPrevouts(tx);
+    if (!anyone_can_pay && base_type != kSigHashSingle && base_type != kSigHashNone)
+        hash_sequence = cached ? txdata->hash_sequence : HashSequence(tx);
+    if (base_type != kSigHashSingle && base_type != kSigHashNone) {
+        hash_outputs = cached ? txdata->hash_outputs : HashOutputs(tx);
+    }
+    else if (base_type == kSigHashSingle && n_in < tx.outputs().size()) {
+        crypto::HashWriter hw;
+        hw << tx.outputs()[n_in];
+        hash_outputs = hw.DoubleSha256();
+    }
+    
+    const TxIn& input = tx.inputs()[n_in];
+    crypto::HashWriter hw;
+    hw << tx.version() << hash_prevouts << hash_sequence << input.prevout()
+       << script_code << amount << input.sequence_no() << hash_outputs
+       << tx.lock_time() << hash_type;
+    
+    return hw.DoubleSha256();
+}
+
+int64_t PopInt(ScriptStack *stack)
+{
+    const int64_t value = ScriptInt(stack->back(), false).value();
+    stack->pop_back();
+    return value;
+}
+
+void PushInt(ScriptStack *stack, int64_t value)
+{
+    stack->push_back(ScriptInt::BytesEncoding(value));
+}
+
+bool EvalOps(ScriptStack *stack, const Script& script, uint32_t flags,
+             const SignatureChecker& checker, SigVersion sigversion, ScriptError *error)
+{
+    // stacktop(i) in the original, i counted from 1 at the top
+    auto top = [stack](size_t i) -> std::vector<uint8_t>& {
+        return (*stack)[stack->size() - i];
+    };
+    
+    Script::const_iterator pc = script.begin();
+    Script::const_iterator code_begin = script.begin();
+    Opcode opcode;
+    std::vector<uint8_t> push;
+    std::vector<bool> exec;
+    ScriptStack altstack;
+    int op_count = 0;
+    
+    if (script.size() > Script::max_size)
+        return SetError(error, ScriptError::kScriptSize);
+    
+    while (pc < script.end()) {
+        const bool executing = std::find(exec.begin(), exec.end(), false) == exec.end();
+    
+        if (!script.GetOp(pc, &opcode, &push))
+            return SetError(error, ScriptError::kBadOpcode);
+        if (push.size() > kMaxElementSize)
+            return SetError(error, ScriptError::kPushSize);
+        if (opcode > Opcode::OP_16 && ++op_count > kMaxOpsPerScript)
+            return SetError(error, ScriptError::kOpCount);
+        // even in a branch not taken
+        if (IsDisabled(opcode))
+            return SetError(error, ScriptError::kDisabledOpcode);
+    
+        if (executing && opcode <= Opcode::OP_PUSHDATA4) {
+            stack->push_back(push);
+        }
+        else if (executing || (Opcode::OP_IF <= opcode && opcode <= Opcode::OP_ENDIF)) {
+            switch (opcode) {
+                case Opcode::OP_1NEGATE:
+                case Opcode::OP_1: case Opcode::OP_2: case Opcode::OP_3: case Opcode::OP_4:
+                case Opcode::OP_5: case Opcode::OP_6: case Opcode::OP_7: case Opcode::OP_8:
+                case Opcode::OP_9: case Opcode::OP_10: case Opcode::OP_11: case Opcode::OP_12:
+                case Opcode::OP_13: case Opcode::OP_14: case Opcode::OP_15: case Opcode::OP_16:
+                {
+                    PushInt(stack, static_cast<int>(opcode) - static_cast<int>(Opcode::OP_1) + 1);
+                    break;
+                }
+    
+                //-------------------------------------------------------------
+                case Opcode::OP_NOP:
+                    break;
+    
+                case Opcode::OP_CHECKLOCKTIMEVERIFY:
+                {
+                    if (!(flags & kVerifyCheckLockTime))
+                        break;
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    // times past 2038 need a fifth byte
+                    const ScriptInt lock_time(top(1), false, 5);
+                    if (lock_time.value() < 0)
+                        return SetError(error, ScriptError::kNegativeLocktime);
+                    if (!checker.CheckLockTime(lock_time))
+                        return SetError(error, ScriptError::kUnsatisfiedLocktime);
+                    break;
+                }
+    
+                case Opcode::OP_CHECKSEQUENCEVERIFY:
+                {
+                    if (!(flags & kVerifyCheckSequence))
+                        break;
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const ScriptInt sequence(top(1), false, 5);
+                    if (sequence.value() < 0)
+                        return SetError(error, ScriptError::kNegativeLocktime);
+                    // left to future soft forks
+                    if (sequence.value() & kSequenceLockTimeDisable)
+                        break;
+                    if (!checker.CheckSequence(sequence))
+                        return SetError(error, ScriptError::kUnsatisfiedLocktime);
+                    break;
+                }
+    
+                case Opcode::OP_NOP1: case Opcode::OP_NOP4: case Opcode::OP_NOP5:
+                case Opcode::OP_NOP6: case Opcode::OP_NOP7: case Opcode::OP_NOP8:
+                case Opcode::OP_NOP9: case Opcode::OP_NOP10:
+                    break;
+    
+                case Opcode::OP_IF:
+                case Opcode::OP_NOTIF:
+                {
+                    bool value = false;
+                    if (executing) {
+                        if (stack->size() < 1)
+                            return SetError(error, ScriptError::kUnbalancedConditional);
+                        value = CastToBool(top(1));
+                        if (opcode == Opcode::OP_NOTIF)
+                            value = !value;
+                        stack->pop_back();
+                    }
+                    exec.push_back(value);
+                    break;
+                }
+    
+                case Opcode::OP_ELSE:
+                {
+                    if (exec.empty())
+                        return SetError(error, ScriptError::kUnbalancedConditional);
+                    exec.back() = !exec.back();
+                    break;
+                }
+    
+                case Opcode::OP_ENDIF:
+                {
+                    if (exec.empty())
+                        return SetError(error, ScriptError::kUnbalancedConditional);
+                    exec.pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_VERIFY:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    if (!CastToBool(top(1)))
+                        return SetError(error, ScriptError::kVerify);
+                    stack->pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_RETURN:
+                    return SetError(error, ScriptError::kOpReturn);
+    
+                //-------------------------------------------------------------
+                case Opcode::OP_TOALTSTACK:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    altstack.push_back(std::move(top(1)));
+                    stack->pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_FROMALTSTACK:
+                {
+                    if (altstack.size() < 1)
+                        return SetError(error, ScriptError::kInvalidAltstackOperation);
+                    stack->push_back(std::move(altstack.back()));
+                    altstack.pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_2DROP:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    stack->pop_back();
+                    stack->pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_2DUP:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v1 = top(2);
+                    std::vector<uint8_t> v2 = top(1);
+                    stack->push_back(std::move(v1));
+                    stack->push_back(std::move(v2));
+                    break;
+                }
+    
+                case Opcode::OP_3DUP:
+                {
+                    if (stack->size() < 3)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v1 = top(3);
+                    std::vector<uint8_t> v2 = top(2);
+                    std::vector<uint8_t> v3 = top(1);
+                    stack->push_back(std::move(v1));
+                    stack->push_back(std::move(v2));
+                    stack->push_back(std::move(v3));
+                    break;
+                }
+    
+                case Opcode::OP_2OVER:
+                {
+                    if (stack->size() < 4)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v1 = top(4);
+                    std::vector<uint8_t> v2 = top(3);
+                    stack->push_back(std::move(v1));
+                    stack->push_back(std::move(v2));
+                    break;
+                }
+    
+                case Opcode::OP_2ROT:
+                {
+                    if (stack->size() < 6)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v1 = top(6);
+                    std::vector<uint8_t> v2 = top(5);
+                    stack->erase(stack->end() - 6, stack->end() - 4);
+                    stack->push_back(std::move(v1));
+                    stack->push_back(std::move(v2));
+                    break;
+                }
+    
+                case Opcode::OP_2SWAP:
+                {
+                    if (stack->size() < 4)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::swap(top(4), top(2));
+                    std::swap(top(3), top(1));
+                    break;
+                }
+    
+                case Opcode::OP_IFDUP:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    if (CastToBool(top(1))) {
+                        std::vector<uint8_t> v = top(1);
+                        stack->push_back(std::move(v));
+                    }
+                    break;
+                }
+    
+                case Opcode::OP_DEPTH:
+                {
+                    PushInt(stack, stack->size());
+                    break;
+                }
+    
+                case Opcode::OP_DROP:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    stack->pop_back();
+                    break;
+                }
+    
+                case Opcode::OP_DUP:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v = top(1);
+                    stack->push_back(std::move(v));
+                    break;
+                }
+    
+                case Opcode::OP_NIP:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    stack->erase(stack->end() - 2);
+                    break;
+                }
+    
+                case Opcode::OP_OVER:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v = top(2);
+                    stack->push_back(std::move(v));
+                    break;
+                }
+    
+                case Opcode::OP_PICK:
+                case Opcode::OP_ROLL:
+                {
+                    // (xn ... x2 x1 x0 n - xn ... x2 x1 x0 xn)
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const int64_t n = PopInt(stack);
+                    if (n < 0 || static_cast<uint64_t>(n) >= stack->size())
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v = top(n + 1);
+                    if (opcode == Opcode::OP_ROLL)
+                        stack->erase(stack->end() - n - 1);
+                    stack->push_back(std::move(v));
+                    break;
+                }
+    
+                case Opcode::OP_ROT:
+                {
+                    // (x1 x2 x3 - x2 x3 x1)
+                    if (stack->size() < 3)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::swap(top(3), top(2));
+                    std::swap(top(2), top(1));
+                    break;
+                }
+    
+                case Opcode::OP_SWAP:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::swap(top(2), top(1));
+                    break;
+                }
+    
+                case Opcode::OP_TUCK:
+                {
+                    // (x1 x2 - x2 x1 x2)
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    std::vector<uint8_t> v = top(1);
+                    stack->insert(stack->end() - 2, std::move(v));
+                    break;
+                }
+    
+                case Opcode::OP_SIZE:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    PushInt(stack, top(1).size());
+                    break;
+                }
+    
+                //-------------------------------------------------------------
+                case Opcode::OP_EQUAL:
+                case Opcode::OP_EQUALVERIFY:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const bool equal = top(2) == top(1);
+                    stack->pop_back();
+                    stack->pop_back();
+                    stack->push_back(equal ? kTrue : kFalse);
+                    if (opcode == Opcode::OP_EQUALVERIFY) {
+                        if (!equal)
+                            return SetError(error, ScriptError::kEqualVerify);
+                        stack->pop_back();
+                    }
+                    break;
+                }
+    
+                //-------------------------------------------------------------
+                case Opcode::OP_1ADD:
+                case Opcode::OP_1SUB:
+                case Opcode::OP_NEGATE:
+                case Opcode::OP_ABS:
+                case Opcode::OP_NOT:
+                case Opcode::OP_0NOTEQUAL:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    int64_t n = PopInt(stack);
+                    switch (opcode) {
+                        case Opcode::OP_1ADD: n += 1; break;
+                        case Opcode::OP_1SUB: n -= 1; break;
+                        case Opcode::OP_NEGATE: n = -n; break;
+                        case Opcode::OP_ABS: n = n < 0 ? -n : n; break;
+                        case Opcode::OP_NOT: n = (n == 0); break;
+                        case Opcode::OP_0NOTEQUAL: n = (n != 0); break;
+                        default: break;
+                    }
+                    PushInt(stack, n);
+                    break;
+                }
+    
+                case Opcode::OP_ADD:
+                case Opcode::OP_SUB:
+                case Opcode::OP_BOOLAND:
+                case Opcode::OP_BOOLOR:
+                case Opcode::OP_NUMEQUAL:
+                case Opcode::OP_NUMEQUALVERIFY:
+                case Opcode::OP_NUMNOTEQUAL:
+                case Opcode::OP_LESSTHAN:
+                case Opcode::OP_GREATERTHAN:
+                case Opcode::OP_LESSTHANOREQUAL:
+                case Opcode::OP_GREATERTHANOREQUAL:
+                case Opcode::OP_MIN:
+                case Opcode::OP_MAX:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    // both read before either is popped, as a bad one fails
+                    const int64_t a = ScriptInt(top(2), false).value();
+                    const int64_t b = ScriptInt(top(1), false).value();
+                    stack->pop_back();
+                    stack->pop_back();
+    
+                    int64_t n = 0;
+                    switch (opcode) {
+                        case Opcode::OP_ADD: n = a + b; break;
+                        case Opcode::OP_SUB: n = a - b; break;
+                        case Opcode::OP_BOOLAND: n = (a != 0 && b != 0); break;
+                        case Opcode::OP_BOOLOR: n = (a != 0 || b != 0); break;
+                        case Opcode::OP_NUMEQUAL: n = (a == b); break;
+                        case Opcode::OP_NUMEQUALVERIFY: n = (a == b); break;
+                        case Opcode::OP_NUMNOTEQUAL: n = (a != b); break;
+                        case Opcode::OP_LESSTHAN: n = (a < b); break;
+                        case Opcode::OP_GREATERTHAN: n = (a > b); break;
+                        case Opcode::OP_LESSTHANOREQUAL: n = (a <= b); break;
+                        case Opcode::OP_GREATERTHANOREQUAL: n = (a >= b); break;
+                        case Opcode::OP_MIN: n = std::min(a, b); break;
+                        case Opcode::OP_MAX: n = std::max(a, b); break;
+                        default: break;
+                    }
+                    PushInt(stack, n);
+    
+                    if (opcode == Opcode::OP_NUMEQUALVERIFY) {
+                        if (!CastToBool(top(1)))
+                            return SetError(error, ScriptError::kNumEqualVerify);
+                        stack->pop_back();
+                    }
+                    break;
+                }
+    
+                case Opcode::OP_WITHIN:
+                {
+                    // (x min max - out)
+                    if (stack->size() < 3)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const int64_t x = ScriptInt(top(3), false).value();
+                    const int64_t min = ScriptInt(top(2), false).value();
+                    const int64_t max = ScriptInt(top(1), false).value();
+                    stack->resize(stack->size() - 3);
+                    stack->push_back(min <= x && x < max ? kTrue : kFalse);
+                    break;
+                }
+    
+                //-------------------------------------------------------------
+                case Opcode::OP_RIPEMD160:
+                case Opcode::OP_SHA1:
+                case Opcode::OP_SHA256:
+                case Opcode::OP_HASH160:
+                case Opcode::OP_HASH256:
+                {
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const std::vector<uint8_t>& v = top(1);
+                    std::vector<uint8_t> hash;
+                    if (opcode == Opcode::OP_RIPEMD160) {
+                        const util::Hash160 h = crypto::hashfuncs::Ripemd160(v.data(), v.size());
+                        hash.assign(h.begin(), h.end());
+                    }
+                    else if (opcode == Opcode::OP_SHA1) {
+                        const util::Hash160 h = crypto::hashfuncs::Sha1(v.data(), v.size());
+                        hash.assign(h.begin(), h.end());
+                    }
+                    else if (opcode == Opcode::OP_SHA256) {
+                        const util::Hash256 h = crypto::hashfuncs::Sha256(v);
+                        hash.assign(h.begin(), h.end());
+                    }
+                    else if (opcode == Opcode::OP_HASH160) {
+                        const util::Hash160 h = crypto::hashfuncs::Hash160(v);
+                        hash.assign(h.begin(), h.end());
+                    }
+                    else {
+                        const util::Hash256 h = crypto::hashfuncs::DoubleSha256(v);
+                        hash.assign(h.begin(), h.end());
+                    }
+                    top(1) = std::move(hash);
+                    break;
+                }
+    
+                case Opcode::OP_CODESEPARATOR:
+                {
+                    // signatures sign the script from here on
+                    code_begin = pc;
+                    break;
+                }
+    
+                case Opcode::OP_CHECKSIG:
+                case Opcode::OP_CHECKSIGVERIFY:
+                {
+                    if (stack->size() < 2)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    const std::vector<uint8_t>& sig = top(2);
+                    const std::vector<uint8_t>& pubkey = top(1);
+    
+                    Script script_code(code_begin, script.end());
+                    // a signature can not sign itself
+                    if (sigversion == SigVersion::kBase)
+                        FindAndDelete(&script_code, sig);
+    
+                    if (!CheckSignatureEncoding(sig, flags, error))
+                        return false;
+                    const bool success = checker.CheckSig(sig, pubkey, script_code, sigversion);
+    
+                    stack->pop_back();
+                    stack->pop_back();
+                    stack->push_back(success ? kTrue : kFalse);
+                    if (opcode == Opcode::OP_CHECKSIGVERIFY) {
+                        if (!success)
+                            return SetError(error, ScriptError::kCheckSigVerify);
+                        stack->pop_back();
+                    }
+                    break;
+                }
+    
+                case Opcode::OP_CHECKMULTISIG:
+                case Opcode::OP_CHECKMULTISIGVERIFY:
+                {
+                    // ([dummy] [sig ...] num_of_signatures [pubkey ...] num_of_pubkeys -- bool)
+                    size_t i = 1;
+                    if (stack->size() < i)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+    
+                    int keys = ScriptInt(top(i), false).IntValue();
+                    if (keys < 0 || keys > kMaxPubkeysPerMultisig)
+                        return SetError(error, ScriptError::kPubkeyCount);
+                    op_count += keys;
+                    if (op_count > kMaxOpsPerScript)
+                        return SetError(error, ScriptError::kOpCount);
+                    size_t ikey = ++i;
+                    i += keys;
+                    if (stack->size() < i)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+    
+                    int sigs = ScriptInt(top(i), false).IntValue();
+                    if (sigs < 0 || sigs > keys)
+                        return SetError(error, ScriptError::kSigCount);
+                    size_t isig = ++i;
+                    i += sigs;
+                    if (stack->size() < i)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+    
+                    Script script_code(code_begin, script.end());
+                    if (sigversion == SigVersion::kBase)
+                        for (int k = 0; k < sigs; k++)
+                            FindAndDelete(&script_code, top(isig + k));
+    
+                    // Keys and signatures are matched in order, a key that
+                    // fails its signature is skipped for good.
+                    bool success = true;
+                    while (success && sigs > 0) {
+                        const std::vector<uint8_t>& sig = top(isig);
+                        const std::vector<uint8_t>& pubkey = top(ikey);
+                        if (!CheckSignatureEncoding(sig, flags, error))
+                            return false;
+                        if (checker.CheckSig(sig, pubkey, script_code, sigversion)) {
+                            isig++;
+                            sigs--;
+                        }
+                        ikey++;
+                        keys--;
+                        // too many failed to still make it
+                        if (sigs > keys)
+                            success = false;
+                    }
+    
+                    while (i-- > 1)
+                        stack->pop_back();
+                    // one more item, an off-by-one in the original that
+                    // BIP147 pins down to an empty one
+                    if (stack->size() < 1)
+                        return SetError(error, ScriptError::kInvalidStackOperation);
+                    if ((flags & kVerifyNullDummy) && !top(1).empty())
+                        return SetError(error, ScriptError::kSigNullDummy);
+                    stack->pop_back();
+    
+                    stack->push_back(success ? kTrue : kFalse);
+                    if (opcode == Opcode::OP_CHECKMULTISIGVERIFY) {
+                        if (!success)
+                            return SetError(error, ScriptError::kCheckMultisigVerify);
+                        stack->pop_back();
+                    }
+                    break;
+                }
+    
+                default:
+                    return SetError(error, ScriptError::kBadOpcode);
+            }
+        }
+    
+        if (stack->size() + altstack.size() > kMaxStackSize)
+            return SetError(error, ScriptError::kStackSize);
+    }
+    
+    if (!exec.empty())
+        return SetError(error, ScriptError::kUnbalancedConditional);
+    
+    return SetError(error, ScriptError::kOk);
+}
+
+bool VerifyWitnessProgram(const ScriptWitness& witness, int version,
+                          const std::vector<uint8_t>& program, uint32_t flags,
+                          const SignatureChecker& checker, ScriptError *error)
+{
+    // left to future soft forks, taproot among them
+    if (version != 0)
+        return SetError(error, ScriptError::kOk);
+    
+    ScriptStack stack;
+    Script script;
+    if (program.size() == 32) {
+        // P2WSH, the last item is the script and hashes to the program
+        if (witness.size() == 0)
+            return SetError(error, ScriptError::kWitnessProgramWitnessEmpty);
+        stack = witness.ToStack();
+        const util::Hash256 hash = crypto::hashfuncs::Sha256(stack.back());
+        if (!std::equal(hash.begin(), hash.end(), program.begin()))
+            return SetError(error, ScriptError::kWitnessProgramMismatch);
+        script = Script(stack.back());
+        stack.pop_back();
+    }
+    else if (program.size() == 20) {
+        // P2WPKH, a signature and a key run through the P2PKH script
+        if (witness.size() != 2)
+            return SetError(error, ScriptError::kWitnessProgramMismatch);
+        stack = witness.ToStack();
+        script.Push(Opcode::OP_DUP);
+        script.Push(Opcode::OP_HASH160);
+        script.Push(program);
+        script.Push(Opcode::OP_EQUALVERIFY);
+        script.Push(Opcode::OP_CHECKSIG);
+    }
+    else {
+        return SetError(error, ScriptError::kWitnessProgramWrongLength);
+    }
+    
+    for (const std::vector<uint8_t>& item : stack)
+        if (item.size() > kMaxElementSize)
+            return SetError(error, ScriptError::kPushSize);
+    
+    if (!EvalScript(&stack, script, flags, checker, SigVersion::kWitnessV0, error))
+        return false;
+    
+    // exactly one true item left, not a rule of legacy scripts
+    if (stack.size() != 1)
+        return SetError(error, ScriptError::kCleanStack);
+    if (!CastToBool(stack.back()))
+        return SetError(error, ScriptError::kEvalFalse);
+    
+    return SetError(error, ScriptError::kOk);
+}
+
+} // namespace
+
+const char *ScriptErrorString(ScriptError error)
+{
+    switch (error) {
+        case ScriptError::kOk:
+            return "No error";
+        case ScriptError::kEvalFalse:
+            return "Script evaluated without error but finished with a false/empty top stack element";
+        case ScriptError::kOpReturn:
+            return "OP_RETURN was encountered";
+        case ScriptError::kScriptSize:
+            return "Script is too big";
+        case ScriptError::kPushSize:
+            return "Push value size limit exceeded";
+        case ScriptError::kOpCount:
+            return "Operation limit exceeded";
+        case ScriptError::kStackSize:
+            return "Stack size limit exceeded";
+        case ScriptError::kSigCount:
+            return "Signature count negative or greater than pubkey count";
+        case ScriptError::kPubkeyCount:
+            return "Pubkey count negative or limit exceeded";
+        case ScriptError::kVerify:
+            return "Script failed an OP_VERIFY operation";
+        case ScriptError::kEqualVerify:
+            return "Script failed an OP_EQUALVERIFY operation";
+        case ScriptError::kCheckMultisigVerify:
+            return "Script failed an OP_CHECKMULTISIGVERIFY operation";
+        case ScriptError::kCheckSigVerify:
+            return "Script failed an OP_CHECKSIGVERIFY operation";
+        case ScriptError::kNumEqualVerify:
+            return "Script failed an OP_NUMEQUALVERIFY operation";
+        case ScriptError::kBadOpcode:
+            return "Opcode missing or not understood";
+        case ScriptError::kDisabledOpcode:
+            return "Attempted to use a disabled opcode";
+        case ScriptError::kInvalidStackOperation:
+            return "Operation not valid with the current stack size";
+        case ScriptError::kInvalidAltstackOperation:
+            return "Operation not valid with the current altstack size";
+        case ScriptError::kUnbalancedConditional:
+            return "Invalid OP_IF construction";
+        case ScriptError::kNegativeLocktime:
+            return "Negative locktime";
+        case ScriptError::kUnsatisfiedLocktime:
+            return "Locktime requirement not satisfied";
+        case ScriptError::kSigDer:
+            return "Non-canonical DER signature";
+        case ScriptError::kSigNullDummy:
+            return "Dummy CHECKMULTISIG argument must be zero";
+        case ScriptError::kSigPushOnly:
+            return "Only push operators allowed in signatures";
+        case ScriptError::kWitnessProgramWrongLength:
+            return "Witness program has incorrect length";
+        case ScriptError::kWitnessProgramWitnessEmpty:
+            return "Witness program was passed an empty witness";
+        case ScriptError::kWitnessProgramMismatch:
+            return "Witness program hash mismatch";
+        case ScriptError::kWitnessMalleated:
+            return "Witness requires empty scriptSig";
+        case ScriptError::kWitnessMalleatedP2sh:
+            return "Witness requires only-redeemscript scriptSig";
+        case ScriptError::kWitnessUnexpected:
+            return "Witness provided for non-witness script";
+        case ScriptError::kCleanStack:
+            return "Stack size must be exactly one after execution";
+        case ScriptError::kUnknown:
+        default:
+            return "unknown error";
+    }
+}
+
+PrecomputedTxData::PrecomputedTxData(const Transaction& tx)
+{
+    if (!tx.HasWitness())
+        return;
+    
+    hash_prevouts = HashPrevouts(tx);
+    hash_sequence = HashSequence(tx);
+    hash_outputs = HashOutputs(tx);
+    ready = true;
+}
+
+util::Hash256 SignatureHash(const Script& script_code, const Transaction& tx, size_t n_in,
+                            uint32_t hash_type, uint64_t amount, SigVersion sigversion,
+                            const PrecomputedTxData *txdata)
+{
+    if (sigversion == SigVersion::kWitnessV0)
+        return WitnessV0SignatureHash(script_code, tx, n_in, hash_type, amount, txdata);
+    return LegacySignatureHash(script_code, tx, n_in, hash_type);
+}
+
+TransactionSignatureChecker::TransactionSignatureChecker(const Transaction *tx, size_t n_in,
+                                                         uint64_t amount,
+                                                         const PrecomputedTxData *txdata)
+    : tx_(tx), n_in_(n_in), amount_(amount), txdata_(txdata)
+{
+}
+
+bool TransactionSignatureChecker::CheckSig(const std::vector<uint8_t>& sig,
+                                           const std::vector<uint8_t>& pubkey,
+                                           const Script& script_code,
+                                           SigVersion sigversion) const
+{
+    if (sig.empty())
+        return false;
+    
+    std::vector<uint8_t> der(sig.begin(), sig.end() - 1);
+    const uint32_t hash_type = sig.back();
+    const util::Hash256 sighash = SignatureHash(script_code, *tx_, n_in_, hash_type,
+                                                amount_, sigversion, txdata_);
+    
+    return VerifySignature(der, pubkey, sighash);
+}
+
+bool TransactionSignatureChecker::VerifySignature(const std::vector<uint8_t>& sig,
+                                                  const std::vector<uint8_t>& pubkey,
+                                                  const util::Hash256& sighash) const
+{
+    return crypto::VerifyEcdsa(pubkey, sig, sighash);
+}
+
+bool TransactionSignatureChecker::CheckLockTime(const ScriptInt& lock_time) const
+{
+    // both heights or both times
+    const int64_t tx_lock_time = tx_->lock_time();
+    if ((tx_lock_time < kLockTimeThreshold) != (lock_time.value() < kLockTimeThreshold))
+        return false;
+    if (lock_time.value() > tx_lock_time)
+        return false;
+    
+    // A final input turns the lock time off, and the opcode with it.
+    return tx_->inputs()[n_in_].sequence_no() != TxIn::default_sequence_no;
+}
+
+bool TransactionSignatureChecker::CheckSequence(const ScriptInt& sequence) const
+{
+    const uint32_t tx_sequence = tx_->inputs()[n_in_].sequence_no();
+    
+    // BIP68 relative lock times need version 2
+    if (tx_->version() < 2)
+        return false;
+    if (tx_sequence & kSequenceLockTimeDisable)
+        return false;
+    
+    // both in blocks or both in time, then compared by value
+    const uint32_t mask = kSequenceLockTimeType | kSequenceLockTimeMask;
+    const int64_t tx_masked = tx_sequence & mask;
+    const int64_t masked = sequence.value() & mask;
+    if ((tx_masked < kSequenceLockTimeType) != (masked < kSequenceLockTimeType))
+        return false;
+    
+    return masked <= tx_masked;
+}
+
+bool EvalScript(ScriptStack *stack, const Script& script, uint32_t flags,
+                const SignatureChecker& checker, SigVersion sigversion, ScriptError *error)
+{
+    ASSERT_NULL(stack);
+    SetError(error, ScriptError::kUnknown);
+    
+    // ScriptInt throws on numbers too long to be one
+    try {
+        return EvalOps(stack, script, flags, checker, sigversion, error);
+    }
+    catch (const std::runtime_error&) {
+        return SetError(error, ScriptError::kUnknown);
+    }
+}
+
+bool VerifyScript(const Script& script_sig, const Script& script_pub_key,
+                  const ScriptWitness& witness, uint32_t flags,
+                  const SignatureChecker& checker, ScriptError *error)
+{
+    ScriptStack stack, p2sh_stack;
+    int version;
+    std::vector<uint8_t> program;
+    bool had_witness = false;
+    
+    SetError(error, ScriptError::kUnknown);
+    
+    // Run one after the other rather than concatenated, so that script_sig
+    // can not jump past the checks of script_pub_key (CVE-2010-5141).
+    if (!EvalScript(&stack, script_sig, flags, checker, SigVersion::kBase, error))
+        return false;
+    if (flags & kVerifyP2sh)
+        p2sh_stack = stack;
+    if (!EvalScript(&stack, script_pub_key, flags, checker, SigVersion::kBase, error))
+        return false;
+    if (stack.empty() || !CastToBool(stack.back()))
+        return SetError(error, ScriptError::kEvalFalse);
+    
+    if ((flags & kVerifyWitness) && script_pub_key.IsWitnessProgram(&version, &program)) {
+        had_witness = true;
+        // a script_sig would be malleable, the witness is not hashed
+        if (!script_sig.empty())
+            return SetError(error, ScriptError::kWitnessMalleated);
+        if (!VerifyWitnessProgram(witness, version, program, flags, checker, error))
+            return false;
+    }
+    
+    if ((flags & kVerifyP2sh) && script_pub_key.IsPayToScriptHash()) {
+        if (!script_sig.IsPushOnly())
+            return SetError(error, ScriptError::kSigPushOnly);
+    
+        // the top item is the redeem script, the hash check above saw to it
+        // that there is one
+        stack.swap(p2sh_stack);
+        const Script redeem_script(stack.back());
+        stack.pop_back();
+    
+        if (!EvalScript(&stack, redeem_script, flags, checker, SigVersion::kBase, error))
+            return false;
+        if (stack.empty() || !CastToBool(stack.back()))
+            return SetError(error, ScriptError::kEvalFalse);
+    
+        if ((flags & kVerifyWitness) && redeem_script.IsWitnessProgram(&version, &program)) {
+            had_witness = true;
+            // nothing but the push of the redeem script
+            Script expected;
+            expected.Push(std::vector<uint8_t>(redeem_script.begin(), redeem_script.end()));
+            if (script_sig != expected)
+                return SetError(error, ScriptError::kWitnessMalleatedP2sh);
+            if (!VerifyWitnessProgram(witness, version, program, flags, checker, error))
+                return false;
+        }
+    }
+    
+    // Witness data only where a witness program asks for it, or it could be
+    // stuffed with anything without changing the txid.
+    if ((flags & kVerifyWitness) && !had_witness && !witness.IsNull())
+        return SetError(error, ScriptError::kWitnessUnexpected);
+    
+    return SetError(error, ScriptError::kOk);
+}
+
+ScriptCheck::ScriptCheck(const TxOut& spent, const Transaction& tx, size_t n_in,
+                         uint32_t flags, const PrecomputedTxData *txdata, ScriptCache *cache)
+    : spent_(spent), tx_(&tx), n_in_(n_in), flags_(flags), txdata_(txdata), cache_(cache)
+{
+}
+
+bool ScriptCheck::operator()()
+{
+    const TxIn& input = tx_->inputs()[n_in_];
+    if (cache_) {
+        const CachingSignatureChecker checker(tx_, n_in_, spent_.value(), txdata_, cache_);
+        return VerifyScript(input.script_sig(), spent_.script_pub_key(), input.script_witness(),
+                            flags_, checker, &error_);
+    }
+    
+    const TransactionSignatureChecker checker(tx_, n_in_, spent_.value(), txdata_);
+    return VerifyScript(input.script_sig(), spent_.script_pub_key(), input.script_witness(),
+                        flags_, checker, &error_);
+}
+
+} // namespace consensus
+} // namespace btclite
@@ -0,0 +1,86 @@
+#include "merkle.h"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+
+#include "sha256.h"
+
+
+namespace btclite {
+namespace consensus {
+
+namespace {
+
+// Smallest range of wtxids worth handing to another thread.
+constexpr size_t kMinWitnessHashRange = 256;
+
+} // namespace
+
+util::Hash256 ComputeMerkleRoot(std::vector<util::Hash256>&& leaves, bool *mutated)
+{
+    std::vector<util::Hash256> hashes(std::move(leaves));
+    bool mutation = false;
+    
+    while (hashes.size() > 1) {
+        if (mutated) {
+            for (size_t pos = 0; pos + 1 < hashes.size(); pos += 2) {
+                if (hashes[pos] == hashes[pos + 1])
+                    mutation = true;
+            }
+        }
+        
+        // If number of hashes is odd, duplicate last hash in the list.
+        if (hashes.size() & 1)
+            hashes.push_back(hashes.back());
+        
+        // Parents overwrite the front half of the level in place.
+        crypto::sha256::DoubleSha256D64(hashes[0].data(), hashes[0].data(), hashes.size() / 2);
+        hashes.resize(hashes.size() / 2);
+    }
+    
+    if (mutated)
+        *mutated = mutation;
+    if (hashes.empty())
+        return util::Hash256();
+    
+    // There is now only one item in the list.
+    return hashes.front();
+}
+
+util::Hash256 BlockWitnessMerkleRoot(const Block& block, util::ThreadPool *pool, bool *mutated)
+{
+    const std::vector<TransactionRef>& txs = block.transactions();
+    const size_t count = txs.size();
+    std::vector<util::Hash256> leaves(count);
+    
+    const auto hash_range = [&txs, &leaves](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            leaves[i] = txs[i]->GetWitnessHash();
+    };
+    
+    // The witness of the coinbase is not known when its commitment is made,
+    // so its leaf stays zero and the hashing starts at index 1.
+    if (pool && count >= 2) {
+        const size_t max_tasks = std::max(1u, std::thread::hardware_concurrency());
+        const size_t tasks = std::min(max_tasks, (count - 1 + kMinWitnessHashRange - 1)
+                                                 / kMinWitnessHashRange);
+        const size_t step = (count - 1 + tasks - 1) / tasks;
+        std::vector<std::future<void> > futures;
+        
+        for (size_t begin = 1 + step; begin < count; begin += step)
+            futures.push_back(pool->AddTask(hash_range, begin, std::min(begin + step, count)));
+        hash_range(1, std::min(1 + step, count));
+        for (auto& future : futures)
+            future.get();
+    }
+    else {
+        hash_range(1, count);
+    }
+    
+    return ComputeMerkleRoot(std::move(leaves), mutated);
+}
+
+} // namespace consensus
+} // namespace btclite
@@ -18,6 +18,17 @@ Params::Params(BtcNet btcnet)
             CreateGenesisBlock(1231006505, 2083236893, 0x1d00ffff, 1,
                                50 * kSatoshiPerBitcoin);
             subsidy_halving_interval_ = 210000;
+            soft_forks_.bip16_exception = util::StrToHash256(
+                "0x00000000000002dc756eebf4f49723ed8d30cc28a5f108eb94b1ba88ac4f9c22");
+            soft_forks_.bip30_exceptions = {
+                util::StrToHash256("0x00000000000a4d0a398161ffc163c503763b1f4360639393e0e4c8e300e0caec"),
+                util::StrToHash256("0x00000000000743f190a18c5577a3c2d2a1f610ae9601ac046a38084ccb7cd721")
+            };
+            soft_forks_.bip34 = 227931;
+            soft_forks_.bip65 = 388381;
+            soft_forks_.bip66 = 363725;
+            soft_forks_.csv = 419328;
+            soft_forks_.segwit = 481824;
             break;
         }
         case BtcNet::kTestNet :
@@ -25,6 +36,13 @@ Params::Params(BtcNet btcnet)
             CreateGenesisBlock(1296688602, 414098458, 0x1d00ffff, 1, 
                                50 * kSatoshiPerBitcoin);
             subsidy_halving_interval_ = 210000;
+            soft_forks_.bip16_exception = util::StrToHash256(
+                "0x00000000dd30457c001f4095d208cc1296b0eed002427aa599874af7a432b105");
+            soft_forks_.bip34 = 21111;
+            soft_forks_.bip65 = 581885;
+            soft_forks_.bip66 = 330776;
+            soft_forks_.csv = 770112;
+            soft_forks_.segwit = 834624;
             break;
         }
         case BtcNet::kRegTest :
@@ -51,11 +69,26 @@ int Params::SubsideHalvingInterval() const
     return subsidy_halving_interval_;
 }
 
+uint64_t Params::BlockSubsidy(uint32_t height) const
+{
+    const uint32_t halvings = height / subsidy_halving_interval_;
+    // shifting by the width or more is undefined, and the subsidy is long gone
+    if (halvings >= 64)
+        return 0;
+    
+    return (50 * kSatoshiPerBitcoin) >> halvings;
+}
+
 const Bip9Params& Params::Bip9params() const
 {
     return bip9_params_;
 }
 
+const SoftForkHeights& Params::SoftForks() const
+{
+    return soft_forks_;
+}
+
 void Params::CreateGenesisBlock(const std::string& coinbase, const Script& output_script,
                                 uint32_t time, uint32_t nonce, uint32_t bits, int32_t version,
                                 uint64_t reward)
@@ -65,18 +98,17 @@ void Params::CreateGenesisBlock(const std::string& coinbase, const Script& outpu
     script.Push(ScriptInt(4));
     script.Push(std::vector<uint8_t>(coinbase.begin(), coinbase.end()));
 
-    std::vector<TxIn> inputs;
+    std::pmr::vector<TxIn> inputs;
     TxIn input(OutPoint(), script);
     inputs.push_back(input);
 
-    std::vector<TxOut> outputs;
+    std::pmr::vector<TxOut> outputs;
     outputs.push_back(TxOut(reward, output_script));
 
-    std::vector<Transaction> transactions;
-    Transaction tx_new(1, inputs, outputs, 0);
-    transactions.push_back(tx_new);
+    std::vector<TransactionRef> transactions;
+    transactions.push_back(MakeTransactionRef(Transaction(1, inputs, outputs, 0)));
 
-    genesis_.set_transactions(transactions);
+    genesis_.set_transactions(std::move(transactions));
     BlockHeader header(version, util::Hash256(), genesis_.ComputeMerkleRoot(), time, bits, nonce);    
     genesis_.set_header(header);
 }
@@ -0,0 +1,129 @@
+#include "pow.h"
+
+#include "compact.h"
+#include "sha256.h"
+#include "util_endian.h"
+
+
+namespace btclite {
+namespace consensus {
+
+namespace {
+
+// Offset of nBits in a serialized block header.
+constexpr size_t kHeaderBitsOffset = 72;
+
+} // namespace
+
+util::uint256_t TargetCache::Get(uint32_t bits)
+{
+    Slot& slot = slots_[SlotIndex(bits)];
+    
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if (!(seq & 1) && slot.bits.load(std::memory_order_relaxed) == bits) {
+        uint64_t limbs[util::uint256_t::kLimbs];
+        for (int i = 0; i < util::uint256_t::kLimbs; i++)
+            limbs[i] = slot.limbs[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return util::uint256_t::FromLimbs(limbs);
+        }
+    }
+    
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    util::uint256_t target = Decode(bits);
+    
+    // Publish unless another writer holds the slot, the next lookup of
+    // these bits will try again.
+    if (!(seq & 1) && slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire,
+                                                      std::memory_order_relaxed)) {
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.bits.store(bits, std::memory_order_relaxed);
+        for (int i = 0; i < util::uint256_t::kLimbs; i++)
+            slot.limbs[i].store(target.limb(i), std::memory_order_relaxed);
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+    
+    return target;
+}
+
+util::uint256_t TargetCache::Decode(uint32_t bits)
+{
+    Compact compact(bits);
+    if (compact.negative() || compact.overflowed())
+        return 0;
+    
+    return compact.normal();
+}
+
+void TargetCache::Clear()
+{
+    for (Slot& slot : slots_) {
+        slot.seq.fetch_add(1, std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.bits.store(0, std::memory_order_relaxed);
+        for (auto& limb : slot.limbs)
+            limb.store(0, std::memory_order_relaxed);
+        slot.seq.fetch_add(1, std::memory_order_release);
+    }
+    hits_.store(0, std::memory_order_relaxed);
+    misses_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t TargetCache::hits() const
+{
+    return hits_.load(std::memory_order_relaxed);
+}
+
+uint64_t TargetCache::misses() const
+{
+    return misses_.load(std::memory_order_relaxed);
+}
+
+bool HashMeetsTarget(const util::Hash256& hash, const util::uint256_t& target)
+{
+    for (int i = util::uint256_t::kLimbs - 1; i >= 0; i--) {
+        uint64_t limb = util::FromLittleEndian<uint64_t>(hash.data() + 8 * i);
+        if (limb != target.limb(i))
+            return limb < target.limb(i);
+    }
+    
+    return true;
+}
+
+util::uint256_t GetBlockProof(uint32_t bits)
+{
+    util::uint256_t target = SingletonTargetCache::GetInstance().Get(bits);
+    if (target == 0)
+        return 0;
+    
+    // We need to compute 2**256 / (target+1), but we can't represent 2**256
+    // as it's too large for an util::uint256_t. However, as 2**256 is at least
+    // as large as target+1, it is equal to ((2**256 - target - 1) / (target+1)) + 1,
+    // or ~target / (target+1) + 1.
+    return (~target / (target + 1)) + 1;
+}
+
+bool CheckProofOfWork(const util::Hash256& hash, uint32_t bits)
+{
+    util::uint256_t target = SingletonTargetCache::GetInstance().Get(bits);
+    if (target == 0)
+        return false;
+    
+    return HashMeetsTarget(hash, target);
+}
+
+bool CheckHeaderProofOfWork(const uint8_t *header, util::Hash256 *hash)
+{
+    util::Hash256 header_hash;
+    crypto::sha256::DoubleSha256D80(header_hash.data(), header);
+    if (hash)
+        *hash = header_hash;
+    
+    return CheckProofOfWork(header_hash,
+                            util::FromLittleEndian<uint32_t>(header + kHeaderBitsOffset));
+}
+
+} // namespace consensus
+} // namespace btclite
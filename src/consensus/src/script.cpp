@@ -9,11 +9,12 @@ ScriptInt::ScriptInt(const int64_t& n)
     set_value(n);
 }
 
-ScriptInt::ScriptInt(const std::vector<uint8_t>& v, bool minimal)
+ScriptInt::ScriptInt(const std::vector<uint8_t>& v, bool minimal, size_t max_bytes)
 {
+    set_value(0);
     if (v.size() == 0)
         return;
-    if (v.size() > max_size)
+    if (v.size() > max_bytes)
         throw std::runtime_error("script number overflow");
     
     if (minimal) {
@@ -36,7 +37,7 @@ ScriptInt::ScriptInt(const std::vector<uint8_t>& v, bool minimal)
     
     int64_t value = 0;
     for (unsigned int i = 0; i < v.size(); i++) 
-        value |= (v[i] << 8*i);
+        value |= static_cast<int64_t>(v[i]) << 8*i;
     
     // If the input vector's most significant byte is 0x80, remove it from
     // the result's msb and return a negative.
@@ -61,14 +62,15 @@ std::vector<uint8_t> ScriptInt::BytesValue() const
     return BytesEncoding(value());
 }
 
-std::vector<uint8_t> ScriptInt::BytesEncoding(const uint64_t& value)
+std::vector<uint8_t> ScriptInt::BytesEncoding(const int64_t& value)
 {
     if (value == 0)
         return std::vector<uint8_t>();
     
     std::vector<uint8_t> result;
     bool neg = (value < 0);
-    int64_t abs = neg ? -value : value;
+    // unsigned, to negate the minimum too
+    uint64_t abs = neg ? ~static_cast<uint64_t>(value) + 1 : value;
     
     while (abs) {
         result.push_back(abs & 0xff);
@@ -87,18 +89,18 @@ std::vector<uint8_t> ScriptInt::BytesEncoding(const uint64_t& value)
     if (result.back() & 0x80)
         result.push_back(neg ? 0x80 : 0);
     else if (neg)
-        result.push_back(0x80);
+        result.back() |= 0x80;
     
     return result;
 }
 
-Script::Script(std::vector<uint8_t>&& v) noexcept
-    : data_(std::move(v)) 
+Script::Script(const std::vector<uint8_t>& v)
+    : data_(v.begin(), v.end()) 
 {
 }
 
-Script::Script(const std::vector<uint8_t>& v)
-    : data_(v) 
+Script::Script(const_iterator first, const_iterator last)
+    : data_(first, last)
 {
 }
 
@@ -119,7 +121,7 @@ void Script::Push(const uint64_t& b)
     else if (b == 0)
         data_.push_back(static_cast<uint8_t>(Opcode::OP_0));
     else
-        this->Push(ScriptInt::BytesEncoding(b));
+        this->Push(ScriptInt::BytesEncoding(static_cast<int64_t>(b)));
 }
 
 void Script::Push(const Opcode& code)
@@ -163,7 +165,7 @@ void Script::clear()
     data_.clear();
 }
 
-bool Script::Pop(std::vector<uint8_t>::const_iterator& pc, Opcode *out) const
+bool Script::Pop(const_iterator& pc, Opcode *out) const
 {
     ASSERT_NULL(out);
     if (pc >= data_.end())
@@ -175,7 +177,7 @@ bool Script::Pop(std::vector<uint8_t>::const_iterator& pc, Opcode *out) const
     return true;
 }
 
-bool Script::Pop(std::vector<uint8_t>::const_iterator& pc, const Opcode& in, std::vector<uint8_t> *out) const
+bool Script::Pop(const_iterator& pc, const Opcode& in, std::vector<uint8_t> *out) const
 {
     ASSERT_NULL(out);
     if (pc >= data_.end())
@@ -203,29 +205,42 @@ bool Script::Pop(std::vector<uint8_t>::const_iterator& pc, const Opcode& in, std
         pc += 4;
     }
     
-    if (pc + size > data_.end())
+    if (static_cast<size_t>(data_.end() - pc) < size)
         return false;
     out->assign(pc, pc+size);
+    pc += size;
     
     return true;
 }
 
-std::vector<uint8_t>::const_iterator Script::begin() const
+bool Script::GetOp(const_iterator& pc, Opcode *opcode, std::vector<uint8_t> *data) const
+{
+    ASSERT_NULL(data);
+    data->clear();
+    if (!Pop(pc, opcode))
+        return false;
+    if (*opcode == Opcode::OP_0 || *opcode > Opcode::OP_PUSHDATA4)
+        return true;
+    
+    return Pop(pc, *opcode, data);
+}
+
+Script::const_iterator Script::begin() const
 {
     return data_.begin();
 }
 
-std::vector<uint8_t>::const_iterator Script::end() const
+Script::const_iterator Script::end() const
 {
     return data_.end();
 }
 
-std::vector<uint8_t>::const_reverse_iterator Script::rbegin() const
+Script::const_reverse_iterator Script::rbegin() const
 {
     return data_.rbegin();
 }
 
-std::vector<uint8_t>::const_reverse_iterator Script::rend() const
+Script::const_reverse_iterator Script::rend() const
 {
     return data_.rend();
 }
@@ -261,5 +276,70 @@ size_t Script::SerializedSize() const
     return result;
 }
 
+size_t Script::size() const
+{
+    return data_.size();
+}
+
+bool Script::empty() const
+{
+    return data_.empty();
+}
+
+size_t Script::allocated_memory() const
+{
+    return data_.allocated_memory();
+}
+
+bool Script::IsUnspendable() const
+{
+    return (!data_.empty() && data_[0] == static_cast<uint8_t>(Opcode::OP_RETURN)) ||
+           data_.size() > max_size;
+}
+
+bool Script::IsPayToScriptHash() const
+{
+    return data_.size() == 23 &&
+           data_[0] == static_cast<uint8_t>(Opcode::OP_HASH160) &&
+           data_[1] == 0x14 &&
+           data_[22] == static_cast<uint8_t>(Opcode::OP_EQUAL);
+}
+
+bool Script::IsPushOnly() const
+{
+    const_iterator pc = begin();
+    Opcode opcode;
+    std::vector<uint8_t> data;
+    while (pc < end()) {
+        if (!GetOp(pc, &opcode, &data))
+            return false;
+        // OP_RESERVED counts as a push here, it fails when run anyway
+        if (opcode > Opcode::OP_16)
+            return false;
+    }
+    
+    return true;
+}
+
+bool Script::IsWitnessProgram(int *version, std::vector<uint8_t> *program) const
+{
+    ASSERT_NULL(version);
+    ASSERT_NULL(program);
+    if (data_.size() < 4 || data_.size() > 42)
+        return false;
+    if (data_[0] != static_cast<uint8_t>(Opcode::OP_0) &&
+            (data_[0] < static_cast<uint8_t>(Opcode::OP_1) ||
+             data_[0] > static_cast<uint8_t>(Opcode::OP_16)))
+        return false;
+    if (static_cast<size_t>(data_[1]) + 2 != data_.size())
+        return false;
+    
+    *version = data_[0] == static_cast<uint8_t>(Opcode::OP_0) ? 0 :
+               data_[0] - static_cast<uint8_t>(Opcode::OP_1) + 1;
+    program->assign(data_.begin() + 2, data_.end());
+    
+    return true;
+}
+
 } // namespace consensus
 } // namespace btclite
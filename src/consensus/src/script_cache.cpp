@@ -0,0 +1,78 @@
+#include "script_cache.h"
+
+#include "hash.h"
+#include "random.h"
+
+
+namespace btclite {
+namespace consensus {
+
+ScriptCache::ScriptCache(size_t max_bytes)
+    : script_salt_(util::RandHash256()), signature_salt_(util::RandHash256()),
+      scripts_(max_bytes / 2), signatures_(max_bytes / 2)
+{
+}
+
+bool ScriptCache::HaveScripts(const Transaction& tx, uint32_t flags) const
+{
+    return scripts_.Contains(ScriptKey(tx, flags));
+}
+
+void ScriptCache::AddScripts(const Transaction& tx, uint32_t flags)
+{
+    scripts_.Insert(ScriptKey(tx, flags));
+}
+
+bool ScriptCache::HaveSignature(const std::vector<uint8_t>& sig,
+                                const std::vector<uint8_t>& pubkey,
+                                const util::Hash256& sighash) const
+{
+    return signatures_.Contains(SignatureKey(sig, pubkey, sighash));
+}
+
+void ScriptCache::AddSignature(const std::vector<uint8_t>& sig,
+                               const std::vector<uint8_t>& pubkey,
+                               const util::Hash256& sighash)
+{
+    signatures_.Insert(SignatureKey(sig, pubkey, sighash));
+}
+
+util::Hash256 ScriptCache::ScriptKey(const Transaction& tx, uint32_t flags) const
+{
+    crypto::HashWriter hw;
+    hw << script_salt_ << tx.GetWitnessHash() << flags;
+    return hw.Sha256();
+}
+
+util::Hash256 ScriptCache::SignatureKey(const std::vector<uint8_t>& sig,
+                                        const std::vector<uint8_t>& pubkey,
+                                        const util::Hash256& sighash) const
+{
+    crypto::HashWriter hw;
+    hw << signature_salt_ << sighash << pubkey << sig;
+    return hw.Sha256();
+}
+
+CachingSignatureChecker::CachingSignatureChecker(const Transaction *tx, size_t n_in,
+                                                 uint64_t amount,
+                                                 const PrecomputedTxData *txdata,
+                                                 ScriptCache *cache)
+    : TransactionSignatureChecker(tx, n_in, amount, txdata), cache_(cache)
+{
+}
+
+bool CachingSignatureChecker::VerifySignature(const std::vector<uint8_t>& sig,
+                                              const std::vector<uint8_t>& pubkey,
+                                              const util::Hash256& sighash) const
+{
+    if (cache_->HaveSignature(sig, pubkey, sighash))
+        return true;
+    if (!TransactionSignatureChecker::VerifySignature(sig, pubkey, sighash))
+        return false;
+    
+    cache_->AddSignature(sig, pubkey, sighash);
+    return true;
+}
+
+} // namespace consensus
+} // namespace btclite
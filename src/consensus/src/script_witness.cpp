@@ -1,82 +1,134 @@
 #include "script_witness.h"
 
+#include <sstream>
+
+#include "string_encoding.h"
+
 
 namespace btclite {
 namespace consensus {
 
 
 ScriptWitness::ScriptWitness(const ScriptWitness& witness)
-    : stack_(witness.stack_)
+    : data_(witness.data_), offsets_(witness.offsets_)
 {
 }
 
 ScriptWitness::ScriptWitness(ScriptWitness&& witness) noexcept
-    : stack_(std::move(witness.stack_))
+    : data_(std::move(witness.data_)), offsets_(std::move(witness.offsets_))
 {
 }
 
 ScriptWitness::ScriptWitness(const std::vector<std::vector<uint8_t> >& stack)
-    : stack_(stack)
-{
-}
-
-ScriptWitness::ScriptWitness(std::vector<std::vector<uint8_t> >&& stack) noexcept
-    : stack_(std::move(stack)) 
 {
+    size_t total = 0;
+    for (const auto& item : stack)
+        total += item.size();
+    
+    data_.reserve(total);
+    for (const auto& item : stack)
+        Push(item);
 }
 
 bool ScriptWitness::IsNull() const
 {
-    return stack_.empty();
+    return offsets_.empty();
 }
 
 void ScriptWitness::Clear()
 {
-    stack_.clear();
-    stack_.shrink_to_fit();
+    data_.clear();
+    data_.shrink_to_fit();
+    offsets_ = util::Prevector<4, uint32_t>();
 }
 
 std::string ScriptWitness::ToString() const
 {
-    return "";
+    std::stringstream ss;
+    
+    for (size_t i = 0; i < size(); i++) {
+        Item item = (*this)[i];
+        if (i > 0)
+            ss << " ";
+        ss << util::EncodeHex(item.begin(), item.end());
+    }
+    
+    return ss.str();
 }
 
-bool ScriptWitness::operator==(const ScriptWitness& b) const
+size_t ScriptWitness::size() const
 {
-    return stack_ == b.stack_;
+    return offsets_.size();
 }
 
-bool ScriptWitness::operator!=(const ScriptWitness& b) const
+ScriptWitness::Item ScriptWitness::operator[](size_t pos) const
 {
-    return !(*this == b);
+    size_t begin = (pos == 0) ? 0 : offsets_[pos - 1];
+    return Item(data_.data() + begin, offsets_[pos] - begin);
 }
 
-ScriptWitness& ScriptWitness::operator=(const ScriptWitness& b)
+void ScriptWitness::Push(const uint8_t *data, size_t size)
 {
-    stack_ = b.stack_;
-    return *this;
+    data_.insert(data_.end(), data, data + size);
+    offsets_.push_back(static_cast<uint32_t>(data_.size()));
 }
 
-ScriptWitness& ScriptWitness::operator=(ScriptWitness&& b)
+void ScriptWitness::Push(const std::vector<uint8_t>& item)
 {
-    if (this != &b)
-        stack_ = std::move(b.stack_);
-    return *this;
+    Push(item.data(), item.size());
 }
 
-const std::vector<std::vector<uint8_t> >& ScriptWitness::stack() const
+std::vector<std::vector<uint8_t> > ScriptWitness::ToStack() const
 {
-    return stack_;
+    std::vector<std::vector<uint8_t> > stack;
+    
+    stack.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        Item item = (*this)[i];
+        stack.emplace_back(item.begin(), item.end());
+    }
+    
+    return stack;
 }
 
-void ScriptWitness::set_stack(const std::vector<std::vector<uint8_t> >& stack)
+size_t ScriptWitness::allocated_memory() const
 {
-    stack_ = stack;
+    return data_.capacity() + offsets_.allocated_memory();
 }
 
-void ScriptWitness::set_stack(std::vector<std::vector<uint8_t> >&& stack)
+size_t ScriptWitness::SerializedSize() const
+{
+    size_t size = util::VarIntSize(offsets_.size()) + data_.size();
+    for (size_t i = 0; i < offsets_.size(); i++)
+        size += util::VarIntSize((*this)[i].size());
+    
+    return size;
+}
+
+bool ScriptWitness::operator==(const ScriptWitness& b) const
 {
-    stack_ = std::move(stack);
+    return offsets_ == b.offsets_ && data_ == b.data_;
+}
+
+bool ScriptWitness::operator!=(const ScriptWitness& b) const
+{
+    return !(*this == b);
+}
+
+ScriptWitness& ScriptWitness::operator=(const ScriptWitness& b)
+{
+    data_ = b.data_;
+    offsets_ = b.offsets_;
+    return *this;
+}
+
+ScriptWitness& ScriptWitness::operator=(ScriptWitness&& b) noexcept
+{
+    if (this != &b) {
+        data_ = std::move(b.data_);
+        offsets_ = std::move(b.offsets_);
+    }
+    return *this;
 }
 
 } // namespace consensus
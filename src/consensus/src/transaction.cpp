@@ -1,6 +1,7 @@
 #include "transaction.h"
 
 #include <botan/hash.h>
+#include <algorithm>
 #include <numeric>
 
 
@@ -8,7 +9,7 @@ namespace btclite {
 namespace consensus {
 
 OutPoint::OutPoint()
-    : index_(std::numeric_limits<uint32_t>::max()) 
+    : prev_hash_(), index_(std::numeric_limits<uint32_t>::max()) 
 {
 }
     
@@ -187,7 +188,7 @@ size_t TxIn::SerializedSize() const
 
 bool TxIn::HasWitness() const
 {
-    return false;
+    return !script_witness_.IsNull();
 }
 
 const OutPoint& TxIn::prevout() const
@@ -277,7 +278,7 @@ void TxOut::Clear()
     script_pub_key_.clear();
 }
 
-bool TxOut::IsNull()
+bool TxOut::IsNull() const
 {
     return value_ == null_value;
 }
@@ -351,58 +352,78 @@ void TxOut::set_scriptPubKey(Script&& script)
     script_pub_key_ = std::move(script);
 }
 
-Transaction::Transaction()
-    : version_(default_version), inputs_(), outputs_(), lock_time_(0), hash_cache_()
+HashCache::HashCache()
+    : state_(kEmpty), hash_()
 {
 }
 
-Transaction::Transaction(uint32_t version, const std::vector<TxIn>& inputs,
-            const std::vector<TxOut>& outputs, uint32_t lock_time)
-    : version_(version), inputs_(inputs), outputs_(outputs), lock_time_(lock_time)
+HashCache::HashCache(const HashCache& b)
+    : state_(kEmpty), hash_()
 {
-    GetHash();
+    *this = b;
 }
 
-Transaction::Transaction(uint32_t version, std::vector<TxIn>&& inputs,
-            std::vector<TxOut>&& outputs, uint32_t lock_time) noexcept
-    : version_(version), inputs_(std::move(inputs)),
-      outputs_(std::move(outputs)), lock_time_(lock_time)
+void HashCache::Clear()
 {
-    GetHash();
+    state_.store(kEmpty, std::memory_order_relaxed);
 }
 
-Transaction::Transaction(const Transaction& t)
-    : version_(t.version_), inputs_(t.inputs_), outputs_(t.outputs_),
-      lock_time_(t.lock_time_)
+HashCache& HashCache::operator=(const HashCache& b)
 {
-    GetHash();
+    if (this != &b) {
+        if (b.state_.load(std::memory_order_acquire) == kReady) {
+            hash_ = b.hash_;
+            state_.store(kReady, std::memory_order_release);
+        }
+        else {
+            state_.store(kEmpty, std::memory_order_relaxed);
+        }
+    }
+    
+    return *this;
 }
 
-Transaction::Transaction(Transaction&& t) noexcept
-    : version_(t.version_), inputs_(std::move(t.inputs_)), 
-      outputs_(std::move(t.outputs_)), lock_time_(t.lock_time_)
+Transaction::Transaction()
+    : version_(default_version), inputs_(), outputs_(), lock_time_(0),
+      hash_cache_(), witness_hash_cache_()
+{
+}
+
+Transaction::Transaction(std::pmr::memory_resource *resource)
+    : version_(default_version), inputs_(resource), outputs_(resource), lock_time_(0),
+      hash_cache_(), witness_hash_cache_()
+{
+}
+
+Transaction::Transaction(uint32_t version, const std::pmr::vector<TxIn>& inputs,
+            const std::pmr::vector<TxOut>& outputs, uint32_t lock_time)
+    : version_(version), inputs_(inputs), outputs_(outputs), lock_time_(lock_time),
+      hash_cache_(), witness_hash_cache_()
+{
+}
+
+Transaction::Transaction(uint32_t version, std::pmr::vector<TxIn>&& inputs,
+            std::pmr::vector<TxOut>&& outputs, uint32_t lock_time) noexcept
+    : version_(version), inputs_(std::move(inputs)),
+      outputs_(std::move(outputs)), lock_time_(lock_time),
+      hash_cache_(), witness_hash_cache_()
 {
-    GetHash();
 }
 
-template <typename Stream>
-void Transaction::Serialize(Stream& os, bool witness) const
+Transaction::Transaction(const Transaction& t)
+    : version_(t.version_), inputs_(t.inputs_), outputs_(t.outputs_),
+      lock_time_(t.lock_time_), hash_cache_(t.hash_cache_),
+      witness_hash_cache_(t.witness_hash_cache_)
 {
-    util::Serializer<Stream> serializer(os);
-    serializer.SerialWrite(version_);
-    serializer.SerialWrite(inputs_);
-    serializer.SerialWrite(outputs_);
-    serializer.SerialWrite(lock_time_);
 }
 
-template <typename Stream>
-void Transaction::Deserialize(Stream& is, bool witness)
+Transaction::Transaction(Transaction&& t) noexcept
+    : version_(t.version_), inputs_(std::move(t.inputs_)), 
+      outputs_(std::move(t.outputs_)), lock_time_(t.lock_time_),
+      hash_cache_(t.hash_cache_), witness_hash_cache_(t.witness_hash_cache_)
 {
-    util::Deserializer<Stream> deserializer(is);
-    deserializer.SerialRead(&version_);
-    deserializer.SerialRead(&inputs_);
-    deserializer.SerialRead(&outputs_);
-    deserializer.SerialRead(&lock_time_);
+    t.hash_cache_.Clear();
+    t.witness_hash_cache_.Clear();
 }
 
 bool Transaction::operator==(const Transaction& b) const
@@ -421,7 +442,8 @@ Transaction& Transaction::operator=(const Transaction& b)
     inputs_ = b.inputs_;
     outputs_ = b.outputs_;
     lock_time_ = b.lock_time_;
-    hash_cache_.fill(0);
+    hash_cache_ = b.hash_cache_;
+    witness_hash_cache_ = b.witness_hash_cache_;
     
     return *this;
 }
@@ -433,7 +455,10 @@ Transaction& Transaction::operator=(Transaction&& b) noexcept
         inputs_ = std::move(b.inputs_);
         outputs_ = std::move(b.outputs_);
         lock_time_ = std::move(b.lock_time_);
-        hash_cache_.fill(0);
+        hash_cache_ = b.hash_cache_;
+        witness_hash_cache_ = b.witness_hash_cache_;
+        b.hash_cache_.Clear();
+        b.witness_hash_cache_.Clear();
     }
     
     return *this;
@@ -441,18 +466,20 @@ Transaction& Transaction::operator=(Transaction&& b) noexcept
 
 util::Hash256 Transaction::GetHash() const
 {
-    if (hash_cache_ == crypto::null_hash) {
-        crypto::HashOStream hs;
-        hs << *this;
-        hash_cache_ = hs.DoubleSha256();
-    }
-    
-    return hash_cache_;
+    return hash_cache_.Get([this]() { return crypto::GetDoubleHash(*this); });
 }
 
 util::Hash256 Transaction::GetWitnessHash() const
 {
-    return witness_hash_cache_;
+    if (!HasWitness())
+        return GetHash();
+    
+    return witness_hash_cache_.Get([this]()
+    {
+        crypto::HashWriter hw;
+        Serialize(hw, true);
+        return hw.DoubleSha256();
+    });
 }
 
 bool Transaction::IsNull() const
@@ -465,6 +492,12 @@ bool Transaction::IsCoinBase() const
     return (inputs_.size() == 1 && inputs_[0].prevout().IsNull());
 }
 
+bool Transaction::HasWitness() const
+{
+    return std::any_of(inputs_.begin(), inputs_.end(),
+                       [](const TxIn& input) { return input.HasWitness(); });
+}
+
 uint64_t Transaction::OutputsAmount() const
 {
     uint64_t amount = 0;
@@ -477,7 +510,7 @@ uint64_t Transaction::OutputsAmount() const
     return amount;
 }
 
-size_t Transaction::SerializedSize() const
+size_t Transaction::SerializedSize(bool witness) const
 {
     const auto ins = [](size_t size, const TxIn& input)
     {
@@ -487,12 +520,22 @@ size_t Transaction::SerializedSize() const
     {
         return size + output.SerializedSize();
     };
+    const auto witnesses = [](size_t size, const TxIn& input)
+    {
+        return size + input.script_witness().SerializedSize();
+    };
+    
+    size_t size = sizeof(version_) + sizeof(lock_time_)
+                  + util::VarIntSize(inputs_.size())
+                  + std::accumulate(inputs_.begin(), inputs_.end(), size_t{0}, ins)
+                  + util::VarIntSize(outputs_.size())
+                  + std::accumulate(outputs_.begin(), outputs_.end(), size_t{0}, outs);
+    if (witness && HasWitness()) {
+        // marker and flag
+        size += 2 + std::accumulate(inputs_.begin(), inputs_.end(), size_t{0}, witnesses);
+    }
     
-    return sizeof(version_) + sizeof(lock_time_)
-           + util::VarIntSize(inputs_.size())
-           + std::accumulate(inputs_.begin(), inputs_.end(), size_t{0}, ins)
-           + util::VarIntSize(outputs_.size())
-           + std::accumulate(outputs_.begin(), outputs_.end(), size_t{0}, outs);
+    return size;
 }
 
 std::string Transaction::ToString() const
@@ -523,41 +566,46 @@ uint32_t Transaction::version() const
 void Transaction::set_version(uint32_t v)
 {
     version_ = v;
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
-const std::vector<TxIn>& Transaction::inputs() const
+const std::pmr::vector<TxIn>& Transaction::inputs() const
 {
     return inputs_;
 }
 
-void Transaction::set_inputs(const std::vector<TxIn>& inputs)
+void Transaction::set_inputs(const std::pmr::vector<TxIn>& inputs)
 {
     inputs_ = inputs;
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
-void Transaction::set_inputs(std::vector<TxIn>&& inputs)
+void Transaction::set_inputs(std::pmr::vector<TxIn>&& inputs)
 {
     inputs_ = std::move(inputs);
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
-const std::vector<TxOut>& Transaction::outputs() const
+const std::pmr::vector<TxOut>& Transaction::outputs() const
 {
     return outputs_;
 }
 
-void Transaction::set_outputs(const std::vector<TxOut>& outputs)
+void Transaction::set_outputs(const std::pmr::vector<TxOut>& outputs)
 {
     outputs_ = outputs;
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
-void Transaction::set_outputs(std::vector<TxOut>&& outputs)
+void Transaction::set_outputs(std::pmr::vector<TxOut>&& outputs)
 {
     outputs_ = std::move(outputs);
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
 uint32_t Transaction::lock_time() const
@@ -568,7 +616,8 @@ uint32_t Transaction::lock_time() const
 void Transaction::set_lockTime(uint32_t t)
 {
     lock_time_ = t;
-    hash_cache_.fill(0);
+    hash_cache_.Clear();
+    witness_hash_cache_.Clear();
 }
 
 } // namespace consensus
@@ -0,0 +1,98 @@
+#include "tx_check.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "string_encoding.h"
+
+
+namespace btclite {
+namespace consensus {
+
+namespace {
+
+bool Reject(const Transaction& tx, const char *reason)
+{
+    const util::Hash256 hash = tx.GetHash();
+    BTCLOG(LOG_LEVEL_WARNING) << "Transaction " << util::EncodeHex(hash.rbegin(), hash.rend())
+                              << " is invalid: " << reason;
+    return false;
+}
+
+bool HasDuplicateInputs(const std::pmr::vector<TxIn>& inputs)
+{
+    if (inputs.size() < 2)
+        return false;
+    if (inputs.size() == 2)
+        return inputs[0].prevout() == inputs[1].prevout();
+    
+    std::vector<const OutPoint*> prevouts;
+    prevouts.reserve(inputs.size());
+    for (const TxIn& input : inputs)
+        prevouts.push_back(&input.prevout());
+    std::sort(prevouts.begin(), prevouts.end(), [](const OutPoint *a, const OutPoint *b)
+    {
+        int cmp = std::memcmp(a->prev_hash().data(), b->prev_hash().data(), a->prev_hash().size());
+        return cmp < 0 || (cmp == 0 && a->index() < b->index());
+    });
+    
+    return std::adjacent_find(prevouts.begin(), prevouts.end(),
+                              [](const OutPoint *a, const OutPoint *b) { return *a == *b; })
+           != prevouts.end();
+}
+
+} // namespace
+
+bool CheckTransaction(const Transaction& tx)
+{
+    if (tx.inputs().empty())
+        return Reject(tx, "no inputs");
+    if (tx.outputs().empty())
+        return Reject(tx, "no outputs");
+    if (tx.SerializedSize() > kMaxBlockSize)
+        return Reject(tx, "oversize");
+    
+    uint64_t amount = 0;
+    for (const TxOut& output : tx.outputs()) {
+        if (output.value() > kMaxSatoshiAmount)
+            return Reject(tx, "output value out of range");
+        amount += output.value();
+        if (amount > kMaxSatoshiAmount)
+            return Reject(tx, "total output value out of range");
+    }
+    
+    if (HasDuplicateInputs(tx.inputs()))
+        return Reject(tx, "duplicate inputs");
+    
+    if (tx.IsCoinBase()) {
+        size_t size = tx.inputs()[0].script_sig().size();
+        if (size < 2 || size > 100)
+            return Reject(tx, "bad coinbase script size");
+    }
+    else {
+        for (const TxIn& input : tx.inputs())
+            if (input.prevout().IsNull())
+                return Reject(tx, "null prevout");
+    }
+    
+    return true;
+}
+
+bool IsFinalTx(const Transaction& tx, uint32_t height, int64_t lock_time_cutoff)
+{
+    const int64_t lock_time = tx.lock_time();
+    if (lock_time == 0)
+        return true;
+    if (lock_time < (lock_time < kLockTimeThreshold ? static_cast<int64_t>(height)
+                                                    : lock_time_cutoff))
+        return true;
+    
+    for (const TxIn& input : tx.inputs())
+        if (input.sequence_no() != TxIn::default_sequence_no)
+            return false;
+    
+    return true;
+}
+
+} // namespace consensus
+} // namespace btclite
@@ -0,0 +1,32 @@
+#ifndef BTCLITE_CRYPTO_ECDSA_H
+#define BTCLITE_CRYPTO_ECDSA_H
+
+#include <vector>
+
+#include "arithmetic.h"
+
+
+namespace btclite {
+namespace crypto {
+
+// ECDSA over secp256k1, through libsecp256k1.
+
+// Whether sig is a signature of hash by pubkey, a 33-byte compressed or
+// 65-byte uncompressed key. sig is DER with the laxness of the signatures
+// accepted before BIP66, and a high S verifies, as the chain allows. Safe
+// to call from any number of threads at once.
+bool VerifyEcdsa(const std::vector<uint8_t>& pubkey, const std::vector<uint8_t>& sig,
+                 const util::Hash256& hash);
+
+// Sign hash with the 32-byte secret key seckey into a DER signature with a
+// low S. For tests and tools, the key is not kept out of swap or wiped.
+bool SignEcdsa(const uint8_t *seckey, const util::Hash256& hash, std::vector<uint8_t> *sig);
+
+// The public key of seckey, serialized compressed or uncompressed.
+bool EcdsaPublicKey(const uint8_t *seckey, bool compressed, std::vector<uint8_t> *pubkey);
+
+} // namespace crypto
+} // namespace btclite
+
+
+#endif // BTCLITE_CRYPTO_ECDSA_H
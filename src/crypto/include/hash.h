@@ -7,6 +7,7 @@
 #include <botan/system_rng.h>
 
 #include "arithmetic.h"
+#include "flat_hash_map.h"
 #include "serialize.h"
 
 
@@ -41,6 +42,13 @@ util::Hash256 DoubleSha256(const uint8_t in[], size_t length);
 util::Hash256 DoubleSha256(const std::vector<uint8_t>& in);
 util::Hash256 DoubleSha256(const std::string& in);
 
+util::Hash160 Ripemd160(const uint8_t in[], size_t length);
+util::Hash160 Sha1(const uint8_t in[], size_t length);
+
+// RIPEMD-160 of SHA-256, the hash of keys and scripts in addresses.
+util::Hash160 Hash160(const uint8_t in[], size_t length);
+util::Hash160 Hash160(const std::vector<uint8_t>& in);
+
 } // namespace hashfuncs
 
 
@@ -61,6 +69,9 @@ public:
     HashOStream& operator<<(const T& obj)
     {
         util::Serializer<ByteSinkType> serializer(byte_sink_);
+        if constexpr (util::HasSerializedSize<T>::value) {
+            Reserve(obj.SerializedSize());
+        }
         serializer.SerialWrite(obj);
         return *this;
     }
@@ -70,12 +81,48 @@ public:
     const Container& vec() const;    
     void Clear();
     
+    // make room for size more bytes without regrowing on every write
+    void Reserve(size_t size);
+    
 private:
     Container vec_;
     ByteSinkType byte_sink_;
 };
 
 
+// A writer stream (for serialization) that feeds the serialized bytes
+// straight into SHA-256, so the state stays constant-size no matter how
+// large the object is.
+class HashWriter {
+public:
+    HashWriter();
+    
+    //-------------------------------------------------------------------------
+    // Both finalize the hash and reset the writer for reuse.
+    util::Hash256 Sha256();    
+    util::Hash256 DoubleSha256();
+    
+    //-------------------------------------------------------------------------
+    HashWriter& write(const char *buffer, std::streamsize size);
+    
+    template <typename T>
+    HashWriter& operator<<(const T& obj)
+    {
+        util::Serializer<HashWriter> serializer(*this);
+        serializer.SerialWrite(obj);
+        return *this;
+    }
+    
+    //-------------------------------------------------------------------------
+    size_t Size() const;
+    void Clear();
+    
+private:
+    std::unique_ptr<Botan::HashFunction> hash_func_;
+    size_t size_;
+};
+
+
 // SipHash-2-4
 class SipHasher {
 public:
@@ -101,22 +148,51 @@ private:
     bool is_set_key_;
 };
 
+// SipHash-2-4 of the 32 bytes of val, equal to SipHasher(k0, k1) fed the
+// same bytes but without allocating, for use on every hash table lookup.
+uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const util::Hash256& val);
+
+// The same over the 36 bytes of val followed by extra in little endian, the
+// layout of an outpoint.
+uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const util::Hash256& val,
+                             uint32_t extra);
+
+// Hasher for Hash256-keyed hash tables. Each instance draws a random key,
+// so peers cannot grind block or transaction hashes into one bucket the way
+// they can with the first 8 bytes that Hasher returns.
+class SaltedHash256Hasher {
+public:
+    SaltedHash256Hasher();
+    
+    size_t operator()(const util::Hash256& val) const
+    {
+        return SipHashUint256(k0_, k1_, val);
+    }
+    
+private:
+    uint64_t k0_;
+    uint64_t k1_;
+};
+
+template <typename V>
+using Hash256Map = util::FlatHashMap<util::Hash256, V, SaltedHash256Hasher>;
+
 
 // support hashable for any class with Serialize methord
 template <typename T>
 util::Hash256 GetHash(const T& obj)
 {
-    HashOStream hs;
-    hs << obj;
-    return hs.Sha256();
+    HashWriter hw;
+    hw << obj;
+    return hw.Sha256();
 }
 
 template <typename T>
 util::Hash256 GetDoubleHash(const T& obj)
 {
-    HashOStream hs;
-    hs << obj;
-    return hs.DoubleSha256();
+    HashWriter hw;
+    hw << obj;
+    return hw.DoubleSha256();
 }
 
 } // namespace crypto
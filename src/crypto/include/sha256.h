@@ -0,0 +1,46 @@
+#ifndef BTCLITE_SHA256_H
+#define BTCLITE_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace btclite {
+namespace crypto {
+namespace sha256 {
+
+// SHA-256 implementations for hashing many small inputs at once.
+enum class Backend : uint8_t {
+    kStandard = 0,  // portable C++, one input at a time
+    kSse4,          // SSE4.1, 4 inputs in parallel
+    kAvx2,          // AVX2, 8 inputs in parallel
+    kShaNi          // x86 SHA extensions
+};
+
+// Select the fastest backend supported by the running CPU and return its name.
+// It runs once at startup, call it again only after UseBackend().
+std::string AutoDetect();
+
+// Force a backend, returns false if the CPU does not support it.
+// Not thread safe, must not race with hashing in other threads.
+bool UseBackend(Backend backend);
+bool IsSupported(Backend backend);
+Backend backend();
+std::string BackendName(Backend backend);
+
+// Compute the double SHA-256 of blocks independent 64-byte inputs laid out
+// back to back in `in`, writing blocks 32-byte hashes to `out`.
+// This is the shape of txid pairs in merkle trees. out may equal in, so a
+// level of a merkle tree can be reduced in place.
+void DoubleSha256D64(uint8_t *out, const uint8_t *in, size_t blocks);
+
+// Double SHA-256 of one 80-byte input, the shape of a serialized block
+// header. Padding is fixed, so it is three compressions and no buffering.
+void DoubleSha256D80(uint8_t *out, const uint8_t *in);
+
+} // namespace sha256
+} // namespace crypto
+} // namespace btclite
+
+#endif // BTCLITE_SHA256_H
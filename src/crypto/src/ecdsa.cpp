@@ -0,0 +1,197 @@
+#include "ecdsa.h"
+
+#include <cstring>
+#include <secp256k1.h>
+
+
+namespace btclite {
+namespace crypto {
+
+namespace {
+
+// Created on first use and never destroyed, libsecp256k1 allows sharing a
+// context between threads as long as it is not randomized again.
+const secp256k1_context *Context()
+{
+    static const secp256k1_context *context =
+        secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
+    return context;
+}
+
+// secp256k1_ecdsa_signature_parse_der() only takes strict DER. Signatures
+// in the chain before BIP66 may pad their lengths and integers, so parse
+// them the way OpenSSL did: the sequence length is skipped, integers may
+// carry leading zeros, and an R or S too large for the curve gives a
+// signature that parses but never verifies.
+bool ParseDerLax(const secp256k1_context *ctx, secp256k1_ecdsa_signature *sig,
+                 const uint8_t *input, size_t length)
+{
+    size_t pos = 0;
+    size_t rpos, rlen, spos, slen;
+    size_t lenbyte;
+    uint8_t compact[64] = {};
+    bool overflow = false;
+    
+    // all zero, valid to parse and impossible to verify
+    secp256k1_ecdsa_signature_parse_compact(ctx, sig, compact);
+    
+    // sequence tag and length
+    if (pos == length || input[pos] != 0x30)
+        return false;
+    pos++;
+    if (pos == length)
+        return false;
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > length - pos)
+            return false;
+        pos += lenbyte;
+    }
+    
+    // R, tag and length
+    if (pos == length || input[pos] != 0x02)
+        return false;
+    pos++;
+    if (pos == length)
+        return false;
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > length - pos)
+            return false;
+        while (lenbyte > 0 && input[pos] == 0) {
+            pos++;
+            lenbyte--;
+        }
+        if (lenbyte >= sizeof(size_t))
+            return false;
+        rlen = 0;
+        while (lenbyte > 0) {
+            rlen = (rlen << 8) + input[pos++];
+            lenbyte--;
+        }
+    }
+    else {
+        rlen = lenbyte;
+    }
+    if (rlen > length - pos)
+        return false;
+    rpos = pos;
+    pos += rlen;
+    
+    // S, tag and length
+    if (pos == length || input[pos] != 0x02)
+        return false;
+    pos++;
+    if (pos == length)
+        return false;
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > length - pos)
+            return false;
+        while (lenbyte > 0 && input[pos] == 0) {
+            pos++;
+            lenbyte--;
+        }
+        if (lenbyte >= sizeof(size_t))
+            return false;
+        slen = 0;
+        while (lenbyte > 0) {
+            slen = (slen << 8) + input[pos++];
+            lenbyte--;
+        }
+    }
+    else {
+        slen = lenbyte;
+    }
+    if (slen > length - pos)
+        return false;
+    spos = pos;
+    
+    // the integers without their leading zeros, right-aligned
+    while (rlen > 0 && input[rpos] == 0) {
+        rlen--;
+        rpos++;
+    }
+    if (rlen > 32)
+        overflow = true;
+    else
+        std::memcpy(compact + 32 - rlen, input + rpos, rlen);
+    
+    while (slen > 0 && input[spos] == 0) {
+        slen--;
+        spos++;
+    }
+    if (slen > 32)
+        overflow = true;
+    else
+        std::memcpy(compact + 64 - slen, input + spos, slen);
+    
+    if (!overflow)
+        overflow = !secp256k1_ecdsa_signature_parse_compact(ctx, sig, compact);
+    if (overflow) {
+        std::memset(compact, 0, sizeof(compact));
+        secp256k1_ecdsa_signature_parse_compact(ctx, sig, compact);
+    }
+    
+    return true;
+}
+
+} // namespace
+
+bool VerifyEcdsa(const std::vector<uint8_t>& pubkey, const std::vector<uint8_t>& sig,
+                 const util::Hash256& hash)
+{
+    const secp256k1_context *ctx = Context();
+    secp256k1_pubkey key;
+    secp256k1_ecdsa_signature signature;
+    
+    if (!secp256k1_ec_pubkey_parse(ctx, &key, pubkey.data(), pubkey.size()))
+        return false;
+    if (!ParseDerLax(ctx, &signature, sig.data(), sig.size()))
+        return false;
+    
+    // libsecp256k1 only verifies a low S, the chain takes either
+    secp256k1_ecdsa_signature_normalize(ctx, &signature, &signature);
+    return secp256k1_ecdsa_verify(ctx, &signature, hash.data(), &key);
+}
+
+bool SignEcdsa(const uint8_t *seckey, const util::Hash256& hash, std::vector<uint8_t> *sig)
+{
+    ASSERT_NULL(sig);
+    const secp256k1_context *ctx = Context();
+    secp256k1_ecdsa_signature signature;
+    
+    if (!secp256k1_ecdsa_sign(ctx, &signature, hash.data(), seckey, nullptr, nullptr))
+        return false;
+    
+    size_t size = 72;
+    sig->resize(size);
+    secp256k1_ecdsa_signature_serialize_der(ctx, sig->data(), &size, &signature);
+    sig->resize(size);
+    
+    return true;
+}
+
+bool EcdsaPublicKey(const uint8_t *seckey, bool compressed, std::vector<uint8_t> *pubkey)
+{
+    ASSERT_NULL(pubkey);
+    const secp256k1_context *ctx = Context();
+    secp256k1_pubkey key;
+    
+    if (!secp256k1_ec_pubkey_create(ctx, &key, seckey))
+        return false;
+    
+    size_t size = compressed ? 33 : 65;
+    pubkey->resize(size);
+    secp256k1_ec_pubkey_serialize(ctx, pubkey->data(), &size, &key,
+                                  compressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+    pubkey->resize(size);
+    
+    return true;
+}
+
+} // namespace crypto
+} // namespace btclite
@@ -1,5 +1,9 @@
 #include "hash.h"
 
+#include "random.h"
+#include "sha256.h"
+#include "util_endian.h"
+
 
 namespace btclite {
 namespace crypto {
@@ -25,6 +29,13 @@ util::Hash256 Sha256(const std::vector<uint8_t>& in)
 util::Hash256 DoubleSha256(const uint8_t in[], size_t length)
 {
     util::Hash256 result;
+    
+    // merkle node pairs, use the optimized single-block path
+    if (length == 64) {
+        sha256::DoubleSha256D64(reinterpret_cast<uint8_t*>(&result), in, 1);
+        return result;
+    }
+    
     std::unique_ptr<Botan::HashFunction> hash_func(Botan::HashFunction::create("SHA-256"));
     
     hash_func->update(in, length);
@@ -46,6 +57,39 @@ util::Hash256 DoubleSha256(const std::string& in)
     return DoubleSha256(reinterpret_cast<const uint8_t*>(in.data()), in.size());;
 }
 
+util::Hash160 Ripemd160(const uint8_t in[], size_t length)
+{
+    util::Hash160 result;
+    std::unique_ptr<Botan::HashFunction> hash_func(Botan::HashFunction::create("RIPEMD-160"));
+    
+    hash_func->update(in, length);
+    hash_func->final(reinterpret_cast<uint8_t*>(&result));
+    
+    return result;
+}
+
+util::Hash160 Sha1(const uint8_t in[], size_t length)
+{
+    util::Hash160 result;
+    std::unique_ptr<Botan::HashFunction> hash_func(Botan::HashFunction::create("SHA-1"));
+    
+    hash_func->update(in, length);
+    hash_func->final(reinterpret_cast<uint8_t*>(&result));
+    
+    return result;
+}
+
+util::Hash160 Hash160(const uint8_t in[], size_t length)
+{
+    const util::Hash256 sha256 = Sha256(in, length);
+    return Ripemd160(sha256.data(), sha256.size());
+}
+
+util::Hash160 Hash160(const std::vector<uint8_t>& in)
+{
+    return Hash160(in.data(), in.size());
+}
+
 } // namespace hashfuncs
 
 
@@ -79,6 +123,60 @@ void HashOStream::Clear()
     vec_.clear();
 }
 
+void HashOStream::Reserve(size_t size)
+{
+    size_t required = vec_.size() + size;
+    if (required > vec_.capacity()) {
+        vec_.reserve(std::max(required, 2 * vec_.capacity()));
+    }
+}
+
+HashWriter::HashWriter()
+    : hash_func_(Botan::HashFunction::create_or_throw("SHA-256")), size_(0)
+{
+}
+
+util::Hash256 HashWriter::Sha256()
+{
+    util::Hash256 result;
+    
+    hash_func_->final(reinterpret_cast<uint8_t*>(&result));
+    size_ = 0;
+    
+    return result;
+}
+
+util::Hash256 HashWriter::DoubleSha256()
+{
+    util::Hash256 result;
+    
+    hash_func_->final(reinterpret_cast<uint8_t*>(&result));
+    hash_func_->update(reinterpret_cast<const uint8_t*>(&result), result.size());
+    hash_func_->final(reinterpret_cast<uint8_t*>(&result));
+    size_ = 0;
+    
+    return result;
+}
+
+HashWriter& HashWriter::write(const char *buffer, std::streamsize size)
+{
+    hash_func_->update(reinterpret_cast<const uint8_t*>(buffer), size);
+    size_ += size;
+    
+    return *this;
+}
+
+size_t HashWriter::Size() const
+{
+    return size_;
+}
+
+void HashWriter::Clear()
+{
+    hash_func_->clear();
+    size_ = 0;
+}
+
 SipHasher::SipHasher()
     : mac_(Botan::MessageAuthenticationCode::create_or_throw("SipHash")),
       rng_(), key_(rng_.random_vec(16)), is_set_key_(false) 
@@ -124,5 +222,68 @@ uint64_t SipHasher::Final()
     return ret;
 }
 
+namespace {
+
+inline uint64_t Rotl(uint64_t x, int b)
+{
+    return (x << b) | (x >> (64 - b));
+}
+
+inline void SipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3)
+{
+    v0 += v1; v1 = Rotl(v1, 13); v1 ^= v0; v0 = Rotl(v0, 32);
+    v2 += v3; v3 = Rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = Rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = Rotl(v1, 17); v1 ^= v2; v2 = Rotl(v2, 32);
+}
+
+// SipHash-2-4 of the 32 bytes of val followed by the final block last,
+// which holds the bytes past them and the message length.
+uint64_t SipHashUint256Block(uint64_t k0, uint64_t k1, const util::Hash256& val, uint64_t last)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    
+    for (int i = 0; i < 4; i++) {
+        uint64_t m = util::FromLittleEndian<uint64_t>(val.data() + 8 * i);
+        v3 ^= m;
+        SipRound(v0, v1, v2, v3);
+        SipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    
+    v3 ^= last;
+    SipRound(v0, v1, v2, v3);
+    SipRound(v0, v1, v2, v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++)
+        SipRound(v0, v1, v2, v3);
+    
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace
+
+uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const util::Hash256& val)
+{
+    // the final block holds only the message length, 32
+    return SipHashUint256Block(k0, k1, val, uint64_t{32} << 56);
+}
+
+uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const util::Hash256& val,
+                             uint32_t extra)
+{
+    // the final block holds extra and the message length, 36
+    return SipHashUint256Block(k0, k1, val, (uint64_t{36} << 56) | extra);
+}
+
+SaltedHash256Hasher::SaltedHash256Hasher()
+    : k0_(util::RandUint64()), k1_(util::RandUint64())
+{
+}
+
 } // namespace crypto
 } // namespace btclite
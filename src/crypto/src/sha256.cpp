@@ -0,0 +1,316 @@
+#include "sha256.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#define BTCLITE_SHA256_X86 1
+#endif
+
+
+namespace btclite {
+namespace crypto {
+
+#if defined(BTCLITE_SHA256_X86)
+namespace sha256_sse41 {
+void TransformD64_4way(uint8_t *out, const uint8_t *in);
+} // namespace sha256_sse41
+
+namespace sha256_avx2 {
+void TransformD64_8way(uint8_t *out, const uint8_t *in);
+} // namespace sha256_avx2
+
+namespace sha256_shani {
+void TransformD64(uint8_t *out, const uint8_t *in);
+} // namespace sha256_shani
+#endif
+
+namespace sha256 {
+
+namespace {
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t kInitState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline uint32_t Rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t ReadBE32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x)
+{
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+// One SHA-256 compression of the message schedule seed w[0..15] into state.
+void Compress(uint32_t state[8], const uint32_t block[16])
+{
+    uint32_t w[64];
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = block[i];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = Rotr(w[i-15], 7) ^ Rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = Rotr(w[i-2], 17) ^ Rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) +
+                      (g ^ (e & (f ^ g))) + kRoundConstants[i] + w[i];
+        uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) +
+                      ((a & b) | (c & (a | b)));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void TransformD64(uint8_t *out, const uint8_t *in)
+{
+    uint32_t block[16];
+    uint32_t state[8];
+    uint32_t inner[8];
+
+    // first hash, the 64-byte input followed by a padding-only block
+    std::copy(kInitState, kInitState + 8, state);
+    for (int i = 0; i < 16; i++)
+        block[i] = ReadBE32(in + 4*i);
+    Compress(state, block);
+    block[0] = 0x80000000;
+    std::fill(block + 1, block + 15, 0);
+    block[15] = 0x200;
+    Compress(state, block);
+    std::copy(state, state + 8, inner);
+
+    // second hash over the 32-byte digest
+    std::copy(kInitState, kInitState + 8, state);
+    std::copy(inner, inner + 8, block);
+    block[8] = 0x80000000;
+    std::fill(block + 9, block + 15, 0);
+    block[15] = 0x100;
+    Compress(state, block);
+
+    for (int i = 0; i < 8; i++)
+        WriteBE32(out + 4*i, state[i]);
+}
+
+void TransformD80(uint8_t *out, const uint8_t *in)
+{
+    uint32_t block[16];
+    uint32_t state[8];
+    uint32_t inner[8];
+
+    // first hash, 64 bytes then the last 16 with the padding for 640 bits
+    std::copy(kInitState, kInitState + 8, state);
+    for (int i = 0; i < 16; i++)
+        block[i] = ReadBE32(in + 4*i);
+    Compress(state, block);
+    for (int i = 0; i < 4; i++)
+        block[i] = ReadBE32(in + 64 + 4*i);
+    block[4] = 0x80000000;
+    std::fill(block + 5, block + 15, 0);
+    block[15] = 0x280;
+    Compress(state, block);
+    std::copy(state, state + 8, inner);
+
+    // second hash over the 32-byte digest
+    std::copy(kInitState, kInitState + 8, state);
+    std::copy(inner, inner + 8, block);
+    block[8] = 0x80000000;
+    std::fill(block + 9, block + 15, 0);
+    block[15] = 0x100;
+    Compress(state, block);
+
+    for (int i = 0; i < 8; i++)
+        WriteBE32(out + 4*i, state[i]);
+}
+
+#if defined(BTCLITE_SHA256_X86)
+bool HaveCpuFeature(Backend backend)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    bool have_sse41 = (ecx >> 19) & 1;
+    bool have_xsave = ((ecx >> 27) & 1) && ((ecx >> 28) & 1);
+
+    // the OS must save the ymm registers for AVX to be usable
+    bool have_ymm = false;
+    if (have_xsave) {
+        uint32_t xcr0_lo, xcr0_hi;
+        __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        have_ymm = (xcr0_lo & 6) == 6;
+    }
+
+    bool have_avx2 = false, have_shani = false;
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_shani = (ebx >> 29) & 1;
+    }
+
+    switch (backend) {
+        case Backend::kStandard:
+            return true;
+        case Backend::kSse4:
+            return have_sse41;
+        case Backend::kAvx2:
+            return have_sse41 && have_avx2 && have_ymm;
+        case Backend::kShaNi:
+            return have_sse41 && have_shani;
+    }
+
+    return false;
+}
+#else
+bool HaveCpuFeature(Backend backend)
+{
+    return backend == Backend::kStandard;
+}
+#endif
+
+Backend g_backend = Backend::kStandard;
+
+const std::string g_auto_detected = AutoDetect();
+
+} // namespace
+
+std::string AutoDetect()
+{
+    if (HaveCpuFeature(Backend::kShaNi))
+        g_backend = Backend::kShaNi;
+    else if (HaveCpuFeature(Backend::kAvx2))
+        g_backend = Backend::kAvx2;
+    else if (HaveCpuFeature(Backend::kSse4))
+        g_backend = Backend::kSse4;
+    else
+        g_backend = Backend::kStandard;
+
+    return BackendName(g_backend);
+}
+
+bool UseBackend(Backend backend)
+{
+    if (!HaveCpuFeature(backend))
+        return false;
+    g_backend = backend;
+
+    return true;
+}
+
+bool IsSupported(Backend backend)
+{
+    return HaveCpuFeature(backend);
+}
+
+Backend backend()
+{
+    return g_backend;
+}
+
+std::string BackendName(Backend backend)
+{
+    switch (backend) {
+        case Backend::kStandard:
+            return "standard";
+        case Backend::kSse4:
+            return "sse4(4way)";
+        case Backend::kAvx2:
+            return "avx2(8way)";
+        case Backend::kShaNi:
+            return "shani(1way)";
+    }
+
+    return "unknown";
+}
+
+void DoubleSha256D64(uint8_t *out, const uint8_t *in, size_t blocks)
+{
+#if defined(BTCLITE_SHA256_X86)
+    switch (g_backend) {
+        case Backend::kShaNi:
+            while (blocks) {
+                sha256_shani::TransformD64(out, in);
+                out += 32;
+                in += 64;
+                --blocks;
+            }
+            return;
+        case Backend::kAvx2:
+            while (blocks >= 8) {
+                sha256_avx2::TransformD64_8way(out, in);
+                out += 256;
+                in += 512;
+                blocks -= 8;
+            }
+            // AVX2 implies SSE4.1, finish the remainder 4 at a time
+            [[fallthrough]];
+        case Backend::kSse4:
+            while (blocks >= 4) {
+                sha256_sse41::TransformD64_4way(out, in);
+                out += 128;
+                in += 256;
+                blocks -= 4;
+            }
+            break;
+        case Backend::kStandard:
+            break;
+    }
+#endif
+
+    while (blocks) {
+        TransformD64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
+
+void DoubleSha256D80(uint8_t *out, const uint8_t *in)
+{
+    TransformD80(out, in);
+}
+
+} // namespace sha256
+} // namespace crypto
+} // namespace btclite
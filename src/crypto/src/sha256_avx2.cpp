@@ -0,0 +1,175 @@
+// 8-way AVX2 double SHA-256 of 64-byte inputs, see sha256.h.
+// Each 32-bit lane of a vector carries the state of one input.
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <immintrin.h>
+
+
+namespace btclite {
+namespace crypto {
+namespace sha256_avx2 {
+
+namespace {
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+using Vec = __m256i;
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t kInitState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline uint32_t ReadBE32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x)
+{
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+AVX2_TARGET inline Vec Set1(uint32_t x)
+{
+    return _mm256_set1_epi32(static_cast<int>(x));
+}
+
+AVX2_TARGET inline Vec Add(Vec x, Vec y)
+{
+    return _mm256_add_epi32(x, y);
+}
+
+AVX2_TARGET inline Vec Xor(Vec x, Vec y)
+{
+    return _mm256_xor_si256(x, y);
+}
+
+AVX2_TARGET inline Vec And(Vec x, Vec y)
+{
+    return _mm256_and_si256(x, y);
+}
+
+AVX2_TARGET inline Vec Or(Vec x, Vec y)
+{
+    return _mm256_or_si256(x, y);
+}
+
+AVX2_TARGET inline Vec Shr(Vec x, int n)
+{
+    return _mm256_srli_epi32(x, n);
+}
+
+AVX2_TARGET inline Vec Rotr(Vec x, int n)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+AVX2_TARGET void Compress(Vec state[8], const Vec block[16])
+{
+    Vec w[64];
+    Vec a = state[0], b = state[1], c = state[2], d = state[3];
+    Vec e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 16; i++)
+        w[i] = block[i];
+    for (int i = 16; i < 64; i++) {
+        Vec s0 = Xor(Xor(Rotr(w[i-15], 7), Rotr(w[i-15], 18)), Shr(w[i-15], 3));
+        Vec s1 = Xor(Xor(Rotr(w[i-2], 17), Rotr(w[i-2], 19)), Shr(w[i-2], 10));
+        w[i] = Add(Add(w[i-16], s0), Add(w[i-7], s1));
+    }
+
+    for (int i = 0; i < 64; i++) {
+        Vec t1 = Add(Add(h, Xor(Xor(Rotr(e, 6), Rotr(e, 11)), Rotr(e, 25))),
+                     Add(Xor(g, And(e, Xor(f, g))), Add(Set1(kRoundConstants[i]), w[i])));
+        Vec t2 = Add(Xor(Xor(Rotr(a, 2), Rotr(a, 13)), Rotr(a, 22)),
+                     Or(And(a, b), And(c, Or(a, b))));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    state[0] = Add(state[0], a);
+    state[1] = Add(state[1], b);
+    state[2] = Add(state[2], c);
+    state[3] = Add(state[3], d);
+    state[4] = Add(state[4], e);
+    state[5] = Add(state[5], f);
+    state[6] = Add(state[6], g);
+    state[7] = Add(state[7], h);
+}
+
+} // namespace
+
+AVX2_TARGET void TransformD64_8way(uint8_t *out, const uint8_t *in)
+{
+    Vec block[16];
+    Vec state[8];
+
+    // first hash, the eight inputs followed by a padding-only block
+    for (int i = 0; i < 8; i++)
+        state[i] = Set1(kInitState[i]);
+    for (int i = 0; i < 16; i++)
+        block[i] = _mm256_set_epi32(static_cast<int>(ReadBE32(in + 448 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 384 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 320 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 256 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 192 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 128 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 64 + 4*i)),
+                                    static_cast<int>(ReadBE32(in + 4*i)));
+    Compress(state, block);
+    block[0] = Set1(0x80000000);
+    for (int i = 1; i < 15; i++)
+        block[i] = Set1(0);
+    block[15] = Set1(0x200);
+    Compress(state, block);
+
+    // second hash over the 32-byte digests
+    for (int i = 0; i < 8; i++) {
+        block[i] = state[i];
+        state[i] = Set1(kInitState[i]);
+    }
+    block[8] = Set1(0x80000000);
+    for (int i = 9; i < 15; i++)
+        block[i] = Set1(0);
+    block[15] = Set1(0x100);
+    Compress(state, block);
+
+    for (int i = 0; i < 8; i++) {
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256(reinterpret_cast<Vec*>(lanes), state[i]);
+        for (int j = 0; j < 8; j++)
+            WriteBE32(out + 32*j + 4*i, lanes[j]);
+    }
+}
+
+#undef AVX2_TARGET
+
+} // namespace sha256_avx2
+} // namespace crypto
+} // namespace btclite
+
+#endif
@@ -0,0 +1,135 @@
+// Double SHA-256 of a 64-byte input using the x86 SHA extensions, see sha256.h.
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <immintrin.h>
+
+
+namespace btclite {
+namespace crypto {
+namespace sha256_shani {
+
+namespace {
+
+#define SHANI_TARGET __attribute__((target("sse4.1,sha")))
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t kInitState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline uint32_t ReadBE32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline void WriteBE32(uint8_t *p, uint32_t x)
+{
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+// The SHA instructions keep the state as ABEF/CDGH instead of ABCD/EFGH.
+SHANI_TARGET void Compress(uint32_t state[8], const uint32_t block[16])
+{
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    const __m128i abef_save = state0;
+    const __m128i cdgh_save = state1;
+
+    __m128i msgs[4];
+    for (int i = 0; i < 4; i++)
+        msgs[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4*i));
+
+    // 16 groups of 4 rounds, msgs[] is a ring of the last 16 schedule words
+    for (int i = 0; i < 16; i++) {
+        const __m128i cur = msgs[i & 3];
+        __m128i msg = _mm_add_epi32(cur, _mm_loadu_si128(
+                                             reinterpret_cast<const __m128i*>(kRoundConstants + 4*i)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+        // finish the words of the next group before msg1 touches the previous one
+        if (i >= 3 && i <= 14) {
+            __m128i& next = msgs[(i + 1) & 3];
+            next = _mm_add_epi32(next, _mm_alignr_epi8(cur, msgs[(i - 1) & 3], 4));
+            next = _mm_sha256msg2_epu32(next, cur);
+        }
+        if (i >= 1 && i <= 12)
+            msgs[(i - 1) & 3] = _mm_sha256msg1_epu32(msgs[(i - 1) & 3], cur);
+    }
+
+    state0 = _mm_add_epi32(state0, abef_save);
+    state1 = _mm_add_epi32(state1, cdgh_save);
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+} // namespace
+
+SHANI_TARGET void TransformD64(uint8_t *out, const uint8_t *in)
+{
+    uint32_t block[16];
+    uint32_t state[8];
+
+    // first hash, the 64-byte input followed by a padding-only block
+    for (int i = 0; i < 8; i++)
+        state[i] = kInitState[i];
+    for (int i = 0; i < 16; i++)
+        block[i] = ReadBE32(in + 4*i);
+    Compress(state, block);
+    block[0] = 0x80000000;
+    for (int i = 1; i < 15; i++)
+        block[i] = 0;
+    block[15] = 0x200;
+    Compress(state, block);
+
+    // second hash over the 32-byte digest
+    for (int i = 0; i < 8; i++) {
+        block[i] = state[i];
+        state[i] = kInitState[i];
+    }
+    block[8] = 0x80000000;
+    for (int i = 9; i < 15; i++)
+        block[i] = 0;
+    block[15] = 0x100;
+    Compress(state, block);
+
+    for (int i = 0; i < 8; i++)
+        WriteBE32(out + 4*i, state[i]);
+}
+
+#undef SHANI_TARGET
+
+} // namespace sha256_shani
+} // namespace crypto
+} // namespace btclite
+
+#endif
@@ -12,6 +12,7 @@ namespace fullnode {
 #define FULLNODE_BIN_NAME        "btc-fullnode"
 
 #define FULLNODE_OPTION_CONNECT  "connect"
+#define FULLNODE_OPTION_REACTORS "reactors"
 
 #define DEFAULT_DATA_DIR        ".btc-fullnode"
 #define DEFAULT_CONFIG_FILE     "btc-fullnode.conf"
@@ -19,6 +20,7 @@ namespace fullnode {
 #define DEFAULT_LISTEN    "1"
 #define DEFAULT_DISCOVER  "1"
 #define DEFAULT_DNSSEED   "1"
+#define DEFAULT_REACTORS  "0"
 
 
 class FullNodeConfig final : public btclite::util::Configuration {
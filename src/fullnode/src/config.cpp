@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <arpa/inet.h>
+#include <cctype>
 
 #include "error.h"
 #include "utility/include/logging.h"
@@ -25,6 +26,7 @@ void FullNodeConfig::ParseParameters(int argc, const char* const argv[])
         { GLOBAL_OPTION_TESTNET,    no_argument,        NULL,  0  },
         { GLOBAL_OPTION_REGTEST,    no_argument,        NULL,  0  },
         { FULLNODE_OPTION_CONNECT,  required_argument,  NULL,  0  },
+        { FULLNODE_OPTION_REACTORS, required_argument,  NULL,  0  },
         { 0,                        0,                  0,     0  }
     };
     int c, option_index = 0;
@@ -84,6 +86,8 @@ void FullNodeConfig::PrintUsageCustomized() const
     fprintf(stdout, "\nConnection Options:\n");
     fprintf(stdout, "  --connect=<ip>        connect only to the specified node(s); -connect=0 \n");
     fprintf(stdout, "                        disables automatic connections\n");
+    fprintf(stdout, "  --reactors=<n>        number of threads servicing peer sockets (default: %s,\n", DEFAULT_REACTORS);
+    fprintf(stdout, "                        one per cpu core)\n");
     //              "                                                                                "
 
 }
@@ -153,6 +157,14 @@ void FullNodeConfig::CheckArgsCustomized() const
         if (result != arg_values.end())
             throw Exception(ErrorCode::kInvalidArg, "invalid ip '" + *result + "'");
     }
+    
+    // --reactors
+    if (args_.IsArgSet(FULLNODE_OPTION_REACTORS)) {
+        const std::string val = args_.GetArg(FULLNODE_OPTION_REACTORS, DEFAULT_REACTORS);
+        if (val.empty() || val.size() > 3 ||
+                !std::all_of(val.begin(), val.end(), ::isdigit))
+            throw Exception(ErrorCode::kInvalidArg, "invalid reactors '" + val + "'");
+    }
 }
 
 } // namespace fullnode
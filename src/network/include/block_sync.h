@@ -369,7 +369,7 @@ struct IterLess
 };
 
 struct OrphanTx {
-    using TxSharedPtr = std::shared_ptr<const consensus::Transaction>;
+    using TxSharedPtr = consensus::TransactionRef;
     
     // When modifying, adapt the copy of this definition in unit tests.
     TxSharedPtr tx;
@@ -18,7 +18,7 @@ public:
     bool InitEvent();
     void StartEventLoop();
     void ExitEventLoop();
-    struct bufferevent *NewSocketEvent(const Context& ctx);
+    struct bufferevent *NewSocketEvent(const Context& ctx, Reactor *reactor = nullptr);
     
     //-------------------------------------------------------------------------
     bool StartOutboundTimer(Context *ctx);
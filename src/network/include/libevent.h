@@ -65,6 +65,8 @@ public:
     void EvconnlistenerFree(struct evconnlistener *lev);
 };
 
+class MsgProcessor;
+
 struct Context {
     const Params *pparams = nullptr;
     LocalService *plocal_service = nullptr;
@@ -72,6 +74,12 @@ struct Context {
     chain::ChainState *pchain_state = nullptr;
     BanList *pbanlist = nullptr;
     Peers *ppeers = nullptr;
+    // when set, messages are framed on the I/O thread and handled on the
+    // processor's threads
+    MsgProcessor *pmsg_processor = nullptr;
+    // when set, peers' bufferevents are spread over these rather than
+    // created on the accepting or connecting base
+    Reactors *preactors = nullptr;
     
     bool IsValid() const;
 };
@@ -12,22 +12,31 @@
 namespace btclite {
 namespace network {
 
+class MsgProcessor;
+
+// Frames the messages that have arrived from src_node and handles them on
+// the calling thread.
 bool ParseMsg(std::shared_ptr<Node> src_node, const Params& params, 
               const LocalService& local_service, Peers *ppeers,
               chain::ChainState *pchain_state);
 
-template <typename Message>
-bool HandleMsgData(std::shared_ptr<Node> src_node, 
-                   const protocol::MessageHeader& header, const Message& msg, 
-                   std::function<bool(std::shared_ptr<Node>)> recv_handler)
+// Frames the messages that have arrived from src_node and queues them on
+// processor, on the I/O thread. Stops framing while the peer's reads are
+// paused.
+bool QueueMsgs(std::shared_ptr<Node> src_node, const Params& params,
+               MsgProcessor *processor);
+
+// Checks the payload at raw against the header's checksum and dispatches it
+// by the header's command, unknown commands fail.
+bool ParseMsgData(const uint8_t *raw, std::shared_ptr<Node> src_node, 
+                  const protocol::MessageHeader& header, const Params& params,
+                  const LocalService& local_service, Peers *ppeers,
+                  chain::ChainState *pchain_state);
+
+template <typename Message, typename RecvHandler>
+bool HandleMsgData(std::shared_ptr<Node> src_node, const Message& msg, 
+                   RecvHandler&& recv_handler)
 {
-    if (header.checksum() != util::FromLittleEndian<uint32_t>(msg.GetHash().data())) {
-        BTCLOG(LOG_LEVEL_WARNING) << msg.Command() << " message checksum error: expect "
-                                  << header.checksum() << ", received "
-                                  << util::FromLittleEndian<uint32_t>(msg.GetHash().data());
-        return false;
-    }
-    
     if (!msg.IsValid()) {
         BTCLOG(LOG_LEVEL_ERROR) << "Received invalid " << msg.Command() 
                                 << " message data";
@@ -44,6 +53,10 @@ bool HandleMsgData(std::shared_ptr<Node> src_node,
     return recv_handler(src_node);
 }
 
+// Writes a serialized message to dst_node's bufferevent, on the reactor
+// that owns it when it has one.
+bool WriteMsg(std::shared_ptr<Node> dst_node, const uint8_t *data, size_t size);
+
 template <typename Message>
 bool SendMsg(const Message& msg, uint32_t magic, std::shared_ptr<Node> dst_node)
 {
@@ -58,26 +71,27 @@ bool SendMsg(const Message& msg, uint32_t magic, std::shared_ptr<Node> dst_node)
         dst_node->mutable_connection()->set_socket_no_msg(false);
     }
 
-    MessageHeader header(magic, msg.Command(), msg.SerializedSize(), 
-                         util::FromLittleEndian<uint32_t>(msg.GetHash().data()));
+    size_t payload_size = msg.SerializedSize();
+    MessageHeader header(magic, msg.Command(), payload_size, 0);
+    
+    // header and payload are written into a single exactly sized buffer
+    ms.Reserve(MessageHeader::kSize + payload_size);
     ms << header << msg;
 
-    if (ms.Size() != MessageHeader::kSize + msg.SerializedSize()) {
+    if (ms.Size() != MessageHeader::kSize + payload_size) {
         BTCLOG(LOG_LEVEL_ERROR) << "Wrong serialized message size:" << ms.Size()
-                                << ", correct size:" << MessageHeader::kSize + msg.SerializedSize() 
+                                << ", correct size:" << MessageHeader::kSize + payload_size 
                                 << ", message type:" << msg.Command();
         return false;
     }
+    
+    // checksum the payload bytes just written rather than serializing msg
+    // a second time for GetHash()
+    util::ToLittleEndian(PayloadChecksum(ms.Data() + MessageHeader::kSize, payload_size),
+                         ms.Data() + MessageHeader::kChecksumOffset);
 
-    //bufferevent_lock(dst_node->mutable_bev());
-
-    if (bufferevent_write(dst_node->mutable_connection()->mutable_bev(), ms.Data(), ms.Size())) {
-        BTCLOG(LOG_LEVEL_ERROR) << "Writing message to bufferevent failed, peer:" 
-                                << dst_node->id();
+    if (!WriteMsg(dst_node, ms.Data(), ms.Size()))
         return false;
-    }
-
-    //bufferevent_unlock(dst_node->mutable_bev());
     
     if (dst_node->timers().no_sending_timer) {
         dst_node->mutable_timers()->no_sending_timer->Reset();
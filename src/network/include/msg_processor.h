@@ -0,0 +1,110 @@
+#ifndef BTCLITE_MSG_PROCESSOR_H
+#define BTCLITE_MSG_PROCESSOR_H
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "node.h"
+
+
+namespace btclite {
+namespace network {
+
+/*
+ * Handles the messages of every peer on a fixed set of threads, away from
+ * the event loops that read them, so that a slow handler holds up no
+ * socket I/O.
+ *
+ * An I/O thread frames a peer's messages and Push()es them onto the peer's
+ * NodeRecvQueue. A peer with messages waiting is in the list of ready peers
+ * once; a processing thread takes the peer at the front, handles one of its
+ * messages and, if it has more, puts it back at the end. Peers so take
+ * turns however many messages each sends, and a peer's messages are
+ * handled one at a time, in order.
+ *
+ * A peer's queue going over the byte budget pauses reads from the peer, the
+ * rest of what it sends waits in the socket and TCP pushes back on it.
+ * Reads resume once the queue is back under half the budget. Every message
+ * counts its header too, so that empty ones fill the budget as well.
+ */
+class MsgProcessor : util::Uncopyable {
+public:
+    using Handler = std::function<bool(const std::shared_ptr<Node>&, const ReceivedMsg&)>;
+    
+    // room for a message of kMaxMessageSize and then some
+    static constexpr size_t kDefaultPeerBudget = 5 * 1000 * 1000;
+    
+    struct Stats {
+        size_t ready_peers = 0;
+        size_t paused_peers = 0;
+        uint64_t queued_msgs = 0;
+        uint64_t queued_bytes = 0;
+        uint64_t max_queued_bytes = 0; // of all peers together, ever
+        uint64_t processed = 0;
+        uint64_t pauses = 0;
+    };
+    
+    static size_t DefaultWorkers()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    explicit MsgProcessor(Handler handler, size_t workers = DefaultWorkers(),
+                          size_t peer_budget = kDefaultPeerBudget);
+    
+    // Messages still queued are dropped.
+    ~MsgProcessor();
+    
+    //-------------------------------------------------------------------------
+    // Queues msg from node. Returns false when this put the peer over its
+    // budget and paused its reads, framing should stop until they resume.
+    bool Push(const std::shared_ptr<Node>& node, ReceivedMsg&& msg);
+    
+    //-------------------------------------------------------------------------
+    Stats stats() const;
+    
+    size_t peer_budget() const
+    {
+        return peer_budget_;
+    }
+
+private:
+    const Handler handler_;
+    const size_t peer_budget_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::shared_ptr<Node> > ready_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+    
+    std::atomic<uint64_t> queued_msgs_ = 0;
+    std::atomic<uint64_t> queued_bytes_ = 0;
+    std::atomic<uint64_t> max_queued_bytes_ = 0;
+    std::atomic<uint64_t> processed_ = 0;
+    std::atomic<uint64_t> pauses_ = 0;
+    std::atomic<size_t> paused_peers_ = 0;
+    
+    // what msg counts toward the budget and queued_bytes
+    static size_t Footprint(const ReceivedMsg& msg)
+    {
+        return protocol::MessageHeader::kSize + msg.payload.size();
+    }
+    
+    void WorkerThread();
+    void Schedule(const std::shared_ptr<Node>& node);
+    void MaybeResume(const std::shared_ptr<Node>& node);
+};
+
+} // namespace network
+} // namespace btclite
+
+#endif // BTCLITE_MSG_PROCESSOR_H
@@ -3,8 +3,10 @@
 
 
 #include <boost/circular_buffer.hpp>
+#include <deque>
 #include <event2/bufferevent.h>
 #include <functional>
+#include <mutex>
 #include <queue>
 
 #include "banlist.h"
@@ -13,6 +15,8 @@
 #include "bloom.h"
 #include "net_base.h"
 #include "peers.h"
+#include "protocol/message_header.h"
+#include "reactor.h"
 #include "timer.h"
 
 
@@ -190,6 +194,18 @@ public:
         return bev_;
     }
     
+    // the reactor bev_ was created on, nullptr when it is not one of the
+    // sharded ones
+    Reactor *reactor() const
+    {
+        return reactor_;
+    }
+    
+    void set_reactor(Reactor *reactor)
+    {
+        reactor_ = reactor;
+    }
+    
     const NetAddr& addr() const
     {
         return addr_;
@@ -250,6 +266,7 @@ public:
     
 private:
     struct bufferevent *bev_ = nullptr;    
+    Reactor *reactor_ = nullptr;
     const NetAddr addr_;
     //const uint64_t keyed_net_group_;  
     
@@ -391,6 +408,43 @@ struct NodeTimers {
     util::TimerMng::TimerPtr broadcast_addrs_timer;
 };
 
+// Where ParseMsg stands in the byte stream received from a peer. A message
+// whose payload has not all arrived yet waits in kPayloadPending with its
+// header already taken off the input buffer and parsed.
+struct NodeFraming {
+    enum State {
+        kHeaderPending,
+        kPayloadPending
+    };
+    
+    // ParseMsg runs on the thread pool once per read callback, so two of them
+    // may work on one peer at a time, each holds cs for as long as it runs
+    util::CriticalSection cs;
+    State state = kHeaderPending;
+    protocol::MessageHeader header;
+};
+
+// A whole message taken off a peer's input buffer.
+struct ReceivedMsg {
+    protocol::MessageHeader header;
+    std::vector<uint8_t> payload;
+};
+
+// Messages framed by the I/O thread that wait for a processing thread, see
+// MsgProcessor.
+struct NodeRecvQueue {
+    std::mutex mutex;
+    std::deque<ReceivedMsg> msgs;
+    size_t bytes = 0;
+    
+    // waiting in MsgProcessor's list of peers, or being processed, so that
+    // one thread at a time takes this peer's messages, in order
+    bool scheduled = false;
+    
+    // reads disabled for being over the byte budget
+    bool paused = false;
+};
+
 class Misbehavior {
 public:    
     void Misbehaving(NodeId id, int howmuch);
@@ -710,6 +764,10 @@ public:
     void ShakeHandsTimeoutCb();
     void StopAllTimers();
     
+    // Hands task to the connection's reactor when called off its thread,
+    // returns false when the caller is to run it inline instead.
+    bool PostToReactor(std::function<void()> task);
+    
     //-------------------------------------------------------------------------
     bool CheckBanned(BanList *pbanlist);
     
@@ -888,6 +946,26 @@ public:
     {
         return &relay_state_;
     }
+    
+    const NodeFraming& framing() const
+    {
+        return framing_;
+    }
+    
+    NodeFraming *mutable_framing()
+    {
+        return &framing_;
+    }
+    
+    const NodeRecvQueue& recv_queue() const
+    {
+        return recv_queue_;
+    }
+    
+    NodeRecvQueue *mutable_recv_queue()
+    {
+        return &recv_queue_;
+    }
      
 private:
     const NodeId id_;
@@ -906,6 +984,8 @@ private:
     BlockSyncState1 block_sync_state_;
     NodeBlocksInFlight blocks_in_flight_;
     RelayState relay_state_;
+    NodeFraming framing_;
+    NodeRecvQueue recv_queue_;
     
     //-------------------------------------------------------------------------
     static NodeId GetNewNodeId()
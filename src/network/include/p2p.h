@@ -1,10 +1,13 @@
 #ifndef BTCLITE_P2P_H
 #define BTCLITE_P2P_H
 
+#include <memory>
 #include <thread>
 
 #include "acceptor.h"
 #include "connector.h"
+#include "msg_processor.h"
+#include "reactor.h"
 #include "network/include/params.h"
 
 
@@ -30,7 +33,9 @@ private:
     BanDb ban_db_;
     Acceptor acceptor_;
     Connector connector_;
+    Reactors reactors_;
     //CollectionTimer collection_timer_;
+    std::unique_ptr<MsgProcessor> msg_processor_;
     
     std::thread thread_acceptor_loop_;
     std::thread thread_connector_loop_;
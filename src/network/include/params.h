@@ -38,6 +38,8 @@ public:
     
     const std::vector<std::string>& specified_outgoing() const;
     
+    size_t reactors() const;
+    
     const fs::path& path_data_dir() const;
     
 private:
@@ -49,6 +51,7 @@ private:
     bool discover_local_addr_ = true;
     bool use_dnsseed_ = true;
     std::vector<std::string> specified_outgoing_;
+    size_t reactors_ = 1;
     
     fs::path path_data_dir_;
 };
@@ -0,0 +1,130 @@
+#ifndef BTCLITE_PROTOCOL_MESSAGE_HEADER_H
+#define BTCLITE_PROTOCOL_MESSAGE_HEADER_H
+
+
+#include <array>
+#include <string>
+
+#include "constants.h"
+#include "serialize.h"
+
+
+namespace btclite {
+namespace network {
+namespace protocol {
+
+// The 12 byte command field of a message header packed into two integers,
+// little endian, nul padded, so that commands are told apart by comparing
+// integers rather than strings.
+struct CommandCode {
+    uint64_t head = 0;
+    uint32_t tail = 0;
+    
+    constexpr bool operator==(const CommandCode& b) const
+    {
+        return head == b.head && tail == b.tail;
+    }
+    
+    constexpr bool operator!=(const CommandCode& b) const
+    {
+        return !(*this == b);
+    }
+};
+
+// Packs a command string as it would be laid out in a header, at compile
+// time for the msg_command constants.
+constexpr CommandCode PackCommand(const char *command)
+{
+    CommandCode code;
+    for (size_t i = 0; i < 12 && command[i] != '\0'; i++) {
+        if (i < 8)
+            code.head |= static_cast<uint64_t>(static_cast<uint8_t>(command[i])) << (8 * i);
+        else
+            code.tail |= static_cast<uint32_t>(static_cast<uint8_t>(command[i])) << (8 * (i - 8));
+    }
+    
+    return code;
+}
+
+class MessageHeader {
+public:
+    static constexpr size_t kMessageStartSize = 4;
+    static constexpr size_t kCommandSize = 12;
+    static constexpr size_t kPayloadSize = 4;
+    static constexpr size_t kChecksumSize = 4;
+    static constexpr size_t kSize = kMessageStartSize + kCommandSize
+                                    + kPayloadSize + kChecksumSize;
+    static constexpr size_t kChecksumOffset = kSize - kChecksumSize;
+    
+    MessageHeader() = default;
+    
+    MessageHeader(uint32_t magic, const std::string& command,
+                  uint32_t payload_length, uint32_t checksum);    
+    MessageHeader(uint32_t magic, std::string&& command,
+                  uint32_t payload_length, uint32_t checksum) noexcept;
+    
+    explicit MessageHeader(const uint8_t *raw);
+    
+    //-------------------------------------------------------------------------
+    bool IsValid(uint32_t magic = 0) const;
+    void Clear();
+    
+    //-------------------------------------------------------------------------
+    template <typename Stream>
+    void Serialize(Stream& out) const;
+    template <typename Stream>
+    void Deserialize(Stream& in);
+    
+    //-------------------------------------------------------------------------
+    bool operator==(const MessageHeader& b) const;    
+    bool operator!=(const MessageHeader& b) const;
+    
+    //-------------------------------------------------------------------------
+    uint32_t magic() const;
+    void set_magic(uint32_t magic);
+    
+    std::string command() const;
+    CommandCode command_code() const;
+    
+    void set_command(const std::string& command);
+    void set_command(std::string&& command) noexcept;
+    
+    uint32_t payload_length() const;
+    void set_payload_length(uint32_t payload_length);
+    
+    uint32_t checksum() const;
+    void set_checksum(uint32_t checksum);
+
+private:    
+    uint32_t magic_ = 0;
+    std::array<char, kCommandSize> command_ = {};
+    uint32_t payload_length_ = 0;
+    uint32_t checksum_ = 0;
+};
+
+template <typename Stream>
+void MessageHeader::Serialize(Stream& out) const
+{
+    util::Serializer<Stream> serializer(out);
+    serializer.SerialWrite(magic_);
+    serializer.SerialWrite(command_);
+    serializer.SerialWrite(payload_length_);
+    serializer.SerialWrite(checksum_);
+}
+
+template <typename Stream>
+void MessageHeader::Deserialize(Stream& in)
+{
+    util::Deserializer<Stream> deserializer(in);
+    deserializer.SerialRead(&magic_);
+    deserializer.SerialRead(&command_);
+    deserializer.SerialRead(&payload_length_);
+    deserializer.SerialRead(&checksum_);
+}
+
+} // namespace protocol
+} // namespace network
+} // namespace btclite
+
+
+#endif // BTCLITE_PROTOCOL_MESSAGE_HEADER_H
@@ -0,0 +1,98 @@
+#ifndef BTCLITE_REACTOR_H
+#define BTCLITE_REACTOR_H
+
+
+#include <atomic>
+#include <event2/event.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "util.h"
+
+
+namespace btclite {
+namespace network {
+
+/*
+ * An event_base with a thread of its own, servicing the bufferevents of the
+ * peers given to it. A bufferevent belongs to the reactor it was created on,
+ * other threads hand work for it to that reactor through RunInLoop() rather
+ * than touching it themselves.
+ */
+class Reactor : util::Uncopyable {
+public:
+    Reactor();
+    
+    // Tasks not run yet are dropped.
+    ~Reactor();
+    
+    //-------------------------------------------------------------------------
+    bool InitEvent();
+    void StartEventLoop();
+    void ExitEventLoop();
+    
+    //-------------------------------------------------------------------------
+    // Runs task on the loop's thread, in the order posted, right away when
+    // called there.
+    void RunInLoop(std::function<void()> task);
+    bool IsInLoopThread() const;
+    
+    // events added to the base, one for every peer reading
+    int Load() const;
+    
+    //-------------------------------------------------------------------------
+    struct event_base *base() const
+    {
+        return base_;
+    }
+
+private:
+    struct event_base *base_;
+    struct event *wakeup_;
+    std::atomic<std::thread::id> loop_thread_;
+    
+    std::mutex mutex_;
+    std::vector<std::function<void()> > tasks_;
+    
+    //-------------------------------------------------------------------------
+    static void WakeupCb(evutil_socket_t fd, short event, void *arg);
+};
+
+// A fixed set of reactors peers are spread over.
+class Reactors : util::Uncopyable {
+public:
+    explicit Reactors(size_t count);
+    ~Reactors();
+    
+    //-------------------------------------------------------------------------
+    bool InitEvent();
+    void StartEventLoops();
+    void ExitEventLoops();
+    void Join();
+    
+    //-------------------------------------------------------------------------
+    // where a new connection goes
+    Reactor *LeastLoaded() const;
+    
+    size_t Size() const
+    {
+        return reactors_.size();
+    }
+    
+    Reactor *At(size_t i) const
+    {
+        return reactors_[i].get();
+    }
+
+private:
+    std::vector<std::unique_ptr<Reactor> > reactors_;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace network
+} // namespace btclite
+
+#endif // BTCLITE_REACTOR_H
@@ -90,6 +90,7 @@ void Acceptor::AcceptConnCb(struct evconnlistener *listener, evutil_socket_t fd,
     NetAddr addr;
     struct event_base *base;
     struct bufferevent *bev;
+    Reactor *reactor = nullptr;
     auto& inbounds = Inbounds();
     struct Context *ctx = reinterpret_cast<struct Context*>(arg);
     
@@ -114,7 +115,11 @@ void Acceptor::AcceptConnCb(struct evconnlistener *listener, evutil_socket_t fd,
         return;
     }
     
-    if (nullptr == (base = evconnlistener_get_base(listener))) {
+    if (ctx && ctx->preactors) {
+        reactor = ctx->preactors->LeastLoaded();
+        base = reactor->base();
+    }
+    else if (nullptr == (base = evconnlistener_get_base(listener))) {
         BTCLOG(LOG_LEVEL_WARNING) << "Acceptor get event base by listener failed.";
         evutil_closesocket(fd);
         return;
@@ -133,6 +138,7 @@ void Acceptor::AcceptConnCb(struct evconnlistener *listener, evutil_socket_t fd,
         bufferevent_free(bev);
         return;
     }
+    pnode->mutable_connection()->set_reactor(reactor);
 
     if (ctx) {
         pnode->mutable_connection()->RegisterSetStateCb(NodeConnection::kDisconnected,
@@ -66,11 +66,12 @@ void Connector::ExitEventLoop()
     event_base_loopexit(base_, &delay);
 }
 
-struct bufferevent *Connector::NewSocketEvent(const Context& ctx)
+struct bufferevent *Connector::NewSocketEvent(const Context& ctx, Reactor *reactor)
 {
     struct bufferevent *bev;
+    struct event_base *base = reactor ? reactor->base() : base_;
     
-    if (nullptr == (bev = bufferevent_socket_new(base_, -1, 
+    if (nullptr == (bev = bufferevent_socket_new(base, -1, 
                               BEV_OPT_THREADSAFE | BEV_OPT_CLOSE_ON_FREE))) {
         BTCLOG(LOG_LEVEL_ERROR) << "Connector create socket event failed.";
         return nullptr;
@@ -267,6 +268,7 @@ bool Connector::ConnectNode(const NetAddr& addr, const Context& ctx, bool manual
     struct bufferevent *bev;
     struct sockaddr_storage sock_addr;
     socklen_t len;
+    Reactor *reactor = ctx.preactors ? ctx.preactors->LeastLoaded() : nullptr;
 
     if (!base_) {
         return false;
@@ -293,7 +295,7 @@ bool Connector::ConnectNode(const NetAddr& addr, const Context& ctx, bool manual
         return false;
     }
 
-    if (nullptr == (bev = NewSocketEvent(ctx))) {
+    if (nullptr == (bev = NewSocketEvent(ctx, reactor))) {
         return false;
     }
 
@@ -319,6 +321,7 @@ bool Connector::ConnectNode(const NetAddr& addr, const Context& ctx, bool manual
         bufferevent_free(bev);
         return false;
     }
+    node->mutable_connection()->set_reactor(reactor);
     node->mutable_connection()->RegisterSetStateCb(NodeConnection::kDisconnected,
             std::bind(DisconnectNodeCb, node, &outbounds_, ctx.ppeers,
                       &SingletonBlocksInFlight::GetInstance(), &SingletonOrphans::GetInstance()));
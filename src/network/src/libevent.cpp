@@ -121,6 +121,11 @@ void ConnReadCb(struct bufferevent *bev, void *ctx)
                                  std::bind(&Node::InactivityTimeoutCb, pnode));
     }
     
+    if (context->pmsg_processor) {
+        QueueMsgs(pnode, *(context->pparams), context->pmsg_processor);
+        return;
+    }
+    
     auto task = std::bind(ParseMsg, pnode, std::ref(*(context->pparams)), 
                           std::ref(*(context->plocal_service)), context->ppeers,
                           context->pchain_state);
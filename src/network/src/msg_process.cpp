@@ -1,7 +1,10 @@
 #include "msg_process.h"
 
+#include <array>
+
 #include <event2/buffer.h>
 
+#include "msg_processor.h"
 #include "protocol/addr.h"
 #include "protocol/getaddr.h"
 #include "protocol/inventory.h"
@@ -17,154 +20,311 @@
 namespace btclite {
 namespace network {
 
-using namespace std::placeholders;
 using namespace protocol;
 
+namespace {
+
+// everything a handler may need besides the message itself
+struct MsgContext {
+    const std::shared_ptr<Node>& src_node;
+    const Params& params;
+    const LocalService& local_service;
+    Peers *ppeers;
+    chain::ChainState *pchain_state;
+};
+
+template <typename Message>
+Message NewMsg(const MsgContext& ctx)
+{
+    return Message();
+}
+
+// the nonce is only there from BIP31 on
+template <>
+Ping NewMsg<Ping>(const MsgContext& ctx)
+{
+    return Ping(0, ctx.src_node->protocol().version);
+}
+
+template <typename Message>
+bool RecvMsg(const Message& msg, std::shared_ptr<Node> node, const MsgContext& ctx)
+{
+    return msg.RecvHandler(node);
+}
+
+bool RecvMsg(const Version& version, std::shared_ptr<Node> node, const MsgContext& ctx)
+{
+    return version.RecvHandler(node, ctx.params.msg_magic(),
+                               ctx.params.advertise_local_addr(),
+                               ctx.local_service,
+                               ctx.pchain_state->ActiveChainHeight(),
+                               ctx.ppeers);
+}
+
+bool RecvMsg(const Verack& verack, std::shared_ptr<Node> node, const MsgContext& ctx)
+{
+    return verack.RecvHandler(node, ctx.params.msg_magic(),
+                              ctx.params.advertise_local_addr(),
+                              ctx.local_service);
+}
+
+bool RecvMsg(const Ping& ping, std::shared_ptr<Node> node, const MsgContext& ctx)
+{
+    return ping.RecvHandler(node, ctx.params.msg_magic());
+}
+
+template <typename Message>
+bool ParseAndHandle(util::ByteSpanSource& byte_source, const MsgContext& ctx)
+{
+    Message msg = NewMsg<Message>(ctx);
+    msg.Deserialize(byte_source);
+    return HandleMsgData(ctx.src_node, msg,
+                         [&msg, &ctx](std::shared_ptr<Node> node) {
+                             return RecvMsg(msg, std::move(node), ctx);
+                         });
+}
+
+using MsgHandler = bool (*)(util::ByteSpanSource&, const MsgContext&);
+
+struct MsgEntry {
+    CommandCode code;
+    MsgHandler handler;
+};
+
+constexpr MsgEntry kMsgTable[] = {
+    { PackCommand(msg_command::kMsgVersion), &ParseAndHandle<Version> },
+    { PackCommand(msg_command::kMsgVerack), &ParseAndHandle<Verack> },
+    { PackCommand(msg_command::kMsgAddr), &ParseAndHandle<Addr> },
+    { PackCommand(msg_command::kMsgInv), &ParseAndHandle<Inv> },
+    { PackCommand(msg_command::kMsgGetAddr), &ParseAndHandle<GetAddr> },
+    { PackCommand(msg_command::kMsgPing), &ParseAndHandle<Ping> },
+    { PackCommand(msg_command::kMsgPong), &ParseAndHandle<Pong> },
+    { PackCommand(msg_command::kMsgReject), &ParseAndHandle<Reject> },
+    { PackCommand(msg_command::kMsgSendHeaders), &ParseAndHandle<SendHeaders> },
+    { PackCommand(msg_command::kMsgSendCmpct), &ParseAndHandle<SendCmpct> }
+};
+constexpr size_t kMsgTableSize = sizeof(kMsgTable) / sizeof(kMsgTable[0]);
+
+// Multiplicative hash of the packed command onto kSlotCount slots, perfect
+// for the commands in kMsgTable, which the static_assert below checks.
+constexpr size_t kSlotBits = 5;
+constexpr size_t kSlotCount = size_t(1) << kSlotBits;
+constexpr uint8_t kNoSlot = 0xff;
+
+constexpr size_t Slot(const CommandCode& code)
+{
+    return ((code.head ^ (static_cast<uint64_t>(code.tail) << 29)) * 0x9e3779b97f4a7c15ULL)
+           >> (64 - kSlotBits);
+}
+
+constexpr std::array<uint8_t, kSlotCount> MakeSlots()
+{
+    std::array<uint8_t, kSlotCount> slots = {};
+    for (size_t i = 0; i < kSlotCount; i++)
+        slots[i] = kNoSlot;
+    for (size_t i = 0; i < kMsgTableSize; i++)
+        slots[Slot(kMsgTable[i].code)] = static_cast<uint8_t>(i);
+    return slots;
+}
+
+constexpr std::array<uint8_t, kSlotCount> kSlots = MakeSlots();
+
+constexpr bool IsPerfect()
+{
+    for (size_t i = 0; i < kMsgTableSize; i++)
+        if (kSlots[Slot(kMsgTable[i].code)] != i)
+            return false;
+    return true;
+}
+
+static_assert(IsPerfect(), "two commands share a slot, pick another multiplier");
+
+MsgHandler FindHandler(const CommandCode& code)
+{
+    const uint8_t i = kSlots[Slot(code)];
+    if (i == kNoSlot || kMsgTable[i].code != code)
+        return nullptr;
+    return kMsgTable[i].handler;
+}
+
+// Frames the messages that have arrived in src_node's input buffer, see
+// NodeFraming. on_msg(header, buf) gets each whole one while its payload is
+// at the front of buf and takes the payload off; returning false it stops
+// the framing after that message. Fails on a bad header, after
+// disconnecting the peer.
+template <typename OnMsg>
+bool FrameMsgs(const std::shared_ptr<Node>& src_node, const Params& params,
+               OnMsg&& on_msg)
+{
+    struct evbuffer *buf;
+    
+    if (!src_node->connection().bev())
+        return false;
+    
+    if (nullptr == (buf = bufferevent_get_input(
+                              src_node->mutable_connection()->mutable_bev())))
+        return false;
+    
+    if (src_node->connection().IsDisconnected())
+        return false;
+    
+    NodeFraming *framing = src_node->mutable_framing();
+    LOCK(framing->cs);
+    
+    while (true) {
+        if (framing->state == NodeFraming::kHeaderPending) {
+            if (evbuffer_get_length(buf) < MessageHeader::kSize)
+                break;
+    
+            // construct msg header from raw, once, the header stays in
+            // framing until its payload has arrived
+            uint8_t raw[MessageHeader::kSize];
+            evbuffer_remove(buf, raw, MessageHeader::kSize);
+            framing->header = MessageHeader(raw);
+            if (framing->header.payload_length() > kMaxMessageSize) {
+                BTCLOG(LOG_LEVEL_ERROR) << "Oversized message from peer " << src_node->id()
+                                        << ", disconnecting";
+                src_node->mutable_connection()->Disconnect();
+                return false;
+            }
+            if (framing->header.magic() != params.msg_magic()) {
+                BTCLOG(LOG_LEVEL_ERROR) << "Invalid message magic " << framing->header.magic()
+                                        << " from peer " << src_node->id() << ", disconnecting";
+                src_node->mutable_connection()->Disconnect();
+                return false;
+            }
+            framing->state = NodeFraming::kPayloadPending;
+        }
+    
+        // wait for the rest of the payload, the next read callback comes back
+        // here
+        if (evbuffer_get_length(buf) < framing->header.payload_length())
+            break;
+    
+        framing->state = NodeFraming::kHeaderPending;
+        if (!on_msg(framing->header, buf))
+            break;
+    }
+    
+    return true;
+}
+
+} // namespace
+
 bool ParseMsgData(const uint8_t *raw, std::shared_ptr<Node> src_node, 
                   const MessageHeader& header, const Params& params,
                   const LocalService& local_service, Peers *ppeers,
                   chain::ChainState *pchain_state)
 {
-    std::vector<uint8_t> vec;
-    util::ByteSource<std::vector<uint8_t> > byte_source(vec);
-    
     if (!header.IsValid()) {
         return false;    
     }
     
-    vec.reserve(header.payload_length());
-    vec.assign(raw, raw + header.payload_length());
-    
-    if (header.command() == msg_command::kMsgVersion) {
-        Version version;
-        version.Deserialize(byte_source);
-        auto recv_handler = std::bind(&Version::RecvHandler, &version,
-                                      _1, params.msg_magic(), 
-                                      params.advertise_local_addr(),
-                                      std::ref(local_service), 
-                                      pchain_state->ActiveChainHeight(),
-                                      ppeers);
-        return HandleMsgData(src_node, header, version, recv_handler);
-    }
-    else if (header.command() == msg_command::kMsgVerack) {
-        Verack verack;
-        verack.Deserialize(byte_source);
-        auto recv_handler = std::bind(&Verack::RecvHandler, &verack,
-                                      _1, params.msg_magic(),
-                                      params.advertise_local_addr(),
-                                      std::ref(local_service));
-        return HandleMsgData(src_node, header, verack, recv_handler);
-    }
-    else if (header.command() == msg_command::kMsgAddr) {
-        Addr addr;
-        addr.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, addr,
-                             std::bind(&Addr::RecvHandler, &addr, _1));
-    }
-    else if (header.command() == msg_command::kMsgInv) {
-        Inv inv;
-        inv.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, inv,
-                             std::bind(&Inv::RecvHandler, &inv, _1));
-    }
-    else if (header.command() == msg_command::kMsgGetAddr) {
-        GetAddr getaddr;
-        getaddr.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, getaddr,
-                             std::bind(&GetAddr::RecvHandler, &getaddr, _1));
-    }
-    else if (header.command() == msg_command::kMsgPing) {
-        Ping ping(0, src_node->protocol().version);
-        ping.Deserialize(byte_source);
-        auto recv_handler = std::bind(&Ping::RecvHandler, &ping, _1,
-                                      params.msg_magic());
-        return HandleMsgData(src_node, header, ping, recv_handler);
-    }
-    else if (header.command() == msg_command::kMsgPong) {
-        Pong pong;
-        pong.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, pong,
-                             std::bind(&Pong::RecvHandler, &pong, _1));
-    }
-    else if (header.command() == msg_command::kMsgReject) {
-        Reject reject;
-        reject.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, reject,
-                             std::bind(&Reject::RecvHandler, &reject, _1));
-    }
-    else if (header.command() == msg_command::kMsgSendHeaders) {
-        SendHeaders send_headers;
-        send_headers.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, send_headers,
-                             std::bind(&SendHeaders::RecvHandler, &send_headers, _1));
-    }
-    else if (header.command() == msg_command::kMsgSendCmpct) {
-        SendCmpct send_compact;
-        send_compact.Deserialize(byte_source);
-        return HandleMsgData(src_node, header, send_compact,
-                             std::bind(&SendCmpct::RecvHandler, &send_compact, _1));
-    }
-    else {
+    MsgHandler handler = FindHandler(header.command_code());
+    if (!handler) {
         BTCLOG(LOG_LEVEL_WARNING) << "Rececived unknown message: "
                                   << header.command();
         return false;
     }
     
-    return true;
+    // over the bytes as received, before spending anything on deserializing
+    const uint32_t checksum = PayloadChecksum(raw, header.payload_length());
+    if (header.checksum() != checksum) {
+        BTCLOG(LOG_LEVEL_WARNING) << header.command() << " message checksum error: expect "
+                                  << header.checksum() << ", received " << checksum;
+        return false;
+    }
+    
+    // deserialize in place from the pulled up evbuffer memory
+    util::ByteSpanSource byte_source(raw, header.payload_length());
+    const MsgContext ctx = { src_node, params, local_service, ppeers, pchain_state };
+    
+    return handler(byte_source, ctx);
 }
 
 bool ParseMsg(std::shared_ptr<Node> src_node, const Params& params, 
               const LocalService& local_service, Peers *ppeers,
               chain::ChainState *pchain_state)
 {
-    struct evbuffer *buf;
-    uint8_t *raw = nullptr;
     bool ret = true;
     
-    if (!src_node->connection().bev())
-        return false;
-    
-    if (nullptr == (buf = bufferevent_get_input(
-                              src_node->mutable_connection()->mutable_bev())))
-        return false;
-
-    if (src_node->connection().IsDisconnected())
-        return false;
-    
-    if (nullptr == (raw = evbuffer_pullup(buf, MessageHeader::kSize)))
-        return false;
-    
-    while (raw) {
-        // construct msg header from raw
-        MessageHeader header(raw);
-        evbuffer_drain(buf, MessageHeader::kSize);
-        if (header.payload_length() > kMaxMessageSize) {
-            BTCLOG(LOG_LEVEL_ERROR) << "Oversized message from peer " << src_node->id()
-                                    << ", disconnecting";
-            src_node->mutable_connection()->Disconnect();
-            return false;
-        }
-        if (header.magic() != params.msg_magic()) {
-            BTCLOG(LOG_LEVEL_ERROR) << "Invalid message magic " << header.magic()
-                                    << " from peer " << src_node->id() << ", disconnecting";
+    auto on_msg = [&](const MessageHeader& header, struct evbuffer *buf) {
+        // made contiguous once it has all arrived, rather than on every
+        // partial read
+        const uint32_t payload_length = header.payload_length();
+        const uint8_t *raw = nullptr;
+        if (payload_length > 0 && nullptr == (raw = evbuffer_pullup(buf, payload_length))) {
+            // the stream can not be framed past this message
             src_node->mutable_connection()->Disconnect();
+            ret = false;
             return false;
         }
-        
-        if (header.payload_length() > 0) {
-            if (nullptr == (raw = evbuffer_pullup(buf, header.payload_length())))
-                return false;
-        }
-        
+    
         // construct msg data from raw
         ret &= ParseMsgData(raw, src_node, header, params, local_service, 
                             ppeers, pchain_state);
-        evbuffer_drain(buf, header.payload_length()); 
-      
-        raw = evbuffer_pullup(buf, MessageHeader::kSize);
+        evbuffer_drain(buf, payload_length);
+        return true;
+    };
+    
+    return FrameMsgs(src_node, params, on_msg) && ret;
+}
+
+bool QueueMsgs(std::shared_ptr<Node> src_node, const Params& params,
+               MsgProcessor *processor)
+{
+    {
+        NodeRecvQueue *queue = src_node->mutable_recv_queue();
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->paused)
+            return true;
     }
+    
+    auto on_msg = [&](const MessageHeader& header, struct evbuffer *buf) {
+        // copied out chain by chain, the evbuffer is not linearised
+        ReceivedMsg msg;
+        msg.header = header;
+        msg.payload.resize(header.payload_length());
+        evbuffer_remove(buf, msg.payload.data(), msg.payload.size());
+        return processor->Push(src_node, std::move(msg));
+    };
+    
+    return FrameMsgs(src_node, params, on_msg);
+}
 
-    return ret;
+bool WriteMsg(std::shared_ptr<Node> dst_node, const uint8_t *data, size_t size)
+{
+    Reactor *reactor = dst_node->connection().reactor();
+    
+    if (!reactor || reactor->IsInLoopThread()) {
+        if (bufferevent_write(dst_node->mutable_connection()->mutable_bev(), data, size)) {
+            BTCLOG(LOG_LEVEL_ERROR) << "Writing message to bufferevent failed, peer:"
+                                    << dst_node->id();
+            return false;
+        }
+        return true;
+    }
+    
+    // copied once into a buffer of its own here, whose chains the reactor
+    // then moves onto the bufferevent's output, in the order sent
+    struct evbuffer *staged = evbuffer_new();
+    if (!staged) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Staging message for peer " << dst_node->id() << " failed";
+        return false;
+    }
+    std::shared_ptr<struct evbuffer> buf(staged, evbuffer_free);
+    if (evbuffer_add(staged, data, size)) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Staging message for peer " << dst_node->id() << " failed";
+        return false;
+    }
+    
+    reactor->RunInLoop([dst_node, buf] {
+        if (bufferevent_write_buffer(dst_node->mutable_connection()->mutable_bev(), buf.get()))
+            BTCLOG(LOG_LEVEL_ERROR) << "Writing message to bufferevent failed, peer:"
+                                    << dst_node->id();
+    });
+    
+    return true;
 }
 
 bool SendVersion(std::shared_ptr<Node> dst_node, uint32_t magic, uint32_t start_height)
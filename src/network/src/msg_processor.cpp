@@ -0,0 +1,170 @@
+#include "msg_processor.h"
+
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+
+
+namespace btclite {
+namespace network {
+
+MsgProcessor::MsgProcessor(Handler handler, size_t workers, size_t peer_budget)
+    : handler_(std::move(handler)), peer_budget_(peer_budget)
+{
+    for (size_t i = 0; i < std::max(size_t(1), workers); i++)
+        workers_.emplace_back(&MsgProcessor::WorkerThread, this);
+}
+
+MsgProcessor::~MsgProcessor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (std::thread& worker : workers_)
+        worker.join();
+}
+
+bool MsgProcessor::Push(const std::shared_ptr<Node>& node, ReceivedMsg&& msg)
+{
+    NodeRecvQueue *queue = node->mutable_recv_queue();
+    const size_t size = Footprint(msg);
+    bool schedule = false;
+    bool paused = false;
+    
+    // Called from the read callback, which holds the bufferevent lock, the
+    // queue mutex is taken second here as in MaybeResume().
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->msgs.push_back(std::move(msg));
+        queue->bytes += size;
+        if (!queue->scheduled)
+            schedule = queue->scheduled = true;
+        if (!queue->paused && queue->bytes > peer_budget_) {
+            paused = queue->paused = true;
+            bufferevent_disable(node->mutable_connection()->mutable_bev(), EV_READ);
+        }
+    }
+    
+    queued_msgs_++;
+    const uint64_t queued = queued_bytes_ += size;
+    uint64_t max = max_queued_bytes_;
+    while (queued > max && !max_queued_bytes_.compare_exchange_weak(max, queued)) {}
+    if (paused) {
+        pauses_++;
+        paused_peers_++;
+        BTCLOG(LOG_LEVEL_VERBOSE) << "Paused reading from peer " << node->id()
+                                  << ", " << queue->bytes << " bytes queued";
+    }
+    
+    if (schedule)
+        Schedule(node);
+    
+    return !paused;
+}
+
+MsgProcessor::Stats MsgProcessor::stats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.ready_peers = ready_.size();
+    }
+    stats.paused_peers = paused_peers_;
+    stats.queued_msgs = queued_msgs_;
+    stats.queued_bytes = queued_bytes_;
+    stats.max_queued_bytes = max_queued_bytes_;
+    stats.processed = processed_;
+    stats.pauses = pauses_;
+    
+    return stats;
+}
+
+void MsgProcessor::Schedule(const std::shared_ptr<Node>& node)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(node);
+    }
+    cond_.notify_one();
+}
+
+void MsgProcessor::WorkerThread()
+{
+    while (true) {
+        std::shared_ptr<Node> node;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this]{ return stop_ || !ready_.empty(); });
+            if (stop_)
+                return;
+            node = std::move(ready_.front());
+            ready_.pop_front();
+        }
+    
+        // one message per turn, the peer goes to the back of the line for
+        // the next
+        NodeRecvQueue *queue = node->mutable_recv_queue();
+        ReceivedMsg msg;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            msg = std::move(queue->msgs.front());
+            queue->msgs.pop_front();
+        }
+    
+        // what a peer sent before it went away is dropped all the same
+        if (!node->connection().IsDisconnected())
+            handler_(node, msg);
+    
+        const size_t size = Footprint(msg);
+        queued_msgs_--;
+        queued_bytes_ -= size;
+        processed_++;
+    
+        bool more;
+        bool resume;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->bytes -= size;
+            more = !queue->msgs.empty();
+            queue->scheduled = more;
+            resume = queue->paused && queue->bytes <= peer_budget_ / 2;
+        }
+    
+        if (resume)
+            MaybeResume(node);
+        if (more)
+            Schedule(node);
+    }
+}
+
+void MsgProcessor::MaybeResume(const std::shared_ptr<Node>& node)
+{
+    struct bufferevent *bev = node->mutable_connection()->mutable_bev();
+    NodeRecvQueue *queue = node->mutable_recv_queue();
+    bool resumed = false;
+    
+    // the bufferevent lock first, as in Push()
+    bufferevent_lock(bev);
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->paused && queue->bytes <= peer_budget_ / 2) {
+            queue->paused = false;
+            resumed = true;
+            bufferevent_enable(bev, EV_READ);
+            // what was read before the pause and not framed yet gets its
+            // read callback, on the event loop's thread
+            bufferevent_trigger(bev, EV_READ,
+                                BEV_TRIG_IGNORE_WATERMARKS | BEV_TRIG_DEFER_CALLBACKS);
+        }
+    }
+    bufferevent_unlock(bev);
+    
+    if (resumed) {
+        paused_peers_--;
+        BTCLOG(LOG_LEVEL_VERBOSE) << "Resumed reading from peer " << node->id();
+    }
+}
+
+} // namespace network
+} // namespace btclite
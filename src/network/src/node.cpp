@@ -135,6 +135,17 @@ void Node::StopAllTimers()
     }
 }
 
+bool Node::PostToReactor(std::function<void()> task)
+{
+    Reactor *reactor = connection_.reactor();
+    if (!reactor || reactor->IsInLoopThread())
+        return false;
+    
+    reactor->RunInLoop(std::move(task));
+    
+    return true;
+}
+
 bool Node::CheckBanned(BanList *pbanlist)
 {
     if (!misbehavior_.should_ban())
@@ -163,6 +174,9 @@ bool Node::CheckBanned(BanList *pbanlist)
 
 void Node::InactivityTimeoutCb()
 {
+    if (PostToReactor(std::bind(&Node::InactivityTimeoutCb, shared_from_this())))
+        return;
+    
     if (util::SingletonInterruptor::GetInstance() || 
             connection_.IsDisconnected()) {
         return;
@@ -174,6 +188,9 @@ void Node::InactivityTimeoutCb()
 
 void Node::SocketNoMsgTimeoutCb()
 {
+    if (PostToReactor(std::bind(&Node::SocketNoMsgTimeoutCb, shared_from_this())))
+        return;
+    
     if (util::SingletonInterruptor::GetInstance() || 
             connection_.IsDisconnected()) {
         return;
@@ -189,6 +206,9 @@ void Node::SocketNoMsgTimeoutCb()
 
 void Node::PingTimeoutCb(uint32_t magic)
 {
+    if (PostToReactor(std::bind(&Node::PingTimeoutCb, shared_from_this(), magic)))
+        return;
+    
     if (util::SingletonInterruptor::GetInstance() || 
             connection_.IsDisconnected()) {
         return;
@@ -210,6 +230,9 @@ void Node::PingTimeoutCb(uint32_t magic)
 
 void Node::ShakeHandsTimeoutCb()
 {
+    if (PostToReactor(std::bind(&Node::ShakeHandsTimeoutCb, shared_from_this())))
+        return;
+    
     if (util::SingletonInterruptor::GetInstance() || 
             connection_.IsDisconnected()) {
         return;
@@ -1,5 +1,6 @@
 #include "p2p.h"
 #include "fullnode/include/config.h"
+#include "msg_process.h"
 
 
 namespace btclite {
@@ -9,7 +10,8 @@ P2P::P2P(const util::Configuration& config)
     : params_(config), 
       peers_db_(config.path_data_dir()),
       ban_db_(config.path_data_dir()),
-      acceptor_(params_.default_port()) 
+      acceptor_(params_.default_port()),
+      reactors_(params_.reactors())
 {
 }
 
@@ -21,10 +23,19 @@ bool P2P::Init(const chain::ChainState& chain_state)
         local_service_.DiscoverLocalAddrs();
     }
     
+    auto *pchain_state = const_cast<chain::ChainState*>(&chain_state);
+    msg_processor_ = std::make_unique<MsgProcessor>(
+        [this, pchain_state](const std::shared_ptr<Node>& node, const ReceivedMsg& msg) {
+            return ParseMsgData(msg.payload.data(), node, msg.header, params_,
+                                local_service_, &peers_, pchain_state);
+        });
+    
     Nodes nodes;
-    static Context ctx = { &params_, &local_service_, &nodes, 
-                           const_cast<chain::ChainState*>(&chain_state),
-                           &ban_list_, &peers_ };
+    static Context ctx = { &params_, &local_service_, &nodes, pchain_state,
+                           &ban_list_, &peers_, msg_processor_.get(), &reactors_ };
+    if (!reactors_.InitEvent())
+        return false;
+    
     if (!acceptor_.InitEvent(&ctx))
         return false;
     
@@ -62,6 +73,9 @@ bool P2P::Start(const chain::ChainState& chain_state)
     
     util::SingletonInterruptor::GetInstance().Reset();
     
+    // peers' sockets
+    reactors_.StartEventLoops();
+    
     // start acceptor
     thread_acceptor_loop_ = std::thread(&util::TraceThread<std::function<void()> >, 
                                         "acceptor",
@@ -77,7 +91,7 @@ bool P2P::Start(const chain::ChainState& chain_state)
     Nodes nodes;
     static Context ctx = { &params_, &local_service_, &nodes, 
                                   const_cast<chain::ChainState*>(&chain_state),
-                                  &ban_list_, &peers_ };
+                                  &ban_list_, &peers_, msg_processor_.get(), &reactors_ };
     if (!params_.specified_outgoing().empty()) {
         if (!connector_.ConnectNodes(params_.specified_outgoing(), 
                                      ctx, true)) {
@@ -103,6 +117,7 @@ void P2P::Interrupt()
     
     acceptor_.ExitEventLoop();
     connector_.ExitEventLoop();    
+    reactors_.ExitEventLoops();
     
     BTCLOG(LOG_LEVEL_INFO) << "Finished interrupting p2p network.";
 }
@@ -117,6 +132,11 @@ void P2P::Stop()
     if (thread_connector_loop_.joinable())
         thread_connector_loop_.join();
     
+    reactors_.Join();
+    
+    // the event loops are done, nothing pushes any more
+    msg_processor_.reset();
+    
     peers_db_.DumpPeers(peers_);
     ban_db_.DumpBanList(ban_list_);
     
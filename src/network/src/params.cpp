@@ -1,4 +1,8 @@
 #include "network/include/params.h"
+
+#include <algorithm>
+#include <thread>
+
 #include "constants.h"
 #include "fullnode/include/config.h"
 
@@ -32,6 +36,11 @@ Params::Params(BtcNet btcnet, const util::Args& args,
         specified_outgoing_ = args.GetArgs(FULLNODE_OPTION_CONNECT);
     }
     
+    // 0 for one per cpu core
+    reactors_ = std::stoul(args.GetArg(FULLNODE_OPTION_REACTORS, DEFAULT_REACTORS));
+    if (reactors_ == 0)
+        reactors_ = std::max(1u, std::thread::hardware_concurrency());
+    
     switch (btcnet) {
         case BtcNet::kMainNet :
         {
@@ -121,6 +130,11 @@ const std::vector<std::string>& Params::specified_outgoing() const
     return specified_outgoing_;
 }
 
+size_t Params::reactors() const
+{
+    return reactors_;
+}
+
 const fs::path& Params::path_data_dir() const
 {
     return path_data_dir_;
@@ -373,7 +373,7 @@ bool Peers::GetAddrs(std::vector<NetAddr> *out)
 
 uint64_t Peers::MakeMapKey(const NetAddr& addr, bool by_group)
 {
-    crypto::HashOStream hs;
+    crypto::HashWriter hs;
     
     if (by_group) {
         std::vector<uint8_t> group;        
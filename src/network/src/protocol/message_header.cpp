@@ -0,0 +1,186 @@
+#include "protocol/message_header.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "blob.h"
+#include "logging.h"
+#include "util_endian.h"
+
+
+namespace btclite {
+namespace network {
+namespace protocol {
+
+namespace {
+
+constexpr CommandCode kCommands[] = {
+    PackCommand(msg_command::kMsgVersion),
+    PackCommand(msg_command::kMsgVerack),
+    PackCommand(msg_command::kMsgAddr),
+    PackCommand(msg_command::kMsgInv),
+    PackCommand(msg_command::kMsgGetData),
+    PackCommand(msg_command::kMsgMerkleBlock),
+    PackCommand(msg_command::kMsgGetBlocks),
+    PackCommand(msg_command::kMsgGetHeaders),
+    PackCommand(msg_command::kMsgTx),
+    PackCommand(msg_command::kMsgHeaders),
+    PackCommand(msg_command::kMsgBlock),
+    PackCommand(msg_command::kMsgGetAddr),
+    PackCommand(msg_command::kMsgMempool),
+    PackCommand(msg_command::kMsgPing),
+    PackCommand(msg_command::kMsgPong),
+    PackCommand(msg_command::kMsgNotFound),
+    PackCommand(msg_command::kMsgFilterLoad),
+    PackCommand(msg_command::kMsgFilterAdd),
+    PackCommand(msg_command::kMsgFilterClear),
+    PackCommand(msg_command::kMsgReject),
+    PackCommand(msg_command::kMsgSendHeaders),
+    PackCommand(msg_command::kMsgFeeFilter),
+    PackCommand(msg_command::kMsgSendCmpct),
+    PackCommand(msg_command::kMsgCmpctBlock),
+    PackCommand(msg_command::kMsgGetBlockTxn),
+    PackCommand(msg_command::kMsgBlockTxn)
+};
+
+} // namespace
+
+MessageHeader::MessageHeader(uint32_t magic, const std::string& command,
+              uint32_t payload_length, uint32_t checksum)
+    : magic_(magic), payload_length_(payload_length),
+      checksum_(checksum)
+{
+    set_command(command);
+}
+
+MessageHeader::MessageHeader(uint32_t magic, std::string&& command,
+              uint32_t payload_length, uint32_t checksum) noexcept
+    : magic_(magic), payload_length_(payload_length),
+      checksum_(checksum)
+{
+    set_command(std::move(command));
+}
+
+MessageHeader::MessageHeader(const uint8_t *raw_data)
+{
+    util::ByteSpanSource byte_source(raw_data, kSize);
+    
+    std::memset(command_.begin(), 0, kCommandSize);
+    Deserialize(byte_source);
+}
+
+bool MessageHeader::IsValid(uint32_t magic) const
+{
+    if (magic == kMainnetMagic || magic == kTestnetMagic || magic == kRegtestMagic) {
+        if (magic_ != magic) {
+            BTCLOG(LOG_LEVEL_WARNING) << "MessageHeader::magic_(" << magic_ 
+                                      << ") is invalid, " << magic << " is correct";
+            return false;
+        }
+    }
+    else {
+        if (magic_ != kMainnetMagic && magic_ != kTestnetMagic && magic_ != kRegtestMagic) {
+            BTCLOG(LOG_LEVEL_WARNING) << "MessageHeader::magic_(" << magic_ 
+                                      << ") is invalid";
+            return false;
+        }
+    }
+    
+    const CommandCode code = command_code();
+    if (std::find(std::begin(kCommands), std::end(kCommands), code) == std::end(kCommands)) {
+        BTCLOG(LOG_LEVEL_WARNING) << "MessageHeader::command_(" << command() << ") is invalid";
+        return false;
+    }
+    
+    if (payload_length_ > kMaxMessageSize) {
+        BTCLOG(LOG_LEVEL_WARNING) << "MessageHeader::payload_length_(" << payload_length_ << ") is oversize";
+        return false;
+    }
+    
+    return true;
+}
+
+void MessageHeader::Clear()
+{
+    magic_ = 0;
+    std::memset(command_.begin(), 0, kCommandSize);
+    payload_length_ = 0;
+    checksum_ = 0;
+}
+
+bool MessageHeader::operator==(const MessageHeader& b) const
+{
+    return (magic_ == b.magic_) &&
+           (command_ == b.command_) &&
+           (payload_length_ == b.payload_length_) &&
+           (checksum_ == b.checksum_);
+}
+
+bool MessageHeader::operator!=(const MessageHeader& b) const
+{
+    return !(*this == b);
+}
+
+uint32_t MessageHeader::magic() const
+{
+    return magic_;
+}
+
+void MessageHeader::set_magic(uint32_t magic)
+{
+    magic_ = magic;
+}
+
+std::string MessageHeader::command() const
+{
+    const char *end = (const char*)std::memchr(command_.begin(), '\0', kCommandSize);
+    size_t size = end ? (end - command_.begin()) : kCommandSize;
+    return std::string(command_.begin(), size);
+}
+
+CommandCode MessageHeader::command_code() const
+{
+    const uint8_t *raw = reinterpret_cast<const uint8_t*>(command_.data());
+    CommandCode code;
+    code.head = util::FromLittleEndian<uint64_t>(raw);
+    code.tail = util::FromLittleEndian<uint32_t>(raw + 8);
+    return code;
+}
+
+void MessageHeader::set_command(const std::string& command)
+{
+    std::memset(command_.begin(), 0, kCommandSize);
+    size_t size = command.size() < kCommandSize ? command.size() : kCommandSize;
+    std::memcpy(command_.begin(), command.data(), size);
+}
+
+void MessageHeader::set_command(std::string&& command) noexcept
+{
+    std::memset(command_.begin(), 0, kCommandSize);
+    size_t size = command.size() < kCommandSize ? command.size() : kCommandSize;
+    std::memmove(command_.begin(), command.data(), size);
+}
+
+uint32_t MessageHeader::payload_length() const
+{
+    return payload_length_;
+}
+
+void MessageHeader::set_payload_length(uint32_t payload_length)
+{
+    payload_length_ = payload_length;
+}
+
+uint32_t MessageHeader::checksum() const
+{
+    return checksum_;
+}
+
+void MessageHeader::set_checksum(uint32_t checksum)
+{
+    checksum_ = checksum;
+}
+
+} // namespace protocol
+} // namespace network
+} // namespace btclite
@@ -0,0 +1,170 @@
+#include "reactor.h"
+
+#include <event2/thread.h>
+
+#include "thread.h"
+
+
+namespace btclite {
+namespace network {
+
+Reactor::Reactor()
+    : base_(nullptr), wakeup_(nullptr)
+{
+}
+
+Reactor::~Reactor()
+{
+    // the tasks may hold the last reference to a node, whose bufferevent has
+    // to go before the base
+    tasks_.clear();
+    if (wakeup_)
+        event_free(wakeup_);
+    if (base_)
+        event_base_free(base_);
+}
+
+bool Reactor::InitEvent()
+{
+    evthread_use_pthreads();
+    
+    if (nullptr == (base_ = event_base_new())) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Reactor open event_base failed.";
+        return false;
+    }
+    
+    // never added, only made active by RunInLoop()
+    if (nullptr == (wakeup_ = event_new(base_, -1, 0, WakeupCb, this))) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Reactor create wakeup event failed.";
+        return false;
+    }
+    
+    return true;
+}
+
+void Reactor::StartEventLoop()
+{
+    if (!base_) {
+        BTCLOG(LOG_LEVEL_ERROR) << "Event base for loop is null.";
+        return;
+    }
+    
+    loop_thread_ = std::this_thread::get_id();
+    // keeps running with no peers yet
+    event_base_loop(base_, EVLOOP_NO_EXIT_ON_EMPTY);
+    loop_thread_ = std::thread::id();
+}
+
+void Reactor::ExitEventLoop()
+{
+    if (base_)
+        event_base_loopexit(base_, nullptr);
+}
+
+void Reactor::RunInLoop(std::function<void()> task)
+{
+    if (IsInLoopThread()) {
+        task();
+        return;
+    }
+    
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // the loop has been woken already if there were tasks
+        wakeup = tasks_.empty();
+        tasks_.push_back(std::move(task));
+    }
+    
+    if (wakeup)
+        event_active(wakeup_, EV_READ, 0);
+}
+
+bool Reactor::IsInLoopThread() const
+{
+    return loop_thread_ == std::this_thread::get_id();
+}
+
+int Reactor::Load() const
+{
+    return event_base_get_num_events(base_, EVENT_BASE_COUNT_ADDED);
+}
+
+void Reactor::WakeupCb(evutil_socket_t fd, short event, void *arg)
+{
+    auto *reactor = reinterpret_cast<Reactor*>(arg);
+    std::vector<std::function<void()> > tasks;
+    {
+        std::lock_guard<std::mutex> lock(reactor->mutex_);
+        tasks.swap(reactor->tasks_);
+    }
+    
+    for (auto& task : tasks)
+        task();
+}
+
+Reactors::Reactors(size_t count)
+{
+    for (size_t i = 0; i < std::max(size_t(1), count); i++)
+        reactors_.emplace_back(std::make_unique<Reactor>());
+}
+
+Reactors::~Reactors()
+{
+    ExitEventLoops();
+    Join();
+}
+
+bool Reactors::InitEvent()
+{
+    for (auto& reactor : reactors_)
+        if (!reactor->InitEvent())
+            return false;
+    
+    return true;
+}
+
+void Reactors::StartEventLoops()
+{
+    BTCLOG(LOG_LEVEL_INFO) << "Dispatching " << reactors_.size() << " reactor event loops...";
+    
+    for (size_t i = 0; i < reactors_.size(); i++) {
+        threads_.emplace_back(&util::TraceThread<std::function<void()> >,
+                              "reactor" + std::to_string(i),
+                              std::function<void()>(std::bind(
+                                      &Reactor::StartEventLoop, reactors_[i].get())));
+    }
+}
+
+void Reactors::ExitEventLoops()
+{
+    for (auto& reactor : reactors_)
+        reactor->ExitEventLoop();
+}
+
+void Reactors::Join()
+{
+    for (std::thread& thread : threads_)
+        if (thread.joinable())
+            thread.join();
+    threads_.clear();
+}
+
+Reactor *Reactors::LeastLoaded() const
+{
+    Reactor *least = reactors_.front().get();
+    int least_load = least->Load();
+    
+    for (size_t i = 1; i < reactors_.size() && least_load > 0; i++) {
+        int load = reactors_[i]->Load();
+        if (load < least_load) {
+            least = reactors_[i].get();
+            least_load = load;
+        }
+    }
+    
+    return least;
+}
+
+} // namespace network
+} // namespace btclite
@@ -0,0 +1,723 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "block_connector.h"
+#include "block_store.h"
+#include "chain/include/params.h"
+#include "chain_state.h"
+#include "coins_db.h"
+#include "ecdsa.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace chain;
+
+namespace {
+
+const fs::path kDbPath = fs::path("/tmp") / "block_connector_tests";
+
+class MemoryCoinsView : public CoinsView {
+public:
+    bool GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const override
+    {
+        auto it = coins_.find(outpoint);
+        if (it == coins_.end())
+            return false;
+        *coin = it->second;
+        return true;
+    }
+    
+    util::Hash256 GetBestBlock() const override
+    {
+        return best_block_;
+    }
+    
+    bool BatchWrite(CoinsMap *coins, const util::Hash256& best_block) override
+    {
+        for (auto& [outpoint, entry] : *coins) {
+            if (!(entry.flags & CoinsCacheEntry::kDirty))
+                continue;
+            if (entry.coin.IsSpent())
+                coins_.erase(outpoint);
+            else
+                coins_[outpoint] = entry.coin;
+        }
+        best_block_ = best_block;
+        return true;
+    }
+
+private:
+    util::FlatHashMap<consensus::OutPoint, Coin, SaltedOutPointHasher> coins_;
+    util::Hash256 best_block_{};
+};
+
+// OP_TRUE, spent by an empty script_sig
+consensus::Script TestScript()
+{
+    consensus::Script script;
+    script.Push(consensus::Opcode::OP_TRUE);
+    return script;
+}
+
+consensus::Script P2pkhScript(const std::vector<uint8_t>& pubkey)
+{
+    const util::Hash160 hash = crypto::hashfuncs::Hash160(pubkey);
+    consensus::Script script;
+    script.Push(consensus::Opcode::OP_DUP);
+    script.Push(consensus::Opcode::OP_HASH160);
+    script.Push(std::vector<uint8_t>(hash.begin(), hash.end()));
+    script.Push(consensus::Opcode::OP_EQUALVERIFY);
+    script.Push(consensus::Opcode::OP_CHECKSIG);
+    return script;
+}
+
+consensus::TransactionRef Coinbase(uint32_t height, uint64_t value)
+{
+    // the height keeps the coinbases of different blocks apart, as BIP34
+    // has it, padded to the least size of the script
+    consensus::Script script_sig;
+    script_sig.Push(static_cast<uint64_t>(height));
+    script_sig.Push(consensus::Opcode::OP_0);
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(consensus::OutPoint(), script_sig);
+    std::pmr::vector<consensus::TxOut> outputs;
+    outputs.emplace_back(value, TestScript());
+    
+    return consensus::MakeTransactionRef(
+               consensus::Transaction(1, std::move(inputs), std::move(outputs), 0));
+}
+
+consensus::TransactionRef Spend(const std::vector<consensus::OutPoint>& prevouts,
+                                const std::vector<uint64_t>& values)
+{
+    std::pmr::vector<consensus::TxIn> inputs;
+    for (const consensus::OutPoint& prevout : prevouts)
+        inputs.emplace_back(prevout, consensus::Script());
+    std::pmr::vector<consensus::TxOut> outputs;
+    for (uint64_t value : values)
+        outputs.emplace_back(value, TestScript());
+    
+    return consensus::MakeTransactionRef(
+               consensus::Transaction(1, std::move(inputs), std::move(outputs), 0));
+}
+
+// Regtest difficulty, a few tries find a nonce.
+consensus::Block MakeBlock(const util::Hash256& prev,
+                           std::vector<consensus::TransactionRef>&& transactions)
+{
+    consensus::Block block(std::move(transactions));
+    consensus::BlockHeader header(1, prev, block.ComputeMerkleRoot(), 1600000000, 0x207fffff, 0);
+    while (!header.CheckProofOfWork())
+        header.set_nonce(header.nonce() + 1);
+    block.set_header(std::move(header));
+    
+    return block;
+}
+
+// block with a coinbase committing to the witnesses of its transactions,
+// the commitment made over reserved and the coinbase witness holding
+// witness_reserved
+consensus::Block CommitWitnesses(const consensus::Block& block, uint8_t reserved = 0,
+                                 uint8_t witness_reserved = 0)
+{
+    // the coinbase counts as zero in the witness tree, its own change is
+    // not seen
+    const util::Hash256 root = block.ComputeWitnessMerkleRoot();
+    std::vector<uint8_t> buf(root.begin(), root.end());
+    buf.resize(2 * kHashSize, reserved);
+    const util::Hash256 commitment = crypto::hashfuncs::DoubleSha256(buf);
+    
+    std::vector<uint8_t> script = { 0x6a, 0x24, 0xaa, 0x21, 0xa9, 0xed };
+    script.insert(script.end(), commitment.begin(), commitment.end());
+    consensus::Transaction coinbase(*block.transactions()[0]);
+    std::pmr::vector<consensus::TxIn> inputs = coinbase.inputs();
+    inputs[0].set_scriptWitness(consensus::ScriptWitness(std::vector<std::vector<uint8_t> >{
+                                    std::vector<uint8_t>(kHashSize, witness_reserved) }));
+    coinbase.set_inputs(std::move(inputs));
+    std::pmr::vector<consensus::TxOut> outputs = coinbase.outputs();
+    outputs.emplace_back(0, consensus::Script(script));
+    coinbase.set_outputs(std::move(outputs));
+    
+    std::vector<consensus::TransactionRef> transactions = block.transactions();
+    transactions[0] = consensus::MakeTransactionRef(std::move(coinbase));
+    return MakeBlock(block.header().hashPrevBlock(), std::move(transactions));
+}
+
+consensus::OutPoint OutPointOf(const consensus::TransactionRef& tx, uint32_t index = 0)
+{
+    return consensus::OutPoint(tx->GetHash(), index);
+}
+
+} // namespace
+
+// Connects a chain of regtest blocks on top of the genesis block, with or
+// without a thread pool and a script check queue, through a script cache.
+class BlockConnectorTest : public ::testing::TestWithParam<bool> {
+protected:
+    BlockConnectorTest()
+        : params_(BtcNet::kRegTest), pool_(2), checks_(2), script_cache_(1 << 20),
+          coins_(&base_),
+          connector_(params_.consensus_params(), &coins_, &base_,
+                     GetParam() ? &pool_ : nullptr, GetParam() ? &checks_ : nullptr,
+                     &script_cache_)
+    {
+        const consensus::Block& genesis = params_.consensus_params().GenesisBlock();
+        EXPECT_EQ(connector_.ConnectBlock(genesis, 0, nullptr), ConnectResult::kConnected);
+        tip_ = genesis.GetHash();
+    
+        // coinbases of blocks 1 and up are mature from 101 on
+        coinbases_.push_back(nullptr);
+        for (uint32_t i = 0; i < 100; i++)
+            EXPECT_TRUE(Connect({}));
+    }
+    
+    uint64_t Subsidy() const
+    {
+        return params_.consensus_params().BlockSubsidy(height_ + 1);
+    }
+    
+    consensus::Block NextBlock(std::vector<consensus::TransactionRef> transactions,
+                               uint64_t coinbase_value)
+    {
+        transactions.insert(transactions.begin(), Coinbase(height_ + 1, coinbase_value));
+        return MakeBlock(tip_, std::move(transactions));
+    }
+    
+    bool ConnectBlock(const consensus::Block& block, BlockUndo *undo = nullptr)
+    {
+        if (connector_.ConnectBlock(block, height_ + 1, undo) != ConnectResult::kConnected)
+            return false;
+        tip_ = block.GetHash();
+        height_++;
+        coinbases_.push_back(block.transactions()[0]);
+        return true;
+    }
+    
+    bool Connect(std::vector<consensus::TransactionRef> transactions, uint64_t fees = 0,
+                 BlockUndo *undo = nullptr)
+    {
+        return ConnectBlock(NextBlock(std::move(transactions), Subsidy() + fees), undo);
+    }
+    
+    const Params params_;
+    util::ThreadPool pool_;
+    ScriptCheckQueue checks_;
+    consensus::ScriptCache script_cache_;
+    MemoryCoinsView base_;
+    CoinsViewCache coins_;
+    BlockConnector connector_;
+    util::Hash256 tip_;
+    uint32_t height_ = 0;
+    std::vector<consensus::TransactionRef> coinbases_;
+};
+
+TEST_P(BlockConnectorTest, ConnectBlock)
+{
+    EXPECT_EQ(coins_.GetBestBlock(), tip_);
+    EXPECT_EQ(height_, 100);
+    
+    // the second transaction spends an output of the first
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    consensus::TransactionRef tx1 = Spend({ OutPointOf(coinbases_[1]) }, { 1000, value - 2000 });
+    consensus::TransactionRef tx2 = Spend({ OutPointOf(tx1, 1) }, { value - 6000 });
+    BlockUndo undo;
+    ASSERT_TRUE(Connect({ tx1, tx2 }, 5000, &undo));
+    EXPECT_EQ(coins_.GetBestBlock(), tip_);
+    
+    ASSERT_EQ(undo.size(), 2);
+    EXPECT_EQ(undo[0].height(), 1);
+    EXPECT_TRUE(undo[0].coinbase());
+    EXPECT_EQ(undo[0].out(), coinbases_[1]->outputs()[0]);
+    EXPECT_EQ(undo[1].height(), 101);
+    EXPECT_FALSE(undo[1].coinbase());
+    
+    EXPECT_FALSE(coins_.HaveCoin(OutPointOf(coinbases_[1])));
+    EXPECT_TRUE(coins_.HaveCoin(OutPointOf(tx1, 0)));
+    EXPECT_FALSE(coins_.HaveCoin(OutPointOf(tx1, 1)));
+    EXPECT_TRUE(coins_.HaveCoin(OutPointOf(tx2)));
+    EXPECT_TRUE(coins_.HaveCoin(OutPointOf(coinbases_[101])));
+    EXPECT_EQ(coins_.AccessCoin(OutPointOf(coinbases_[101]))->out().value(), Subsidy() + 5000);
+}
+
+TEST_P(BlockConnectorTest, RejectInvalid)
+{
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    const consensus::OutPoint spendable = OutPointOf(coinbases_[1]);
+    
+    // each leaves the coins as they were
+    auto expect_rejected = [&](const consensus::Block& block,
+                               ConnectResult result = ConnectResult::kInvalid)
+    {
+        EXPECT_EQ(connector_.ConnectBlock(block, height_ + 1, nullptr), result);
+        EXPECT_EQ(coins_.GetBestBlock(), tip_);
+        EXPECT_TRUE(coins_.HaveCoin(spendable));
+        EXPECT_FALSE(coins_.HaveCoin(OutPointOf(block.transactions()[0])));
+    };
+    
+    consensus::OutPoint missing(OutPointOf(coinbases_[1]).prev_hash(), 1);
+    expect_rejected(NextBlock({ Spend({ missing }, { 1 }) }, Subsidy()));
+    expect_rejected(NextBlock({ Spend({ spendable }, { value + 1 }) }, Subsidy()));
+    expect_rejected(NextBlock({ Spend({ OutPointOf(coinbases_[2]) }, { 1 }) }, Subsidy()));
+    expect_rejected(NextBlock({ Spend({ spendable }, { value - 1 }) }, Subsidy() + 2));
+    expect_rejected(NextBlock({ Spend({ spendable, spendable }, { 1 }) }, Subsidy()));
+    // spent twice in one block
+    expect_rejected(NextBlock({ Spend({ spendable }, { 1 }), Spend({ spendable }, { 2 }) },
+                              Subsidy()));
+    
+    consensus::Block bad_root = NextBlock({}, Subsidy());
+    consensus::BlockHeader header = bad_root.header();
+    header.set_hashMerkleRoot(OutPointOf(coinbases_[1]).prev_hash());
+    bad_root.set_header(std::move(header));
+    expect_rejected(bad_root);
+    
+    consensus::Block no_coinbase = MakeBlock(tip_, { Spend({ spendable }, { value }) });
+    EXPECT_EQ(connector_.ConnectBlock(no_coinbase, height_ + 1, nullptr), ConnectResult::kInvalid);
+    
+    consensus::Block not_on_tip = MakeBlock(coinbases_[1]->GetHash(),
+                                            { Coinbase(height_ + 1, Subsidy()) });
+    // not the block's fault
+    expect_rejected(not_on_tip, ConnectResult::kError);
+    
+    // and the valid one still connects
+    ASSERT_TRUE(Connect({ Spend({ spendable }, { value }) }));
+    EXPECT_FALSE(coins_.HaveCoin(spendable));
+}
+
+TEST_P(BlockConnectorTest, LockTimes)
+{
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    auto spend = [&](const consensus::OutPoint& prevout, uint32_t version, uint32_t sequence,
+                     uint32_t lock_time)
+    {
+        std::pmr::vector<consensus::TxIn> inputs;
+        inputs.emplace_back(prevout, consensus::Script(), sequence);
+        std::pmr::vector<consensus::TxOut> outputs;
+        outputs.emplace_back(value, TestScript());
+        return consensus::MakeTransactionRef(
+                   consensus::Transaction(version, std::move(inputs), std::move(outputs),
+                                          lock_time));
+    };
+    // ten minutes a block
+    const MedianTimePast median_time_past = [](uint32_t height)
+    {
+        return 1600000000 + 600 * static_cast<int64_t>(height);
+    };
+    auto connect = [&](const consensus::TransactionRef& tx)
+    {
+        consensus::Block block = NextBlock({ tx }, Subsidy());
+        ConnectResult result = connector_.ConnectBlock(block, height_ + 1, nullptr, nullptr,
+                                                       median_time_past);
+        if (result == ConnectResult::kConnected) {
+            tip_ = block.GetHash();
+            height_++;
+        }
+        return result;
+    };
+    
+    consensus::Block wrong_height = MakeBlock(tip_, { Coinbase(height_ + 2, Subsidy()) });
+    EXPECT_EQ(connector_.ConnectBlock(wrong_height, height_ + 1, nullptr),
+              ConnectResult::kInvalid);
+    
+    // a lock time is the last height or time the transaction can not be in
+    // a block at, unless final sequence numbers disable it
+    const consensus::OutPoint spendable = OutPointOf(coinbases_[1]);
+    const uint32_t time_past = median_time_past(height_);
+    EXPECT_EQ(connect(spend(spendable, 1, 0, height_ + 1)), ConnectResult::kInvalid);
+    EXPECT_EQ(connect(spend(spendable, 1, 0, time_past)), ConnectResult::kInvalid);
+    const consensus::TransactionRef tx1 =
+        spend(spendable, 2, consensus::TxIn::default_sequence_no, height_ + 1);
+    ASSERT_EQ(connect(tx1), ConnectResult::kConnected);
+    
+    // relative locks of 1024 and 512 seconds, one block of 600 seconds on
+    const uint32_t kTimeLock = consensus::kSequenceLockTimeType;
+    EXPECT_EQ(connect(spend(OutPointOf(tx1), 2, kTimeLock | 2, 0)), ConnectResult::kInvalid);
+    const consensus::TransactionRef tx2 = spend(OutPointOf(tx1), 2, kTimeLock | 1, 0);
+    ASSERT_EQ(connect(tx2), ConnectResult::kConnected);
+    
+    // and of two and one blocks
+    EXPECT_EQ(connect(spend(OutPointOf(tx2), 2, 2, 0)), ConnectResult::kInvalid);
+    const consensus::TransactionRef tx3 = spend(OutPointOf(tx2), 2, 1, 0);
+    ASSERT_EQ(connect(tx3), ConnectResult::kConnected);
+    
+    // none before version 2
+    ASSERT_EQ(connect(spend(OutPointOf(tx3), 1, 5, 0)), ConnectResult::kConnected);
+    EXPECT_FALSE(coins_.HaveCoin(OutPointOf(tx3)));
+}
+
+TEST_P(BlockConnectorTest, Prefetch)
+{
+    for (uint32_t i = 0; i < 60; i++)
+        ASSERT_TRUE(Connect({}));
+    ASSERT_TRUE(coins_.Flush());
+    
+    std::vector<consensus::TransactionRef> transactions;
+    for (uint32_t i = 1; i <= 50; i++)
+        transactions.push_back(Spend({ OutPointOf(coinbases_[i]) },
+                                     { coinbases_[i]->OutputsAmount() }));
+    consensus::Block block = NextBlock(transactions, Subsidy());
+    connector_.Prefetch(block);
+    ASSERT_TRUE(ConnectBlock(block));
+    for (uint32_t i = 1; i <= 50; i++)
+        EXPECT_FALSE(coins_.HaveCoin(OutPointOf(coinbases_[i])));
+    
+    // reads taken before a flush are dropped, not merged
+    transactions.clear();
+    for (uint32_t i = 51; i <= 60; i++)
+        transactions.push_back(Spend({ OutPointOf(coinbases_[i]) },
+                                     { coinbases_[i]->OutputsAmount() }));
+    block = NextBlock(transactions, Subsidy());
+    connector_.Prefetch(block);
+    ASSERT_TRUE(coins_.Flush());
+    ASSERT_TRUE(ConnectBlock(block));
+    ASSERT_TRUE(coins_.Flush());
+    EXPECT_EQ(base_.GetBestBlock(), tip_);
+    for (uint32_t i = 51; i <= 60; i++)
+        EXPECT_FALSE(base_.HaveCoin(OutPointOf(coinbases_[i])));
+    EXPECT_TRUE(base_.HaveCoin(OutPointOf(coinbases_[61])));
+}
+
+TEST_P(BlockConnectorTest, Scripts)
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 1, sizeof(seckey));
+    std::vector<uint8_t> pubkey;
+    ASSERT_TRUE(crypto::EcdsaPublicKey(seckey, true, &pubkey));
+    const consensus::Script p2pkh = P2pkhScript(pubkey);
+    
+    // ten outputs to the key
+    const uint64_t value = coinbases_[1]->OutputsAmount() / 10;
+    std::pmr::vector<consensus::TxOut> outputs;
+    for (int i = 0; i < 10; i++)
+        outputs.emplace_back(value, p2pkh);
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(OutPointOf(coinbases_[1]), consensus::Script());
+    consensus::TransactionRef funding = consensus::MakeTransactionRef(
+        consensus::Transaction(1, std::move(inputs), std::move(outputs), 0));
+    ASSERT_TRUE(Connect({ funding }, coinbases_[1]->OutputsAmount() - 10 * value));
+    
+    // one transaction spending them all, input bad signed with the wrong
+    // hash; the good signatures are made once and shared
+    std::vector<std::vector<uint8_t> > sigs(10);
+    auto spend_all = [&](size_t bad)
+    {
+        std::pmr::vector<consensus::TxIn> inputs;
+        for (uint32_t i = 0; i < 10; i++)
+            inputs.emplace_back(OutPointOf(funding, i), consensus::Script());
+        std::pmr::vector<consensus::TxOut> outputs;
+        outputs.emplace_back(10 * value, TestScript());
+        consensus::Transaction tx(1, std::move(inputs), std::move(outputs), 0);
+    
+        std::pmr::vector<consensus::TxIn> signed_inputs = tx.inputs();
+        for (size_t i = 0; i < signed_inputs.size(); i++) {
+            util::Hash256 sighash = consensus::SignatureHash(
+                p2pkh, tx, i, consensus::kSigHashAll, value, consensus::SigVersion::kBase);
+            std::vector<uint8_t> sig = sigs[i];
+            if (i == bad || sig.empty()) {
+                if (i == bad)
+                    sighash[0] ^= 1;
+                EXPECT_TRUE(crypto::SignEcdsa(seckey, sighash, &sig));
+                sig.push_back(consensus::kSigHashAll);
+                if (i != bad)
+                    sigs[i] = sig;
+            }
+            consensus::Script script_sig;
+            script_sig.Push(sig);
+            script_sig.Push(pubkey);
+            signed_inputs[i].set_scriptSig(script_sig);
+        }
+        tx.set_inputs(std::move(signed_inputs));
+        return consensus::MakeTransactionRef(std::move(tx));
+    };
+    
+    consensus::Block invalid = NextBlock({ spend_all(7) }, Subsidy());
+    EXPECT_EQ(connector_.ConnectBlock(invalid, height_ + 1, nullptr), ConnectResult::kInvalid);
+    EXPECT_EQ(coins_.GetBestBlock(), tip_);
+    for (uint32_t i = 0; i < 10; i++)
+        EXPECT_TRUE(coins_.HaveCoin(OutPointOf(funding, i)));
+    
+    // The good signatures checked before the bad one are cached: the seven
+    // ahead of it when the checks run in order, up to all nine on the
+    // check queue.
+    const uint64_t cached = script_cache_.signature_stats().inserts;
+    EXPECT_LE(cached, 9);
+    if (!GetParam()) {
+        EXPECT_EQ(cached, 7);
+    }
+    
+    const consensus::TransactionRef good = spend_all(10);
+    const uint32_t flags = connector_.ScriptFlags(tip_, height_ + 1);
+    ASSERT_TRUE(Connect({ good }));
+    for (uint32_t i = 0; i < 10; i++)
+        EXPECT_FALSE(coins_.HaveCoin(OutPointOf(funding, i)));
+    EXPECT_EQ(script_cache_.signature_stats().hits, cached);
+    EXPECT_TRUE(script_cache_.HaveScripts(*good, flags));
+}
+
+// The coins move to the block only once its undo data is written.
+TEST_P(BlockConnectorTest, WriteUndo)
+{
+    const consensus::OutPoint spendable = OutPointOf(coinbases_[1]);
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    const consensus::Block block = NextBlock({ Spend({ spendable }, { value }) }, Subsidy());
+    BlockUndo written;
+    auto write_undo = [&](const BlockUndo& undo)
+    {
+        written = undo;
+        return false;
+    };
+    
+    EXPECT_EQ(connector_.ConnectBlock(block, height_ + 1, nullptr, write_undo),
+              ConnectResult::kError);
+    ASSERT_EQ(written.size(), 1);
+    EXPECT_EQ(written[0].out(), coinbases_[1]->outputs()[0]);
+    EXPECT_EQ(coins_.GetBestBlock(), tip_);
+    EXPECT_TRUE(coins_.HaveCoin(spendable));
+    
+    ASSERT_TRUE(ConnectBlock(block));
+    EXPECT_FALSE(coins_.HaveCoin(spendable));
+}
+
+// A transaction the cache says passed is not checked again.
+TEST_P(BlockConnectorTest, ScriptCache)
+{
+    consensus::Script script_pub_key;
+    script_pub_key.Push(consensus::Opcode::OP_FALSE);
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    std::pmr::vector<consensus::TxOut> outputs;
+    outputs.emplace_back(value, script_pub_key);
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(OutPointOf(coinbases_[1]), consensus::Script());
+    consensus::TransactionRef funding = consensus::MakeTransactionRef(
+        consensus::Transaction(1, std::move(inputs), std::move(outputs), 0));
+    ASSERT_TRUE(Connect({ funding }));
+    
+    consensus::TransactionRef spend = Spend({ OutPointOf(funding) }, { value });
+    consensus::Block block = NextBlock({ spend }, Subsidy());
+    const uint32_t flags = connector_.ScriptFlags(block.GetHash(), height_ + 1);
+    EXPECT_EQ(connector_.ConnectBlock(block, height_ + 1, nullptr), ConnectResult::kInvalid);
+    
+    script_cache_.AddScripts(*spend, flags);
+    EXPECT_TRUE(ConnectBlock(block));
+    EXPECT_EQ(script_cache_.script_stats().hits, 1);
+}
+
+// A P2WPKH spend, connected from the block as it comes off the wire.
+TEST_P(BlockConnectorTest, WitnessSpend)
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 1, sizeof(seckey));
+    std::vector<uint8_t> pubkey;
+    ASSERT_TRUE(crypto::EcdsaPublicKey(seckey, true, &pubkey));
+    const util::Hash160 key_hash = crypto::hashfuncs::Hash160(pubkey);
+    consensus::Script p2wpkh;
+    p2wpkh.Push(consensus::Opcode::OP_FALSE);
+    p2wpkh.Push(std::vector<uint8_t>(key_hash.begin(), key_hash.end()));
+    
+    const uint64_t value = coinbases_[1]->OutputsAmount();
+    std::pmr::vector<consensus::TxOut> outputs;
+    outputs.emplace_back(value, p2wpkh);
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(OutPointOf(coinbases_[1]), consensus::Script());
+    consensus::TransactionRef funding = consensus::MakeTransactionRef(
+        consensus::Transaction(1, std::move(inputs), std::move(outputs), 0));
+    ASSERT_TRUE(Connect({ funding }));
+    
+    // signed over the P2PKH script code, bad flipping the signature hash
+    auto spend = [&](bool bad)
+    {
+        std::pmr::vector<consensus::TxIn> inputs;
+        inputs.emplace_back(OutPointOf(funding), consensus::Script());
+        std::pmr::vector<consensus::TxOut> outputs;
+        outputs.emplace_back(value, TestScript());
+        consensus::Transaction tx(1, std::move(inputs), std::move(outputs), 0);
+    
+        util::Hash256 sighash = consensus::SignatureHash(
+            P2pkhScript(pubkey), tx, 0, consensus::kSigHashAll, value,
+            consensus::SigVersion::kWitnessV0);
+        if (bad)
+            sighash[0] ^= 1;
+        std::vector<uint8_t> sig;
+        EXPECT_TRUE(crypto::SignEcdsa(seckey, sighash, &sig));
+        sig.push_back(consensus::kSigHashAll);
+        std::pmr::vector<consensus::TxIn> signed_inputs = tx.inputs();
+        signed_inputs[0].set_scriptWitness(
+            consensus::ScriptWitness(std::vector<std::vector<uint8_t> >{ sig, pubkey }));
+        tx.set_inputs(std::move(signed_inputs));
+        return consensus::MakeTransactionRef(std::move(tx));
+    };
+    const consensus::TransactionRef good = spend(false);
+    
+    auto expect_rejected = [&](const consensus::Block& block)
+    {
+        EXPECT_EQ(connector_.ConnectBlock(block, height_ + 1, nullptr), ConnectResult::kInvalid);
+        EXPECT_EQ(coins_.GetBestBlock(), tip_);
+        EXPECT_TRUE(coins_.HaveCoin(OutPointOf(funding)));
+    };
+    // witnesses without a commitment, a commitment to other witnesses, and
+    // a bad signature
+    expect_rejected(NextBlock({ good }, Subsidy()));
+    expect_rejected(CommitWitnesses(NextBlock({ good }, Subsidy()), 0, 1));
+    expect_rejected(CommitWitnesses(NextBlock({ spend(true) }, Subsidy())));
+    
+    const consensus::Block block = CommitWitnesses(NextBlock({ good }, Subsidy()));
+    EXPECT_LE(block.Weight(), kMaxBlockWeight);
+    util::MemoryStream ms;
+    ms << block;
+    consensus::Block received;
+    ms >> received;
+    ASSERT_EQ(received.GetHash(), block.GetHash());
+    ASSERT_TRUE(ConnectBlock(received));
+    EXPECT_FALSE(coins_.HaveCoin(OutPointOf(funding)));
+    EXPECT_TRUE(coins_.HaveCoin(OutPointOf(good)));
+}
+
+INSTANTIATE_TEST_SUITE_P(Pool, BlockConnectorTest, ::testing::Bool());
+
+// Before BIP34 a coinbase can repeat an earlier one, but not while that one
+// is unspent.
+TEST(BlockConnectorMainNetTest, RepeatedCoinbase)
+{
+    const Params params(BtcNet::kMainNet);
+    MemoryCoinsView base;
+    CoinsViewCache coins(&base);
+    BlockConnector connector(params.consensus_params(), &coins, &base);
+    const consensus::Block& genesis = params.consensus_params().GenesisBlock();
+    ASSERT_EQ(connector.ConnectBlock(genesis, 0, nullptr), ConnectResult::kConnected);
+    
+    const consensus::TransactionRef coinbase =
+        Coinbase(1, params.consensus_params().BlockSubsidy(1));
+    consensus::Block block = MakeBlock(genesis.GetHash(), { coinbase });
+    ASSERT_EQ(connector.ConnectBlock(block, 1, nullptr), ConnectResult::kConnected);
+    consensus::Block repeated = MakeBlock(block.GetHash(), { coinbase });
+    EXPECT_EQ(connector.ConnectBlock(repeated, 2, nullptr), ConnectResult::kInvalid);
+    EXPECT_EQ(coins.GetBestBlock(), block.GetHash());
+}
+
+TEST(ChainStateTest, ActivateBestChain)
+{
+    fs::remove_all(kDbPath);
+    fs::create_directories(kDbPath);
+    const Params params(BtcNet::kRegTest);
+    const consensus::Block& genesis = params.consensus_params().GenesisBlock();
+    BlockStore store(kDbPath);
+    ASSERT_TRUE(store.Open());
+    MemoryCoinsView base;
+    CoinsViewCache coins(&base);
+    BlockConnector connector(params.consensus_params(), &coins, &base);
+    ChainState chain_state;
+    ASSERT_TRUE(chain_state.LoadGenesisBlock(genesis, &store, &connector));
+    
+    // accepted out of the way first, then connected in one go
+    std::vector<consensus::TransactionRef> coinbases;
+    std::vector<util::Hash256> hashes{ genesis.GetHash() };
+    util::Hash256 prev = genesis.GetHash();
+    for (uint32_t height = 1; height <= 120; height++) {
+        std::vector<consensus::TransactionRef> transactions;
+        transactions.push_back(Coinbase(height, params.consensus_params().BlockSubsidy(height)));
+        if (height == 120)
+            transactions.push_back(Spend({ OutPointOf(coinbases[0]) },
+                                         { coinbases[0]->OutputsAmount() }));
+        coinbases.push_back(transactions[0]);
+        consensus::Block block = MakeBlock(prev, std::move(transactions));
+        ASSERT_TRUE(chain_state.AcceptBlock(block, &store));
+        prev = block.GetHash();
+        hashes.push_back(prev);
+    }
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 0);
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 120);
+    EXPECT_EQ(coins.GetBestBlock(), prev);
+    EXPECT_FALSE(coins.HaveCoin(OutPointOf(coinbases[0])));
+    
+    // a block spending the same coin again is marked failed and skipped
+    consensus::Block invalid = MakeBlock(prev, {
+        Coinbase(121, params.consensus_params().BlockSubsidy(121)),
+        Spend({ OutPointOf(coinbases[0]) }, { 1 }) });
+    ASSERT_TRUE(chain_state.AcceptBlock(invalid, &store));
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 120);
+    EXPECT_EQ(coins.GetBestBlock(), prev);
+    consensus::Block child = MakeBlock(invalid.GetHash(), {
+        Coinbase(122, params.consensus_params().BlockSubsidy(122)) });
+    EXPECT_FALSE(chain_state.AcceptBlock(child, &store));
+    
+    // coins that never got flushed, as after a crash, are connected again
+    MemoryCoinsView base2;
+    CoinsViewCache coins2(&base2);
+    BlockConnector connector2(params.consensus_params(), &coins2, &base2);
+    EXPECT_FALSE(chain_state.RewindTip(invalid.GetHash()));
+    ASSERT_TRUE(chain_state.RewindTip(coins2.GetBestBlock()));
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector2));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 120);
+    EXPECT_EQ(coins2.GetBestBlock(), prev);
+    
+    // a block that can not connect to coins elsewhere is not marked failed,
+    // and connects to the right ones later
+    consensus::Block next = MakeBlock(prev, {
+        Coinbase(121, params.consensus_params().BlockSubsidy(121)) });
+    ASSERT_TRUE(chain_state.AcceptBlock(next, &store));
+    MemoryCoinsView base3;
+    CoinsViewCache coins3(&base3);
+    BlockConnector connector3(params.consensus_params(), &coins3, &base3);
+    EXPECT_FALSE(chain_state.ActivateBestChain(&store, &connector3));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 120);
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector2));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 121);
+    EXPECT_EQ(coins2.GetBestBlock(), next.GetHash());
+    
+    // a heavier fork off the active chain is not switched to, blocks on the
+    // tip still connect
+    util::Hash256 fork = hashes[119];
+    for (uint32_t height = 120; height <= 123; height++) {
+        consensus::Block block = MakeBlock(fork, {
+            Coinbase(height, params.consensus_params().BlockSubsidy(height) - 1) });
+        ASSERT_TRUE(chain_state.AcceptBlock(block, &store));
+        fork = block.GetHash();
+    }
+    consensus::Block next2 = MakeBlock(next.GetHash(), {
+        Coinbase(122, params.consensus_params().BlockSubsidy(122)) });
+    ASSERT_TRUE(chain_state.AcceptBlock(next2, &store));
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector2));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 122);
+    EXPECT_EQ(coins2.GetBestBlock(), next2.GetHash());
+}
+
+TEST(ChainStateTest, ChildBeforeParent)
+{
+    fs::remove_all(kDbPath);
+    fs::create_directories(kDbPath);
+    const Params params(BtcNet::kRegTest);
+    const consensus::Block& genesis = params.consensus_params().GenesisBlock();
+    BlockStore store(kDbPath);
+    ASSERT_TRUE(store.Open());
+    MemoryCoinsView base;
+    CoinsViewCache coins(&base);
+    BlockConnector connector(params.consensus_params(), &coins, &base);
+    ChainState chain_state;
+    ASSERT_TRUE(chain_state.LoadGenesisBlock(genesis, &store, &connector));
+    
+    consensus::Block parent = MakeBlock(genesis.GetHash(), {
+        Coinbase(1, params.consensus_params().BlockSubsidy(1)) });
+    consensus::Block child = MakeBlock(parent.GetHash(), {
+        Coinbase(2, params.consensus_params().BlockSubsidy(2)) });
+    EXPECT_FALSE(chain_state.AcceptBlock(child, &store));
+    ASSERT_TRUE(chain_state.AcceptBlockHeader(parent.header()));
+    ASSERT_TRUE(chain_state.AcceptBlockHeader(child.header()));
+    
+    // the child waits for the data of its parent
+    ASSERT_TRUE(chain_state.AcceptBlock(child, &store));
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 0);
+    
+    ASSERT_TRUE(chain_state.AcceptBlock(parent, &store));
+    ASSERT_TRUE(chain_state.ActivateBestChain(&store, &connector));
+    EXPECT_EQ(chain_state.ActiveChainHeight(), 2);
+    EXPECT_EQ(coins.GetBestBlock(), child.GetHash());
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,283 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "block_connector.h"
+#include "block_index_db.h"
+#include "block_store.h"
+#include "chain/include/params.h"
+#include "coins_db.h"
+#include "pow.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace chain;
+
+namespace {
+
+const fs::path kDbPath = fs::path("/tmp") / "block_index_db_tests";
+
+fs::path CleanDbPath()
+{
+    fs::remove_all(kDbPath);
+    fs::create_directories(kDbPath);
+    return kDbPath;
+}
+
+util::Hash256 TestHash(uint64_t n)
+{
+    util::Hash256 hash = {};
+    std::memcpy(hash.data(), &n, sizeof(n));
+    hash[31] = 0x5a;
+    return hash;
+}
+
+// Append a block on top of pprev the way ChainState does.
+BlockIndex *AddEntry(ChainState::BlockMap *map, BlockIndex *pprev, uint64_t n)
+{
+    consensus::BlockHeader header(1, pprev ? pprev->block_hash() : util::Hash256{},
+                                  TestHash(n + 1000000), 1231006505 + n,
+                                  n % 3 ? 0x207fffff : 0x1d00ffff, n);
+    BlockIndex *pindex = SingletonBlockIndexArena::GetInstance().New(header);
+    pindex->set_block_hash(TestHash(n));
+    pindex->set_pprev(pprev);
+    pindex->set_height(pprev ? pprev->height() + 1 : 0);
+    pindex->BuildSkip();
+    pindex->set_chain_work((pprev ? pprev->chain_work() : 0) + header.GetBlockProof());
+    pindex->set_tx_num(n % 5 ? 1 + n % 7 : 0);
+    pindex->set_chain_tx_num(pindex->tx_num() && (!pprev || pprev->chain_tx_num()) ?
+                             (pprev ? pprev->chain_tx_num() : 0) + pindex->tx_num() : 0);
+    pindex->set_status(kBlockValidTree | (pindex->tx_num() ? kBlockHaveData : 0));
+    pindex->set_block_pos(FlatFilePos{ static_cast<uint32_t>(n / 1000),
+                                       static_cast<uint32_t>(n % 1000 * 1000 + 8) });
+    pindex->set_undo_pos(static_cast<uint32_t>(n % 1000 * 100 + 8));
+    (*map)[pindex->block_hash()] = pindex;
+    
+    return pindex;
+}
+
+// A main chain of length blocks and a 100 block fork off its middle.
+BlockIndex *BuildTree(ChainState::BlockMap *map, size_t length)
+{
+    BlockIndex *tip = nullptr;
+    BlockIndex *fork = nullptr;
+    for (size_t i = 0; i < length; i++) {
+        tip = AddEntry(map, tip, i);
+        if (i == length / 2)
+            fork = tip;
+    }
+    for (size_t i = 0; i < 100; i++)
+        fork = AddEntry(map, fork, length + i);
+    
+    return tip;
+}
+
+void ExpectSameIndex(const ChainState::BlockMap& expected, const ChainState::BlockMap& loaded)
+{
+    ASSERT_EQ(loaded.size(), expected.size());
+    for (const auto& value : expected) {
+        const BlockIndex *a = value.second;
+        auto it = loaded.find(value.first);
+        ASSERT_NE(it, loaded.end());
+        const BlockIndex *b = it->second;
+    
+        ASSERT_NE(a, b);
+        ASSERT_EQ(b->block_hash(), a->block_hash());
+        ASSERT_EQ(b->GetBlockHeader().GetHash(), a->GetBlockHeader().GetHash());
+        ASSERT_EQ(b->height(), a->height());
+        ASSERT_EQ(b->status(), a->status());
+        ASSERT_EQ(b->tx_num(), a->tx_num());
+        ASSERT_EQ(b->chain_tx_num(), a->chain_tx_num());
+        ASSERT_EQ(b->chain_work(), a->chain_work());
+        ASSERT_EQ(b->GetBlockPos().file, a->GetBlockPos().file);
+        ASSERT_EQ(b->GetBlockPos().pos, a->GetBlockPos().pos);
+        ASSERT_EQ(b->GetUndoPos().pos, a->GetUndoPos().pos);
+        ASSERT_EQ(b->pprev() ? b->pprev()->block_hash() : util::Hash256{},
+                  a->pprev() ? a->pprev()->block_hash() : util::Hash256{});
+        ASSERT_EQ(b->pskip() ? b->pskip()->block_hash() : util::Hash256{},
+                  a->pskip() ? a->pskip()->block_hash() : util::Hash256{});
+    }
+}
+
+} // namespace
+
+TEST(BlockIndexDbTest, Constructor)
+{
+    BlockIndexDb db(fs::path("/foo"));
+    EXPECT_EQ(db.path_snapshot(), fs::path("/foo") / "blockindex.dat");
+    EXPECT_EQ(db.path_log(), fs::path("/foo") / "blockindex.log");
+}
+
+TEST(BlockIndexDbTest, LoadMissingFiles)
+{
+    BlockIndexDb db(CleanDbPath());
+    ChainState::BlockMap map;
+    util::Hash256 tip_hash;
+    
+    ASSERT_TRUE(db.Load(&map, &tip_hash));
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(tip_hash, util::Hash256{});
+    EXPECT_EQ(db.snapshot_records(), 0);
+    EXPECT_EQ(db.log_records(), 0);
+}
+
+TEST(BlockIndexDbTest, CompactAndLoad)
+{
+    BlockIndexDb db(CleanDbPath());
+    ChainState::BlockMap map, loaded;
+    util::Hash256 tip_hash;
+    ASSERT_TRUE(db.Load(&loaded, &tip_hash));
+    
+    // large enough to be loaded in parallel ranges
+    const BlockIndex *tip = BuildTree(&map, 40000);
+    ASSERT_TRUE(db.Compact(map, tip));
+    EXPECT_EQ(db.snapshot_records(), map.size());
+    EXPECT_EQ(db.log_records(), 0);
+    EXPECT_FALSE(fs::exists(db.path_log()));
+    
+    util::ThreadPool pool(4);
+    BlockIndexDb db2(kDbPath);
+    ASSERT_TRUE(db2.Load(&loaded, &tip_hash, &pool));
+    EXPECT_EQ(tip_hash, tip->block_hash());
+    ExpectSameIndex(map, loaded);
+    
+    // the map must start out empty
+    EXPECT_FALSE(db2.Load(&loaded, &tip_hash));
+}
+
+TEST(BlockIndexDbTest, AppendOverridesSnapshot)
+{
+    BlockIndexDb db(CleanDbPath());
+    ChainState::BlockMap map, loaded;
+    util::Hash256 tip_hash;
+    ASSERT_TRUE(db.Load(&loaded, &tip_hash));
+    
+    BlockIndex *tip = BuildTree(&map, 1000);
+    ASSERT_TRUE(db.Compact(map, tip));
+    
+    // change some entries, extend the chain and move the tip
+    std::vector<const BlockIndex*> dirty;
+    for (const auto& value : map) {
+        if (value.second->height() % 10 == 0) {
+            value.second->set_status(value.second->status() | kBlockHaveUndo);
+            dirty.push_back(value.second);
+        }
+    }
+    ASSERT_TRUE(db.Append(dirty, nullptr));
+    dirty.clear();
+    for (size_t i = 0; i < 10; i++) {
+        tip = AddEntry(&map, tip, 5000 + i);
+        dirty.push_back(tip);
+    }
+    ASSERT_TRUE(db.Append(dirty, tip));
+    size_t log_records = db.log_records();
+    
+    // a record torn by a crash is dropped
+    {
+        std::ofstream log(db.path_log(), std::ios::app | std::ios::binary);
+        log << std::string(BlockIndexDb::kRecordSize / 2, '\x01');
+    }
+    
+    BlockIndexDb db2(kDbPath);
+    ASSERT_TRUE(db2.Load(&loaded, &tip_hash));
+    EXPECT_EQ(tip_hash, tip->block_hash());
+    EXPECT_EQ(db2.log_records(), log_records);
+    ExpectSameIndex(map, loaded);
+    
+    // appending after the torn record cuts it off first
+    ASSERT_TRUE(db2.Append({}, loaded.at(tip->pprev()->block_hash())));
+    EXPECT_EQ(fs::file_size(db2.path_log()), BlockIndexDb::kHeaderSize +
+              (log_records + 1) * BlockIndexDb::kRecordSize);
+    ChainState::BlockMap reloaded;
+    BlockIndexDb db3(kDbPath);
+    ASSERT_TRUE(db3.Load(&reloaded, &tip_hash));
+    EXPECT_EQ(tip_hash, tip->pprev()->block_hash());
+}
+
+TEST(BlockIndexDbTest, StaleLogIgnored)
+{
+    BlockIndexDb db(CleanDbPath());
+    ChainState::BlockMap map, loaded;
+    util::Hash256 tip_hash;
+    ASSERT_TRUE(db.Load(&loaded, &tip_hash));
+    
+    BlockIndex *tip = BuildTree(&map, 100);
+    ASSERT_TRUE(db.Append({ tip }, tip));
+    fs::copy_file(db.path_log(), kDbPath / "old.log");
+    
+    // a crash between writing the snapshot and removing the log
+    ASSERT_TRUE(db.Compact(map, tip->pprev()));
+    fs::copy_file(kDbPath / "old.log", db.path_log());
+    
+    BlockIndexDb db2(kDbPath);
+    ASSERT_TRUE(db2.Load(&loaded, &tip_hash));
+    EXPECT_EQ(tip_hash, tip->pprev()->block_hash());
+    EXPECT_EQ(db2.log_records(), 0);
+    EXPECT_FALSE(fs::exists(db2.path_log()));
+    ExpectSameIndex(map, loaded);
+}
+
+TEST(BlockIndexDbTest, MissingParent)
+{
+    BlockIndexDb db(CleanDbPath());
+    ChainState::BlockMap map, loaded;
+    util::Hash256 tip_hash;
+    ASSERT_TRUE(db.Load(&loaded, &tip_hash));
+    
+    BlockIndex *tip = BuildTree(&map, 100);
+    ASSERT_TRUE(db.Append({ tip }, tip));
+    
+    BlockIndexDb db2(kDbPath);
+    EXPECT_FALSE(db2.Load(&loaded, &tip_hash));
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST(ChainStateTest, FlushAndLoadBlockIndex)
+{
+    const Params params(BtcNet::kMainNet);
+    const consensus::Block& genesis = params.consensus_params().GenesisBlock();
+    BlockIndexDb db(CleanDbPath());
+    BlockStore store(kDbPath);
+    ASSERT_TRUE(store.Open());
+    CoinsViewDb coins_db(kDbPath);
+    ASSERT_TRUE(coins_db.Open());
+    CoinsViewCache coins(&coins_db);
+    BlockConnector connector(params.consensus_params(), &coins, &coins_db);
+    ChainState chain_state;
+    ASSERT_TRUE(chain_state.LoadBlockIndex(&db));
+    EXPECT_FALSE(chain_state.LoadGenesisBlock(genesis, nullptr, &connector));
+    EXPECT_FALSE(chain_state.LoadGenesisBlock(genesis, &store, nullptr));
+    ASSERT_TRUE(chain_state.LoadGenesisBlock(genesis, &store, &connector));
+    EXPECT_EQ(coins.GetBestBlock(), genesis.GetHash());
+    ASSERT_TRUE(store.Flush());
+    ASSERT_TRUE(chain_state.FlushBlockIndex(&db));
+    // nothing changed, nothing written
+    size_t log_records = db.log_records();
+    ASSERT_TRUE(chain_state.FlushBlockIndex(&db));
+    EXPECT_EQ(db.log_records(), log_records);
+    
+    BlockIndexDb db2(kDbPath);
+    ChainState loaded;
+    ASSERT_TRUE(loaded.LoadBlockIndex(&db2));
+    EXPECT_EQ(loaded.ActiveChainHeight(), 0);
+    ASSERT_TRUE(loaded.LoadGenesisBlock(genesis, &store, &connector));
+    EXPECT_EQ(store.last_file(), 0);
+    EXPECT_FALSE(loaded.LoadBlockIndex(&db2));
+    
+    // the loaded entry points at the stored block
+    ChainState::BlockMap map;
+    util::Hash256 tip_hash;
+    BlockIndexDb db3(kDbPath);
+    ASSERT_TRUE(db3.Load(&map, &tip_hash));
+    ASSERT_EQ(map.size(), 1);
+    const BlockIndex *pindex = map.at(genesis.GetHash());
+    EXPECT_TRUE(pindex->status() & kBlockHaveData);
+    consensus::Block block;
+    ASSERT_TRUE(store.ReadBlock(pindex->GetBlockPos(), &block));
+    EXPECT_EQ(block.GetHash(), genesis.GetHash());
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "block_index.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace chain;
+
+TEST(BlockIndexArenaTest, Handles)
+{
+    BlockIndexArena& arena = SingletonBlockIndexArena::GetInstance();
+    const size_t size = arena.size();
+    
+    // cross at least one chunk boundary
+    std::vector<BlockIndex*> entries;
+    for (size_t i = 0; i < BlockIndexArena::kChunkSize + 10; i++) {
+        entries.push_back(arena.New());
+        entries.back()->set_height(i);
+    }
+    
+    EXPECT_EQ(arena.size(), size + entries.size());
+    EXPECT_GE(arena.allocated_memory(), arena.size() * sizeof(BlockIndex));
+    EXPECT_EQ(arena.Get(kNullBlockIndex), nullptr);
+    for (size_t i = 0; i < entries.size(); i++) {
+        ASSERT_NE(entries[i]->handle(), kNullBlockIndex);
+        ASSERT_EQ(arena.Get(entries[i]->handle()), entries[i]);
+        ASSERT_EQ(entries[i]->height(), i);
+    }
+}
+
+TEST(BlockIndexTest, GetAncestor)
+{
+    BlockIndexArena& arena = SingletonBlockIndexArena::GetInstance();
+    std::vector<BlockIndex*> chain;
+    
+    for (size_t i = 0; i < 5000; i++) {
+        BlockIndex *pindex = arena.New();
+        pindex->set_pprev(i ? chain.back() : nullptr);
+        pindex->set_height(i);
+        pindex->BuildSkip();
+        chain.push_back(pindex);
+    }
+    
+    EXPECT_EQ(chain[0]->pprev(), nullptr);
+    EXPECT_EQ(chain[0]->pskip(), nullptr);
+    for (size_t i = 1; i < chain.size(); i++) {
+        ASSERT_EQ(chain[i]->pprev(), chain[i - 1]);
+        ASSERT_NE(chain[i]->pskip(), nullptr);
+        ASSERT_LT(chain[i]->pskip()->height(), i);
+    }
+    
+    for (size_t height : { 0, 1, 2, 1000, 2047, 2048, 4998, 4999 })
+        EXPECT_EQ(chain.back()->GetAncestor(height), chain[height]);
+    EXPECT_EQ(chain[100]->GetAncestor(101), nullptr);
+}
+
+TEST(BlockIndexTest, GetBlockHeader)
+{
+    BlockIndexArena& arena = SingletonBlockIndexArena::GetInstance();
+    util::Hash256 prev_hash, merkle_root;
+    prev_hash.fill(0x11);
+    merkle_root.fill(0x22);
+    
+    BlockIndex *prev = arena.New();
+    prev->set_block_hash(prev_hash);
+    
+    consensus::BlockHeader header(2, prev_hash, merkle_root, 1231006505, 0x1d00ffff, 42);
+    BlockIndex *pindex = arena.New(header);
+    pindex->set_pprev(prev);
+    
+    EXPECT_EQ(pindex->GetBlockHeader().GetHash(), header.GetHash());
+    EXPECT_EQ(pindex->time(), header.time());
+    EXPECT_EQ(pindex->bits(), header.bits());
+    
+    // without pprev the previous hash reads as null, as for genesis
+    EXPECT_TRUE(arena.New(header)->GetBlockHeader().hashPrevBlock() == util::Hash256{});
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "block_store.h"
+#include "chain/include/params.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace chain;
+
+namespace {
+
+const fs::path kStorePath = fs::path("/tmp") / "block_store_tests";
+
+fs::path CleanStorePath()
+{
+    fs::remove_all(kStorePath);
+    fs::create_directories(kStorePath);
+    return kStorePath;
+}
+
+// The genesis block with its coinbase repeated num_txs times and the nonce
+// set to n, so that every block differs.
+consensus::Block TestBlock(uint32_t n, size_t num_txs = 1)
+{
+    const Params params(BtcNet::kMainNet);
+    const consensus::Block& genesis = params.consensus_params().GenesisBlock();
+    consensus::BlockHeader header = genesis.header();
+    header.set_nonce(n);
+    std::vector<consensus::TransactionRef> transactions(num_txs, genesis.transactions()[0]);
+    
+    return consensus::Block(header, transactions);
+}
+
+std::vector<uint8_t> Serialized(const consensus::Block& block)
+{
+    util::MemoryStream ms;
+    ms << block;
+    return std::vector<uint8_t>(ms.Data(), ms.Data() + ms.Size());
+}
+
+} // namespace
+
+TEST(BlockStoreTest, Constructor)
+{
+    BlockStore store(fs::path("/foo"));
+    EXPECT_EQ(store.path_blocks(), fs::path("/foo") / "blocks");
+    EXPECT_EQ(store.BlockFilePath(0), fs::path("/foo") / "blocks" / "blk00000.dat");
+    EXPECT_EQ(store.UndoFilePath(12), fs::path("/foo") / "blocks" / "rev00012.dat");
+}
+
+TEST(BlockStoreTest, WriteAndRead)
+{
+    BlockStore store(CleanStorePath());
+    ASSERT_TRUE(store.Open());
+    EXPECT_TRUE(fs::is_directory(store.path_blocks()));
+    
+    std::vector<FlatFilePos> positions;
+    for (uint32_t i = 0; i < 10; i++) {
+        FlatFilePos pos;
+        ASSERT_TRUE(store.WriteBlock(TestBlock(i, i + 1), &pos));
+        EXPECT_EQ(pos.file, 0);
+        positions.push_back(pos);
+    }
+    EXPECT_EQ(positions[0].pos, BlockStore::kRecordHeaderSize);
+    
+    // readable before and after the sync
+    for (int flushed = 0; flushed < 2; flushed++) {
+        for (uint32_t i = 0; i < positions.size(); i++) {
+            consensus::Block expected = TestBlock(i, i + 1);
+            util::ByteSpan raw = store.ReadRawBlock(positions[i]);
+            std::vector<uint8_t> serialized = Serialized(expected);
+            ASSERT_EQ(raw, util::ByteSpan(serialized.data(), serialized.size()));
+    
+            consensus::Block block;
+            ASSERT_TRUE(store.ReadBlock(positions[i], &block));
+            EXPECT_EQ(block.GetHash(), expected.GetHash());
+            EXPECT_EQ(block.transactions().size(), i + 1);
+        }
+        ASSERT_TRUE(store.Flush());
+    }
+    
+    // nothing there
+    consensus::Block block;
+    EXPECT_TRUE(store.ReadRawBlock(FlatFilePos{ 0, 1 }).empty());
+    EXPECT_TRUE(store.ReadRawBlock(FlatFilePos{ 1, positions[0].pos }).empty());
+    EXPECT_TRUE(store.ReadRawBlock(FlatFilePos{ 0, positions[1].pos + 1 }).empty());
+    EXPECT_FALSE(store.ReadBlock(FlatFilePos{ 0, 1000000 }, &block));
+}
+
+TEST(BlockStoreTest, WitnessBlock)
+{
+    BlockStore store(CleanStorePath());
+    ASSERT_TRUE(store.Open());
+    
+    consensus::Block block = TestBlock(0);
+    std::pmr::vector<consensus::TxIn> inputs;
+    inputs.emplace_back(consensus::OutPoint(block.transactions()[0]->GetHash(), 0),
+                        consensus::Script(), consensus::TxIn::default_sequence_no,
+                        consensus::ScriptWitness(std::vector<std::vector<uint8_t> >{
+                            std::vector<uint8_t>(72, 0x30), std::vector<uint8_t>(33, 0x02) }));
+    std::pmr::vector<consensus::TxOut> outputs;
+    outputs.emplace_back(1000, consensus::Script(std::vector<uint8_t>(22, 0x14)));
+    std::vector<consensus::TransactionRef> transactions = block.transactions();
+    transactions.push_back(consensus::MakeTransactionRef(
+            consensus::Transaction(2, std::move(inputs), std::move(outputs), 0)));
+    block.set_transactions(std::move(transactions));
+    
+    FlatFilePos pos;
+    ASSERT_TRUE(store.WriteBlock(block, &pos));
+    EXPECT_EQ(store.ReadRawBlock(pos).size(), block.SerializedSize());
+    
+    consensus::Block read;
+    ASSERT_TRUE(store.ReadBlock(pos, &read));
+    ASSERT_EQ(read.transactions().size(), 2);
+    EXPECT_TRUE(read.transactions()[1]->HasWitness());
+    EXPECT_EQ(read.transactions()[1]->GetWitnessHash(), block.transactions()[1]->GetWitnessHash());
+    EXPECT_EQ(read.ComputeWitnessMerkleRoot(), block.ComputeWitnessMerkleRoot());
+}
+
+TEST(BlockStoreTest, NextFile)
+{
+    const size_t max_file_size = 4096;
+    BlockStore store(CleanStorePath(), max_file_size);
+    ASSERT_TRUE(store.Open());
+    
+    std::vector<FlatFilePos> positions;
+    for (uint32_t i = 0; i < 40; i++) {
+        FlatFilePos pos;
+        ASSERT_TRUE(store.WriteBlock(TestBlock(i), &pos));
+        positions.push_back(pos);
+    }
+    ASSERT_TRUE(store.Flush());
+    EXPECT_GT(store.last_file(), 1);
+    EXPECT_EQ(positions.back().file, store.last_file());
+    
+    // finished files are cut down to their records
+    for (uint32_t file = 0; file < store.last_file(); file++) {
+        size_t size = fs::file_size(store.BlockFilePath(file));
+        EXPECT_LE(size, max_file_size);
+        EXPECT_GT(size + Serialized(TestBlock(0)).size() + BlockStore::kRecordHeaderSize,
+                  max_file_size);
+    }
+    
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        consensus::Block block;
+        ASSERT_TRUE(store.ReadBlock(positions[i], &block));
+        EXPECT_EQ(block.header().nonce(), i);
+    }
+    
+    // too large for any file
+    FlatFilePos pos;
+    EXPECT_FALSE(store.WriteBlock(TestBlock(0, 100), &pos));
+}
+
+TEST(BlockStoreTest, Reopen)
+{
+    std::vector<FlatFilePos> positions;
+    {
+        BlockStore store(CleanStorePath(), 4096);
+        ASSERT_TRUE(store.Open());
+        for (uint32_t i = 0; i < 20; i++) {
+            FlatFilePos pos;
+            ASSERT_TRUE(store.WriteBlock(TestBlock(i), &pos));
+            positions.push_back(pos);
+        }
+    }
+    
+    // a record header torn by a crash
+    BlockStore store(kStorePath, 4096);
+    {
+        std::fstream file(store.BlockFilePath(positions.back().file),
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(positions.back().pos + Serialized(TestBlock(19)).size());
+        file.write("BRE", 3);
+    }
+    ASSERT_TRUE(store.Open());
+    EXPECT_EQ(store.last_file(), positions.back().file);
+    
+    FlatFilePos pos;
+    ASSERT_TRUE(store.WriteBlock(TestBlock(20), &pos));
+    EXPECT_EQ(pos.file, positions.back().file);
+    EXPECT_EQ(pos.pos, positions.back().pos + Serialized(TestBlock(19)).size() +
+              BlockStore::kRecordHeaderSize);
+    positions.push_back(pos);
+    
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        consensus::Block block;
+        ASSERT_TRUE(store.ReadBlock(positions[i], &block));
+        EXPECT_EQ(block.header().nonce(), i);
+    }
+}
+
+TEST(BlockStoreTest, Undo)
+{
+    BlockStore store(CleanStorePath(), 4096);
+    ASSERT_TRUE(store.Open());
+    
+    FlatFilePos block_pos;
+    ASSERT_TRUE(store.WriteBlock(TestBlock(0), &block_pos));
+    while (store.last_file() == 0)
+        ASSERT_TRUE(store.WriteBlock(TestBlock(1), &block_pos));
+    
+    // undo data goes next to its block, also into a finished file
+    const std::vector<uint8_t> undo0(1000, 0xaa), undo1(2000, 0xbb);
+    FlatFilePos pos0, pos1;
+    ASSERT_TRUE(store.WriteUndo(util::ByteSpan(undo0.data(), undo0.size()), 0, &pos0));
+    ASSERT_TRUE(store.WriteUndo(util::ByteSpan(undo1.data(), undo1.size()), 1, &pos1));
+    EXPECT_EQ(pos0.file, 0);
+    EXPECT_EQ(pos1.file, 1);
+    EXPECT_FALSE(store.WriteUndo(util::ByteSpan(undo0.data(), undo0.size()), 2, &pos0));
+    ASSERT_TRUE(store.Flush());
+    
+    EXPECT_EQ(store.ReadRawUndo(pos0), util::ByteSpan(undo0.data(), undo0.size()));
+    EXPECT_EQ(store.ReadRawUndo(pos1), util::ByteSpan(undo1.data(), undo1.size()));
+}
+
+} // namespace unit_test
+} // namespace btclite
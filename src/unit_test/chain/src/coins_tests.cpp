@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+
+#include "coins.h"
+#include "coins_db.h"
+#include "stream.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace chain;
+
+namespace {
+
+const fs::path kCoinsPath = fs::path("/tmp") / "coins_tests";
+
+// An in-memory base view that counts what reaches it.
+class TestCoinsView : public CoinsView {
+public:
+    bool GetCoin(const consensus::OutPoint& outpoint, Coin *coin) const override
+    {
+        auto it = coins_.find(outpoint);
+        if (it == coins_.end())
+            return false;
+        *coin = it->second;
+        return true;
+    }
+    
+    util::Hash256 GetBestBlock() const override
+    {
+        return best_block_;
+    }
+    
+    bool BatchWrite(CoinsMap *coins, const util::Hash256& best_block) override
+    {
+        for (auto& [outpoint, entry] : *coins) {
+            if (!(entry.flags & CoinsCacheEntry::kDirty))
+                continue;
+            writes_++;
+            if (entry.coin.IsSpent())
+                coins_.erase(outpoint);
+            else
+                coins_[outpoint] = entry.coin;
+        }
+        best_block_ = best_block;
+        return true;
+    }
+    
+    size_t size() const
+    {
+        return coins_.size();
+    }
+    
+    size_t writes() const
+    {
+        return writes_;
+    }
+
+private:
+    util::FlatHashMap<consensus::OutPoint, Coin, SaltedOutPointHasher> coins_;
+    util::Hash256 best_block_{};
+    size_t writes_ = 0;
+};
+
+consensus::OutPoint TestOutPoint(uint32_t n, uint32_t index = 0)
+{
+    util::Hash256 hash;
+    hash.fill(static_cast<uint8_t>(n));
+    hash[1] = static_cast<uint8_t>(n >> 8);
+    return consensus::OutPoint(hash, index);
+}
+
+Coin TestCoin(uint64_t value, size_t script_size = 25)
+{
+    std::vector<uint8_t> script(script_size, 0x76);
+    return Coin(consensus::TxOut(value, consensus::Script(script)), 100, false);
+}
+
+} // namespace
+
+TEST(CoinTest, Serialize)
+{
+    Coin coin(TestCoin(5000).out(), 123456, true);
+    util::MemoryStream ms;
+    ms << coin;
+    
+    Coin coin2;
+    EXPECT_TRUE(coin2.IsSpent());
+    ms >> coin2;
+    EXPECT_EQ(coin2, coin);
+    EXPECT_EQ(coin2.height(), 123456);
+    EXPECT_TRUE(coin2.coinbase());
+}
+
+TEST(CoinTest, Clear)
+{
+    Coin coin = TestCoin(5000, 100);
+    EXPECT_FALSE(coin.IsSpent());
+    EXPECT_GE(coin.DynamicMemoryUsage(), 100);
+    
+    coin.Clear();
+    EXPECT_TRUE(coin.IsSpent());
+    EXPECT_EQ(coin.DynamicMemoryUsage(), 0);
+}
+
+TEST(CoinsViewCacheTest, AddAndSpend)
+{
+    TestCoinsView base;
+    CoinsViewCache cache(&base);
+    
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(1), TestCoin(1), false));
+    EXPECT_TRUE(cache.HaveCoin(TestOutPoint(1)));
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(2)));
+    EXPECT_FALSE(cache.AddCoin(TestOutPoint(1), TestCoin(2), false));
+    EXPECT_TRUE(cache.AddCoin(TestOutPoint(1), TestCoin(2), true));
+    EXPECT_EQ(cache.AccessCoin(TestOutPoint(1))->out().value(), 2);
+    
+    // unspendable outputs are never stored
+    std::vector<uint8_t> op_return(1, static_cast<uint8_t>(consensus::Opcode::OP_RETURN));
+    Coin unspendable(consensus::TxOut(1, consensus::Script(op_return)), 1, false);
+    EXPECT_TRUE(cache.AddCoin(TestOutPoint(3), std::move(unspendable), false));
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(3)));
+    
+    Coin spent;
+    EXPECT_TRUE(cache.SpendCoin(TestOutPoint(1), &spent));
+    EXPECT_EQ(spent.out().value(), 2);
+    EXPECT_FALSE(cache.SpendCoin(TestOutPoint(1)));
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(1)));
+}
+
+TEST(CoinsViewCacheTest, FreshCoinsSkipTheBase)
+{
+    TestCoinsView base;
+    CoinsViewCache cache(&base);
+    util::Hash256 best_block;
+    best_block.fill(0x11);
+    
+    for (uint32_t i = 0; i < 100; i++)
+        ASSERT_TRUE(cache.AddCoin(TestOutPoint(i), TestCoin(i), false));
+    for (uint32_t i = 0; i < 50; i++)
+        ASSERT_TRUE(cache.SpendCoin(TestOutPoint(i)));
+    EXPECT_EQ(cache.CacheSize(), 50);
+    
+    cache.SetBestBlock(best_block);
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_EQ(cache.CacheSize(), 0);
+    EXPECT_EQ(base.writes(), 50);
+    EXPECT_EQ(base.size(), 50);
+    EXPECT_EQ(base.GetBestBlock(), best_block);
+    
+    // coins read back from the base are not fresh, spending them is written
+    for (uint32_t i = 50; i < 60; i++)
+        ASSERT_TRUE(cache.SpendCoin(TestOutPoint(i)));
+    EXPECT_TRUE(cache.HaveCoin(TestOutPoint(60)));
+    EXPECT_EQ(cache.CacheSize(), 11);
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_EQ(base.writes(), 60);
+    EXPECT_EQ(base.size(), 40);
+    EXPECT_EQ(cache.GetBestBlock(), best_block);
+    
+    // re-adding a spent coin that the base still has is not fresh
+    ASSERT_TRUE(cache.SpendCoin(TestOutPoint(70)));
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(70), TestCoin(7), false));
+    ASSERT_TRUE(cache.SpendCoin(TestOutPoint(70)));
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_EQ(base.size(), 39);
+}
+
+TEST(CoinsViewCacheTest, Uncache)
+{
+    TestCoinsView base;
+    CoinsViewCache cache(&base);
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(1), TestCoin(1), false));
+    ASSERT_TRUE(cache.Flush());
+    
+    EXPECT_TRUE(cache.HaveCoin(TestOutPoint(1)));
+    EXPECT_EQ(cache.CacheSize(), 1);
+    cache.Uncache(TestOutPoint(1));
+    EXPECT_EQ(cache.CacheSize(), 0);
+    
+    // changed entries stay
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(2), TestCoin(2), false));
+    cache.Uncache(TestOutPoint(2));
+    EXPECT_EQ(cache.CacheSize(), 1);
+}
+
+TEST(CoinsViewCacheTest, Stacked)
+{
+    TestCoinsView base;
+    CoinsViewCache cache(&base);
+    for (uint32_t i = 0; i < 10; i++)
+        ASSERT_TRUE(cache.AddCoin(TestOutPoint(i), TestCoin(i), false));
+    ASSERT_TRUE(cache.Flush());
+    for (uint32_t i = 10; i < 20; i++)
+        ASSERT_TRUE(cache.AddCoin(TestOutPoint(i), TestCoin(i), false));
+    
+    // a block's worth of changes made in a child cache
+    util::Hash256 best_block;
+    best_block.fill(0x22);
+    CoinsViewCache child(&cache);
+    ASSERT_TRUE(child.SpendCoin(TestOutPoint(1)));
+    ASSERT_TRUE(child.SpendCoin(TestOutPoint(11)));
+    ASSERT_TRUE(child.AddCoin(TestOutPoint(20), TestCoin(20), false));
+    ASSERT_TRUE(child.SpendCoin(TestOutPoint(20)));
+    ASSERT_TRUE(child.AddCoin(TestOutPoint(21), TestCoin(21), false));
+    child.SetBestBlock(best_block);
+    EXPECT_TRUE(cache.HaveCoin(TestOutPoint(11)));
+    ASSERT_TRUE(child.Flush());
+    
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(1)));
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(11)));
+    EXPECT_FALSE(cache.HaveCoin(TestOutPoint(20)));
+    EXPECT_TRUE(cache.HaveCoin(TestOutPoint(21)));
+    EXPECT_EQ(cache.GetBestBlock(), best_block);
+    
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_EQ(base.size(), 19);
+    EXPECT_EQ(base.GetBestBlock(), best_block);
+}
+
+TEST(CoinsViewCacheTest, MemoryUsage)
+{
+    TestCoinsView base;
+    CoinsViewCache cache(&base, 1 << 20);
+    EXPECT_EQ(cache.DynamicMemoryUsage(), 0);
+    EXPECT_FALSE(cache.NeedFlush());
+    
+    // scripts too long to be stored inline count too
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(0), TestCoin(0, 25), false));
+    size_t usage = cache.DynamicMemoryUsage();
+    EXPECT_GT(usage, 0);
+    ASSERT_TRUE(cache.AddCoin(TestOutPoint(1), TestCoin(1, 1000), false));
+    EXPECT_GE(cache.DynamicMemoryUsage(), usage + 1000);
+    ASSERT_TRUE(cache.SpendCoin(TestOutPoint(1)));
+    EXPECT_EQ(cache.DynamicMemoryUsage(), usage);
+    
+    uint32_t n = 2;
+    for (; !cache.NeedFlush(); n++)
+        ASSERT_TRUE(cache.AddCoin(TestOutPoint(n, n), TestCoin(n), false));
+    EXPECT_GT(cache.DynamicMemoryUsage(), cache.max_memory());
+    ASSERT_TRUE(cache.Flush());
+    EXPECT_EQ(cache.DynamicMemoryUsage(), 0);
+    EXPECT_EQ(base.size(), n - 1);
+}
+
+TEST(CoinsViewDbTest, WriteAndReopen)
+{
+    fs::remove_all(kCoinsPath);
+    util::Hash256 best_block;
+    best_block.fill(0x33);
+    {
+        CoinsViewDb db(kCoinsPath);
+        EXPECT_EQ(db.path_chainstate(), kCoinsPath / "chainstate");
+        ASSERT_TRUE(db.Open());
+        EXPECT_EQ(db.GetBestBlock(), crypto::null_hash);
+    
+        CoinsViewCache cache(&db);
+        for (uint32_t i = 0; i < 100; i++)
+            ASSERT_TRUE(cache.AddCoin(TestOutPoint(i, i), TestCoin(i, i), false));
+        cache.SetBestBlock(best_block);
+        ASSERT_TRUE(cache.Flush());
+    
+        for (uint32_t i = 0; i < 10; i++)
+            ASSERT_TRUE(cache.SpendCoin(TestOutPoint(i, i)));
+        ASSERT_TRUE(cache.Flush());
+    }
+    
+    CoinsViewDb db(kCoinsPath);
+    ASSERT_TRUE(db.Open());
+    EXPECT_EQ(db.GetBestBlock(), best_block);
+    for (uint32_t i = 0; i < 100; i++) {
+        Coin coin;
+        if (i < 10) {
+            EXPECT_FALSE(db.GetCoin(TestOutPoint(i, i), &coin));
+        }
+        else {
+            ASSERT_TRUE(db.GetCoin(TestOutPoint(i, i), &coin));
+            EXPECT_EQ(coin, TestCoin(i, i));
+        }
+    }
+    fs::remove_all(kCoinsPath);
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,393 @@
+#include "interpreter.h"
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "ecdsa.h"
+#include "hash.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+namespace {
+
+struct TestKey {
+    uint8_t seckey[32];
+    std::vector<uint8_t> pubkey;
+    
+    explicit TestKey(uint8_t fill)
+    {
+        std::memset(seckey, fill, sizeof(seckey));
+        crypto::EcdsaPublicKey(seckey, true, &pubkey);
+    }
+    
+    std::vector<uint8_t> Sign(const util::Hash256& sighash) const
+    {
+        std::vector<uint8_t> sig;
+        crypto::SignEcdsa(seckey, sighash, &sig);
+        sig.push_back(kSigHashAll);
+        return sig;
+    }
+};
+
+std::vector<uint8_t> ToBytes(const util::Hash160& hash)
+{
+    return std::vector<uint8_t>(hash.begin(), hash.end());
+}
+
+Script P2pkhScript(const std::vector<uint8_t>& pubkey)
+{
+    Script script;
+    script.Push(Opcode::OP_DUP);
+    script.Push(Opcode::OP_HASH160);
+    script.Push(ToBytes(crypto::hashfuncs::Hash160(pubkey)));
+    script.Push(Opcode::OP_EQUALVERIFY);
+    script.Push(Opcode::OP_CHECKSIG);
+    return script;
+}
+
+// One input spending an output of value to script_pub_key, one output.
+Transaction SpendingTx(uint64_t value, uint32_t lock_time = 0,
+                       uint32_t sequence_no = TxIn::default_sequence_no)
+{
+    std::pmr::vector<TxIn> inputs;
+    inputs.emplace_back(OutPoint(util::Hash256{ 1 }, 0), Script(), sequence_no);
+    std::pmr::vector<TxOut> outputs;
+    outputs.emplace_back(value, Script());
+    return Transaction(2, std::move(inputs), std::move(outputs), lock_time);
+}
+
+bool Eval(const Script& script, ScriptStack *stack, ScriptError *error,
+          uint32_t flags = kVerifyNone)
+{
+    return EvalScript(stack, script, flags, SignatureChecker(), SigVersion::kBase, error);
+}
+
+} // namespace
+
+TEST(ScriptIntTest, Encoding)
+{
+    EXPECT_TRUE(ScriptInt::BytesEncoding(0).empty());
+    EXPECT_EQ(ScriptInt::BytesEncoding(1), std::vector<uint8_t>{ 0x01 });
+    EXPECT_EQ(ScriptInt::BytesEncoding(-1), std::vector<uint8_t>{ 0x81 });
+    EXPECT_EQ(ScriptInt::BytesEncoding(127), std::vector<uint8_t>{ 0x7f });
+    EXPECT_EQ(ScriptInt::BytesEncoding(128), (std::vector<uint8_t>{ 0x80, 0x00 }));
+    EXPECT_EQ(ScriptInt::BytesEncoding(-255), (std::vector<uint8_t>{ 0xff, 0x80 }));
+    EXPECT_EQ(ScriptInt::BytesEncoding(0x100000000),
+              (std::vector<uint8_t>{ 0x00, 0x00, 0x00, 0x00, 0x01 }));
+    
+    for (int64_t n : { 0L, 1L, -1L, 255L, -256L, 0x7fffffffL, -0x7fffffffL })
+        EXPECT_EQ(ScriptInt(ScriptInt::BytesEncoding(n), true).value(), n);
+    
+    // five bytes only where asked for
+    const std::vector<uint8_t> five{ 0xff, 0xff, 0xff, 0xff, 0x00 };
+    EXPECT_THROW(ScriptInt(five, true), std::runtime_error);
+    EXPECT_EQ(ScriptInt(five, true, 5).value(), 0xffffffff);
+    
+    // zero padding and negative zero are not minimal
+    EXPECT_THROW(ScriptInt(std::vector<uint8_t>{ 0x01, 0x00 }, true), std::runtime_error);
+    EXPECT_THROW(ScriptInt(std::vector<uint8_t>{ 0x80 }, true), std::runtime_error);
+    EXPECT_EQ(ScriptInt(std::vector<uint8_t>{ 0x01, 0x00 }, false).value(), 1);
+}
+
+TEST(InterpreterTest, Arithmetic)
+{
+    ScriptStack stack;
+    ScriptError error;
+    Script script;
+    script.Push(2);
+    script.Push(3);
+    script.Push(Opcode::OP_ADD);
+    script.Push(ScriptInt(-5));
+    script.Push(Opcode::OP_SUB);
+    script.Push(10);
+    script.Push(Opcode::OP_NUMEQUAL);
+    
+    EXPECT_TRUE(Eval(script, &stack, &error));
+    EXPECT_EQ(error, ScriptError::kOk);
+    EXPECT_EQ(stack, ScriptStack{ { 1 } });
+    
+    // operands are 4 bytes at most, results may be longer
+    stack.clear();
+    script.clear();
+    script.Push(ScriptInt(0x7fffffff));
+    script.Push(Opcode::OP_DUP);
+    script.Push(Opcode::OP_ADD);
+    EXPECT_TRUE(Eval(script, &stack, &error));
+    script.Push(Opcode::OP_1ADD);
+    stack.clear();
+    EXPECT_FALSE(Eval(script, &stack, &error));
+    EXPECT_EQ(error, ScriptError::kUnknown);
+}
+
+TEST(InterpreterTest, Conditionals)
+{
+    ScriptStack stack;
+    ScriptError error;
+    Script script;
+    script.Push(0);
+    script.Push(Opcode::OP_IF);
+    script.Push(Opcode::OP_CAT);  // disabled, but never run
+    script.Push(Opcode::OP_ELSE);
+    script.Push(7);
+    script.Push(Opcode::OP_ENDIF);
+    
+    EXPECT_FALSE(Eval(script, &stack, &error));
+    EXPECT_EQ(error, ScriptError::kDisabledOpcode);
+    
+    script.clear();
+    script.Push(0);
+    script.Push(Opcode::OP_IF);
+    script.Push(Opcode::OP_RETURN);
+    script.Push(Opcode::OP_ELSE);
+    script.Push(7);
+    script.Push(Opcode::OP_ENDIF);
+    stack.clear();
+    EXPECT_TRUE(Eval(script, &stack, &error));
+    EXPECT_EQ(stack, ScriptStack{ { 7 } });
+    
+    script.clear();
+    script.Push(1);
+    script.Push(Opcode::OP_IF);
+    stack.clear();
+    EXPECT_FALSE(Eval(script, &stack, &error));
+    EXPECT_EQ(error, ScriptError::kUnbalancedConditional);
+    
+    script.clear();
+    script.Push(Opcode::OP_ENDIF);
+    stack.clear();
+    EXPECT_FALSE(Eval(script, &stack, &error));
+    EXPECT_EQ(error, ScriptError::kUnbalancedConditional);
+}
+
+TEST(InterpreterTest, P2pkh)
+{
+    const TestKey key(1), other(2);
+    const Script script_pub_key = P2pkhScript(key.pubkey);
+    const Transaction tx = SpendingTx(1000);
+    const TransactionSignatureChecker checker(&tx, 0, 1000);
+    const util::Hash256 sighash = SignatureHash(script_pub_key, tx, 0, kSigHashAll, 1000,
+                                                SigVersion::kBase);
+    ScriptError error;
+    
+    Script script_sig;
+    script_sig.Push(key.Sign(sighash));
+    script_sig.Push(key.pubkey);
+    EXPECT_TRUE(VerifyScript(script_sig, script_pub_key, ScriptWitness(), kVerifyNone,
+                             checker, &error));
+    EXPECT_EQ(error, ScriptError::kOk);
+    
+    // signed by the wrong key
+    script_sig.clear();
+    script_sig.Push(other.Sign(sighash));
+    script_sig.Push(key.pubkey);
+    EXPECT_FALSE(VerifyScript(script_sig, script_pub_key, ScriptWitness(), kVerifyNone,
+                              checker, &error));
+    EXPECT_EQ(error, ScriptError::kEvalFalse);
+    
+    // the wrong key
+    script_sig.clear();
+    script_sig.Push(other.Sign(sighash));
+    script_sig.Push(other.pubkey);
+    EXPECT_FALSE(VerifyScript(script_sig, script_pub_key, ScriptWitness(), kVerifyNone,
+                              checker, &error));
+    EXPECT_EQ(error, ScriptError::kEqualVerify);
+    
+    // a zero padded R is fine before BIP66 only
+    std::vector<uint8_t> sig = key.Sign(sighash);
+    sig.insert(sig.begin() + 4, 0x00);
+    sig[1]++;
+    sig[3]++;
+    script_sig.clear();
+    script_sig.Push(sig);
+    script_sig.Push(key.pubkey);
+    EXPECT_TRUE(VerifyScript(script_sig, script_pub_key, ScriptWitness(), kVerifyNone,
+                             checker, &error));
+    EXPECT_FALSE(VerifyScript(script_sig, script_pub_key, ScriptWitness(), kVerifyDerSig,
+                              checker, &error));
+    EXPECT_EQ(error, ScriptError::kSigDer);
+}
+
+TEST(InterpreterTest, P2shMultisig)
+{
+    const TestKey keys[3] = { TestKey(1), TestKey(2), TestKey(3) };
+    Script redeem;
+    redeem.Push(2);
+    for (const TestKey& key : keys)
+        redeem.Push(key.pubkey);
+    redeem.Push(3);
+    redeem.Push(Opcode::OP_CHECKMULTISIG);
+    
+    const std::vector<uint8_t> redeem_bytes(redeem.begin(), redeem.end());
+    Script script_pub_key;
+    script_pub_key.Push(Opcode::OP_HASH160);
+    script_pub_key.Push(ToBytes(crypto::hashfuncs::Hash160(redeem_bytes)));
+    script_pub_key.Push(Opcode::OP_EQUAL);
+    ASSERT_TRUE(script_pub_key.IsPayToScriptHash());
+    
+    const Transaction tx = SpendingTx(5000);
+    const TransactionSignatureChecker checker(&tx, 0, 5000);
+    const util::Hash256 sighash = SignatureHash(redeem, tx, 0, kSigHashAll, 5000,
+                                                SigVersion::kBase);
+    const uint32_t flags = kVerifyP2sh | kVerifyNullDummy;
+    ScriptError error;
+    
+    auto script_sig = [&](const std::vector<uint8_t>& dummy, size_t first, size_t second) {
+        Script script;
+        script.Push(dummy);
+        script.Push(keys[first].Sign(sighash));
+        script.Push(keys[second].Sign(sighash));
+        script.Push(redeem_bytes);
+        return script;
+    };
+    
+    EXPECT_TRUE(VerifyScript(script_sig({}, 0, 2), script_pub_key, ScriptWitness(), flags,
+                             checker, &error));
+    EXPECT_EQ(error, ScriptError::kOk);
+    
+    // signatures out of key order
+    EXPECT_FALSE(VerifyScript(script_sig({}, 2, 0), script_pub_key, ScriptWitness(), flags,
+                              checker, &error));
+    EXPECT_EQ(error, ScriptError::kEvalFalse);
+    
+    // BIP147
+    EXPECT_TRUE(VerifyScript(script_sig({ 1 }, 1, 2), script_pub_key, ScriptWitness(),
+                             kVerifyP2sh, checker, &error));
+    EXPECT_FALSE(VerifyScript(script_sig({ 1 }, 1, 2), script_pub_key, ScriptWitness(), flags,
+                              checker, &error));
+    EXPECT_EQ(error, ScriptError::kSigNullDummy);
+    
+    // without BIP16 only the hash is checked
+    Script wrong;
+    wrong.Push(redeem_bytes);
+    EXPECT_TRUE(VerifyScript(wrong, script_pub_key, ScriptWitness(), kVerifyNone,
+                             checker, &error));
+    EXPECT_FALSE(VerifyScript(wrong, script_pub_key, ScriptWitness(), flags, checker, &error));
+}
+
+TEST(InterpreterTest, P2wpkh)
+{
+    const TestKey key(1);
+    Script script_pub_key;
+    script_pub_key.Push(0);
+    script_pub_key.Push(ToBytes(crypto::hashfuncs::Hash160(key.pubkey)));
+    int version = -1;
+    std::vector<uint8_t> program;
+    ASSERT_TRUE(script_pub_key.IsWitnessProgram(&version, &program));
+    EXPECT_EQ(version, 0);
+    EXPECT_EQ(program.size(), 20);
+    
+    Transaction tx = SpendingTx(7000);
+    const Script script_code = P2pkhScript(key.pubkey);
+    util::Hash256 sighash = SignatureHash(script_code, tx, 0, kSigHashAll, 7000,
+                                          SigVersion::kWitnessV0);
+    ScriptWitness witness(std::vector<std::vector<uint8_t> >{ key.Sign(sighash), key.pubkey });
+    std::pmr::vector<TxIn> inputs = tx.inputs();
+    inputs[0].set_scriptWitness(witness);
+    tx.set_inputs(std::move(inputs));
+    
+    // the witness digest leaves the witness out, so the signature still holds
+    const PrecomputedTxData txdata(tx);
+    EXPECT_TRUE(txdata.ready);
+    EXPECT_EQ(SignatureHash(script_code, tx, 0, kSigHashAll, 7000, SigVersion::kWitnessV0,
+                            &txdata), sighash);
+    
+    const uint32_t flags = kVerifyP2sh | kVerifyWitness;
+    const TransactionSignatureChecker checker(&tx, 0, 7000, &txdata);
+    ScriptError error;
+    EXPECT_TRUE(VerifyScript(Script(), script_pub_key, witness, flags, checker, &error));
+    EXPECT_EQ(error, ScriptError::kOk);
+    
+    // the amount is signed
+    const TransactionSignatureChecker wrong_amount(&tx, 0, 7001, &txdata);
+    EXPECT_FALSE(VerifyScript(Script(), script_pub_key, witness, flags, wrong_amount, &error));
+    EXPECT_EQ(error, ScriptError::kEvalFalse);
+    
+    // segwit spends carry nothing in the script_sig
+    Script script_sig;
+    script_sig.Push(1);
+    EXPECT_FALSE(VerifyScript(script_sig, script_pub_key, witness, flags, checker, &error));
+    EXPECT_EQ(error, ScriptError::kWitnessMalleated);
+    
+    EXPECT_FALSE(VerifyScript(Script(), script_pub_key, ScriptWitness(), flags, checker, &error));
+    EXPECT_EQ(error, ScriptError::kWitnessProgramMismatch);
+    
+    // nor do other outputs carry a witness
+    const Script p2pkh = P2pkhScript(key.pubkey);
+    script_sig.clear();
+    script_sig.Push(key.Sign(SignatureHash(p2pkh, tx, 0, kSigHashAll, 7000, SigVersion::kBase)));
+    script_sig.Push(key.pubkey);
+    EXPECT_TRUE(VerifyScript(script_sig, p2pkh, ScriptWitness(), flags, checker, &error));
+    EXPECT_FALSE(VerifyScript(script_sig, p2pkh, witness, flags, checker, &error));
+    EXPECT_EQ(error, ScriptError::kWitnessUnexpected);
+}
+
+TEST(InterpreterTest, CheckLockTime)
+{
+    Script script;
+    script.Push(ScriptInt(500));
+    script.Push(Opcode::OP_CHECKLOCKTIMEVERIFY);
+    const uint32_t flags = kVerifyCheckLockTime;
+    ScriptStack stack;
+    ScriptError error;
+    
+    const Transaction locked = SpendingTx(1, 500, 0);
+    const TransactionSignatureChecker locked_checker(&locked, 0, 1);
+    EXPECT_TRUE(EvalScript(&stack, script, flags, locked_checker, SigVersion::kBase, &error));
+    
+    // too early
+    const Transaction early = SpendingTx(1, 499, 0);
+    const TransactionSignatureChecker early_checker(&early, 0, 1);
+    stack.clear();
+    EXPECT_FALSE(EvalScript(&stack, script, flags, early_checker, SigVersion::kBase, &error));
+    EXPECT_EQ(error, ScriptError::kUnsatisfiedLocktime);
+    
+    // a final input does not enforce the lock time
+    const Transaction final_tx = SpendingTx(1, 500);
+    const TransactionSignatureChecker final_checker(&final_tx, 0, 1);
+    stack.clear();
+    EXPECT_FALSE(EvalScript(&stack, script, flags, final_checker, SigVersion::kBase, &error));
+    
+    // a NOP before BIP65
+    stack.clear();
+    EXPECT_TRUE(EvalScript(&stack, script, kVerifyNone, early_checker, SigVersion::kBase, &error));
+    
+    script.clear();
+    script.Push(ScriptInt(-1));
+    script.Push(Opcode::OP_CHECKLOCKTIMEVERIFY);
+    stack.clear();
+    EXPECT_FALSE(EvalScript(&stack, script, flags, locked_checker, SigVersion::kBase, &error));
+    EXPECT_EQ(error, ScriptError::kNegativeLocktime);
+}
+
+TEST(InterpreterTest, ScriptCheck)
+{
+    const TestKey key(1);
+    const TxOut spent(1000, P2pkhScript(key.pubkey));
+    Transaction tx = SpendingTx(1000);
+    
+    Script script_sig;
+    script_sig.Push(key.Sign(SignatureHash(spent.script_pub_key(), tx, 0, kSigHashAll, 1000,
+                                           SigVersion::kBase)));
+    script_sig.Push(key.pubkey);
+    std::pmr::vector<TxIn> inputs = tx.inputs();
+    inputs[0].set_scriptSig(script_sig);
+    tx.set_inputs(std::move(inputs));
+    
+    const PrecomputedTxData txdata(tx);
+    ScriptCheck check(spent, tx, 0, kVerifyP2sh | kVerifyDerSig, &txdata);
+    EXPECT_EQ(check.error(), ScriptError::kUnknown);
+    EXPECT_TRUE(check());
+    EXPECT_EQ(check.error(), ScriptError::kOk);
+    
+    ScriptCheck wrong(TxOut(1000, P2pkhScript(TestKey(2).pubkey)), tx, 0, kVerifyP2sh, &txdata);
+    EXPECT_FALSE(wrong());
+    EXPECT_EQ(wrong.error(), ScriptError::kEqualVerify);
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include "hash.h"
+#include "merkle.h"
+#include "sha256.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+namespace {
+
+util::Hash256 NaiveMerkleRoot(std::vector<util::Hash256> hashes)
+{
+    while (hashes.size() > 1) {
+        std::vector<util::Hash256> parents;
+        if (hashes.size() % 2 != 0)
+            hashes.push_back(hashes.back());
+        for (size_t i = 0; i < hashes.size(); i += 2) {
+            std::vector<uint8_t> concat(hashes[i].begin(), hashes[i].end());
+            concat.insert(concat.end(), hashes[i+1].begin(), hashes[i+1].end());
+            util::Hash256 first = crypto::hashfuncs::Sha256(concat);
+            parents.push_back(crypto::hashfuncs::Sha256(first.data(), first.size()));
+        }
+        hashes.swap(parents);
+    }
+    
+    return hashes.front();
+}
+
+Block WitnessBlock(size_t num_txs)
+{
+    std::vector<TransactionRef> transactions;
+    
+    for (size_t i = 0; i < num_txs; i++) {
+        util::Hash256 prev_hash;
+        prev_hash.fill(static_cast<uint8_t>(i));
+        prev_hash[1] = static_cast<uint8_t>(i >> 8);
+        ScriptWitness witness(std::vector<std::vector<uint8_t> >{
+                                  std::vector<uint8_t>(72, static_cast<uint8_t>(i)) });
+        std::pmr::vector<TxIn> inputs;
+        inputs.emplace_back(OutPoint(prev_hash, 0), Script(), TxIn::default_sequence_no, witness);
+        std::pmr::vector<TxOut> outputs;
+        outputs.emplace_back(i, Script());
+        transactions.push_back(MakeTransactionRef(
+                                   Transaction(2, std::move(inputs), std::move(outputs), 0)));
+    }
+    
+    return Block(std::move(transactions));
+}
+
+std::vector<util::Hash256> Leaves(size_t count)
+{
+    std::vector<util::Hash256> leaves(count);
+    for (size_t i = 0; i < count; i++)
+        leaves[i].fill(static_cast<uint8_t>(i + 1));
+    
+    return leaves;
+}
+
+} // namespace
+
+TEST(MerkleTest, Block100000)
+{
+    std::vector<util::Hash256> leaves = {
+        util::StrToHash256("8c14f0db3df150123e6f3dbbf30f8b955a8249b62ac1d1ff16284aefa3d06d87"),
+        util::StrToHash256("fff2525b8931402dd09222c50775608f75787bd2b87e56995a7bdd30f79702c4"),
+        util::StrToHash256("6359f0868171b1d194cbee1af2f16ea598ae8fad666d9b012c8ed2b79a236ec4"),
+        util::StrToHash256("e9a66845e05d5abc0ad04ec80f774a7e585c6e8db975962d069a522137b80c1d")
+    };
+    bool mutated = true;
+    
+    EXPECT_EQ(ComputeMerkleRoot(std::move(leaves), &mutated),
+              util::StrToHash256("f3e94742aca4b5ef85488dc37c06c3282295ffec960994b2c0d5ac2a25a95766"));
+    EXPECT_FALSE(mutated);
+}
+
+TEST(MerkleTest, MatchesNaive)
+{
+    bool mutated = true;
+    
+    EXPECT_EQ(ComputeMerkleRoot(std::vector<util::Hash256>(), &mutated), util::Hash256());
+    EXPECT_FALSE(mutated);
+    
+    for (size_t count = 1; count <= 40; count++) {
+        std::vector<util::Hash256> leaves = Leaves(count);
+        util::Hash256 expected = NaiveMerkleRoot(leaves);
+        EXPECT_EQ(ComputeMerkleRoot(std::move(leaves), &mutated), expected) << "leaves=" << count;
+        EXPECT_FALSE(mutated);
+    }
+    
+    // the batched levels must not depend on the hashing backend
+    if (crypto::sha256::UseBackend(crypto::sha256::Backend::kStandard)) {
+        std::vector<util::Hash256> leaves = Leaves(37);
+        util::Hash256 expected = NaiveMerkleRoot(leaves);
+        EXPECT_EQ(ComputeMerkleRoot(std::move(leaves)), expected);
+        crypto::sha256::AutoDetect();
+    }
+}
+
+TEST(MerkleTest, DuplicateLastNodes)
+{
+    // [1,2,3,4,5,6] and [1,2,3,4,5,6,5,6] share the same root (CVE-2012-2459)
+    std::vector<util::Hash256> leaves = Leaves(6);
+    std::vector<util::Hash256> mutated_leaves = leaves;
+    mutated_leaves.push_back(leaves[4]);
+    mutated_leaves.push_back(leaves[5]);
+    bool mutated = true;
+    
+    util::Hash256 root = ComputeMerkleRoot(std::move(leaves), &mutated);
+    EXPECT_FALSE(mutated);
+    EXPECT_EQ(ComputeMerkleRoot(std::move(mutated_leaves), &mutated), root);
+    EXPECT_TRUE(mutated);
+    
+    // an odd tail duplicated by the algorithm itself is not a mutation
+    leaves = Leaves(5);
+    ComputeMerkleRoot(std::move(leaves), &mutated);
+    EXPECT_FALSE(mutated);
+    
+    // duplicated leaves
+    leaves = Leaves(4);
+    leaves.push_back(leaves.back());
+    leaves.push_back(leaves.back());
+    ComputeMerkleRoot(std::move(leaves), &mutated);
+    EXPECT_TRUE(mutated);
+}
+
+TEST(MerkleTest, WitnessMerkleRoot)
+{
+    Block block = WitnessBlock(2 * kParallelWitnessHashTxs + 3);
+    std::vector<util::Hash256> leaves;
+    
+    leaves.push_back(util::Hash256());
+    for (auto it = block.transactions().begin() + 1; it != block.transactions().end(); ++it)
+        leaves.push_back((*it)->GetWitnessHash());
+    util::Hash256 expected = NaiveMerkleRoot(leaves);
+    EXPECT_NE(expected, block.ComputeMerkleRoot());
+    
+    util::ThreadPool pool(4);
+    EXPECT_EQ(BlockWitnessMerkleRoot(block, nullptr), expected);
+    EXPECT_EQ(BlockWitnessMerkleRoot(block, &pool), expected);
+    EXPECT_EQ(block.ComputeWitnessMerkleRoot(), expected);
+    
+    Block small_block = WitnessBlock(3);
+    EXPECT_EQ(BlockWitnessMerkleRoot(small_block, &pool),
+              BlockWitnessMerkleRoot(small_block, nullptr));
+    EXPECT_EQ(BlockWitnessMerkleRoot(Block(), &pool), util::Hash256());
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "block.h"
+#include "compact.h"
+#include "pow.h"
+#include "string_encoding.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+namespace {
+
+// Hashes are displayed most significant byte first.
+util::Hash256 HashFromDisplayHex(const std::string& hex)
+{
+    std::vector<uint8_t> bytes = util::DecodeHex(hex);
+    util::Hash256 hash;
+    std::copy(bytes.rbegin(), bytes.rend(), hash.begin());
+    return hash;
+}
+
+} // namespace
+
+TEST(TargetCacheTest, Get)
+{
+    TargetCache cache;
+    const uint32_t bits[] = { 0x1d00ffff, 0x1b0404cb, 0x170f48e4, 0x01003456, 0x04923456, 0xff123456, 0 };
+    
+    for (uint32_t b : bits) {
+        EXPECT_EQ(cache.Get(b), TargetCache::Decode(b));
+        EXPECT_EQ(cache.Get(b), TargetCache::Decode(b));
+    }
+    EXPECT_EQ(cache.misses(), 6);
+    EXPECT_EQ(cache.hits(), 8);
+    
+    EXPECT_EQ(TargetCache::Decode(0x1d00ffff), Compact(0x1d00ffff).normal());
+    // negative and overflowed targets
+    EXPECT_EQ(TargetCache::Decode(0x04923456), 0);
+    EXPECT_EQ(TargetCache::Decode(0xff123456), 0);
+    
+    cache.Clear();
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.Get(0x1d00ffff), TargetCache::Decode(0x1d00ffff));
+    EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(TargetCacheTest, Collisions)
+{
+    TargetCache cache;
+    
+    // more distinct bits than slots, every answer must still be exact
+    for (int round = 0; round < 2; round++) {
+        for (uint32_t i = 0; i < 4 * TargetCache::kSlots; i++) {
+            uint32_t b = 0x1c000000 | (0x010000 + i * 977);
+            ASSERT_EQ(cache.Get(b), TargetCache::Decode(b));
+        }
+    }
+}
+
+TEST(TargetCacheTest, Concurrent)
+{
+    TargetCache cache;
+    std::vector<std::thread> threads;
+    std::atomic<int> errors{0};
+    
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, &errors, t]() {
+            for (uint32_t i = 0; i < 20000; i++) {
+                uint32_t b = 0x1b000000 | (0x008000 + ((i * 7 + t) % 1500) * 101);
+                if (cache.Get(b) != TargetCache::Decode(b))
+                    errors++;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    
+    EXPECT_EQ(errors, 0);
+    EXPECT_EQ(cache.hits() + cache.misses(), 80000);
+}
+
+TEST(PowTest, HashMeetsTarget)
+{
+    util::uint256_t target = util::uint256_t(0x1234) << 200;
+    util::Hash256 hash = target.ToHash256();
+    
+    EXPECT_TRUE(HashMeetsTarget(hash, target));
+    EXPECT_TRUE(HashMeetsTarget((target - 1).ToHash256(), target));
+    EXPECT_FALSE(HashMeetsTarget((target + 1).ToHash256(), target));
+    EXPECT_FALSE(HashMeetsTarget((target << 1).ToHash256(), target));
+    EXPECT_TRUE(HashMeetsTarget(util::uint256_t(0).ToHash256(), 0));
+}
+
+TEST(PowTest, CheckProofOfWork)
+{
+    // mainnet genesis
+    BlockHeader header(1, util::Hash256{},
+                       HashFromDisplayHex("4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"),
+                       1231006505, 0x1d00ffff, 2083236893);
+    util::Hash256 hash;
+    
+    EXPECT_TRUE(header.CheckProofOfWork(&hash));
+    EXPECT_EQ(hash, HashFromDisplayHex("000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f"));
+    EXPECT_EQ(hash, header.GetHash());
+    EXPECT_TRUE(CheckProofOfWork(hash, header.bits()));
+    
+    // a harder target than the genesis hash meets, then invalid bits
+    EXPECT_FALSE(CheckProofOfWork(hash, 0x1a00ffff));
+    EXPECT_FALSE(CheckProofOfWork(hash, 0x04923456));
+    EXPECT_FALSE(CheckProofOfWork(hash, 0));
+    
+    header.set_nonce(header.nonce() + 1);
+    EXPECT_FALSE(header.CheckProofOfWork(&hash));
+    EXPECT_EQ(hash, header.GetHash());
+}
+
+} // namespace unit_test
+} // namespace btclite
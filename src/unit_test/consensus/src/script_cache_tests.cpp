@@ -0,0 +1,91 @@
+#include "script_cache.h"
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "ecdsa.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+namespace {
+
+Transaction MakeTx(const ScriptWitness& witness = ScriptWitness())
+{
+    std::pmr::vector<TxIn> inputs;
+    inputs.emplace_back(OutPoint(util::Hash256{ 1 }, 0), Script(), TxIn::default_sequence_no,
+                        witness);
+    std::pmr::vector<TxOut> outputs;
+    outputs.emplace_back(1000, Script());
+    return Transaction(2, std::move(inputs), std::move(outputs), 0);
+}
+
+} // namespace
+
+TEST(ScriptCacheTest, Scripts)
+{
+    ScriptCache cache(1 << 20);
+    const Transaction tx = MakeTx();
+    const uint32_t flags = kVerifyP2sh | kVerifyWitness;
+    
+    EXPECT_FALSE(cache.HaveScripts(tx, flags));
+    cache.AddScripts(tx, flags);
+    EXPECT_TRUE(cache.HaveScripts(tx, flags));
+    // passing under other rules says nothing
+    EXPECT_FALSE(cache.HaveScripts(tx, flags | kVerifyDerSig));
+    
+    // nor does the same txid with another witness
+    const Transaction malleated = MakeTx(ScriptWitness(
+        std::vector<std::vector<uint8_t> >{ { 1 } }));
+    ASSERT_EQ(malleated.GetHash(), tx.GetHash());
+    EXPECT_FALSE(cache.HaveScripts(malleated, flags));
+    
+    // nor another cache, salted differently
+    ScriptCache other(1 << 20);
+    EXPECT_FALSE(other.HaveScripts(tx, flags));
+    
+    const util::CuckooCache::Stats stats = cache.script_stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.inserts, 1);
+    EXPECT_EQ(cache.signature_stats().hits + cache.signature_stats().misses, 0);
+}
+
+TEST(ScriptCacheTest, CachingSignatureChecker)
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 1, sizeof(seckey));
+    std::vector<uint8_t> pubkey;
+    ASSERT_TRUE(crypto::EcdsaPublicKey(seckey, true, &pubkey));
+    
+    const Transaction tx = MakeTx();
+    Script script_code;
+    script_code.Push(pubkey);
+    script_code.Push(Opcode::OP_CHECKSIG);
+    std::vector<uint8_t> sig;
+    ASSERT_TRUE(crypto::SignEcdsa(seckey, SignatureHash(script_code, tx, 0, kSigHashAll, 1000,
+                                                        SigVersion::kBase), &sig));
+    sig.push_back(kSigHashAll);
+    std::vector<uint8_t> bad_sig = sig;
+    bad_sig[10] ^= 1;
+    
+    ScriptCache cache(1 << 20);
+    const CachingSignatureChecker checker(&tx, 0, 1000, nullptr, &cache);
+    EXPECT_TRUE(checker.CheckSig(sig, pubkey, script_code, SigVersion::kBase));
+    EXPECT_TRUE(checker.CheckSig(sig, pubkey, script_code, SigVersion::kBase));
+    EXPECT_FALSE(checker.CheckSig(bad_sig, pubkey, script_code, SigVersion::kBase));
+    EXPECT_FALSE(checker.CheckSig(bad_sig, pubkey, script_code, SigVersion::kBase));
+    
+    // failures are checked every time, only the success is stored
+    const util::CuckooCache::Stats stats = cache.signature_stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.inserts, 1);
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,65 @@
+#include "script_witness.h"
+
+#include <gtest/gtest.h>
+
+#include "blob.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+TEST(ScriptWitnessTest, Items)
+{
+    const std::vector<std::vector<uint8_t> > stack{
+        {}, std::vector<uint8_t>(72, 0x30), std::vector<uint8_t>(33, 0x02) };
+    ScriptWitness witness(stack);
+    
+    EXPECT_FALSE(witness.IsNull());
+    ASSERT_EQ(witness.size(), 3);
+    EXPECT_TRUE(witness[0].empty());
+    EXPECT_EQ(witness[1].size(), 72);
+    EXPECT_EQ(witness[2][0], 0x02);
+    EXPECT_EQ(witness.ToStack(), stack);
+    
+    // one buffer for the items, the offsets stay inline
+    EXPECT_EQ(witness.allocated_memory(), 105);
+    
+    witness.Push(std::vector<uint8_t>{ 0x51 });
+    EXPECT_EQ(witness.size(), 4);
+    EXPECT_EQ(witness[3], util::ByteSpan(std::vector<uint8_t>{ 0x51 }.data(), 1));
+    EXPECT_NE(witness, ScriptWitness(stack));
+    
+    witness.Clear();
+    EXPECT_TRUE(witness.IsNull());
+    EXPECT_EQ(witness, ScriptWitness());
+}
+
+TEST(ScriptWitnessTest, Serialize)
+{
+    std::vector<std::vector<uint8_t> > stack;
+    for (size_t i = 0; i < 6; i++)
+        stack.emplace_back(i * 60, static_cast<uint8_t>(i));
+    
+    for (size_t n = 0; n <= stack.size(); n++) {
+        std::vector<std::vector<uint8_t> > sub(stack.begin(), stack.begin() + n);
+        ScriptWitness witness(sub);
+        
+        // BIP144 layout, as the nested vectors serialize
+        std::vector<uint8_t> vec, expected;
+        util::ByteSink<std::vector<uint8_t> > byte_sink(vec), expected_sink(expected);
+        witness.Serialize(byte_sink);
+        util::Serializer<util::ByteSink<std::vector<uint8_t> > >(expected_sink).SerialWrite(sub);
+        EXPECT_EQ(vec, expected);
+        
+        ScriptWitness witness2(std::vector<std::vector<uint8_t> >{ {0x01} });
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        witness2.Deserialize(byte_source);
+        EXPECT_EQ(witness2, witness);
+        EXPECT_EQ(witness2.ToStack(), sub);
+    }
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,14 @@
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+
+
+int main(int argc, char **argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_logtostderr = 1;
+    FLAGS_v = 1;
+    
+    testing::InitGoogleTest(&argc, argv);
+
+    // Runs all tests using Google Test.
+    return RUN_ALL_TESTS();
+}
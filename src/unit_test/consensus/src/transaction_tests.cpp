@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "blob.h"
+#include "block.h"
+#include "transaction.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace consensus;
+
+namespace {
+
+Transaction WitnessTx()
+{
+    util::Hash256 prev_hash;
+    prev_hash.fill(0x11);
+    ScriptWitness witness(std::vector<std::vector<uint8_t> >{
+                              std::vector<uint8_t>(72, 0x30),
+                              std::vector<uint8_t>(33, 0x02) });
+    std::pmr::vector<TxIn> inputs;
+    inputs.emplace_back(OutPoint(prev_hash, 0), Script(), TxIn::default_sequence_no, witness);
+    inputs.emplace_back(OutPoint(prev_hash, 1), Script());
+    std::pmr::vector<TxOut> outputs;
+    outputs.emplace_back(1000, Script(std::vector<uint8_t>(22, 0x14)));
+    
+    return Transaction(2, std::move(inputs), std::move(outputs), 0);
+}
+
+} // namespace
+
+TEST(OutPointTest, DefaultIsNull)
+{
+    // over memory that is not zero already
+    alignas(OutPoint) uint8_t buf[sizeof(OutPoint)];
+    std::memset(buf, 0xa5, sizeof(buf));
+    OutPoint *out_point = new (buf) OutPoint();
+    EXPECT_TRUE(out_point->IsNull());
+    out_point->~OutPoint();
+}
+
+TEST(TransactionTest, WitnessHashWithoutWitness)
+{
+    Transaction tx = WitnessTx();
+    std::pmr::vector<TxIn> inputs = tx.inputs();
+    
+    inputs[0].set_scriptWitness(ScriptWitness());
+    tx.set_inputs(std::move(inputs));
+    EXPECT_FALSE(tx.HasWitness());
+    EXPECT_EQ(tx.GetWitnessHash(), tx.GetHash());
+}
+
+TEST(TransactionTest, WitnessHash)
+{
+    Transaction tx = WitnessTx();
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    
+    ASSERT_TRUE(tx.HasWitness());
+    EXPECT_NE(tx.GetWitnessHash(), tx.GetHash());
+    
+    // wtxid is the double hash of the BIP144 serialization
+    tx.Serialize(byte_sink, true);
+    EXPECT_EQ(tx.GetWitnessHash(), crypto::hashfuncs::DoubleSha256(vec));
+    
+    // the cache is dropped when the witness changes
+    util::Hash256 wtxid = tx.GetWitnessHash();
+    std::pmr::vector<TxIn> inputs = tx.inputs();
+    inputs[1].set_scriptWitness(ScriptWitness(std::vector<std::vector<uint8_t> >{ {0x01} }));
+    tx.set_inputs(std::move(inputs));
+    EXPECT_NE(tx.GetWitnessHash(), wtxid);
+}
+
+TEST(TransactionTest, SerializeWitness)
+{
+    Transaction tx = WitnessTx();
+    std::vector<uint8_t> stripped, extended;
+    util::ByteSink<std::vector<uint8_t> > stripped_sink(stripped);
+    util::ByteSink<std::vector<uint8_t> > extended_sink(extended);
+    
+    tx.Serialize(stripped_sink);
+    tx.Serialize(extended_sink, true);
+    ASSERT_EQ(stripped.size(), tx.SerializedSize());
+    // marker, flag, witness stacks of 2 and 0 items
+    ASSERT_EQ(extended.size(), stripped.size() + 2 + (1 + 1 + 72 + 1 + 33) + 1);
+    EXPECT_EQ(extended[4], 0);
+    EXPECT_EQ(extended[5], 1);
+    
+    Transaction tx2;
+    util::ByteSource<std::vector<uint8_t> > extended_source(extended);
+    tx2.Deserialize(extended_source, true);
+    EXPECT_EQ(tx2.GetHash(), tx.GetHash());
+    EXPECT_EQ(tx2.GetWitnessHash(), tx.GetWitnessHash());
+    EXPECT_EQ(tx2.inputs()[0].script_witness(), tx.inputs()[0].script_witness());
+    EXPECT_TRUE(tx2.inputs()[1].script_witness().IsNull());
+    
+    Transaction tx3;
+    util::ByteSource<std::vector<uint8_t> > stripped_source(stripped);
+    tx3.Deserialize(stripped_source, true);
+    EXPECT_FALSE(tx3.HasWitness());
+    EXPECT_EQ(tx3.GetHash(), tx.GetHash());
+}
+
+TEST(TransactionTest, DeserializeBadWitnessFlag)
+{
+    Transaction tx = WitnessTx();
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    
+    tx.Serialize(byte_sink, true);
+    vec[5] = 0x02;
+    
+    util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+    Transaction tx2;
+    EXPECT_THROW(tx2.Deserialize(byte_source, true), std::ios_base::failure);
+}
+
+TEST(TransactionTest, HashCacheCopy)
+{
+    Transaction tx = WitnessTx();
+    util::Hash256 txid = tx.GetHash();
+    util::Hash256 wtxid = tx.GetWitnessHash();
+    
+    Transaction copied(tx);
+    EXPECT_EQ(copied.GetHash(), txid);
+    EXPECT_EQ(copied.GetWitnessHash(), wtxid);
+    
+    Transaction moved(std::move(copied));
+    EXPECT_EQ(moved.GetHash(), txid);
+    
+    Transaction assigned;
+    assigned = moved;
+    EXPECT_EQ(assigned.GetHash(), txid);
+    assigned.set_lockTime(1);
+    EXPECT_NE(assigned.GetHash(), txid);
+    EXPECT_EQ(moved.GetHash(), txid);
+}
+
+TEST(TransactionTest, ConcurrentGetHash)
+{
+    const TransactionRef tx = MakeTransactionRef(WitnessTx());
+    const util::Hash256 expected = Transaction(*tx).GetHash();
+    std::vector<util::Hash256> txids(8), wtxids(8);
+    std::vector<std::thread> threads;
+    
+    for (size_t i = 0; i < txids.size(); i++) {
+        threads.emplace_back([&tx, &txids, &wtxids, i]()
+        {
+            txids[i] = tx->GetHash();
+            wtxids[i] = tx->GetWitnessHash();
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    
+    for (size_t i = 0; i < txids.size(); i++) {
+        EXPECT_EQ(txids[i], expected);
+        EXPECT_EQ(wtxids[i], tx->GetWitnessHash());
+    }
+}
+
+TEST(TransactionTest, BlockSharesTransactions)
+{
+    std::vector<TransactionRef> transactions{ MakeTransactionRef(WitnessTx()) };
+    Block block(transactions);
+    Block copied(block);
+    
+    EXPECT_EQ(copied.transactions().front().get(), transactions.front().get());
+    
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    block.Serialize(byte_sink);
+    
+    Block block2;
+    util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+    block2.Deserialize(byte_source);
+    ASSERT_EQ(block2.transactions().size(), 1);
+    EXPECT_EQ(block2.transactions().front()->GetHash(), transactions.front()->GetHash());
+    
+    Block moved;
+    moved = std::move(copied);
+    EXPECT_EQ(moved.transactions().size(), 1);
+}
+
+TEST(TransactionTest, BlockArena)
+{
+    std::vector<TransactionRef> transactions{ MakeTransactionRef(WitnessTx()),
+                                              MakeTransactionRef(Transaction()) };
+    Block block(transactions);
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    block.Serialize(byte_sink);
+    
+    TransactionRef ref;
+    Transaction copied;
+    {
+        Block block2;
+        block2.set_useArena(true);
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        block2.Deserialize(byte_source);
+        ASSERT_EQ(block2.transactions().size(), 2);
+        EXPECT_EQ(block2.ComputeMerkleRoot(), block.ComputeMerkleRoot());
+        
+        ref = block2.transactions().front();
+        copied = *ref;
+        EXPECT_NE(copied.inputs().get_allocator(), ref->inputs().get_allocator());
+    }
+    
+    // the arena lives on with the ref taken from the dropped block
+    EXPECT_EQ(ref->GetHash(), transactions.front()->GetHash());
+    EXPECT_EQ(*ref, copied);
+    ref.reset();
+    EXPECT_EQ(copied.GetHash(), transactions.front()->GetHash());
+}
+
+TEST(TransactionTest, BlockWitnessRoundTrip)
+{
+    std::vector<TransactionRef> transactions{ MakeTransactionRef(Transaction()),
+                                              MakeTransactionRef(WitnessTx()) };
+    Block block(transactions);
+    std::vector<uint8_t> vec;
+    util::ByteSink<std::vector<uint8_t> > byte_sink(vec);
+    block.Serialize(byte_sink);
+    ASSERT_EQ(vec.size(), block.SerializedSize());
+    EXPECT_LT(block.SerializedSize(false), vec.size());
+    
+    for (bool use_arena : { false, true }) {
+        Block block2;
+        block2.set_useArena(use_arena);
+        util::ByteSource<std::vector<uint8_t> > byte_source(vec);
+        block2.Deserialize(byte_source);
+        ASSERT_EQ(block2.transactions().size(), 2);
+        EXPECT_TRUE(block2.transactions()[1]->HasWitness());
+        EXPECT_EQ(block2.transactions()[1]->GetWitnessHash(), transactions[1]->GetWitnessHash());
+        EXPECT_EQ(block2.ComputeMerkleRoot(), block.ComputeMerkleRoot());
+        EXPECT_EQ(block2.ComputeWitnessMerkleRoot(), block.ComputeWitnessMerkleRoot());
+        EXPECT_EQ(block2.SerializedSize(), vec.size());
+    }
+}
+
+} // namespace unit_test
+} // namespace btclite
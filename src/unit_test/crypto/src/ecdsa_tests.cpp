@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "ecdsa.h"
+#include "hash.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace crypto;
+
+namespace {
+
+// the order of the curve, big endian
+const uint8_t kOrder[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe,
+    0xba, 0xae, 0xdc, 0xe6, 0xaf, 0x48, 0xa0, 0x3b, 0xbf, 0xd2, 0x5e, 0x8c, 0xd0, 0x36, 0x41, 0x41
+};
+
+std::vector<uint8_t> DerInteger(const uint8_t *data, size_t size)
+{
+    while (size > 1 && data[0] == 0 && !(data[1] & 0x80)) {
+        data++;
+        size--;
+    }
+    std::vector<uint8_t> result{ 0x02 };
+    const bool pad = data[0] & 0x80;
+    result.push_back(static_cast<uint8_t>(size + pad));
+    if (pad)
+        result.push_back(0);
+    result.insert(result.end(), data, data + size);
+    return result;
+}
+
+std::vector<uint8_t> DerSignature(const std::vector<uint8_t>& r, const std::vector<uint8_t>& s)
+{
+    std::vector<uint8_t> result{ 0x30, static_cast<uint8_t>(r.size() + s.size()) };
+    result.insert(result.end(), r.begin(), r.end());
+    result.insert(result.end(), s.begin(), s.end());
+    return result;
+}
+
+} // namespace
+
+TEST(EcdsaTest, SignVerify)
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 0x11, sizeof(seckey));
+    const util::Hash256 hash = hashfuncs::Sha256(std::vector<uint8_t>{ 'a', 'b', 'c' });
+    util::Hash256 other = hash;
+    other[31] ^= 1;
+    
+    for (bool compressed : { true, false }) {
+        std::vector<uint8_t> pubkey, sig;
+        ASSERT_TRUE(EcdsaPublicKey(seckey, compressed, &pubkey));
+        EXPECT_EQ(pubkey.size(), compressed ? 33 : 65);
+        ASSERT_TRUE(SignEcdsa(seckey, hash, &sig));
+    
+        EXPECT_TRUE(VerifyEcdsa(pubkey, sig, hash));
+        EXPECT_FALSE(VerifyEcdsa(pubkey, sig, other));
+    
+        std::vector<uint8_t> bad_key = pubkey;
+        bad_key.pop_back();
+        EXPECT_FALSE(VerifyEcdsa(bad_key, sig, hash));
+        EXPECT_FALSE(VerifyEcdsa(pubkey, std::vector<uint8_t>(), hash));
+    }
+    
+    // not a key
+    std::memset(seckey, 0, sizeof(seckey));
+    std::vector<uint8_t> pubkey;
+    EXPECT_FALSE(EcdsaPublicKey(seckey, true, &pubkey));
+}
+
+TEST(EcdsaTest, LaxDer)
+{
+    uint8_t seckey[32];
+    std::memset(seckey, 0x22, sizeof(seckey));
+    const util::Hash256 hash = hashfuncs::Sha256(std::vector<uint8_t>{ 'x' });
+    std::vector<uint8_t> pubkey, sig;
+    ASSERT_TRUE(EcdsaPublicKey(seckey, true, &pubkey));
+    ASSERT_TRUE(SignEcdsa(seckey, hash, &sig));
+    
+    // 0x30 <length> R S, both integers tag, length and value
+    const size_t rlen = sig[3];
+    const std::vector<uint8_t> der_r(sig.begin() + 2, sig.begin() + 4 + rlen);
+    const std::vector<uint8_t> der_s(sig.begin() + 4 + rlen, sig.end());
+    const size_t slen = std::min<size_t>(der_s[1], 32);
+    uint8_t s[32] = {};
+    std::memcpy(s + 32 - slen, &*(der_s.end() - slen), slen);
+    EXPECT_EQ(DerSignature(der_r, DerInteger(s, 32)), sig);
+    
+    // a zero too many in R, as OpenSSL let through before BIP66
+    std::vector<uint8_t> padded_r{ 0x02, static_cast<uint8_t>(der_r[1] + 1), 0x00 };
+    padded_r.insert(padded_r.end(), der_r.begin() + 2, der_r.end());
+    EXPECT_TRUE(VerifyEcdsa(pubkey, DerSignature(padded_r, der_s), hash));
+    
+    // the high S twin of the signature
+    uint8_t high_s[32];
+    int borrow = 0;
+    for (int i = 31; i >= 0; i--) {
+        int diff = kOrder[i] - s[i] - borrow;
+        borrow = diff < 0;
+        high_s[i] = static_cast<uint8_t>(diff + (borrow ? 256 : 0));
+    }
+    EXPECT_TRUE(VerifyEcdsa(pubkey, DerSignature(der_r, DerInteger(high_s, 32)), hash));
+    high_s[31] ^= 1;
+    EXPECT_FALSE(VerifyEcdsa(pubkey, DerSignature(der_r, DerInteger(high_s, 32)), hash));
+    
+    // garbage after the integers, or cut short
+    std::vector<uint8_t> truncated = sig;
+    truncated.resize(sig.size() - 1);
+    EXPECT_FALSE(VerifyEcdsa(pubkey, truncated, hash));
+    std::vector<uint8_t> tagged = sig;
+    tagged[2] = 0x03;
+    EXPECT_FALSE(VerifyEcdsa(pubkey, tagged, hash));
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "hash.h"
+#include "string_encoding.h"
 #include "transaction.h"
 
 
@@ -38,6 +39,45 @@ TEST(HashOStreamTest, DoubleSha256)
     EXPECT_EQ(hs.DoubleSha256(), hash);
 }
 
+TEST(HashWriterTest, Sha256)
+{
+    Transaction tx;
+    HashWriter hw;
+    util::Hash256 hash({0x96,0xee,0xff,0x56,0x3b,0x31,0x35,0xe3,
+                         0xf7,0x79,0x64,0xe8,0xc0,0x62,0x32,0x8f,
+                         0xd2,0x07,0xc8,0xbc,0x9e,0x75,0x4f,0xc4,
+                         0x23,0xab,0xaf,0x83,0xeb,0x3f,0x14,0x90});
+    
+    tx.set_version(1);    
+    hw << tx;
+    EXPECT_EQ(hw.Size(), tx.SerializedSize());
+    EXPECT_EQ(hw.Sha256(), hash);
+    
+    // writer is reset after finalizing
+    EXPECT_EQ(hw.Size(), 0);
+    hw << tx;
+    EXPECT_EQ(hw.Sha256(), hash);
+}
+
+TEST(HashWriterTest, DoubleSha256)
+{
+    Transaction tx;
+    HashWriter hw;
+    util::Hash256 hash({0x43,0xec,0x7a,0x57,0x9f,0x55,0x61,0xa4,
+                         0x2a,0x7e,0x96,0x37,0xad,0x41,0x56,0x67,
+                         0x27,0x35,0xa6,0x58,0xbe,0x27,0x52,0x18,
+                         0x18,0x01,0xf7,0x23,0xba,0x33,0x16,0xd2});
+    
+    tx.set_version(1);    
+    hw << tx;
+    EXPECT_EQ(hw.DoubleSha256(), hash);
+    
+    hw << tx;
+    hw.Clear();
+    hw << tx;
+    EXPECT_EQ(hw.DoubleSha256(), hash);
+}
+
 TEST(HashTest, Sha256)
 {
     Transaction tx;
@@ -68,6 +108,17 @@ TEST(HashTest, DoubleSha256)
     EXPECT_EQ(hashfuncs::DoubleSha256(hs.vec().data(), hs.vec().size()), hash);
 }
 
+TEST(HashTest, Hash160)
+{
+    const std::string abc = "abc";
+    const uint8_t *in = reinterpret_cast<const uint8_t*>(abc.data());
+    auto hex = [](const util::Hash160& hash) { return util::EncodeHex(hash.begin(), hash.end()); };
+    
+    EXPECT_EQ(hex(hashfuncs::Ripemd160(in, abc.size())), "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+    EXPECT_EQ(hex(hashfuncs::Sha1(in, abc.size())), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(hex(hashfuncs::Hash160(std::vector<uint8_t>())),
+              "b472a266d0bd89c13706a4132ccfb16f7c3b9fcb");
+}
 
 TEST(SipHasherTest, Constructor1)
 {
@@ -87,6 +138,40 @@ TEST(SipHasherTest, Constructor2)
     ASSERT_EQ(tag, 0xb0bc17a3d48ce99a);
 }
 
+TEST(SipHasherTest, SipHashUint256)
+{
+    util::Hash256 val;
+    for (size_t i = 0; i < val.size(); i++)
+        val[i] = static_cast<uint8_t>(i * 31 + 7);
+    
+    SipHasher sip_hasher(0x0706050403020100, 0x0f0e0d0c0b0a0908);
+    uint64_t expected = sip_hasher.Update(val.data(), val.size()).Final();
+    EXPECT_EQ(SipHashUint256(0x0706050403020100, 0x0f0e0d0c0b0a0908, val), expected);
+    EXPECT_EQ(SipHashUint256(0x0706050403020100, 0x0f0e0d0c0b0a0908, val), 0x4b1990b93a53e1e6);
+    
+    // independently salted hashers disagree
+    SaltedHash256Hasher hasher1, hasher2;
+    EXPECT_EQ(hasher1(val), hasher1(val));
+    EXPECT_NE(hasher1(val), hasher2(val));
+}
+
+TEST(SipHasherTest, SipHashUint256Extra)
+{
+    util::Hash256 val;
+    for (size_t i = 0; i < val.size(); i++)
+        val[i] = static_cast<uint8_t>(i * 31 + 7);
+    const uint8_t extra[4] = { 0x78, 0x56, 0x34, 0x12 };
+    
+    SipHasher sip_hasher(0x0706050403020100, 0x0f0e0d0c0b0a0908);
+    uint64_t expected = sip_hasher.Update(val.data(), val.size()).Update(extra, sizeof(extra)).Final();
+    EXPECT_EQ(SipHashUint256Extra(0x0706050403020100, 0x0f0e0d0c0b0a0908, val, 0x12345678),
+              expected);
+    EXPECT_EQ(SipHashUint256Extra(0x0706050403020100, 0x0f0e0d0c0b0a0908, val, 0x12345678),
+              0xdf6d43f58a7fec04);
+    EXPECT_NE(SipHashUint256Extra(0x0706050403020100, 0x0f0e0d0c0b0a0908, val, 0),
+              SipHashUint256(0x0706050403020100, 0x0f0e0d0c0b0a0908, val));
+}
+
 
 TEST(GetHashTest, GetHash)
 {
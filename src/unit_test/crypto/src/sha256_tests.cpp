@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include "hash.h"
+#include "sha256.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace crypto;
+
+TEST(Sha256Test, DoubleSha256D64)
+{
+    const sha256::Backend backends[] = { sha256::Backend::kStandard,
+                                         sha256::Backend::kSse4,
+                                         sha256::Backend::kAvx2,
+                                         sha256::Backend::kShaNi };
+    
+    // enough blocks to cover the 8-way, 4-way and scalar tails
+    for (size_t blocks = 1; blocks <= 17; blocks++) {
+        std::vector<uint8_t> in(64 * blocks);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = static_cast<uint8_t>(i * 7 + blocks);
+        
+        std::vector<util::Hash256> expected;
+        for (size_t i = 0; i < blocks; i++) {
+            util::Hash256 first = hashfuncs::Sha256(&in[64 * i], 64);
+            expected.push_back(hashfuncs::Sha256(first.data(), first.size()));
+        }
+        
+        for (sha256::Backend backend : backends) {
+            if (!sha256::UseBackend(backend))
+                continue;
+            std::vector<util::Hash256> out(blocks);
+            sha256::DoubleSha256D64(out[0].data(), in.data(), blocks);
+            EXPECT_EQ(out, expected) << sha256::BackendName(backend) << " blocks=" << blocks;
+        }
+    }
+    sha256::AutoDetect();
+}
+
+TEST(Sha256Test, DoubleSha256D80)
+{
+    for (int n = 0; n < 16; n++) {
+        std::vector<uint8_t> in(80);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = static_cast<uint8_t>(i * 13 + n);
+        
+        util::Hash256 out;
+        sha256::DoubleSha256D80(out.data(), in.data());
+        EXPECT_EQ(out, hashfuncs::DoubleSha256(in));
+    }
+}
+
+TEST(Sha256Test, DoubleSha256Routing)
+{
+    std::vector<uint8_t> in(64, 0xab);
+    util::Hash256 first = hashfuncs::Sha256(in);
+    
+    EXPECT_EQ(hashfuncs::DoubleSha256(in), hashfuncs::Sha256(first.data(), first.size()));
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -8,8 +8,11 @@
 
 #include "btcnet.h"
 #include "constants.h"
+#include "msg_process.h"
 #include "network_address.h"
 #include "network/include/params.h"
+#include "protocol/pong.h"
+#include "protocol/version.h"
 
 
 namespace btclite {
@@ -34,6 +37,50 @@ protected:
     network::NetAddr addr_;
 };
 
+class MsgFramingTest : public MsgProcessTest {
+protected:
+    void SetUp() override
+    {
+        MsgProcessTest::SetUp();
+        bufferevent_enable(pair_[0], EV_READ);
+        bufferevent_enable(pair_[1], EV_READ);
+        node_ = std::make_shared<network::Node>(pair_[0], addr_, false);
+        node_->mutable_protocol()->version = network::protocol::kProtocolVersion;
+        node_->mutable_connection()->set_connection_state(
+            network::NodeConnection::kEstablished);
+    }
+    
+    void TearDown() override
+    {
+        util::SingletonTimerMng::GetInstance().StopTimer(node_->timers().no_sending_timer);
+        node_->mutable_timers()->no_sending_timer.reset();
+    }
+    
+    // sent by the peer at the other end of the pair
+    void Receive(const uint8_t *data, size_t size)
+    {
+        bufferevent_write(pair_[1], data, size);
+    }
+    
+    bool Parse()
+    {
+        return network::ParseMsg(node_, params_, network::LocalService(), &peers_,
+                                 &chain_state_);
+    }
+    
+    size_t PongsSent() const
+    {
+        using namespace network::protocol;
+        return evbuffer_get_length(bufferevent_get_input(pair_[1])) /
+               (MessageHeader::kSize + Pong(0).SerializedSize());
+    }
+    
+    network::Params params_{ BtcNet::kTestNet, util::Args(), fs::path("/tmp/foo") };
+    network::Peers peers_;
+    chain::ChainState chain_state_;
+    std::shared_ptr<network::Node> node_;
+};
+
 
 } // namespace unit_test
 } // namespace btclit
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <event2/event.h>
+#include <event2/bufferevent.h>
+#include <event2/buffer.h>
+#include <event2/thread.h>
+#include <arpa/inet.h>
+
+#include "msg_process.h"
+#include "msg_processor.h"
+#include "network/include/params.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+class MsgProcessorTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        // the processing threads enable reads again
+        evthread_use_pthreads();
+        base_ = event_base_new();
+        addr_.SetIpv4(inet_addr("1.2.3.4"));
+    }
+    
+    void TearDown() override
+    {
+        nodes_.clear();
+        for (struct bufferevent *bev : peer_ends_)
+            bufferevent_free(bev);
+        if (base_)
+            event_base_free(base_);
+    }
+    
+    // a node reading from a bufferevent pair, whose other end is the peer's
+    std::shared_ptr<network::Node> NewNode()
+    {
+        struct bufferevent *pair[2] = {};
+        if (bufferevent_pair_new(base_, BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE, pair) != 0)
+            return nullptr;
+        bufferevent_enable(pair[0], EV_READ);
+        bufferevent_enable(pair[1], EV_READ);
+        peer_ends_.push_back(pair[1]);
+        nodes_.push_back(std::make_shared<network::Node>(pair[0], addr_, false));
+        nodes_.back()->mutable_connection()->set_connection_state(
+            network::NodeConnection::kEstablished);
+    
+        return nodes_.back();
+    }
+    
+    // waits for pred, for a second at most
+    template <typename Pred>
+    static bool WaitFor(Pred pred)
+    {
+        for (int i = 0; i < 1000 && !pred(); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return pred();
+    }
+    
+    struct event_base *base_ = nullptr;
+    network::NetAddr addr_;
+    network::Params params_{ BtcNet::kTestNet, util::Args(), fs::path("/tmp/foo") };
+    std::vector<struct bufferevent*> peer_ends_;
+    std::vector<std::shared_ptr<network::Node> > nodes_;
+};
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include <event2/bufferevent.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "reactor.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+class ReactorsTest : public ::testing::Test {
+protected:
+    ReactorsTest()
+        : reactors_(2) {}
+    
+    void SetUp() override
+    {
+        ASSERT_TRUE(reactors_.InitEvent());
+        reactors_.StartEventLoops();
+    }
+    
+    void TearDown() override
+    {
+        reactors_.ExitEventLoops();
+        reactors_.Join();
+    }
+    
+    network::Reactors reactors_;
+};
+
+} // namespace unit_test
+} // namespace btclite
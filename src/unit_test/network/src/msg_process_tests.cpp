@@ -354,6 +354,39 @@ TEST_F(MsgProcessTest, SendReject)
 }
 #endif
 
+TEST_F(MsgProcessTest, ParseMsgData)
+{
+    Params params(BtcNet::kTestNet, util::Args(), fs::path("/tmp/foo"));
+    Peers peers;
+    chain::ChainState chain_state;
+    auto node = std::make_shared<Node>(pair_[0], addr_, false);
+    node->mutable_protocol()->version = kInvalidCbNoBanVersion;
+    node->mutable_connection()->set_connection_state(NodeConnection::kEstablished);
+    
+    Inv inv;
+    inv.mutable_inv_vects()->emplace_back(kMsgTx, util::RandHash256());
+    util::MemoryStream ms;
+    ms << inv;
+    MessageHeader header(kTestnetMagic, msg_command::kMsgInv, ms.Size(),
+                         util::FromLittleEndian<uint32_t>(inv.GetHash().data()));
+    EXPECT_TRUE(ParseMsgData(ms.Data(), node, header, params, LocalService(),
+                             &peers, &chain_state));
+    
+    // a known command without a handler, and an unknown one
+    header.set_command(msg_command::kMsgHeaders);
+    EXPECT_FALSE(ParseMsgData(ms.Data(), node, header, params, LocalService(),
+                              &peers, &chain_state));
+    header.set_command("foo");
+    EXPECT_FALSE(ParseMsgData(ms.Data(), node, header, params, LocalService(),
+                              &peers, &chain_state));
+    
+    // a payload not matching the checksum
+    header.set_command(msg_command::kMsgInv);
+    header.set_checksum(header.checksum() + 1);
+    EXPECT_FALSE(ParseMsgData(ms.Data(), node, header, params, LocalService(),
+                              &peers, &chain_state));
+}
+
 void ParseMsgCb(struct bufferevent *bev, void *ctx)
 {
     Peers peers;
@@ -378,5 +411,94 @@ TEST_F(MsgProcessTest, ParseMsg)
     event_base_dispatch(base_);
 }
 
+namespace {
+
+template <typename Message>
+void AppendMsg(const Message& msg, std::vector<uint8_t> *stream)
+{
+    util::MemoryStream ms;
+    ms << MessageHeader(kTestnetMagic, msg.Command(), msg.SerializedSize(),
+                        util::FromLittleEndian<uint32_t>(msg.GetHash().data()))
+       << msg;
+    stream->insert(stream->end(), ms.Data(), ms.Data() + ms.Size());
+}
+
+// kPings pings, each answered with a pong, between an inv and a sendheaders,
+// which has no payload at all
+constexpr size_t kPings = 16;
+
+std::vector<uint8_t> MixedStream()
+{
+    std::vector<uint8_t> stream;
+    Inv inv;
+    inv.mutable_inv_vects()->emplace_back(kMsgTx, util::RandHash256());
+    
+    for (size_t i = 0; i < kPings; i++) {
+        AppendMsg(inv, &stream);
+        AppendMsg(Ping(util::RandUint64(), kProtocolVersion), &stream);
+        AppendMsg(SendHeaders(), &stream);
+    }
+    
+    return stream;
+}
+
+} // namespace
+
+TEST_F(MsgFramingTest, ByteAtATime)
+{
+    const std::vector<uint8_t> stream = MixedStream();
+    // bytes received when the first inv's header is complete
+    const size_t header_complete = MessageHeader::kSize;
+    
+    for (size_t i = 0; i < stream.size(); i++) {
+        Receive(&stream[i], 1);
+        ASSERT_TRUE(Parse());
+    
+        // the first inv's header was taken off the buffer once complete,
+        // and its payload waits for the rest
+        if (i + 1 == header_complete) {
+            EXPECT_EQ(node_->framing().state, NodeFraming::kPayloadPending);
+        }
+        if (i + 1 == header_complete + 1) {
+            EXPECT_EQ(evbuffer_get_length(bufferevent_get_input(pair_[0])), 1);
+        }
+    }
+    
+    EXPECT_EQ(node_->framing().state, NodeFraming::kHeaderPending);
+    EXPECT_EQ(evbuffer_get_length(bufferevent_get_input(pair_[0])), 0);
+    EXPECT_EQ(PongsSent(), kPings);
+}
+
+TEST_F(MsgFramingTest, Fragments)
+{
+    const std::vector<uint8_t> stream = MixedStream();
+    
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        const size_t size = std::min<size_t>(1 + util::RandUint64() % 100,
+                                             stream.size() - pos);
+        Receive(&stream[pos], size);
+        ASSERT_TRUE(Parse());
+        pos += size;
+    }
+    
+    EXPECT_EQ(node_->framing().state, NodeFraming::kHeaderPending);
+    EXPECT_EQ(evbuffer_get_length(bufferevent_get_input(pair_[0])), 0);
+    EXPECT_EQ(PongsSent(), kPings);
+}
+
+TEST_F(MsgFramingTest, BadHeader)
+{
+    std::vector<uint8_t> stream;
+    AppendMsg(Ping(util::RandUint64(), kProtocolVersion), &stream);
+    
+    // the magic is checked as soon as the header is in, not the payload
+    stream[0] ^= 1;
+    Receive(stream.data(), MessageHeader::kSize);
+    EXPECT_FALSE(Parse());
+    EXPECT_TRUE(node_->connection().IsDisconnected());
+    EXPECT_FALSE(Parse());
+}
+
 } // namespace unit_test
 } // namespace btclit
@@ -0,0 +1,197 @@
+#include "msg_processor_tests.h"
+
+#include <future>
+
+#include "protocol/ping.h"
+#include "random.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace network;
+using namespace network::protocol;
+
+namespace {
+
+ReceivedMsg NumberedMsg(uint8_t n)
+{
+    ReceivedMsg msg;
+    msg.payload.assign(1, n);
+    
+    return msg;
+}
+
+struct ReadContext {
+    const Params *pparams;
+    MsgProcessor *processor;
+    std::shared_ptr<Node> node;
+};
+
+void QueueMsgsCb(struct bufferevent *bev, void *ctx)
+{
+    auto *context = reinterpret_cast<ReadContext*>(ctx);
+    QueueMsgs(context->node, *context->pparams, context->processor);
+}
+
+} // namespace
+
+TEST_F(MsgProcessorTest, InOrderPerPeer)
+{
+    std::mutex mutex;
+    std::vector<uint8_t> handled;
+    std::shared_ptr<Node> node = NewNode();
+    ASSERT_NE(node, nullptr);
+    
+    {
+        MsgProcessor processor([&](const std::shared_ptr<Node>&, const ReceivedMsg& msg) {
+            std::lock_guard<std::mutex> lock(mutex);
+            handled.push_back(msg.payload[0]);
+            return true;
+        }, 4);
+    
+        for (int i = 0; i < 200; i++)
+            EXPECT_TRUE(processor.Push(node, NumberedMsg(i)));
+        ASSERT_TRUE(WaitFor([&]{ return processor.stats().processed == 200; }));
+    
+        MsgProcessor::Stats stats = processor.stats();
+        EXPECT_EQ(stats.queued_msgs, 0);
+        EXPECT_EQ(stats.queued_bytes, 0);
+        EXPECT_GE(stats.max_queued_bytes, 1);
+        EXPECT_EQ(stats.pauses, 0);
+    }
+    
+    ASSERT_EQ(handled.size(), 200);
+    for (int i = 0; i < 200; i++)
+        EXPECT_EQ(handled[i], uint8_t(i));
+}
+
+TEST_F(MsgProcessorTest, PeersTakeTurns)
+{
+    std::mutex mutex;
+    std::vector<NodeId> handled;
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::shared_ptr<Node> busy = NewNode();
+    std::shared_ptr<Node> quiet = NewNode();
+    ASSERT_TRUE(busy && quiet);
+    
+    MsgProcessor processor([&](const std::shared_ptr<Node>& node, const ReceivedMsg&) {
+        opened.wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        handled.push_back(node->id());
+        return true;
+    }, 1);
+    
+    // the one processing thread is held on busy's first message while the
+    // rest queue up behind it
+    processor.Push(busy, NumberedMsg(0));
+    ASSERT_TRUE(WaitFor([&]{ return processor.stats().ready_peers == 0; }));
+    for (int i = 1; i < 32; i++)
+        processor.Push(busy, NumberedMsg(i));
+    processor.Push(quiet, NumberedMsg(0));
+    processor.Push(quiet, NumberedMsg(1));
+    EXPECT_EQ(processor.stats().ready_peers, 1);
+    EXPECT_EQ(processor.stats().queued_msgs, 34);
+    
+    gate.set_value();
+    ASSERT_TRUE(WaitFor([&]{ return processor.stats().processed == 34; }));
+    
+    // quiet is done by the fourth message, not after all of busy's
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(handled.size(), 34);
+    const std::vector<NodeId> first(handled.begin(), handled.begin() + 4);
+    EXPECT_EQ(first, std::vector<NodeId>({ busy->id(), quiet->id(), busy->id(), quiet->id() }));
+}
+
+TEST_F(MsgProcessorTest, PausesReadsOverBudget)
+{
+    constexpr size_t kPings = 6;
+    std::mutex mutex;
+    std::vector<uint64_t> handled;
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::shared_ptr<Node> node = NewNode();
+    ASSERT_NE(node, nullptr);
+    struct bufferevent *bev = node->mutable_connection()->mutable_bev();
+    
+    // two pings with their headers fit, the third goes over
+    constexpr size_t kPingSize = MessageHeader::kSize + 8;
+    MsgProcessor processor([&](const std::shared_ptr<Node>&, const ReceivedMsg& msg) {
+        opened.wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        handled.push_back(util::FromLittleEndian<uint64_t>(msg.payload.data()));
+        return true;
+    }, 1, 2 * kPingSize + kPingSize / 2);
+    ReadContext ctx = { &params_, &processor, node };
+    bufferevent_setcb(bev, QueueMsgsCb, nullptr, nullptr, &ctx);
+    
+    std::vector<uint64_t> nonces;
+    util::MemoryStream ms;
+    for (size_t i = 0; i < kPings; i++) {
+        nonces.push_back(util::RandUint64());
+        Ping ping(nonces.back(), kProtocolVersion);
+        ms << MessageHeader(params_.msg_magic(), ping.Command(), ping.SerializedSize(),
+                            util::FromLittleEndian<uint32_t>(ping.GetHash().data()))
+           << ping;
+    }
+    bufferevent_write(peer_ends_.back(), ms.Data(), ms.Size());
+    event_base_loop(base_, EVLOOP_NONBLOCK);
+    
+    // the rest stays unread in the input buffer
+    MsgProcessor::Stats stats = processor.stats();
+    EXPECT_EQ(stats.queued_msgs, 3);
+    EXPECT_EQ(stats.paused_peers, 1);
+    EXPECT_EQ(stats.pauses, 1);
+    EXPECT_FALSE(bufferevent_get_enabled(bev) & EV_READ);
+    EXPECT_EQ(evbuffer_get_length(bufferevent_get_input(bev)), ms.Size() / 2);
+    EXPECT_TRUE(QueueMsgs(node, params_, &processor));
+    EXPECT_EQ(processor.stats().queued_msgs, 3);
+    
+    // draining resumes reads, and the deferred read callback frames the rest
+    gate.set_value();
+    ASSERT_TRUE(WaitFor([&]{
+        event_base_loop(base_, EVLOOP_NONBLOCK);
+        return processor.stats().processed == kPings;
+    }));
+    ASSERT_TRUE(WaitFor([&]{ return processor.stats().paused_peers == 0; }));
+    
+    EXPECT_TRUE(bufferevent_get_enabled(bev) & EV_READ);
+    EXPECT_EQ(evbuffer_get_length(bufferevent_get_input(bev)), 0);
+    EXPECT_GE(processor.stats().pauses, 1);
+    EXPECT_EQ(processor.stats().max_queued_bytes, 3 * kPingSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(handled, nonces);
+}
+
+// Messages with nothing in them count toward the budget too.
+TEST_F(MsgProcessorTest, PausesOnEmptyMsgs)
+{
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    std::shared_ptr<Node> node = NewNode();
+    ASSERT_NE(node, nullptr);
+    struct bufferevent *bev = node->mutable_connection()->mutable_bev();
+    
+    MsgProcessor processor([&](const std::shared_ptr<Node>&, const ReceivedMsg&) {
+        opened.wait();
+        return true;
+    }, 1, 100 * MessageHeader::kSize);
+    
+    size_t pushed = 0;
+    while (processor.Push(node, ReceivedMsg()) && pushed < 1000)
+        pushed++;
+    EXPECT_EQ(pushed, 100);
+    EXPECT_EQ(processor.stats().paused_peers, 1);
+    EXPECT_EQ(processor.stats().queued_bytes, 101 * MessageHeader::kSize);
+    EXPECT_FALSE(bufferevent_get_enabled(bev) & EV_READ);
+    
+    gate.set_value();
+    ASSERT_TRUE(WaitFor([&]{ return processor.stats().processed == 101; }));
+    ASSERT_TRUE(WaitFor([&]{ return processor.stats().paused_peers == 0; }));
+    EXPECT_EQ(processor.stats().queued_bytes, 0);
+    EXPECT_TRUE(bufferevent_get_enabled(bev) & EV_READ);
+}
+
+} // namespace unit_test
+} // namespace btclite
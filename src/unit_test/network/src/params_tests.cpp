@@ -1,10 +1,12 @@
 #include "network/include/params.h"
 
 #include <gtest/gtest.h>
+#include <thread>
 #include <vector>
 
 #include "btcnet.h"
 #include "constants.h"
+#include "fullnode/include/config.h"
 
 
 namespace btclite {
@@ -49,5 +51,16 @@ TEST(NetworkParamsTest, Constructor)
     EXPECT_EQ(0, network_params4.seeds().size());
 }
 
+TEST(NetworkParamsTest, Reactors)
+{
+    util::Args args;
+    Params params(BtcNet::kTestNet, args, fs::path("/tmp/foo"));
+    EXPECT_EQ(params.reactors(), std::max(1u, std::thread::hardware_concurrency()));
+    
+    args.SetArg(FULLNODE_OPTION_REACTORS, "3");
+    Params params2(BtcNet::kTestNet, args, fs::path("/tmp/foo"));
+    EXPECT_EQ(params2.reactors(), 3);
+}
+
 } // namespace unit_test
 } // namespace btclite
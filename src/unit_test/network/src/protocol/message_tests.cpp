@@ -1,5 +1,7 @@
 #include "protocol/message_tests.h"
 
+#include "protocol/ping.h"
+#include "protocol/send_headers.h"
 #include "stream.h"
 
 
@@ -100,6 +102,24 @@ TEST_F(MessageHeaderTest, ValidateHeader)
     EXPECT_FALSE(header1_.IsValid());
 }
 
+TEST_F(MessageHeaderTest, CommandCode)
+{
+    static_assert(PackCommand("ping") == CommandCode{ 0x676e6970, 0 }, "");
+    static_assert(PackCommand("sendheaders") != PackCommand("sendheader"), "");
+    
+    EXPECT_EQ(header1_.command_code(), CommandCode());
+    EXPECT_EQ(header2_.command_code(), PackCommand(msg_command::kMsgVersion));
+    
+    header1_.set_command(msg_command::kMsgSendHeaders);
+    EXPECT_EQ(header1_.command_code(), PackCommand(msg_command::kMsgSendHeaders));
+    EXPECT_NE(header1_.command_code(), PackCommand(msg_command::kMsgSendCmpct));
+    
+    // only the first 12 characters fit in a header
+    header1_.set_command("barbarbarbarbar");
+    EXPECT_EQ(header1_.command_code(), PackCommand("barbarbarbarbar"));
+    EXPECT_EQ(header1_.command_code(), PackCommand("barbarbarbar"));
+}
+
 TEST_F(MessageHeaderTest, Serialize)
 {
     std::vector<uint8_t> vec;
@@ -111,5 +131,17 @@ TEST_F(MessageHeaderTest, Serialize)
     EXPECT_EQ(header1_, header2_);
 }
 
+TEST(PayloadChecksumTest, MatchesGetHash)
+{
+    Ping ping(0x1122334455667788);
+    util::MemoryStream ms;
+    ms << ping;
+    
+    EXPECT_EQ(PayloadChecksum(ms.Data(), ms.Size()),
+              util::FromLittleEndian<uint32_t>(ping.GetHash().data()));
+    EXPECT_EQ(PayloadChecksum(nullptr, 0),
+              util::FromLittleEndian<uint32_t>(SendHeaders().GetHash().data()));
+}
+
 } // namespace unit_test
 } // namespace btclite
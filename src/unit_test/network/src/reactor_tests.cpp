@@ -0,0 +1,109 @@
+#include "reactor_tests.h"
+
+#include <future>
+
+#include "msg_process.h"
+#include "protocol/ping.h"
+#include "random.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace network;
+using namespace network::protocol;
+
+TEST_F(ReactorsTest, RunInLoop)
+{
+    Reactor *reactor = reactors_.At(0);
+    std::vector<int> ran;
+    std::set<std::thread::id> threads;
+    std::promise<void> done;
+    
+    EXPECT_FALSE(reactor->IsInLoopThread());
+    for (int i = 0; i < 100; i++) {
+        reactor->RunInLoop([&, i] {
+            // already there, run right away
+            reactor->RunInLoop([&, i] { ran.push_back(i); });
+            threads.insert(std::this_thread::get_id());
+            if (i == 99)
+                done.set_value();
+        });
+    }
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    
+    ASSERT_EQ(ran.size(), 100);
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(ran[i], i);
+    ASSERT_EQ(threads.size(), 1);
+    EXPECT_NE(*threads.begin(), std::this_thread::get_id());
+}
+
+TEST_F(ReactorsTest, LeastLoaded)
+{
+    int fds[2][2];
+    struct bufferevent *bevs[2];
+    
+    EXPECT_EQ(reactors_.Size(), 2);
+    EXPECT_EQ(reactors_.LeastLoaded(), reactors_.At(0));
+    
+    // a peer reading on the first, the second gets the next
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]), 0);
+        Reactor *reactor = reactors_.LeastLoaded();
+        EXPECT_EQ(reactor, reactors_.At(i));
+        bevs[i] = bufferevent_socket_new(reactor->base(), fds[i][0],
+                                         BEV_OPT_THREADSAFE | BEV_OPT_CLOSE_ON_FREE);
+        ASSERT_NE(bevs[i], nullptr);
+        bufferevent_enable(bevs[i], EV_READ);
+    }
+    EXPECT_EQ(reactors_.At(0)->Load(), reactors_.At(1)->Load());
+    
+    bufferevent_free(bevs[0]);
+    EXPECT_EQ(reactors_.LeastLoaded(), reactors_.At(0));
+    
+    bufferevent_free(bevs[1]);
+    close(fds[0][1]);
+    close(fds[1][1]);
+}
+
+TEST_F(ReactorsTest, WriteOnOwningReactor)
+{
+    constexpr size_t kPings = 8;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    Reactor *reactor = reactors_.LeastLoaded();
+    struct bufferevent *bev = bufferevent_socket_new(reactor->base(), fds[0],
+                                                     BEV_OPT_THREADSAFE | BEV_OPT_CLOSE_ON_FREE);
+    ASSERT_NE(bev, nullptr);
+    auto node = std::make_shared<Node>(bev, NetAddr(), false);
+    node->mutable_connection()->set_reactor(reactor);
+    
+    // sent from here, written by the reactor, in order
+    std::vector<uint64_t> nonces;
+    for (size_t i = 0; i < kPings; i++) {
+        nonces.push_back(util::RandUint64());
+        ASSERT_TRUE(SendMsg(Ping(nonces.back(), kProtocolVersion), kTestnetMagic, node));
+    }
+    
+    const size_t msg_size = MessageHeader::kSize + Ping(0, kProtocolVersion).SerializedSize();
+    std::vector<uint8_t> received(kPings * msg_size);
+    struct timeval timeout = { 1, 0 };
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    for (size_t size = 0; size < received.size(); ) {
+        ssize_t n = read(fds[1], received.data() + size, received.size() - size);
+        ASSERT_GT(n, 0);
+        size += n;
+    }
+    for (size_t i = 0; i < kPings; i++) {
+        const uint8_t *msg = received.data() + i * msg_size;
+        EXPECT_EQ(MessageHeader(msg).command(), msg_command::kMsgPing);
+        EXPECT_EQ(util::FromLittleEndian<uint64_t>(msg + MessageHeader::kSize), nonces[i]);
+    }
+    
+    node->StopAllTimers();
+    close(fds[1]);
+}
+
+} // namespace unit_test
+} // namespace btclite
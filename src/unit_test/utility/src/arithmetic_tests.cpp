@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <random>
+
 #include "arithmetic.h"
 
 
@@ -31,5 +33,79 @@ TEST(Hash256, StrToHash256)
     EXPECT_DEATH(StrToHash256("0x123x456"), "");
 }
 
+namespace {
+
+using BoostUint256 = boost::multiprecision::uint256_t;
+
+BoostUint256 ToBoost(const ArithUint256& a)
+{
+    BoostUint256 result = 0;
+    for (int i = ArithUint256::kLimbs - 1; i >= 0; i--) {
+        result <<= 64;
+        result |= a.limb(i);
+    }
+    return result;
+}
+
+// Random values with a random number of significant bits.
+ArithUint256 RandUint256(std::mt19937_64& rng)
+{
+    Hash256 hash;
+    for (auto& byte : hash)
+        byte = static_cast<uint8_t>(rng());
+    return ArithUint256::FromHash256(hash) >> (rng() % 256);
+}
+
+} // namespace
+
+TEST(ArithUint256Test, Constexpr)
+{
+    constexpr ArithUint256 one(1);
+    constexpr ArithUint256 max = ~ArithUint256();
+    static_assert((max + one) == 0, "wraps around");
+    static_assert((one << 255).bits() == 256, "bits");
+    static_assert((max / (ArithUint256(0xffff) << 208)).GetLow64() == 0x100010001, "divide");
+    static_assert((one << 100) > (one << 99) && (one << 64) - one == ~uint64_t{0}, "compare");
+    
+    EXPECT_THROW(one / ArithUint256(), std::overflow_error);
+}
+
+TEST(ArithUint256Test, Hash256)
+{
+    Hash256 hash = StrToHash256("00000000000000000000000000000000000000000000000000000000000000ff");
+    EXPECT_EQ(ArithUint256::FromHash256(hash), ArithUint256(0xff));
+    EXPECT_EQ(ArithUint256::FromHash256(hash).ToHash256(), hash);
+    EXPECT_EQ((ArithUint256(0x1234) << 240).GetHex(),
+              "1234000000000000000000000000000000000000000000000000000000000000");
+}
+
+TEST(ArithUint256Test, MatchesBoost)
+{
+    const BoostUint256 mask = ~BoostUint256(0);
+    std::mt19937_64 rng(42);
+    
+    for (int i = 0; i < 2000; i++) {
+        ArithUint256 a = RandUint256(rng), b = RandUint256(rng);
+        BoostUint256 ba = ToBoost(a), bb = ToBoost(b);
+        unsigned int shift = rng() % 300;
+        
+        EXPECT_EQ(ToBoost(a + b), (ba + bb) & mask);
+        EXPECT_EQ(ToBoost(a - b), (ba - bb) & mask);
+        EXPECT_EQ(ToBoost(~a), ~ba);
+        EXPECT_EQ(ToBoost(a << shift), shift < 256 ? BoostUint256((ba << shift) & mask) : 0);
+        EXPECT_EQ(ToBoost(a >> shift), shift < 256 ? BoostUint256(ba >> shift) : 0);
+        EXPECT_EQ(a < b, ba < bb);
+        EXPECT_EQ(a == b, ba == bb);
+        EXPECT_EQ(a.bits(), ba == 0 ? 0 : boost::multiprecision::msb(ba) + 1);
+        if (b != 0) {
+            EXPECT_EQ(ToBoost(a / b), ba / bb);
+        }
+        // the shape of GetBlockProof
+        if (a + 1 != 0) {
+            EXPECT_EQ(ToBoost(~a / (a + 1)), (~ba & mask) / (ba + 1));
+        }
+    }
+}
+
 } // namespace unit_test
 } // namespace btclite
@@ -0,0 +1,49 @@
+#include "blob.h"
+
+#include <gtest/gtest.h>
+
+#include "stream.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+TEST(SpanSourceTest, Read)
+{
+    const uint8_t raw[] = { 0x1, 0x2, 0x3, 0x4, 0x5 };
+    util::ByteSpanSource byte_source(raw, sizeof(raw));
+    char buf[4] = {};
+    
+    EXPECT_EQ(byte_source.read(buf, 2), 2);
+    EXPECT_EQ(buf[0], 0x1);
+    EXPECT_EQ(buf[1], 0x2);
+    EXPECT_EQ(byte_source.remaining(), 3);
+    
+    // never reads beyond the range
+    EXPECT_EQ(byte_source.read(buf, 4), 3);
+    EXPECT_EQ(buf[2], 0x5);
+    EXPECT_EQ(byte_source.remaining(), 0);
+    EXPECT_EQ(byte_source.read(buf, 1), -1);
+}
+
+TEST(SpanSourceTest, Deserialize)
+{
+    util::MemoryStream ms;
+    std::string str_input = "hello world", str_output;
+    std::vector<uint8_t> vec_input = { 1, 2, 3 }, vec_output;
+    uint32_t num = 0;
+    
+    ms << 0x12345678u << str_input << vec_input;
+    util::ByteSpanSource byte_source(ms.Data(), ms.Size());
+    util::Deserializer<util::ByteSpanSource> deserializer(byte_source);
+    deserializer.SerialRead(&num);
+    deserializer.SerialRead(&str_output);
+    deserializer.SerialRead(&vec_output);
+    EXPECT_EQ(num, 0x12345678u);
+    EXPECT_EQ(str_output, str_input);
+    EXPECT_EQ(vec_output, vec_input);
+    EXPECT_EQ(byte_source.remaining(), 0);
+}
+
+} // namespace unit_test
+} // namespace btclit
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <set>
+
+#include "check_queue.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace util;
+
+namespace {
+
+std::atomic<int> checks_run(0);
+
+struct CountingCheck {
+    bool pass = true;
+    
+    bool operator()()
+    {
+        checks_run++;
+        return pass;
+    }
+};
+
+// Records the thread it ran on, slowly enough for the others to steal.
+struct SlowCheck {
+    std::mutex *mutex = nullptr;
+    std::set<std::thread::id> *threads = nullptr;
+    
+    bool operator()()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::lock_guard<std::mutex> lock(*mutex);
+        threads->insert(std::this_thread::get_id());
+        return true;
+    }
+};
+
+} // namespace
+
+TEST(CheckQueueTest, Batches)
+{
+    CheckQueue<CountingCheck> queue(3);
+    EXPECT_EQ(queue.workers(), 3);
+    
+    // empty, few and many checks at once
+    EXPECT_TRUE(queue.Wait());
+    for (size_t count : { 1, 3, 1000 }) {
+        checks_run = 0;
+        for (int i = 0; i < 10; i++)
+            queue.Add(std::vector<CountingCheck>(count));
+        EXPECT_TRUE(queue.Wait());
+        EXPECT_EQ(checks_run, 10 * count);
+    }
+}
+
+TEST(CheckQueueTest, Failure)
+{
+    CheckQueue<CountingCheck> queue(2);
+    
+    // all of the batch is dropped or run, never some left behind
+    std::vector<CountingCheck> checks(10000);
+    checks[10].pass = false;
+    queue.Add(std::move(checks));
+    EXPECT_FALSE(queue.Wait());
+    
+    // the next batch starts over
+    queue.Add(std::vector<CountingCheck>(100));
+    EXPECT_TRUE(queue.Wait());
+    
+    // on the waiting thread alone the order is known, nothing runs after
+    // the failure
+    CheckQueue<CountingCheck> single(0);
+    checks_run = 0;
+    checks.assign(10000, CountingCheck());
+    checks[10].pass = false;
+    single.Add(std::move(checks));
+    EXPECT_FALSE(single.Wait());
+    EXPECT_EQ(checks_run, 11);
+}
+
+TEST(CheckQueueTest, Steal)
+{
+    CheckQueue<SlowCheck> queue(3);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    
+    // fewer checks than threads, all to one deque
+    std::vector<SlowCheck> checks(3, SlowCheck{ &mutex, &threads });
+    queue.Add(std::move(checks));
+    EXPECT_TRUE(queue.Wait());
+    EXPECT_GT(threads.size(), 1);
+}
+
+TEST(CheckQueueTest, Control)
+{
+    CheckQueue<CountingCheck> queue(2);
+    
+    checks_run = 0;
+    {
+        // waits on the way out
+        CheckQueueControl<CountingCheck> control(&queue);
+        control.Add(std::vector<CountingCheck>(500));
+    }
+    EXPECT_EQ(checks_run, 500);
+    EXPECT_TRUE(queue.Wait());
+    
+    // without a queue the checks run as they are added
+    CheckQueueControl<CountingCheck> control(nullptr);
+    std::vector<CountingCheck> checks(3);
+    checks[1].pass = false;
+    control.Add(std::move(checks));
+    EXPECT_TRUE(control.failed());
+    EXPECT_FALSE(control.Wait());
+}
+
+} // namespace unit_test
+} // namespace btclite
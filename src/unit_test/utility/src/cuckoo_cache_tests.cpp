@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "cuckoo_cache.h"
+#include "random.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace util;
+
+TEST(CuckooCacheTest, ContainsInserted)
+{
+    CuckooCache cache(1 << 20);
+    EXPECT_EQ(cache.capacity(), (1 << 20) / 32);
+    
+    std::vector<Hash256> keys;
+    for (int i = 0; i < 1000; i++)
+        keys.push_back(RandHash256());
+    for (size_t i = 0; i < keys.size(); i += 2)
+        cache.Insert(keys[i]);
+    // a second insert is a no-op
+    cache.Insert(keys[0]);
+    
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ(cache.Contains(keys[i]), i % 2 == 0);
+    
+    CuckooCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 500);
+    EXPECT_EQ(stats.misses, 500);
+    EXPECT_EQ(stats.inserts, 500);
+    EXPECT_EQ(stats.evictions, 0);
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 0.5);
+    
+    cache.Clear();
+    EXPECT_FALSE(cache.Contains(keys[0]));
+    EXPECT_EQ(cache.stats().misses, 501);
+}
+
+TEST(CuckooCacheTest, Full)
+{
+    // the minimum, kWays slots per stripe
+    CuckooCache cache(0);
+    ASSERT_EQ(cache.capacity(), CuckooCache::kWays * CuckooCache::kStripes);
+    
+    std::vector<Hash256> keys;
+    for (size_t i = 0; i < 4 * cache.capacity(); i++) {
+        keys.push_back(RandHash256());
+        cache.Insert(keys.back());
+    }
+    
+    // room for no more than capacity(), the rest were dropped
+    size_t found = 0;
+    for (const Hash256& key : keys)
+        found += cache.Contains(key);
+    EXPECT_LE(found, cache.capacity());
+    EXPECT_GT(found, cache.capacity() / 2);
+    EXPECT_EQ(cache.stats().evictions, keys.size() - found);
+}
+
+TEST(CuckooCacheTest, Threads)
+{
+    CuckooCache cache(1 << 20);
+    std::vector<std::vector<Hash256> > keys(4);
+    for (auto& thread_keys : keys)
+        for (int i = 0; i < 2000; i++)
+            thread_keys.push_back(RandHash256());
+    
+    std::vector<std::thread> threads;
+    for (const auto& thread_keys : keys)
+        threads.emplace_back([&cache, &thread_keys]() {
+            for (const Hash256& key : thread_keys) {
+                cache.Insert(key);
+                cache.Contains(key);
+            }
+        });
+    for (std::thread& thread : threads)
+        thread.join();
+    
+    const CuckooCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.inserts, 8000);
+    EXPECT_EQ(stats.hits + stats.misses, 8000);
+    for (const auto& thread_keys : keys)
+        for (const Hash256& key : thread_keys)
+            EXPECT_TRUE(cache.Contains(key));
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "flat_hash_map.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using namespace util;
+
+namespace {
+
+// Keeps colliding tags and groups likely with small tables.
+struct PoorHash {
+    size_t operator()(uint64_t key) const
+    {
+        return key % 97;
+    }
+};
+
+} // namespace
+
+TEST(FlatHashMapTest, Basic)
+{
+    FlatHashMap<int, std::string> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), map.end());
+    EXPECT_EQ(map.count(1), 0);
+    
+    EXPECT_TRUE(map.insert(std::make_pair(1, "one")).second);
+    EXPECT_FALSE(map.insert(std::make_pair(1, "uno")).second);
+    map[2] = "two";
+    EXPECT_TRUE(map.try_emplace(3, 5, 'x').second);
+    
+    EXPECT_EQ(map.size(), 3);
+    EXPECT_EQ(map.at(1), "one");
+    EXPECT_EQ(map.find(2)->second, "two");
+    EXPECT_EQ(map[3], "xxxxx");
+    EXPECT_THROW(map.at(4), std::out_of_range);
+    
+    EXPECT_EQ(map.erase(2), 1);
+    EXPECT_EQ(map.erase(2), 0);
+    EXPECT_FALSE(map.contains(2));
+    EXPECT_EQ(map.size(), 2);
+    
+    FlatHashMap<int, std::string> copy(map);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(copy.size(), 2);
+    EXPECT_EQ(copy.at(3), "xxxxx");
+    
+    FlatHashMap<int, std::string> moved(std::move(copy));
+    EXPECT_EQ(moved.size(), 2);
+    EXPECT_TRUE(copy.empty());
+}
+
+TEST(FlatHashMapTest, MatchesUnorderedMap)
+{
+    FlatHashMap<uint64_t, uint64_t, PoorHash> map;
+    std::unordered_map<uint64_t, uint64_t> expected;
+    std::mt19937_64 rng(7);
+    
+    // mixed inserts and erases, so tombstones are made, reused and purged
+    for (int i = 0; i < 50000; i++) {
+        uint64_t key = rng() % 2000;
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(map.erase(key), expected.erase(key));
+        } else {
+            ASSERT_EQ(map.try_emplace(key, i).second, expected.emplace(key, i).second);
+        }
+        ASSERT_EQ(map.size(), expected.size());
+    }
+    
+    for (uint64_t key = 0; key < 2000; key++) {
+        auto it = expected.find(key);
+        if (it == expected.end())
+            ASSERT_EQ(map.find(key), map.end());
+        else
+            ASSERT_EQ(map.at(key), it->second);
+    }
+    
+    size_t visited = 0;
+    for (const auto& value : map) {
+        ASSERT_EQ(expected.at(value.first), value.second);
+        visited++;
+    }
+    EXPECT_EQ(visited, expected.size());
+    EXPECT_LE(map.load_factor(), 0.875);
+}
+
+TEST(FlatHashMapTest, Reserve)
+{
+    FlatHashMap<int, int> map;
+    map.reserve(1000);
+    size_t capacity = map.capacity();
+    EXPECT_GE(capacity * 7 / 8, 1000);
+    
+    for (int i = 0; i < 1000; i++)
+        map[i] = i;
+    EXPECT_EQ(map.capacity(), capacity);
+    
+    // erase everything and refill, the table must not keep growing
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 1000; i++)
+            map.erase(i + round * 1000);
+        for (int i = 0; i < 1000; i++)
+            map[i + (round + 1) * 1000] = i;
+    }
+    EXPECT_EQ(map.size(), 1000);
+    EXPECT_EQ(map.capacity(), capacity);
+}
+
+} // namespace unit_test
+} // namespace btclite
@@ -0,0 +1,118 @@
+#include "prevector.h"
+
+#include <gtest/gtest.h>
+
+#include "stream.h"
+
+
+namespace btclite {
+namespace unit_test {
+
+using Prevector8 = util::Prevector<8, uint8_t>;
+
+TEST(PrevectorTest, Layout)
+{
+    EXPECT_EQ(sizeof(util::Prevector<28, uint8_t>), 32);
+
+    Prevector8 pv;
+    EXPECT_TRUE(pv.empty());
+    EXPECT_TRUE(pv.is_direct());
+    EXPECT_EQ(pv.capacity(), 8);
+    EXPECT_EQ(pv.allocated_memory(), 0);
+}
+
+TEST(PrevectorTest, GrowAndShrink)
+{
+    Prevector8 pv;
+    std::vector<uint8_t> expected;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        pv.push_back(i);
+        expected.push_back(i);
+    }
+    EXPECT_TRUE(pv.is_direct());
+    EXPECT_TRUE(std::equal(pv.begin(), pv.end(), expected.begin(), expected.end()));
+
+    pv.push_back(8);
+    expected.push_back(8);
+    EXPECT_FALSE(pv.is_direct());
+    EXPECT_EQ(pv.size(), 9);
+    EXPECT_GE(pv.capacity(), 9);
+    EXPECT_GT(pv.allocated_memory(), 0);
+    EXPECT_TRUE(std::equal(pv.begin(), pv.end(), expected.begin(), expected.end()));
+    EXPECT_TRUE(std::equal(pv.rbegin(), pv.rend(), expected.rbegin(), expected.rend()));
+
+    pv.resize(3);
+    EXPECT_EQ(pv.size(), 3);
+    EXPECT_EQ(pv.back(), 2);
+    pv.clear();
+    EXPECT_TRUE(pv.empty());
+}
+
+TEST(PrevectorTest, InsertErase)
+{
+    std::vector<uint8_t> bytes(20, 0xab);
+    Prevector8 pv(3, 1);
+
+    pv.insert(pv.begin() + 1, bytes.begin(), bytes.end());
+    ASSERT_EQ(pv.size(), 23);
+    EXPECT_EQ(pv[0], 1);
+    EXPECT_EQ(pv[1], 0xab);
+    EXPECT_EQ(pv[20], 0xab);
+    EXPECT_EQ(pv[21], 1);
+    EXPECT_EQ(pv[22], 1);
+
+    pv.erase(pv.begin() + 1, pv.begin() + 21);
+    EXPECT_EQ(pv, Prevector8(3, 1));
+
+    pv.insert(pv.begin(), 2);
+    EXPECT_EQ(pv.front(), 2);
+    EXPECT_EQ(pv.size(), 4);
+}
+
+TEST(PrevectorTest, CopyMove)
+{
+    std::vector<uint8_t> small(5, 1), large(50, 2);
+
+    for (const auto& bytes : { small, large }) {
+        Prevector8 pv(bytes.begin(), bytes.end());
+        Prevector8 copied(pv);
+        EXPECT_EQ(copied, pv);
+
+        Prevector8 moved(std::move(copied));
+        EXPECT_EQ(moved, pv);
+        EXPECT_TRUE(copied.empty());
+
+        Prevector8 assigned(20, 3);
+        assigned = pv;
+        EXPECT_EQ(assigned, pv);
+        assigned = std::move(moved);
+        EXPECT_EQ(assigned, pv);
+        EXPECT_NE(assigned, Prevector8(bytes.size(), 0));
+    }
+}
+
+TEST(PrevectorTest, Serialize)
+{
+    std::vector<uint8_t> bytes(50);
+    for (size_t i = 0; i < bytes.size(); i++)
+        bytes[i] = static_cast<uint8_t>(i);
+
+    for (size_t size : { 0, 5, 8, 9, 50 }) {
+        Prevector8 pv(bytes.begin(), bytes.begin() + size), pv2(4, 7);
+        std::vector<uint8_t> vec(bytes.begin(), bytes.begin() + size), vec2;
+        util::MemoryStream ms, ms2;
+
+        // same wire format as std::vector
+        ms << pv;
+        ms2 << vec;
+        EXPECT_EQ(ms.Size(), ms2.Size());
+        ms >> pv2;
+        ms2 >> vec2;
+        EXPECT_EQ(pv2, pv);
+        EXPECT_TRUE(std::equal(pv2.begin(), pv2.end(), vec2.begin(), vec2.end()));
+    }
+}
+
+} // namespace unit_test
+} // namespace btclit
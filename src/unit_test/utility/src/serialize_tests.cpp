@@ -1,6 +1,7 @@
 #include "stream.h"
 
 #include <gtest/gtest.h>
+#include <memory_resource>
 
 
 namespace btclite {
@@ -75,6 +76,18 @@ TEST(SerializerTest, SerializeArithmeticVector)
     EXPECT_EQ(finput, foutput);
 }
 
+TEST(SerializerTest, SerializeVarInt)
+{
+    std::vector<uint8_t> input16(0xfff, 0x1), output16;
+    std::vector<uint8_t> input32(0x10000, 0x2), output32;
+    util::MemoryStream ms;
+    
+    ms << input16 << input32;
+    EXPECT_NO_THROW(ms >> output16 >> output32);
+    EXPECT_EQ(input16, output16);
+    EXPECT_EQ(input32, output32);
+}
+
 TEST(SerializerTest, SerializeClassVector)
 {
     std::vector<std::string> input = { "foo", "bar" }, output;
@@ -85,5 +98,40 @@ TEST(SerializerTest, SerializeClassVector)
     EXPECT_EQ(input, output);
 }
 
+namespace {
+
+// One byte, constructed from a memory resource as transactions are.
+struct Byte {
+    explicit Byte(std::pmr::memory_resource *resource) {}
+    
+    template <typename Stream>
+    void Deserialize(Stream& is, bool strict)
+    {
+        if (is.read(reinterpret_cast<char*>(&value), 1) != 1 && strict)
+            throw std::ios_base::failure("end of data");
+    }
+    
+    uint8_t value = 0;
+};
+
+} // namespace
+
+TEST(SerializerTest, DeserializeSharedWithAllocator)
+{
+    using ByteSourceType = util::ByteSource<std::vector<uint8_t> >;
+    // a count of 2^24 and two bytes
+    std::vector<uint8_t> vec = { kVarint32bits, 0x00, 0x00, 0x00, 0x01, 0x11, 0x22 };
+    ByteSourceType byte_source(vec);
+    util::Deserializer<ByteSourceType> deserializer(byte_source);
+    std::vector<std::shared_ptr<const Byte> > out;
+    
+    EXPECT_THROW(deserializer.SerialRead(&out, std::pmr::polymorphic_allocator<Byte>(), true),
+                 std::ios_base::failure);
+    ASSERT_EQ(out.size(), 2);
+    EXPECT_EQ(out[1]->value, 0x22);
+    // not reserved for the count
+    EXPECT_LE(out.capacity(), kMaxBlockSize / sizeof(Byte));
+}
+
 } // namespace unit_test
 } // namespace btclit
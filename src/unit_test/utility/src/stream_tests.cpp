@@ -23,5 +23,42 @@ TEST(MemIOstreamTest, OperatorIO)
     EXPECT_EQ(arr_output, arr_input);
 }
 
+namespace {
+
+class SizedFoo {
+public:
+    size_t SerializedSize() const
+    {
+        return util::VarIntSize(data_.size()) + data_.size();
+    }
+    
+    template <typename Stream>
+    void Serialize(Stream& out) const
+    {
+        util::Serializer<Stream> serializer(out);
+        serializer.SerialWrite(data_);
+    }
+    
+private:
+    std::vector<uint8_t> data_ = std::vector<uint8_t>(1000, 0x1);
+};
+
+} // namespace
+
+TEST(MemIOstreamTest, ReserveSerializedSize)
+{
+    SizedFoo foo;
+    util::MemoryStream ms;
+    
+    ms << foo;
+    EXPECT_EQ(ms.Size(), foo.SerializedSize());
+    EXPECT_EQ(ms.Capacity(), foo.SerializedSize());
+    
+    ms.Clear();
+    ms.Reserve(2 * foo.SerializedSize());
+    ms << foo << foo;
+    EXPECT_EQ(ms.Capacity(), 2 * foo.SerializedSize());
+}
+
 } // namespace unit_test
 } // namespace btclit
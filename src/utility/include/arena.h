@@ -0,0 +1,79 @@
+#ifndef BTCLITE_ARENA_H
+#define BTCLITE_ARENA_H
+
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+
+namespace btclite {
+namespace util {
+
+// Hands out memory from a few large chunks and releases all of it at once
+// when destroyed, deallocate() is a no-op.
+using Arena = std::pmr::monotonic_buffer_resource;
+
+/*
+ * Allocator drawing from a shared Arena. Every copy owns a reference to the
+ * arena, so objects created with std::allocate_shared keep it alive through
+ * their control block: the arena goes away with the last of them.
+ *
+ * Allocation is not thread safe, fill the arena from one thread.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(std::shared_ptr<Arena> arena)
+        : arena_(std::move(arena)) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena_(other.arena()) {}
+
+    //-------------------------------------------------------------------------
+    T *allocate(size_t n)
+    {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        arena_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    //-------------------------------------------------------------------------
+    // For pmr containers nested inside the allocated objects.
+    std::pmr::memory_resource *resource() const
+    {
+        return arena_.get();
+    }
+
+    const std::shared_ptr<Arena>& arena() const
+    {
+        return arena_;
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& b) const
+    {
+        return arena_ == b.arena();
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& b) const
+    {
+        return !(*this == b);
+    }
+
+private:
+    std::shared_ptr<Arena> arena_;
+};
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_ARENA_H
@@ -0,0 +1,326 @@
+#ifndef BTCLITE_ARITH_UINT256_H
+#define BTCLITE_ARITH_UINT256_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "blob.h"
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * Unsigned 256-bit integer of four 64-bit limbs, least significant first.
+ * Fixed width and trivially copyable, arithmetic wraps modulo 2**256 like
+ * the built-in unsigned types. Used for proof-of-work targets and chain work.
+ */
+class ArithUint256 {
+public:
+    static constexpr int kLimbs = 4;
+
+    constexpr ArithUint256()
+        : limbs_{0, 0, 0, 0} {}
+    constexpr ArithUint256(uint64_t value)
+        : limbs_{value, 0, 0, 0} {}
+
+    static constexpr ArithUint256 FromLimbs(const uint64_t (&limbs)[kLimbs])
+    {
+        ArithUint256 ret;
+        for (int i = 0; i < kLimbs; i++)
+            ret.limbs_[i] = limbs[i];
+        return ret;
+    }
+
+    // From and to the little-endian byte order of util::Hash256.
+    static ArithUint256 FromHash256(const Bytes<32>& hash);
+    Bytes<32> ToHash256() const;
+
+    //-------------------------------------------------------------------------
+    constexpr uint64_t limb(int i) const
+    {
+        return limbs_[i];
+    }
+
+    constexpr uint64_t GetLow64() const
+    {
+        return limbs_[0];
+    }
+
+    // Position of the highest set bit plus one, 0 for zero.
+    constexpr unsigned int bits() const
+    {
+        for (int i = kLimbs - 1; i >= 0; i--) {
+            if (limbs_[i])
+                return 64 * i + 64 - __builtin_clzll(limbs_[i]);
+        }
+        return 0;
+    }
+
+    std::string GetHex() const;
+
+    //-------------------------------------------------------------------------
+    constexpr ArithUint256 operator~() const
+    {
+        ArithUint256 ret;
+        for (int i = 0; i < kLimbs; i++)
+            ret.limbs_[i] = ~limbs_[i];
+        return ret;
+    }
+
+    constexpr ArithUint256& operator+=(const ArithUint256& b)
+    {
+        uint64_t carry = 0;
+        for (int i = 0; i < kLimbs; i++) {
+            uint64_t sum = limbs_[i] + b.limbs_[i];
+            uint64_t carry_out = (sum < limbs_[i]);
+            sum += carry;
+            carry_out |= (sum < carry);
+            limbs_[i] = sum;
+            carry = carry_out;
+        }
+        return *this;
+    }
+
+    constexpr ArithUint256& operator-=(const ArithUint256& b)
+    {
+        uint64_t borrow = 0;
+        for (int i = 0; i < kLimbs; i++) {
+            uint64_t diff = limbs_[i] - b.limbs_[i];
+            uint64_t borrow_out = (limbs_[i] < b.limbs_[i]);
+            borrow_out |= (diff < borrow);
+            limbs_[i] = diff - borrow;
+            borrow = borrow_out;
+        }
+        return *this;
+    }
+
+    constexpr ArithUint256& operator<<=(unsigned int shift)
+    {
+        ArithUint256 a(*this);
+        const int k = shift / 64;
+        shift %= 64;
+        for (int i = kLimbs - 1; i >= 0; i--) {
+            uint64_t v = 0;
+            if (i - k >= 0) {
+                v = a.limbs_[i - k] << shift;
+                if (shift && i - k - 1 >= 0)
+                    v |= a.limbs_[i - k - 1] >> (64 - shift);
+            }
+            limbs_[i] = v;
+        }
+        return *this;
+    }
+
+    constexpr ArithUint256& operator>>=(unsigned int shift)
+    {
+        ArithUint256 a(*this);
+        const int k = shift / 64;
+        shift %= 64;
+        for (int i = 0; i < kLimbs; i++) {
+            uint64_t v = 0;
+            if (i + k < kLimbs) {
+                v = a.limbs_[i + k] >> shift;
+                if (shift && i + k + 1 < kLimbs)
+                    v |= a.limbs_[i + k + 1] << (64 - shift);
+            }
+            limbs_[i] = v;
+        }
+        return *this;
+    }
+
+    // Schoolbook long division one 64-bit limb at a time (Knuth, TAOCP 4.3.1
+    // algorithm D): each quotient limb is estimated from the top two limbs of
+    // the remainder and corrected at most twice.
+    constexpr ArithUint256& operator/=(const ArithUint256& b)
+    {
+        const int n = b.used_limbs();
+        if (n == 0)
+            throw std::overflow_error("ArithUint256 division by zero");
+        const int m = used_limbs();
+
+        ArithUint256 quotient;
+        if (n == 1) {
+            Uint128 rem = 0;
+            for (int i = m - 1; i >= 0; i--) {
+                Uint128 num = (rem << 64) | limbs_[i];
+                quotient.limbs_[i] = static_cast<uint64_t>(num / b.limbs_[0]);
+                rem = num % b.limbs_[0];
+            }
+        }
+        else if (m >= n) {
+            // Normalize so that the divisor's top limb has its high bit set.
+            const unsigned int s = __builtin_clzll(b.limbs_[n - 1]);
+            uint64_t vn[kLimbs] = {};
+            uint64_t un[kLimbs + 1] = {};
+            for (int i = n - 1; i > 0; i--)
+                vn[i] = (b.limbs_[i] << s) | (s ? b.limbs_[i - 1] >> (64 - s) : 0);
+            vn[0] = b.limbs_[0] << s;
+            un[m] = s ? limbs_[m - 1] >> (64 - s) : 0;
+            for (int i = m - 1; i > 0; i--)
+                un[i] = (limbs_[i] << s) | (s ? limbs_[i - 1] >> (64 - s) : 0);
+            un[0] = limbs_[0] << s;
+
+            for (int j = m - n; j >= 0; j--) {
+                Uint128 num = (Uint128(un[j + n]) << 64) | un[j + n - 1];
+                Uint128 qhat = num / vn[n - 1];
+                Uint128 rhat = num % vn[n - 1];
+                while ((qhat >> 64) ||
+                        qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+                    qhat--;
+                    rhat += vn[n - 1];
+                    if (rhat >> 64)
+                        break;
+                }
+
+                // un[j..j+n] -= qhat * vn
+                uint64_t carry = 0, borrow = 0;
+                for (int i = 0; i < n; i++) {
+                    Uint128 p = qhat * vn[i] + carry;
+                    carry = static_cast<uint64_t>(p >> 64);
+                    uint64_t lo = static_cast<uint64_t>(p);
+                    uint64_t t = un[i + j] - lo;
+                    uint64_t borrow_out = (un[i + j] < lo) | (t < borrow);
+                    un[i + j] = t - borrow;
+                    borrow = borrow_out;
+                }
+                Uint128 top = Uint128(carry) + borrow;
+                bool negative = un[j + n] < top;
+                un[j + n] -= static_cast<uint64_t>(top);
+
+                // qhat was one too large, add the divisor back.
+                if (negative) {
+                    qhat--;
+                    uint64_t c = 0;
+                    for (int i = 0; i < n; i++) {
+                        Uint128 sum = Uint128(un[i + j]) + vn[i] + c;
+                        un[i + j] = static_cast<uint64_t>(sum);
+                        c = static_cast<uint64_t>(sum >> 64);
+                    }
+                    un[j + n] += c;
+                }
+                quotient.limbs_[j] = static_cast<uint64_t>(qhat);
+            }
+        }
+
+        *this = quotient;
+        return *this;
+    }
+
+    constexpr ArithUint256& operator&=(const ArithUint256& b)
+    {
+        for (int i = 0; i < kLimbs; i++)
+            limbs_[i] &= b.limbs_[i];
+        return *this;
+    }
+
+    constexpr ArithUint256& operator|=(const ArithUint256& b)
+    {
+        for (int i = 0; i < kLimbs; i++)
+            limbs_[i] |= b.limbs_[i];
+        return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    // -1, 0 or 1 as a is below, equal to or above b.
+    friend constexpr int Compare(const ArithUint256& a, const ArithUint256& b)
+    {
+        for (int i = kLimbs - 1; i >= 0; i--) {
+            if (a.limbs_[i] != b.limbs_[i])
+                return a.limbs_[i] < b.limbs_[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    friend constexpr bool operator==(const ArithUint256& a, const ArithUint256& b)
+    {
+        return a.limbs_[0] == b.limbs_[0] && a.limbs_[1] == b.limbs_[1] &&
+               a.limbs_[2] == b.limbs_[2] && a.limbs_[3] == b.limbs_[3];
+    }
+
+    friend constexpr bool operator!=(const ArithUint256& a, const ArithUint256& b)
+    {
+        return !(a == b);
+    }
+
+    friend constexpr bool operator<(const ArithUint256& a, const ArithUint256& b)
+    {
+        return Compare(a, b) < 0;
+    }
+
+    friend constexpr bool operator<=(const ArithUint256& a, const ArithUint256& b)
+    {
+        return Compare(a, b) <= 0;
+    }
+
+    friend constexpr bool operator>(const ArithUint256& a, const ArithUint256& b)
+    {
+        return Compare(a, b) > 0;
+    }
+
+    friend constexpr bool operator>=(const ArithUint256& a, const ArithUint256& b)
+    {
+        return Compare(a, b) >= 0;
+    }
+
+    //-------------------------------------------------------------------------
+    friend constexpr ArithUint256 operator+(ArithUint256 a, const ArithUint256& b)
+    {
+        return a += b;
+    }
+
+    friend constexpr ArithUint256 operator-(ArithUint256 a, const ArithUint256& b)
+    {
+        return a -= b;
+    }
+
+    friend constexpr ArithUint256 operator/(ArithUint256 a, const ArithUint256& b)
+    {
+        return a /= b;
+    }
+
+    friend constexpr ArithUint256 operator&(ArithUint256 a, const ArithUint256& b)
+    {
+        return a &= b;
+    }
+
+    friend constexpr ArithUint256 operator|(ArithUint256 a, const ArithUint256& b)
+    {
+        return a |= b;
+    }
+
+    friend constexpr ArithUint256 operator<<(ArithUint256 a, unsigned int shift)
+    {
+        return a <<= shift;
+    }
+
+    friend constexpr ArithUint256 operator>>(ArithUint256 a, unsigned int shift)
+    {
+        return a >>= shift;
+    }
+
+private:
+    __extension__ typedef unsigned __int128 Uint128;
+
+    uint64_t limbs_[kLimbs];
+
+    // Number of limbs up to and including the highest non-zero one.
+    constexpr int used_limbs() const
+    {
+        int n = kLimbs;
+        while (n > 0 && limbs_[n - 1] == 0)
+            n--;
+        return n;
+    }
+};
+
+static_assert(sizeof(ArithUint256) == 32, "ArithUint256 must be exactly 256 bits");
+static_assert(std::is_trivially_copyable<ArithUint256>::value,
+              "ArithUint256 must be trivially copyable");
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_ARITH_UINT256_H
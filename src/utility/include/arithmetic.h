@@ -5,6 +5,7 @@
 #include <endian.h>
 #include <limits>
 
+#include "arith_uint256.h"
 #include "blob.h"
 #include "util_assert.h"
 
@@ -15,9 +16,11 @@ namespace util {
 using int128_t = boost::multiprecision::int128_t;
 using uint128_t = boost::multiprecision::uint128_t;
 using int256_t = boost::multiprecision::int256_t;
-using uint256_t = boost::multiprecision::uint256_t;
+// Native fixed width, for targets and chain work.
+using uint256_t = ArithUint256;
 
 using Hash256 = Bytes<32>;
+using Hash160 = Bytes<20>;
 
 Hash256 StrToHash256(const std::string& s);
 
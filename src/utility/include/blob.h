@@ -1,6 +1,7 @@
 #ifndef BTCLITE_BLOB_H
 #define BTCLITE_BLOB_H
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <iterator>
@@ -14,6 +15,64 @@ namespace util {
 template <size_t size>
 using Bytes = std::array<uint8_t, size>;
 
+// Non-owning view of a contiguous range, a stand-in for C++20 std::span.
+template <typename T>
+class Span {
+public:
+    constexpr Span() noexcept
+        : data_(nullptr), size_(0) {}
+    constexpr Span(T *data, size_t size) noexcept
+        : data_(data), size_(size) {}
+    
+    //-------------------------------------------------------------------------
+    constexpr T *data() const noexcept
+    {
+        return data_;
+    }
+    
+    constexpr size_t size() const noexcept
+    {
+        return size_;
+    }
+    
+    constexpr bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+    
+    constexpr T *begin() const noexcept
+    {
+        return data_;
+    }
+    
+    constexpr T *end() const noexcept
+    {
+        return data_ + size_;
+    }
+    
+    constexpr T& operator[](size_t pos) const noexcept
+    {
+        return data_[pos];
+    }
+    
+    //-------------------------------------------------------------------------
+    bool operator==(const Span& b) const
+    {
+        return size_ == b.size_ && std::equal(begin(), end(), b.begin());
+    }
+    
+    bool operator!=(const Span& b) const
+    {
+        return !(*this == b);
+    }
+    
+private:
+    T *data_;
+    size_t size_;
+};
+
+using ByteSpan = Span<const uint8_t>;
+
 
 // merge from boost.iostreams example
 // boost.org/doc/libs/1_55_0/libs/iostreams/doc/tutorial/container_sink.html
@@ -79,6 +138,60 @@ std::streamsize ContainerSource<Container, SourceType, CharType>::read(CharType
 template <typename Container>
 using ByteSource = ContainerSource<Container, uint8_t, char>;
 
+// Non-owning source over a contiguous memory range, e.g. the pointer returned
+// by evbuffer_pullup(). Data is read in place, the range must outlive the source.
+template <typename SourceType, typename CharType>
+class SpanSource
+{
+public:
+    SpanSource(const SourceType *data, size_t size)
+        : data_(data), size_(size), position_(0)
+    {
+        static_assert(sizeof(SourceType) == sizeof(CharType), "invalid size");
+    }
+
+    std::streamsize read(CharType *buffer, std::streamsize size);
+
+    const SourceType *data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    size_t remaining() const
+    {
+        return size_ - position_;
+    }
+
+private:
+    const SourceType *data_;
+    size_t size_;
+    size_t position_;
+};
+
+template <typename SourceType, typename CharType>
+std::streamsize SpanSource<SourceType, CharType>::read(CharType *buffer, std::streamsize size)
+{
+    if (position_ > size_)
+        throw std::overflow_error("span source overflow");
+    else if (position_ == size_)
+        return -1;
+
+    auto amount = size_ - position_;
+    auto result = std::min(size, static_cast<std::streamsize>(amount));
+    const auto value = static_cast<size_t>(result);
+    std::memcpy(buffer, data_ + position_, value);
+    position_ += value;
+
+    return result;
+}
+
+using ByteSpanSource = SpanSource<uint8_t, char>;
+
 } // namespace util
 } // namespace btclite
 
@@ -0,0 +1,244 @@
+#ifndef BTCLITE_CHECK_QUEUE_H
+#define BTCLITE_CHECK_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread.h"
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * Runs batches of independent checks, bool operator()() on a default
+ * constructible Check, on a fixed set of worker threads and the thread that
+ * waits for the batch.
+ *
+ * Every thread has its own deque of checks. Add() deals checks out to the
+ * deques; a thread takes from the front of its own and, once that is empty,
+ * steals from the back of the others, so uneven checks even out without one
+ * lock for the whole queue. The first check that fails ends the batch: the
+ * checks left are dropped unrun and Wait() returns false.
+ *
+ * One batch at a time. Add() and Wait() are called from a single thread.
+ */
+template <typename Check>
+class CheckQueue : Uncopyable {
+public:
+    // Workers besides the waiting thread, for as many threads as cores.
+    static size_t DefaultWorkers()
+    {
+        return std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }
+    
+    explicit CheckQueue(size_t workers = DefaultWorkers())
+        : queues_(workers + 1)
+    {
+        for (auto& queue : queues_)
+            queue = std::make_unique<WorkQueue>();
+        for (size_t i = 1; i <= workers; i++)
+            workers_.emplace_back(&CheckQueue::WorkerThread, this, i);
+    }
+    
+    ~CheckQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_cond_.notify_all();
+        for (std::thread& worker : workers_)
+            worker.join();
+    }
+    
+    //-------------------------------------------------------------------------
+    // Queue checks to the batch, workers start on them at once.
+    void Add(std::vector<Check>&& checks)
+    {
+        const size_t count = checks.size();
+        if (count == 0)
+            return;
+    
+        // counted first, a thread may take them as soon as they are in
+        unfinished_.fetch_add(count);
+        queued_.fetch_add(count);
+        // a few checks to one deque in turn, many spread over them all
+        const size_t parts = count < queues_.size() ? 1 : queues_.size();
+        const size_t step = (count + parts - 1) / parts;
+        for (size_t begin = 0; begin < count; begin += step) {
+            WorkQueue& queue = *queues_[next_queue_];
+            next_queue_ = (next_queue_ + 1) % queues_.size();
+    
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (size_t i = begin; i < std::min(begin + step, count); i++)
+                queue.checks.push_back(std::move(checks[i]));
+        }
+    
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        work_cond_.notify_all();
+    }
+    
+    // Run checks on this thread too until the batch is done. True if every
+    // check passed. The queue is ready for the next batch after.
+    bool Wait()
+    {
+        Check check;
+        while (Take(0, &check))
+            Run(&check);
+    
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cond_.wait(lock, [this]() { return unfinished_.load() == 0; });
+    
+        return !failed_.exchange(false);
+    }
+    
+    //-------------------------------------------------------------------------
+    size_t workers() const
+    {
+        return workers_.size();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Check> checks;
+    };
+    
+    // [0] is the waiting thread's
+    std::vector<std::unique_ptr<WorkQueue> > queues_;
+    std::vector<std::thread> workers_;
+    size_t next_queue_ = 0;
+    
+    // checks in the deques, and checks added but not yet run or dropped
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> unfinished_{0};
+    std::atomic<bool> failed_{false};
+    
+    std::mutex mutex_;
+    std::condition_variable work_cond_;
+    std::condition_variable done_cond_;
+    bool stop_ = false;
+    
+    bool Take(size_t self, Check *check)
+    {
+        if (queued_.load() == 0)
+            return false;
+    
+        {
+            WorkQueue& own = *queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.checks.empty()) {
+                *check = std::move(own.checks.front());
+                own.checks.pop_front();
+                queued_.fetch_sub(1);
+                return true;
+            }
+        }
+    
+        // the back holds the checks the owner would get to last
+        for (size_t i = 1; i < queues_.size(); i++) {
+            WorkQueue& victim = *queues_[(self + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.checks.empty()) {
+                *check = std::move(victim.checks.back());
+                victim.checks.pop_back();
+                queued_.fetch_sub(1);
+                return true;
+            }
+        }
+    
+        return false;
+    }
+    
+    void Run(Check *check)
+    {
+        if (!failed_.load(std::memory_order_relaxed) && !(*check)())
+            failed_.store(true);
+    
+        if (unfinished_.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_cond_.notify_all();
+        }
+    }
+    
+    void WorkerThread(size_t self)
+    {
+        SetThreadName("check");
+        Check check;
+        while (true) {
+            if (Take(self, &check)) {
+                Run(&check);
+                continue;
+            }
+    
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cond_.wait(lock, [this]() { return stop_ || queued_.load() > 0; });
+            if (stop_)
+                return;
+        }
+    }
+};
+
+/*
+ * Waits for the batch of a CheckQueue when it goes out of scope, so that an
+ * early return can not leave checks running on data that is gone. With no
+ * queue every check runs as it is added.
+ */
+template <typename Check>
+class CheckQueueControl : Uncopyable {
+public:
+    explicit CheckQueueControl(CheckQueue<Check> *queue)
+        : queue_(queue)
+    {
+    }
+    
+    ~CheckQueueControl()
+    {
+        if (!done_)
+            Wait();
+    }
+    
+    //-------------------------------------------------------------------------
+    void Add(std::vector<Check>&& checks)
+    {
+        if (queue_) {
+            queue_->Add(std::move(checks));
+            return;
+        }
+        for (Check& check : checks)
+            if (!failed_ && !check())
+                failed_ = true;
+    }
+    
+    bool Wait()
+    {
+        done_ = true;
+        if (queue_)
+            return queue_->Wait();
+        return !failed_;
+    }
+    
+    // A check added without a queue has failed already.
+    bool failed() const
+    {
+        return failed_;
+    }
+
+private:
+    CheckQueue<Check> *queue_;
+    bool failed_ = false;
+    bool done_ = false;
+};
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_CHECK_QUEUE_H
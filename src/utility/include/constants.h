@@ -15,6 +15,10 @@ constexpr size_t kHashSize = 32;
 
 constexpr size_t kMaxVardataSize = 0x02000000;
 constexpr size_t kMaxBlockSize = 1000000;
+// BIP141, the stripped size counts kWitnessScaleFactor times toward the weight
+// and witness data once.
+constexpr size_t kMaxBlockWeight = 4000000;
+constexpr size_t kWitnessScaleFactor = 4;
 // Max number of elements in BlockLoactor vector.
 constexpr size_t kMaxBlockLoactorSize = 32;
 // Maximum length of incoming protocol messages (no message over 4 MB is currently acceptable).
@@ -0,0 +1,180 @@
+#ifndef BTCLITE_CUCKOO_CACHE_H
+#define BTCLITE_CUCKOO_CACHE_H
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "arithmetic.h"
+#include "util.h"
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * A fixed-size set of 32-byte keys that are uniformly random already, salted
+ * hashes, for remembering checks that passed. Nothing is ever allocated
+ * after construction; a full cache drops keys to make room for new ones.
+ *
+ * The slots are split into stripes, each with its own mutex, so threads
+ * checking different keys rarely wait on each other. A key's stripe is
+ * picked by one of its words and, within the stripe, it can sit in any of
+ * kWays slots picked by others. A key finding all of them taken moves one
+ * of the occupants to another of its slots, cuckoo style, up to
+ * kMaxMoves times; the key left over at the end is dropped.
+ *
+ * Thread safe.
+ */
+class CuckooCache : Uncopyable {
+public:
+    static constexpr size_t kWays = 4;
+    static constexpr size_t kStripes = 64;
+    static constexpr size_t kMaxMoves = 16;
+    
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;
+        uint64_t evictions = 0;
+    
+        double HitRate() const
+        {
+            return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0;
+        }
+    };
+    
+    // As many keys as fit in max_bytes, at least a few per stripe.
+    explicit CuckooCache(size_t max_bytes)
+        : stripe_slots_(std::max(kWays, max_bytes / sizeof(Hash256) / kStripes)),
+          stripes_(std::make_unique<Stripe[]>(kStripes))
+    {
+        for (size_t i = 0; i < kStripes; i++) {
+            stripes_[i].keys.resize(stripe_slots_);
+            stripes_[i].used.resize(stripe_slots_);
+        }
+    }
+    
+    //-------------------------------------------------------------------------
+    bool Contains(const Hash256& key) const
+    {
+        Stripe& stripe = StripeOf(key);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        for (size_t way = 0; way < kWays; way++) {
+            const size_t slot = SlotOf(key, way);
+            if (stripe.used[slot] && stripe.keys[slot] == key) {
+                stripe.stats.hits++;
+                return true;
+            }
+        }
+        stripe.stats.misses++;
+    
+        return false;
+    }
+    
+    void Insert(const Hash256& key)
+    {
+        Stripe& stripe = StripeOf(key);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        for (size_t way = 0; way < kWays; way++) {
+            const size_t slot = SlotOf(key, way);
+            if (stripe.used[slot] && stripe.keys[slot] == key)
+                return;
+        }
+        stripe.stats.inserts++;
+    
+        Hash256 homeless = key;
+        size_t last_slot = stripe_slots_;
+        for (size_t move = 0; move <= kMaxMoves; move++) {
+            for (size_t way = 0; way < kWays; way++) {
+                const size_t slot = SlotOf(homeless, way);
+                if (!stripe.used[slot]) {
+                    stripe.keys[slot] = homeless;
+                    stripe.used[slot] = 1;
+                    return;
+                }
+            }
+    
+            // every slot taken, push out the key in one of them, not the one
+            // the homeless key was just pushed out of
+            size_t slot = SlotOf(homeless, stripe.next_way++ % kWays);
+            if (slot == last_slot)
+                slot = SlotOf(homeless, stripe.next_way++ % kWays);
+            std::swap(stripe.keys[slot], homeless);
+            last_slot = slot;
+        }
+        stripe.stats.evictions++;
+    }
+    
+    // Forget every key, the counters stay.
+    void Clear()
+    {
+        for (size_t i = 0; i < kStripes; i++) {
+            std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+            std::fill(stripes_[i].used.begin(), stripes_[i].used.end(), 0);
+        }
+    }
+    
+    //-------------------------------------------------------------------------
+    Stats stats() const
+    {
+        Stats total;
+        for (size_t i = 0; i < kStripes; i++) {
+            std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+            total.hits += stripes_[i].stats.hits;
+            total.misses += stripes_[i].stats.misses;
+            total.inserts += stripes_[i].stats.inserts;
+            total.evictions += stripes_[i].stats.evictions;
+        }
+        return total;
+    }
+    
+    size_t capacity() const
+    {
+        return stripe_slots_ * kStripes;
+    }
+
+private:
+    // Counted per stripe, under its lock, so that no counter is shared by
+    // every thread.
+    struct Stripe {
+        std::mutex mutex;
+        std::vector<Hash256> keys;
+        std::vector<uint8_t> used;
+        size_t next_way = 0;
+        Stats stats;
+    };
+    
+    size_t stripe_slots_;
+    std::unique_ptr<Stripe[]> stripes_;
+    
+    static uint32_t Word(const Hash256& key, size_t i)
+    {
+        uint32_t word;
+        std::memcpy(&word, key.data() + 4 * i, sizeof(word));
+        return word;
+    }
+    
+    // a word onto [0, n) without a division
+    static size_t Reduce(uint32_t word, size_t n)
+    {
+        return (static_cast<uint64_t>(word) * n) >> 32;
+    }
+    
+    Stripe& StripeOf(const Hash256& key) const
+    {
+        return stripes_[Reduce(Word(key, kWays), kStripes)];
+    }
+    
+    size_t SlotOf(const Hash256& key, size_t way) const
+    {
+        return Reduce(Word(key, way), stripe_slots_);
+    }
+};
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_CUCKOO_CACHE_H
@@ -0,0 +1,488 @@
+#ifndef BTCLITE_FLAT_HASH_MAP_H
+#define BTCLITE_FLAT_HASH_MAP_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * Open-addressing hash map in the style of Abseil's Swiss tables. Slots come
+ * in groups of 16, each with a control byte holding either empty, deleted,
+ * or the low 7 bits of the key's hash. A lookup hashes once, picks a group
+ * from the remaining bits and matches the tag against all 16 control bytes
+ * at once, so a slot is only read when its tag matches. Groups are probed
+ * quadratically until one with an empty byte ends the search.
+ *
+ * There is no node per element. Any insert that grows the table invalidates
+ * iterators and references, as does reserve(). All bits of the hash are
+ * used, so it must mix well, e.g. a salted SipHash rather than a truncation.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K> >
+class FlatHashMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+
+    template <bool Const>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        Iterator() = default;
+
+        // iterator converts to const_iterator
+        template <bool C = Const, typename = std::enable_if_t<C> >
+        Iterator(const Iterator<false>& it)
+            : ctrl_(it.ctrl_), slot_(it.slot_), end_(it.end_) {}
+
+        reference operator*() const { return *slot_; }
+        pointer operator->() const { return slot_; }
+
+        Iterator& operator++()
+        {
+            ++ctrl_;
+            ++slot_;
+            SkipFree();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const Iterator& b) const { return ctrl_ == b.ctrl_; }
+        bool operator!=(const Iterator& b) const { return ctrl_ != b.ctrl_; }
+
+    private:
+        friend class FlatHashMap;
+        template <bool> friend class Iterator;
+
+        const int8_t *ctrl_ = nullptr;
+        value_type *slot_ = nullptr;
+        const int8_t *end_ = nullptr;
+
+        Iterator(const int8_t *ctrl, value_type *slot, const int8_t *end)
+            : ctrl_(ctrl), slot_(slot), end_(end) {}
+
+        void SkipFree()
+        {
+            while (ctrl_ != end_ && *ctrl_ < 0) {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    static constexpr size_t kGroupWidth = 16;
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(size_t bucket_count, const Hash& hash = Hash(),
+                         const KeyEqual& equal = KeyEqual())
+        : hash_(hash), equal_(equal)
+    {
+        reserve(bucket_count);
+    }
+
+    FlatHashMap(const FlatHashMap& other)
+        : hash_(other.hash_), equal_(other.equal_)
+    {
+        reserve(other.size_);
+        for (const value_type& value : other)
+            insert(value);
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+        : hash_(std::move(other.hash_)), equal_(std::move(other.equal_))
+    {
+        Swap(other);
+    }
+
+    ~FlatHashMap()
+    {
+        DestroyAll();
+        Deallocate(ctrl_, slots_, capacity_);
+    }
+
+    FlatHashMap& operator=(const FlatHashMap& other)
+    {
+        if (this != &other) {
+            FlatHashMap copy(other);
+            Swap(copy);
+            hash_ = copy.hash_;
+            equal_ = copy.equal_;
+        }
+        return *this;
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& other) noexcept
+    {
+        if (this != &other) {
+            Swap(other);
+            std::swap(hash_, other.hash_);
+            std::swap(equal_, other.equal_);
+        }
+        return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    iterator begin()
+    {
+        iterator it(ctrl_, slots_, ctrl_ + capacity_);
+        it.SkipFree();
+        return it;
+    }
+
+    const_iterator begin() const
+    {
+        const_iterator it(ctrl_, slots_, ctrl_ + capacity_);
+        it.SkipFree();
+        return it;
+    }
+
+    iterator end() { return IteratorAt(capacity_); }
+    const_iterator end() const { return IteratorAt(capacity_); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    //-------------------------------------------------------------------------
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+
+    double load_factor() const
+    {
+        return capacity_ ? static_cast<double>(size_) / capacity_ : 0.0;
+    }
+
+    hasher hash_function() const { return hash_; }
+
+    // Bytes of slot and control storage.
+    size_t allocated_memory() const
+    {
+        return capacity_ * (sizeof(value_type) + 1);
+    }
+
+    //-------------------------------------------------------------------------
+    iterator find(const K& key)
+    {
+        return IteratorAt(Find(key));
+    }
+
+    const_iterator find(const K& key) const
+    {
+        return IteratorAt(Find(key));
+    }
+
+    size_t count(const K& key) const
+    {
+        return Find(key) != capacity_;
+    }
+
+    bool contains(const K& key) const
+    {
+        return Find(key) != capacity_;
+    }
+
+    V& at(const K& key)
+    {
+        size_t pos = Find(key);
+        if (pos == capacity_)
+            throw std::out_of_range("FlatHashMap::at");
+        return slots_[pos].second;
+    }
+
+    const V& at(const K& key) const
+    {
+        return const_cast<FlatHashMap*>(this)->at(key);
+    }
+
+    V& operator[](const K& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    //-------------------------------------------------------------------------
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+    {
+        size_t hash = hash_(key);
+        size_t pos = Find(key, hash);
+        if (pos != capacity_)
+            return std::make_pair(IteratorAt(pos), false);
+
+        pos = PrepareInsert(hash);
+        new (slots_ + pos) value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                      std::forward_as_tuple(std::forward<Args>(args)...));
+        return std::make_pair(IteratorAt(pos), true);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return try_emplace(value.first, std::move(value.second));
+    }
+
+    size_t erase(const K& key)
+    {
+        size_t pos = Find(key);
+        if (pos == capacity_)
+            return 0;
+        EraseAt(pos);
+        return 1;
+    }
+
+    void erase(const_iterator it)
+    {
+        EraseAt(it.ctrl_ - ctrl_);
+    }
+
+    void clear()
+    {
+        DestroyAll();
+        std::fill(ctrl_, ctrl_ + capacity_, kEmpty);
+        size_ = 0;
+        growth_left_ = MaxLoad(capacity_);
+    }
+
+    // Make room for n elements without growing again.
+    void reserve(size_t n)
+    {
+        size_t capacity = kGroupWidth;
+        while (MaxLoad(capacity) < n)
+            capacity *= 2;
+        if (capacity > capacity_)
+            Resize(capacity);
+    }
+
+private:
+    static constexpr int8_t kEmpty = -128;
+    static constexpr int8_t kDeleted = -2;
+
+    int8_t *ctrl_ = nullptr;
+    value_type *slots_ = nullptr;
+    size_t capacity_ = 0;
+    size_t size_ = 0;
+    // empty slots that may still be filled before the table must grow
+    size_t growth_left_ = 0;
+    Hash hash_;
+    KeyEqual equal_;
+
+    //-------------------------------------------------------------------------
+    // Keep at least 1/8 of the slots empty so that probing stays short and
+    // always finds an empty group byte to stop at.
+    static size_t MaxLoad(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    static int8_t Tag(size_t hash)
+    {
+        return static_cast<int8_t>(hash & 0x7f);
+    }
+
+    // Bit i set where control byte i of the group equals tag.
+    static uint32_t Match(const int8_t *group, int8_t tag)
+    {
+#if defined(__SSE2__)
+        __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(group));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; i++)
+            mask |= static_cast<uint32_t>(group[i] == tag) << i;
+        return mask;
+#endif
+    }
+
+    // Bit i set where control byte i is empty or deleted, both negative.
+    static uint32_t MatchFree(const int8_t *group)
+    {
+#if defined(__SSE2__)
+        return _mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(group)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < kGroupWidth; i++)
+            mask |= static_cast<uint32_t>(group[i] < 0) << i;
+        return mask;
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    iterator IteratorAt(size_t pos)
+    {
+        return iterator(ctrl_ + pos, slots_ + pos, ctrl_ + capacity_);
+    }
+
+    const_iterator IteratorAt(size_t pos) const
+    {
+        return const_iterator(ctrl_ + pos, slots_ + pos, ctrl_ + capacity_);
+    }
+
+    size_t Find(const K& key) const
+    {
+        return capacity_ ? Find(key, hash_(key)) : capacity_;
+    }
+
+    // Slot holding key, capacity_ if there is none.
+    size_t Find(const K& key, size_t hash) const
+    {
+        if (capacity_ == 0)
+            return capacity_;
+
+        const size_t group_mask = capacity_ / kGroupWidth - 1;
+        const int8_t tag = Tag(hash);
+        size_t group = (hash >> 7) & group_mask;
+        for (size_t probe = 1; ; probe++) {
+            const int8_t *ctrl = ctrl_ + group * kGroupWidth;
+            for (uint32_t match = Match(ctrl, tag); match; match &= match - 1) {
+                size_t pos = group * kGroupWidth + __builtin_ctz(match);
+                if (equal_(slots_[pos].first, key))
+                    return pos;
+            }
+            // an insert would have stopped at this group
+            if (Match(ctrl, kEmpty))
+                return capacity_;
+            group = (group + probe) & group_mask;
+        }
+    }
+
+    // Claim a free slot for a key known to be absent, growing first if
+    // needed. Only the control byte is written.
+    size_t PrepareInsert(size_t hash)
+    {
+        if (growth_left_ == 0) {
+            // many tombstones: clean them up in place rather than grow
+            if (capacity_ && size_ * 32 <= capacity_ * 25)
+                Resize(capacity_);
+            else
+                Resize(capacity_ ? capacity_ * 2 : kGroupWidth);
+        }
+
+        const size_t group_mask = capacity_ / kGroupWidth - 1;
+        size_t group = (hash >> 7) & group_mask;
+        for (size_t probe = 1; ; probe++) {
+            uint32_t free = MatchFree(ctrl_ + group * kGroupWidth);
+            if (free) {
+                size_t pos = group * kGroupWidth + __builtin_ctz(free);
+                if (ctrl_[pos] == kEmpty)
+                    growth_left_--;
+                ctrl_[pos] = Tag(hash);
+                size_++;
+                return pos;
+            }
+            group = (group + probe) & group_mask;
+        }
+    }
+
+    void EraseAt(size_t pos)
+    {
+        slots_[pos].~value_type();
+        size_--;
+
+        // If the group still has an empty byte no probe ever passed over it,
+        // so the slot can go back to empty instead of becoming a tombstone.
+        const int8_t *group = ctrl_ + pos / kGroupWidth * kGroupWidth;
+        if (Match(group, kEmpty)) {
+            ctrl_[pos] = kEmpty;
+            growth_left_++;
+        } else {
+            ctrl_[pos] = kDeleted;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    void Resize(size_t new_capacity)
+    {
+        int8_t *old_ctrl = ctrl_;
+        value_type *old_slots = slots_;
+        size_t old_capacity = capacity_;
+
+        Allocate(new_capacity);
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_ctrl[i] < 0)
+                continue;
+            size_t pos = PrepareInsert(hash_(old_slots[i].first));
+            new (slots_ + pos) value_type(std::move(old_slots[i]));
+            old_slots[i].~value_type();
+        }
+        Deallocate(old_ctrl, old_slots, old_capacity);
+    }
+
+    void Allocate(size_t capacity)
+    {
+        ctrl_ = static_cast<int8_t*>(::operator new(capacity, std::align_val_t(kGroupWidth)));
+        std::fill(ctrl_, ctrl_ + capacity, kEmpty);
+        slots_ = std::allocator<value_type>().allocate(capacity);
+        capacity_ = capacity;
+        size_ = 0;
+        growth_left_ = MaxLoad(capacity);
+    }
+
+    static void Deallocate(int8_t *ctrl, value_type *slots, size_t capacity)
+    {
+        if (capacity == 0)
+            return;
+        ::operator delete(ctrl, std::align_val_t(kGroupWidth));
+        std::allocator<value_type>().deallocate(slots, capacity);
+    }
+
+    void DestroyAll()
+    {
+        if (!std::is_trivially_destructible<value_type>::value) {
+            for (size_t i = 0; i < capacity_; i++) {
+                if (ctrl_[i] >= 0)
+                    slots_[i].~value_type();
+            }
+        }
+    }
+
+    void Swap(FlatHashMap& other) noexcept
+    {
+        std::swap(ctrl_, other.ctrl_);
+        std::swap(slots_, other.slots_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(growth_left_, other.growth_left_);
+    }
+};
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_FLAT_HASH_MAP_H
@@ -0,0 +1,56 @@
+#ifndef BTCLITE_MAPPED_FILE_H
+#define BTCLITE_MAPPED_FILE_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fs.h"
+#include "util.h"
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * A whole file mapped read-only into memory. Pages are read in by the
+ * kernel as they are touched, so opening is cheap however big the file is,
+ * and readers parse records straight out of the page cache.
+ *
+ * A file that is still being appended to can be mapped with room to grow:
+ * the mapping is shared, so data written to the file later shows through it
+ * as long as it lies within the reserved size.
+ */
+class MappedFile : Uncopyable {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    
+    //-------------------------------------------------------------------------
+    // Map the file at path, unmapping any previous one. An empty file maps
+    // to size 0 and a null data pointer. With reserve the mapping covers at
+    // least reserve bytes, and size() is that of the mapping: bytes past
+    // the current end of the file must not be touched.
+    bool Open(const fs::path& path, size_t reserve = 0);
+    void Close();
+    
+    //-------------------------------------------------------------------------
+    const uint8_t *data() const
+    {
+        return data_;
+    }
+    
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_MAPPED_FILE_H
@@ -0,0 +1,340 @@
+#ifndef BTCLITE_PREVECTOR_H
+#define BTCLITE_PREVECTOR_H
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+
+namespace btclite {
+namespace util {
+
+/*
+ * A vector of trivially copyable T that keeps up to N elements inline and
+ * only goes to the heap once it grows past them, so that short byte strings
+ * like scripts need no allocation of their own.
+ *
+ * size_ holds the element count while the elements are inline. Once they
+ * live on the heap it holds the count plus N + 1, which is how the two
+ * layouts are told apart without an extra member.
+ *
+ * Iterators are plain pointers and are invalidated by any operation that
+ * may change the capacity, as with std::vector.
+ */
+template <unsigned int N, typename T, typename Size = uint32_t>
+class Prevector {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "Prevector needs trivially copyable T");
+    static_assert(N > 0, "Prevector needs inline capacity");
+
+    using value_type = T;
+    using size_type = Size;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    Prevector() = default;
+
+    explicit Prevector(size_type n, const T& val = T())
+    {
+        assign(n, val);
+    }
+
+    template <typename InputIt,
+              typename = std::enable_if_t<!std::is_integral<InputIt>::value> >
+    Prevector(InputIt first, InputIt last)
+    {
+        assign(first, last);
+    }
+
+    Prevector(const Prevector& other)
+    {
+        assign(other.begin(), other.end());
+    }
+
+    Prevector(Prevector&& other) noexcept
+        : size_(other.size_), u_(other.u_)
+    {
+        other.size_ = 0;
+    }
+
+    ~Prevector()
+    {
+        if (!is_direct())
+            ::operator delete(u_.indirect.ptr);
+    }
+
+    //-------------------------------------------------------------------------
+    Prevector& operator=(const Prevector& other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    Prevector& operator=(Prevector&& other) noexcept
+    {
+        if (this != &other) {
+            if (!is_direct())
+                ::operator delete(u_.indirect.ptr);
+            size_ = other.size_;
+            u_ = other.u_;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    iterator begin() { return item_ptr(0); }
+    const_iterator begin() const { return item_ptr(0); }
+    iterator end() { return item_ptr(size()); }
+    const_iterator end() const { return item_ptr(size()); }
+
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    //-------------------------------------------------------------------------
+    size_t size() const
+    {
+        return is_direct() ? size_ : size_ - N - 1;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    size_t capacity() const
+    {
+        return is_direct() ? N : u_.indirect.capacity;
+    }
+
+    // True while the elements are stored inline.
+    bool is_direct() const
+    {
+        return size_ <= N;
+    }
+
+    // Heap bytes owned by this container, 0 while inline.
+    size_t allocated_memory() const
+    {
+        return is_direct() ? 0 : sizeof(T) * u_.indirect.capacity;
+    }
+
+    //-------------------------------------------------------------------------
+    T* data() { return item_ptr(0); }
+    const T* data() const { return item_ptr(0); }
+
+    T& operator[](size_type pos) { return *item_ptr(pos); }
+    const T& operator[](size_type pos) const { return *item_ptr(pos); }
+
+    T& front() { return *item_ptr(0); }
+    const T& front() const { return *item_ptr(0); }
+    T& back() { return *item_ptr(size() - 1); }
+    const T& back() const { return *item_ptr(size() - 1); }
+
+    //-------------------------------------------------------------------------
+    void reserve(size_t new_capacity)
+    {
+        if (new_capacity > capacity())
+            change_capacity(new_capacity);
+    }
+
+    void resize(size_t new_size, const T& val = T());
+
+    void clear()
+    {
+        resize(0);
+    }
+
+    void assign(size_t n, const T& val);
+
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last);
+
+    void push_back(const T& val)
+    {
+        size_t new_size = size() + 1;
+        if (new_size > capacity())
+            change_capacity(new_size + (new_size >> 1));
+        *item_ptr(new_size - 1) = val;
+        set_size(new_size);
+    }
+
+    void pop_back()
+    {
+        set_size(size() - 1);
+    }
+
+    iterator insert(const_iterator pos, const T& val);
+
+    // [first, last) must not point into this container.
+    template <typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last);
+
+    iterator erase(const_iterator first, const_iterator last);
+
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+
+    //-------------------------------------------------------------------------
+    bool operator==(const Prevector& b) const
+    {
+        return size() == b.size() && std::equal(begin(), end(), b.begin());
+    }
+
+    bool operator!=(const Prevector& b) const
+    {
+        return !(*this == b);
+    }
+
+    bool operator<(const Prevector& b) const
+    {
+        return std::lexicographical_compare(begin(), end(), b.begin(), b.end());
+    }
+
+private:
+#pragma pack(push, 1)
+    union Storage {
+        T direct[N];
+        struct {
+            T *ptr;
+            size_type capacity;
+        } indirect;
+    };
+#pragma pack(pop)
+
+    size_type size_ = 0;
+    Storage u_;
+
+    //-------------------------------------------------------------------------
+    T* item_ptr(size_t pos)
+    {
+        return is_direct() ? u_.direct + pos : u_.indirect.ptr + pos;
+    }
+
+    const T* item_ptr(size_t pos) const
+    {
+        return is_direct() ? u_.direct + pos : u_.indirect.ptr + pos;
+    }
+
+    void set_size(size_t new_size)
+    {
+        size_ = static_cast<size_type>(is_direct() ? new_size : new_size + N + 1);
+    }
+
+    // Grow to new_capacity, or move back inline if it fits there.
+    void change_capacity(size_t new_capacity);
+};
+
+template <unsigned int N, typename T, typename Size>
+void Prevector<N, T, Size>::change_capacity(size_t new_capacity)
+{
+    size_t cur_size = size();
+
+    if (new_capacity <= N) {
+        if (!is_direct()) {
+            T *indirect = u_.indirect.ptr;
+            std::memcpy(u_.direct, indirect, cur_size * sizeof(T));
+            ::operator delete(indirect);
+            size_ = static_cast<size_type>(cur_size);
+        }
+        return;
+    }
+
+    T *ptr = static_cast<T*>(::operator new(new_capacity * sizeof(T)));
+    std::memcpy(ptr, item_ptr(0), cur_size * sizeof(T));
+    if (!is_direct())
+        ::operator delete(u_.indirect.ptr);
+    u_.indirect.ptr = ptr;
+    u_.indirect.capacity = static_cast<size_type>(new_capacity);
+    size_ = static_cast<size_type>(cur_size + N + 1);
+}
+
+template <unsigned int N, typename T, typename Size>
+void Prevector<N, T, Size>::resize(size_t new_size, const T& val)
+{
+    size_t cur_size = size();
+
+    if (new_size > capacity())
+        change_capacity(new_size);
+    if (new_size > cur_size)
+        std::fill(item_ptr(cur_size), item_ptr(new_size), val);
+    set_size(new_size);
+}
+
+template <unsigned int N, typename T, typename Size>
+void Prevector<N, T, Size>::assign(size_t n, const T& val)
+{
+    set_size(0);
+    resize(n, val);
+}
+
+template <unsigned int N, typename T, typename Size>
+template <typename InputIt>
+void Prevector<N, T, Size>::assign(InputIt first, InputIt last)
+{
+    set_size(0);
+    insert(end(), first, last);
+}
+
+template <unsigned int N, typename T, typename Size>
+typename Prevector<N, T, Size>::iterator
+Prevector<N, T, Size>::insert(const_iterator pos, const T& val)
+{
+    return insert(pos, &val, &val + 1);
+}
+
+template <unsigned int N, typename T, typename Size>
+template <typename InputIt>
+typename Prevector<N, T, Size>::iterator
+Prevector<N, T, Size>::insert(const_iterator pos, InputIt first, InputIt last)
+{
+    size_t offset = pos - begin();
+    size_t cur_size = size();
+    size_t count = std::distance(first, last);
+
+    if (cur_size + count > capacity())
+        change_capacity(std::max(cur_size + count, cur_size + (cur_size >> 1)));
+
+    T *p = item_ptr(offset);
+    std::memmove(p + count, p, (cur_size - offset) * sizeof(T));
+    std::copy(first, last, p);
+    set_size(cur_size + count);
+
+    return p;
+}
+
+template <unsigned int N, typename T, typename Size>
+typename Prevector<N, T, Size>::iterator
+Prevector<N, T, Size>::erase(const_iterator first, const_iterator last)
+{
+    size_t offset = first - begin();
+    size_t count = last - first;
+    size_t cur_size = size();
+
+    T *p = item_ptr(offset);
+    std::memmove(p, p + count, (cur_size - offset - count) * sizeof(T));
+    set_size(cur_size - count);
+
+    return p;
+}
+
+} // namespace util
+} // namespace btclite
+
+#endif // BTCLITE_PREVECTOR_H
@@ -7,9 +7,13 @@
 #include <cstring>
 #include <google/protobuf/repeated_field.h>
 #include <map>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include "constants.h"
 #include "logging.h"
+#include "prevector.h"
 #include "thread.h"
 #include "util_endian.h"
 
@@ -19,6 +23,15 @@ namespace util {
 
 size_t VarIntSize(size_t vec_size);
 
+// true for types exposing size_t SerializedSize() const, used to reserve
+// the exact output size before serializing
+template <typename T, typename = void>
+struct HasSerializedSize : std::false_type {};
+
+template <typename T>
+struct HasSerializedSize<T, std::void_t<decltype(std::declval<const T&>().SerializedSize())> >
+    : std::true_type {};
+
 inline uint64_t DoubleToBinary(double d)
 {
     union {
@@ -73,6 +86,9 @@ public:
         Serialize(obj);
     }
     
+    // serialize variable length integer
+    void SerWriteVarInt(const uint64_t);
+    
 private:
     Stream& stream_;
     
@@ -126,6 +142,16 @@ private:
         }
     }
     
+    // for arithmetic Prevector, e.g. script bytes
+    template <unsigned int N, typename T, typename Size>
+    std::enable_if_t<std::is_arithmetic<T>::value> Serialize(const Prevector<N, T, Size>& in)
+    {
+        SerWriteVarInt(in.size());
+        if (!in.empty()) {
+            stream_.write(reinterpret_cast<const char*>(in.data()), in.size()*sizeof(T));
+        }
+    }
+    
     // for string vector
     void Serialize(const std::vector<std::string>& in)
     {
@@ -135,9 +161,9 @@ private:
         }
     }
     
-    // for class vector
-    template <typename T>
-    std::enable_if_t<std::is_class<T>::value> Serialize(const std::vector<T>& in)
+    // for class vector, also with pmr allocators
+    template <typename T, typename A>
+    std::enable_if_t<std::is_class<T>::value> Serialize(const std::vector<T, A>& in)
     {
         SerWriteVarInt(in.size());
         for (auto it = in.begin(); it != in.end(); it++) {
@@ -152,6 +178,13 @@ private:
         stream_.write(reinterpret_cast<const char*>(in.data()), in.size()*sizeof(T));
     }
     
+    // for shared immutable class, e.g. TransactionRef
+    template <typename T>
+    std::enable_if_t<std::is_class<T>::value> Serialize(const std::shared_ptr<const T>& in)
+    {
+        Serialize(*in);
+    }
+    
     // default to calling member function 
     template <typename T>
     std::enable_if_t<std::is_class<T>::value> Serialize(const T& obj) 
@@ -159,9 +192,6 @@ private:
         obj.Serialize(stream_);
     }
     
-    // serialize variable length integer
-    void SerWriteVarInt(const uint64_t);
-    
     // Lowest-level serialization and conversion.
     template <typename T> void SerWriteData(const T&);
 };
@@ -208,6 +238,17 @@ public:
         return Deserialize(obj);
     }
     
+    // Read shared immutable objects allocated by alloc, each constructed
+    // from alloc.resource() for the containers it holds, e.g. transactions
+    // in a block's arena. args go on to T::Deserialize, e.g. the witness
+    // flag of transactions.
+    template <typename T, typename Alloc, typename... Args>
+    size_t SerialRead(std::vector<std::shared_ptr<const T> > *out, const Alloc& alloc,
+                      Args... args);
+    
+    // deserialize variable length integer
+    uint64_t SerReadVarInt();
+    
 private:
     Stream& stream_;
     
@@ -240,12 +281,17 @@ private:
     size_t Deserialize(std::vector<T> *out, 
                        std::enable_if_t<std::is_arithmetic<T>::value>* = 0); 
     
+    // for arithmetic Prevector
+    template <unsigned int N, typename T, typename Size>
+    size_t Deserialize(Prevector<N, T, Size> *out,
+                       std::enable_if_t<std::is_arithmetic<T>::value>* = 0);
+    
     // for string vector
     size_t Deserialize(std::vector<std::string> *out);
     
-    // for class vector
-    template <typename T> 
-    size_t Deserialize(std::vector<T> *out,
+    // for class vector, also with pmr allocators
+    template <typename T, typename A> 
+    size_t Deserialize(std::vector<T, A> *out,
                        std::enable_if_t<std::is_class<T>::value>* = 0); 
     
     // for integral RepeatedField
@@ -253,16 +299,25 @@ private:
     size_t Deserialize(::google::protobuf::RepeatedField<T> *out,
                        std::enable_if_t<std::is_integral<T>::value>* = 0);
     
-    // default to calling member function
+    // for shared immutable class, e.g. TransactionRef
+    template <typename T>
+    size_t Deserialize(std::shared_ptr<const T> *out,
+                       std::enable_if_t<std::is_class<T>::value>* = 0)
+    {
+        auto obj = std::make_shared<T>();
+        size_t size = Deserialize(obj.get());
+        *out = std::move(obj);
+        return size;
+    }
+    
+    // default to calling member function, the consumed size is unknown here
     template <typename T>
     size_t Deserialize(T *obj, std::enable_if_t<std::is_class<T>::value>* = 0) 
     {
         obj->Deserialize(stream_);
+        return 0;
     }
     
-    // deserialize variable length integer
-    uint64_t SerReadVarInt();
-    
     // Lowest-level deserialization and conversion.
     template <typename T> size_t SerReadData(T*);
 };
@@ -344,6 +399,34 @@ size_t Deserializer<Stream>::Deserialize(std::vector<T> *out,
     return size;
 }
 
+template <typename Stream>
+template <unsigned int N, typename T, typename Size>
+size_t Deserializer<Stream>::Deserialize(Prevector<N, T, Size> *out,
+                                         std::enable_if_t<std::is_arithmetic<T>::value>*)
+{
+    size_t size = 0;
+    uint64_t count = SerReadVarInt();
+    if (count*sizeof(T) > kMaxBlockSize) {
+        BTCLOG(LOG_LEVEL_ERROR) << "vector size larger than max block size";
+        SingletonInterruptor::GetInstance().Interrupt();
+    }
+    size += 1;
+    
+    out->clear();
+    out->resize(count);
+    if (sizeof(T) == 1) {
+        // bytes need no endian conversion, read them in one go
+        if (count > 0)
+            stream_.read(reinterpret_cast<char*>(out->data()), count);
+        return size + count;
+    }
+    for (auto it = out->begin(); it != out->end(); ++it) {
+        size += Deserialize(&(*it));
+    }
+    
+    return size;
+}
+
 template <typename Stream>
 size_t Deserializer<Stream>::Deserialize(std::vector<std::string> *out)
 {
@@ -365,8 +448,8 @@ size_t Deserializer<Stream>::Deserialize(std::vector<std::string> *out)
 }
 
 template <typename Stream>
-template <typename T> 
-size_t Deserializer<Stream>::Deserialize(std::vector<T> *out,
+template <typename T, typename A> 
+size_t Deserializer<Stream>::Deserialize(std::vector<T, A> *out,
                                          std::enable_if_t<std::is_class<T>::value>*)
 {
     uint64_t count = SerReadVarInt();
@@ -385,6 +468,33 @@ size_t Deserializer<Stream>::Deserialize(std::vector<T> *out,
     return size;
 }
 
+template <typename Stream>
+template <typename T, typename Alloc, typename... Args>
+size_t Deserializer<Stream>::SerialRead(std::vector<std::shared_ptr<const T> > *out,
+                                        const Alloc& alloc, Args... args)
+{
+    uint64_t count = SerReadVarInt();
+    size_t size = 1;
+    
+    // Limit the reserve so bogus count value won't cause out of memory, the
+    // rest grows as the objects are read.
+    out->clear();
+    out->reserve(std::min<uint64_t>(count, kMaxBlockSize / sizeof(T)));
+    for (uint64_t i = 0; i < count; i++) {
+        auto obj = std::allocate_shared<T>(alloc, alloc.resource());
+        obj->Deserialize(stream_, args...);
+        out->push_back(std::move(obj));
+        // each takes a byte at least, stop before a bogus count runs on
+        // past the data
+        if (++size > kMaxBlockSize) {
+            BTCLOG(LOG_LEVEL_ERROR) << "vector size larger than max block size";
+            throw std::ios_base::failure("vector size larger than max block size");
+        }
+    }
+    
+    return size;
+}
+
 template <typename Stream>
 template <typename T>
 size_t Deserializer<Stream>::Deserialize(::google::protobuf::RepeatedField<T> *out,
@@ -404,7 +514,7 @@ template <typename Stream>
 uint64_t Deserializer<Stream>::SerReadVarInt()
 {
     uint8_t count;
-    uint64_t varint;
+    uint64_t varint = 0;
     
     SerReadData(&count);
     if (count < kVarint16bits) {
@@ -22,6 +22,9 @@ public:
     MemoryStream& operator<<(const T& obj)
     {
         Serializer<ByteSinkType> serializer(byte_sink_);
+        if constexpr (HasSerializedSize<T>::value) {
+            Reserve(obj.SerializedSize());
+        }
         serializer.SerialWrite(obj);
         return *this;
     }
@@ -37,6 +40,10 @@ public:
     uint8_t *Data();    
     void Clear();    
     size_t Size();
+    size_t Capacity() const;
+    
+    // make room for size more bytes without regrowing on every write
+    void Reserve(size_t size);
     
 private:
     Container vec_;
@@ -11,6 +11,8 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
 #include "util.h"
 
@@ -132,6 +134,29 @@ std::future<typename std::result_of<Func(Args...)>::type> ThreadPool::AddTask(Fu
     return ret;
 }
 
+// Run func(begin, end) over [0, count) in ranges of at least min_range, all
+// but the first as tasks on pool and the first on the calling thread, and
+// wait for them. With no pool or too little work it all runs on the caller.
+template <typename Func>
+void ForEachRange(ThreadPool *pool, size_t count, size_t min_range, const Func& func)
+{
+    if (pool == nullptr || count < 2 * min_range) {
+        func(0, count);
+        return;
+    }
+    
+    const size_t max_tasks = std::max(1u, std::thread::hardware_concurrency());
+    const size_t tasks = std::min(max_tasks, count / min_range);
+    const size_t step = (count + tasks - 1) / tasks;
+    std::vector<std::future<void> > futures;
+    
+    for (size_t begin = step; begin < count; begin += step)
+        futures.push_back(pool->AddTask(func, begin, std::min(begin + step, count)));
+    func(0, std::min(step, count));
+    for (auto& future : futures)
+        future.get();
+}
+
 class SingletonThreadPool : Uncopyable {
 public:
     static ThreadPool& GetInstance();
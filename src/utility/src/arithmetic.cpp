@@ -1,5 +1,7 @@
 #include <arithmetic.h>
 
+#include "util_endian.h"
+
 
 namespace btclite {
 namespace util {
@@ -42,5 +44,31 @@ Hash256 StrToHash256(const std::string& s)
     return result;
 }
 
+ArithUint256 ArithUint256::FromHash256(const Hash256& hash)
+{
+    ArithUint256 result;
+    
+    for (int i = 0; i < kLimbs; i++)
+        result.limbs_[i] = FromLittleEndian<uint64_t>(hash.data() + 8*i);
+    
+    return result;
+}
+
+Hash256 ArithUint256::ToHash256() const
+{
+    Hash256 result;
+    
+    for (int i = 0; i < kLimbs; i++)
+        ToLittleEndian(limbs_[i], result.data() + 8*i);
+    
+    return result;
+}
+
+std::string ArithUint256::GetHex() const
+{
+    Hash256 hash = ToHash256();
+    return EncodeHex(hash.rbegin(), hash.rend());
+}
+
 } // namespace util
 } // namespace btclite
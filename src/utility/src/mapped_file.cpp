@@ -0,0 +1,62 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace btclite {
+namespace util {
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const fs::path& path, size_t reserve)
+{
+    Close();
+    
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    
+    const size_t size = std::max(static_cast<size_t>(st.st_size), reserve);
+    if (size > 0) {
+        void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        // Whole files are read front to back, growing ones wherever their
+        // records are, with the default readahead.
+        if (reserve == 0)
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(addr);
+        size_ = size;
+    }
+    
+    // the mapping outlives the descriptor
+    ::close(fd);
+    
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data_)
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace util
+} // namespace btclite
@@ -24,5 +24,18 @@ size_t MemoryStream::Size()
     return vec_.size();
 }
 
+size_t MemoryStream::Capacity() const
+{
+    return vec_.capacity();
+}
+
+void MemoryStream::Reserve(size_t size)
+{
+    size_t required = vec_.size() + size;
+    if (required > vec_.capacity()) {
+        vec_.reserve(std::max(required, 2 * vec_.capacity()));
+    }
+}
+
 } // namespace util
 } // namespace btclite